@@ -0,0 +1,240 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "AccessPatternParser.h"
+
+#include <google/protobuf/util/json_util.h>
+#include <algorithm>
+#include <octf/utils/Log.h>
+
+namespace octf {
+
+/* Sector size of IO events */
+static constexpr uint64_t SECTOR_SIZE = 512;
+
+/* Streams tracked at once per device */
+static constexpr size_t DEVICE_STREAMS_MAX = 64;
+
+/* Streams tracked at once per file */
+static constexpr size_t FILE_STREAMS_MAX = 4;
+
+/* Files tracked at once, streams of the least recently used file end */
+static constexpr size_t FILES_MAX = 16384;
+
+AccessPatternParser::Device::Device()
+        : name()
+        , streams(DEVICE_STREAMS_MAX)
+        , device()
+        , files() {}
+
+AccessPatternParser::File::File(uint64_t deviceId)
+        : deviceId(deviceId)
+        , streams(FILE_STREAMS_MAX)
+        , lru() {}
+
+AccessPatternParser::AccessPatternParser(const std::string &tracePath,
+                                         bool printIo,
+                                         uint64_t interval,
+                                         const std::string &filter)
+        : FilteredTraceEventHandler(tracePath, filter)
+        , m_printIo(printIo)
+        , m_interval(interval * 1000ULL * 1000 * 1000)
+        , m_devices()
+        , m_files()
+        , m_filesLru()
+        , m_ios()
+        , m_firstTimestamp(0)
+        , m_hasFirstTimestamp(false) {}
+
+void AccessPatternParser::addIo(Statistics &stats,
+                                AccessClass accessClass,
+                                uint64_t bytes) {
+    stats.ios[accessClass]++;
+    stats.bytes[accessClass] += bytes;
+}
+
+void AccessPatternParser::handleFilteredEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    const auto &header = traceEvent->header();
+
+    if (traceEvent->has_devicedescription()) {
+        const auto &desc = traceEvent->devicedescription();
+        m_devices[desc.id()].name = desc.name();
+    } else if (traceEvent->has_io()) {
+        const auto &event = traceEvent->io();
+        if (!event.len()) {
+            // Flush
+            return;
+        }
+
+        if (!m_hasFirstTimestamp) {
+            m_firstTimestamp = header.timestamp();
+            m_hasFirstTimestamp = true;
+        }
+
+        PendingIo io = {};
+        io.sid = header.sid();
+        io.timestamp = header.timestamp();
+        io.deviceId = event.deviceid();
+        io.lba = event.lba();
+        io.len = event.len();
+        io.operation = event.operation();
+
+        auto &device = m_devices[io.deviceId];
+        io.deviceClass = device.streams.classify(io.operation, io.lba, io.len,
+                                                 io.timestamp);
+
+        uint64_t bytes = io.len * SECTOR_SIZE;
+        addIo(device.device, io.deviceClass, bytes);
+
+        uint64_t timestamp = std::max(io.timestamp, m_firstTimestamp);
+        auto &interval =
+                device.device.intervals[(timestamp - m_firstTimestamp) /
+                                        m_interval];
+        if (interval.empty()) {
+            interval.resize(StreamDetector::AccessClassCount);
+        }
+        interval[io.deviceClass] += bytes;
+
+        if (event.id()) {
+            m_ios[event.id()] = io;
+        } else if (m_printIo) {
+            printIo(io);
+        }
+    } else if (traceEvent->has_filesystemmeta()) {
+        handleFsMeta(traceEvent->filesystemmeta());
+    } else if (traceEvent->has_iocompletion()) {
+        auto iter = m_ios.find(traceEvent->iocompletion().refsid());
+        if (iter == m_ios.end()) {
+            return;
+        }
+
+        if (m_printIo) {
+            printIo(iter->second);
+        }
+        m_ios.erase(iter);
+    }
+}
+
+void AccessPatternParser::handleFsMeta(
+        const proto::trace::EventIoFilesystemMeta &meta) {
+    auto iter = m_ios.find(meta.refsid());
+    if (iter == m_ios.end()) {
+        return;
+    }
+    auto &io = iter->second;
+
+    FileKey key(meta.fileid().partitionid(), meta.fileid().id());
+    auto &streams = getFileStreams(key, io.deviceId);
+
+    io.fileClass = streams.classify(io.operation, meta.fileoffset(), io.len,
+                                    io.timestamp);
+    io.hasFileClass = true;
+    addIo(m_devices[io.deviceId].files, io.fileClass, io.len * SECTOR_SIZE);
+}
+
+StreamDetector &AccessPatternParser::getFileStreams(const FileKey &key,
+                                                    uint64_t deviceId) {
+    auto iter = m_files.find(key);
+    if (iter != m_files.end()) {
+        m_filesLru.splice(m_filesLru.begin(), m_filesLru, iter->second.lru);
+        return iter->second.streams;
+    }
+
+    if (m_files.size() >= FILES_MAX) {
+        auto lru = m_files.find(m_filesLru.back());
+        endFile(lru->second);
+        m_files.erase(lru);
+        m_filesLru.pop_back();
+    }
+
+    m_filesLru.push_front(key);
+    iter = m_files.emplace(key, File(deviceId)).first;
+    iter->second.lru = m_filesLru.begin();
+    return iter->second.streams;
+}
+
+void AccessPatternParser::endFile(File &file) {
+    file.streams.finish();
+
+    auto &stats = m_devices[file.deviceId].files;
+    stats.sequentialStreams.merge(file.streams.getSequentialStreams());
+    stats.stridedStreams.merge(file.streams.getStridedStreams());
+}
+
+void AccessPatternParser::printIo(const PendingIo &io) const {
+    proto::IoAccessPattern result;
+    result.set_sid(io.sid);
+    result.set_timestamp(io.timestamp);
+    result.set_deviceid(io.deviceId);
+    result.set_lba(io.lba);
+    result.set_len(io.len);
+    result.set_operation(proto::trace::IoType_Name(io.operation));
+    result.set_deviceclass(StreamDetector::getName(io.deviceClass));
+    if (io.hasFileClass) {
+        result.set_fileclass(StreamDetector::getName(io.fileClass));
+    }
+
+    std::string json;
+    google::protobuf::util::MessageToJsonString(result, &json);
+    log::cout << json << std::endl;
+}
+
+void AccessPatternParser::fillStatistics(
+        const Statistics &stats,
+        const StreamDetector *streams,
+        proto::AccessPatternStatistics *result) const {
+    auto fillCounts = [](const uint64_t *values,
+                         proto::AccessClassCounts *counts) {
+        counts->set_sequential(values[StreamDetector::Sequential]);
+        counts->set_strided(values[StreamDetector::Strided]);
+        counts->set_random(values[StreamDetector::Random]);
+    };
+
+    fillCounts(stats.ios, result->mutable_ios());
+    fillCounts(stats.bytes, result->mutable_bytes());
+
+    StreamLengths sequential = stats.sequentialStreams;
+    StreamLengths strided = stats.stridedStreams;
+    if (streams) {
+        sequential.merge(streams->getSequentialStreams());
+        strided.merge(streams->getStridedStreams());
+        result->set_maxactivestreams(streams->getMaxActiveStreams());
+    }
+    sequential.fill(result->mutable_sequentialstreams());
+    strided.fill(result->mutable_stridedstreams());
+
+    for (const auto &entry : stats.intervals) {
+        auto interval = result->add_intervals();
+        interval->set_start(entry.first * m_interval);
+        fillCounts(entry.second.data(), interval->mutable_bytes());
+    }
+}
+
+void AccessPatternParser::getSummary(proto::AccessPatternSummary *summary) {
+    summary->Clear();
+    summary->set_interval(m_interval);
+
+    // Streams in progress end with the trace
+    for (auto &entry : m_files) {
+        endFile(entry.second);
+    }
+    m_files.clear();
+    m_filesLru.clear();
+
+    for (auto &entry : m_devices) {
+        auto &device = entry.second;
+        device.streams.finish();
+
+        auto result = summary->add_devices();
+        result->set_id(entry.first);
+        result->set_name(device.name);
+        fillStatistics(device.device, &device.streams,
+                       result->mutable_device());
+        fillStatistics(device.files, nullptr, result->mutable_files());
+    }
+}
+
+}  // namespace octf
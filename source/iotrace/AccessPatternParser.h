@@ -0,0 +1,155 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_ACCESSPATTERNPARSER_H
+#define SOURCE_USERSPACE_ACCESSPATTERNPARSER_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <octf/proto/trace.pb.h>
+#include "FilteredTraceEventHandler.h"
+#include "InterfaceTraceExtensionParsing.pb.h"
+#include "StreamDetector.h"
+
+namespace octf {
+
+/**
+ * @brief Classifies IOs as sequential, strided or random, on devices by LBA
+ * and in files by file offset
+ *
+ * The trace is parsed in a single pass with bounded state: a fixed number of
+ * streams is tracked per device, and per file for a fixed number of recently
+ * accessed files. Only bytes per access class over time grow with the length
+ * of the trace.
+ */
+class AccessPatternParser : public FilteredTraceEventHandler {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param printIo Print access class of each IO
+     * @param interval Length of intervals of bytes over time in seconds
+     * @param filter Filter expression of IOs, see IoFilter
+     */
+    AccessPatternParser(const std::string &tracePath,
+                        bool printIo,
+                        uint64_t interval,
+                        const std::string &filter);
+    virtual ~AccessPatternParser() = default;
+
+    void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) override;
+
+    /**
+     * @brief Fills access patterns of devices, call after processEvents()
+     */
+    void getSummary(proto::AccessPatternSummary *summary);
+
+private:
+    typedef StreamDetector::AccessClass AccessClass;
+
+    /** IO queued and not completed yet */
+    struct PendingIo {
+        uint64_t sid;
+        uint64_t timestamp;
+        uint64_t deviceId;
+        uint64_t lba;
+        uint32_t len;
+        proto::trace::IoType operation;
+        AccessClass deviceClass;
+        bool hasFileClass;
+        AccessClass fileClass;
+    };
+
+    struct Statistics {
+        Statistics()
+                : ios()
+                , bytes()
+                , sequentialStreams()
+                , stridedStreams()
+                , intervals() {}
+
+        /** Indexed by access class */
+        uint64_t ios[StreamDetector::AccessClassCount];
+        uint64_t bytes[StreamDetector::AccessClassCount];
+        /** Streams of files already evicted */
+        StreamLengths sequentialStreams;
+        StreamLengths stridedStreams;
+        /** Bytes per access class keyed by index of the interval */
+        std::map<uint64_t, std::vector<uint64_t>> intervals;
+    };
+
+    struct Device {
+        Device();
+
+        std::string name;
+        StreamDetector streams;
+        Statistics device;
+        Statistics files;
+    };
+
+    /** Partition and ID of the file */
+    typedef std::pair<uint64_t, uint64_t> FileKey;
+
+    struct FileKeyHash {
+        size_t operator()(const FileKey &key) const {
+            return std::hash<uint64_t>()(key.first) ^
+                   (std::hash<uint64_t>()(key.second) << 1);
+        }
+    };
+
+    struct File {
+        File(uint64_t deviceId);
+
+        uint64_t deviceId;
+        StreamDetector streams;
+        /** Position in the list of files, recently used first */
+        std::list<FileKey>::iterator lru;
+    };
+
+    void handleFsMeta(const proto::trace::EventIoFilesystemMeta &meta);
+
+    /**
+     * @return Streams of the file, evicting the least recently used file if
+     * there are too many
+     */
+    StreamDetector &getFileStreams(const FileKey &key, uint64_t deviceId);
+
+    /**
+     * @brief Counts streams of the file into its device, e.g. when the file
+     * is evicted
+     */
+    void endFile(File &file);
+
+    static void addIo(Statistics &stats,
+                      AccessClass accessClass,
+                      uint64_t bytes);
+
+    void printIo(const PendingIo &io) const;
+
+    void fillStatistics(const Statistics &stats,
+                        const StreamDetector *streams,
+                        proto::AccessPatternStatistics *result) const;
+
+private:
+    const bool m_printIo;
+    /** Length of intervals in ns */
+    const uint64_t m_interval;
+    std::map<uint64_t, Device> m_devices;
+    std::unordered_map<FileKey, File, FileKeyHash> m_files;
+    std::list<FileKey> m_filesLru;
+    /** IOs in flight keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_ios;
+    uint64_t m_firstTimestamp;
+    bool m_hasFirstTimestamp;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_ACCESSPATTERNPARSER_H
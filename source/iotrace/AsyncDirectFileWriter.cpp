@@ -0,0 +1,303 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "AsyncDirectFileWriter.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+
+namespace octf {
+
+/** Size of a single write */
+static constexpr uint64_t ASYNC_WRITER_BUFFER_SIZE = 1024 * 1024;
+
+/** Alignment of buffers, file offsets and write sizes required by O_DIRECT */
+static constexpr uint64_t ASYNC_WRITER_ALIGNMENT = 4096;
+
+static constexpr uint64_t ASYNC_WRITER_MIN_BUFFERS = 2;
+
+static constexpr uint64_t ASYNC_WRITER_MAX_BUFFERS = 64;
+
+static uint64_t alignUp(uint64_t size) {
+    return (size + ASYNC_WRITER_ALIGNMENT - 1) & ~(ASYNC_WRITER_ALIGNMENT - 1);
+}
+
+static uint64_t elapsedNs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - since)
+            .count();
+}
+
+AsyncDirectFileWriter::AsyncDirectFileWriter(uint64_t memoryLimit)
+        : m_bufferCount(std::min(
+                  std::max(memoryLimit / ASYNC_WRITER_BUFFER_SIZE,
+                           ASYNC_WRITER_MIN_BUFFERS),
+                  ASYNC_WRITER_MAX_BUFFERS))
+        , m_buffers()
+        , m_current(0)
+        , m_ctx(0)
+        , m_fd(-1)
+        , m_offset(0)
+        , m_size(0)
+        , m_failed(false)
+        , m_stats() {}
+
+AsyncDirectFileWriter::~AsyncDirectFileWriter() {
+    close();
+    release();
+}
+
+void AsyncDirectFileWriter::allocate() {
+    if (!m_buffers.empty()) {
+        return;
+    }
+
+    if (syscall(SYS_io_setup, m_bufferCount, &m_ctx)) {
+        m_ctx = 0;
+        throw Exception("Cannot create AIO context, " +
+                        std::string(std::strerror(errno)));
+    }
+
+    m_buffers.resize(m_bufferCount);
+    for (auto &buffer : m_buffers) {
+        void *data = nullptr;
+        if (posix_memalign(&data, ASYNC_WRITER_ALIGNMENT,
+                           ASYNC_WRITER_BUFFER_SIZE)) {
+            release();
+            throw Exception("Cannot allocate write buffers");
+        }
+
+        buffer.data = static_cast<char *>(data);
+        buffer.used = 0;
+        buffer.inFlight = false;
+    }
+}
+
+void AsyncDirectFileWriter::release() {
+    if (m_ctx) {
+        syscall(SYS_io_destroy, m_ctx);
+        m_ctx = 0;
+    }
+
+    for (auto &buffer : m_buffers) {
+        free(buffer.data);
+    }
+    m_buffers.clear();
+}
+
+void AsyncDirectFileWriter::open(int fd) {
+    close();
+    allocate();
+
+    m_fd = fd;
+    m_current = 0;
+    m_offset = 0;
+    m_size = 0;
+    m_failed = false;
+    m_stats = AsyncWriterStats();
+
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_DIRECT)) {
+        log::cerr << "Direct IO not supported, using buffered writes"
+                  << std::endl;
+    }
+
+    for (auto &buffer : m_buffers) {
+        buffer.used = 0;
+    }
+}
+
+bool AsyncDirectFileWriter::write(const void *data, uint64_t size) {
+    auto src = static_cast<const char *>(data);
+
+    while (size && !m_failed) {
+        Buffer &buffer = m_buffers[m_current];
+        uint64_t chunk = std::min(size, ASYNC_WRITER_BUFFER_SIZE - buffer.used);
+
+        std::memcpy(buffer.data + buffer.used, src, chunk);
+        buffer.used += chunk;
+        src += chunk;
+        size -= chunk;
+        m_size += chunk;
+
+        if (buffer.used == ASYNC_WRITER_BUFFER_SIZE) {
+            // Submit full buffer and continue with the next one
+            if (submit(buffer)) {
+                m_current = (m_current + 1) % m_bufferCount;
+                acquire(m_buffers[m_current]);
+            }
+        }
+    }
+
+    return !m_failed;
+}
+
+bool AsyncDirectFileWriter::submit(Buffer &buffer) {
+    uint64_t size = alignUp(buffer.used);
+    std::memset(buffer.data + buffer.used, 0, size - buffer.used);
+
+    std::memset(&buffer.cb, 0, sizeof(buffer.cb));
+    buffer.cb.aio_data = &buffer - &m_buffers[0];
+    buffer.cb.aio_lio_opcode = IOCB_CMD_PWRITE;
+    buffer.cb.aio_fildes = m_fd;
+    buffer.cb.aio_buf = reinterpret_cast<uintptr_t>(buffer.data);
+    buffer.cb.aio_nbytes = size;
+    buffer.cb.aio_offset = m_offset;
+
+    struct iocb *cbs[1] = {&buffer.cb};
+    buffer.submitTime = std::chrono::steady_clock::now();
+
+    long result;
+    do {
+        result = syscall(SYS_io_submit, m_ctx, 1, cbs);
+    } while (result < 0 && errno == EINTR);
+
+    if (result != 1) {
+        log::cerr << "Cannot submit write, " << std::strerror(errno)
+                  << std::endl;
+        m_failed = true;
+        return false;
+    }
+
+    buffer.inFlight = true;
+    m_offset += size;
+
+    // Collect completed writes without waiting
+    reap(0);
+    return !m_failed;
+}
+
+bool AsyncDirectFileWriter::reap(long minEvents) {
+    struct io_event events[ASYNC_WRITER_MAX_BUFFERS];
+    struct timespec noWait = {};
+
+    long result;
+    do {
+        result = syscall(SYS_io_getevents, m_ctx, minEvents, m_bufferCount,
+                         events, minEvents ? nullptr : &noWait);
+    } while (result < 0 && errno == EINTR);
+
+    if (result < 0) {
+        log::cerr << "Cannot get write completions, " << std::strerror(errno)
+                  << std::endl;
+        m_failed = true;
+        return false;
+    }
+
+    for (long i = 0; i < result; i++) {
+        Buffer &buffer = m_buffers[events[i].data];
+        uint64_t latency = elapsedNs(buffer.submitTime);
+
+        if (events[i].res != static_cast<int64_t>(buffer.cb.aio_nbytes)) {
+            if (!m_failed) {
+                log::cerr << "Cannot write file, "
+                          << (events[i].res < 0
+                                      ? std::strerror(-events[i].res)
+                                      : "short write")
+                          << std::endl;
+            }
+            m_failed = true;
+        } else {
+            m_stats.writes++;
+            m_stats.bytes += buffer.cb.aio_nbytes;
+            m_stats.totalLatency += latency;
+            m_stats.maxLatency = std::max(m_stats.maxLatency, latency);
+        }
+
+        buffer.inFlight = false;
+        buffer.used = 0;
+    }
+
+    return true;
+}
+
+bool AsyncDirectFileWriter::acquire(Buffer &buffer) {
+    if (!buffer.inFlight) {
+        return !m_failed;
+    }
+
+    // All buffers in flight, wait until the oldest write completes
+    auto start = std::chrono::steady_clock::now();
+    m_stats.stalls++;
+
+    while (buffer.inFlight) {
+        if (!reap(1)) {
+            break;
+        }
+    }
+
+    m_stats.stallTime += elapsedNs(start);
+    return !m_failed;
+}
+
+bool AsyncDirectFileWriter::waitAll() {
+    for (auto &buffer : m_buffers) {
+        while (buffer.inFlight) {
+            if (!reap(1)) {
+                // Completions cannot be collected, destroying AIO context
+                // waits for the remaining writes
+                release();
+                return false;
+            }
+        }
+    }
+
+    return !m_failed;
+}
+
+bool AsyncDirectFileWriter::finish() {
+    if (m_fd < 0 || m_buffers.empty()) {
+        return false;
+    }
+
+    Buffer &buffer = m_buffers[m_current];
+    if (!m_failed && buffer.used) {
+        // The last buffer is padded to the alignment, then the file is
+        // truncated to its size
+        submit(buffer);
+    }
+
+    waitAll();
+
+    if (!m_failed && ::ftruncate(m_fd, m_size)) {
+        log::cerr << "Cannot truncate file, " << std::strerror(errno)
+                  << std::endl;
+        m_failed = true;
+    }
+
+    if (!m_failed && ::fdatasync(m_fd)) {
+        log::cerr << "Cannot sync file, " << std::strerror(errno)
+                  << std::endl;
+        m_failed = true;
+    }
+
+    return !m_failed;
+}
+
+void AsyncDirectFileWriter::close() {
+    if (m_fd < 0) {
+        return;
+    }
+
+    // Buffers cannot be reused until writes in flight complete
+    waitAll();
+
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+const AsyncWriterStats &AsyncDirectFileWriter::getStats() const {
+    return m_stats;
+}
+
+}  // namespace octf
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_ASYNCDIRECTFILEWRITER_H
+#define SOURCE_USERSPACE_ASYNCDIRECTFILEWRITER_H
+
+#include <linux/aio_abi.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <octf/utils/NonCopyable.h>
+
+namespace octf {
+
+/**
+ * @brief Statistics of writes done by AsyncDirectFileWriter
+ */
+struct AsyncWriterStats {
+    AsyncWriterStats()
+            : writes(0)
+            , bytes(0)
+            , totalLatency(0)
+            , maxLatency(0)
+            , stalls(0)
+            , stallTime(0) {}
+
+    /** Number of completed writes */
+    uint64_t writes;
+
+    /** Number of bytes written, including alignment padding */
+    uint64_t bytes;
+
+    /** Sum of write latencies (in ns) */
+    uint64_t totalLatency;
+
+    /** Maximum write latency (in ns) */
+    uint64_t maxLatency;
+
+    /** Number of times all buffers were in flight and the writer waited */
+    uint64_t stalls;
+
+    /** Total time (in ns) of waiting for a free buffer */
+    uint64_t stallTime;
+
+    /**
+     * @brief Adds statistics of writes of another file
+     */
+    void add(const AsyncWriterStats &other) {
+        writes += other.writes;
+        bytes += other.bytes;
+        totalLatency += other.totalLatency;
+        maxLatency = std::max(maxLatency, other.maxLatency);
+        stalls += other.stalls;
+        stallTime += other.stallTime;
+    }
+};
+
+/**
+ * @brief Sequential file writer using Linux native AIO and O_DIRECT
+ *
+ * Data is gathered in aligned buffers, and each full buffer is submitted as
+ * an asynchronous write, while the next one is being filled. At least two
+ * buffers are used (double buffering), more if the memory limit allows, so
+ * several writes are in flight. Writes bypass the page cache, so the writer
+ * adds no writeback and memory pressure to the traced system.
+ *
+ * If the file system does not support O_DIRECT, buffered writes are used.
+ *
+ * Trace files of trace queues (see DirectFileSerializer) and the trace
+ * extension file are written this way.
+ *
+ * @note This class is not thread safe.
+ */
+class AsyncDirectFileWriter : public NonCopyable {
+public:
+    /**
+     * @param memoryLimit Maximum memory (in bytes) used for buffers
+     */
+    AsyncDirectFileWriter(uint64_t memoryLimit);
+
+    virtual ~AsyncDirectFileWriter();
+
+    /**
+     * @brief Starts writing the file from its beginning
+     *
+     * @param fd File descriptor of the file opened for writing, owned by the
+     * writer from now on
+     *
+     * @throws Exception if buffers cannot be allocated, the file descriptor
+     * is not taken then
+     */
+    void open(int fd);
+
+    /**
+     * @brief Appends data to the file
+     *
+     * @retval true Data buffered or submitted for writing
+     * @retval false Write error, the file is incomplete
+     */
+    bool write(const void *data, uint64_t size);
+
+    /**
+     * @brief Writes buffered data, waits for all writes and syncs the file
+     *
+     * @retval true All data written
+     * @retval false Write error, the file is incomplete
+     */
+    bool finish();
+
+    /**
+     * @brief Closes the file without waiting for buffered data
+     */
+    void close();
+
+    /**
+     * @return Statistics of writes since the file was opened
+     */
+    const AsyncWriterStats &getStats() const;
+
+private:
+    struct Buffer {
+        char *data;
+        uint64_t used;
+        bool inFlight;
+        struct iocb cb;
+        std::chrono::steady_clock::time_point submitTime;
+    };
+
+    void allocate();
+
+    void release();
+
+    bool submit(Buffer &buffer);
+
+    /**
+     * @brief Collects completed writes
+     *
+     * @param minEvents Minimum number of completions to wait for
+     *
+     * @retval false Completions cannot be collected
+     */
+    bool reap(long minEvents);
+
+    bool acquire(Buffer &buffer);
+
+    bool waitAll();
+
+private:
+    const uint64_t m_bufferCount;
+    std::vector<Buffer> m_buffers;
+    uint64_t m_current;
+    aio_context_t m_ctx;
+    int m_fd;
+    /** File offset of the next submitted buffer */
+    uint64_t m_offset;
+    /** Size of data appended to the file */
+    uint64_t m_size;
+    bool m_failed;
+    AsyncWriterStats m_stats;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_ASYNCDIRECTFILEWRITER_H
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "CpuTopology.h"
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace octf {
+namespace cputopology {
+
+static constexpr const char *CPU_SYSFS_PATH = "/sys/devices/system/cpu";
+
+std::vector<int> getOnlineCpus() {
+    std::vector<int> cpus;
+    std::ifstream file(std::string(CPU_SYSFS_PATH) + "/online");
+    std::string list;
+
+    // CPU list format, e.g. "0-3,8,10-11"
+    if (file >> list) {
+        std::stringstream ranges(list);
+        std::string range;
+
+        while (std::getline(ranges, range, ',')) {
+            int first = -1, last = -1;
+            auto count = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+            if (count < 1 || first < 0) {
+                continue;
+            }
+            if (count < 2 || last < first) {
+                last = first;
+            }
+
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+
+    if (cpus.empty()) {
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long cpu = 0; cpu < count; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+int getCpuNode(int cpu) {
+    auto path = std::string(CPU_SYSFS_PATH) + "/cpu" + std::to_string(cpu);
+    DIR *dir = ::opendir(path.c_str());
+    if (!dir) {
+        return -1;
+    }
+
+    // The CPU directory contains link "node<N>" to its NUMA node
+    int node = -1;
+    struct dirent *entry;
+    while ((entry = ::readdir(dir))) {
+        if (1 == std::sscanf(entry->d_name, "node%d", &node)) {
+            break;
+        }
+    }
+
+    ::closedir(dir);
+    return node;
+}
+
+NumaNodePreference::NumaNodePreference(int node)
+        : m_set(false)
+        , m_oldMode(MPOL_DEFAULT)
+        , m_oldMask() {
+    constexpr int bits = sizeof(unsigned long) * 8;
+    if (node < 0 || node >= NODE_MASK_SIZE * bits) {
+        return;
+    }
+
+    if (syscall(SYS_get_mempolicy, &m_oldMode, m_oldMask,
+                NODE_MASK_SIZE * bits, nullptr, 0)) {
+        return;
+    }
+
+    unsigned long mask[NODE_MASK_SIZE] = {};
+    mask[node / bits] = 1UL << (node % bits);
+    m_set = 0 == syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask,
+                         NODE_MASK_SIZE * bits);
+}
+
+NumaNodePreference::~NumaNodePreference() {
+    if (m_set) {
+        constexpr int bits = sizeof(unsigned long) * 8;
+        syscall(SYS_set_mempolicy, m_oldMode,
+                m_oldMode == MPOL_DEFAULT ? nullptr : m_oldMask,
+                m_oldMode == MPOL_DEFAULT ? 0 : NODE_MASK_SIZE * bits);
+    }
+}
+
+}  // namespace cputopology
+}  // namespace octf
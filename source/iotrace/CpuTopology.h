@@ -0,0 +1,49 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_CPUTOPOLOGY_H
+#define SOURCE_USERSPACE_CPUTOPOLOGY_H
+
+#include <vector>
+#include <octf/utils/NonCopyable.h>
+
+namespace octf {
+namespace cputopology {
+
+/**
+ * @return IDs of online CPUs in ascending order
+ */
+std::vector<int> getOnlineCpus();
+
+/**
+ * @return NUMA node of the CPU, -1 if unknown
+ */
+int getCpuNode(int cpu);
+
+/**
+ * @brief Prefers allocating memory of the calling thread on the NUMA node
+ * within the scope of the object
+ *
+ * Memory is allocated on the node when the pages are touched first, so the
+ * allocation and initialization of memory has to happen within the scope.
+ * If the node is unknown, the memory policy is not changed.
+ */
+class NumaNodePreference : public NonCopyable {
+public:
+    NumaNodePreference(int node);
+    virtual ~NumaNodePreference();
+
+private:
+    static constexpr int NODE_MASK_SIZE = 16;
+
+    bool m_set;
+    int m_oldMode;
+    unsigned long m_oldMask[NODE_MASK_SIZE];
+};
+
+}  // namespace cputopology
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_CPUTOPOLOGY_H
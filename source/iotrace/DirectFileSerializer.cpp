@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "DirectFileSerializer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+
+namespace octf {
+
+DirectFileSerializer::DirectFileSerializer(
+        const std::string &path,
+        uint64_t memoryLimit,
+        std::shared_ptr<AsyncWriterStats> stats)
+        : m_path(path)
+        , m_writer(memoryLimit)
+        , m_stats(stats)
+        , m_dataSize(0)
+        , m_opened(false)
+        , m_failed(false) {}
+
+DirectFileSerializer::~DirectFileSerializer() {
+    close();
+}
+
+bool DirectFileSerializer::open() {
+    if (m_opened) {
+        return true;
+    }
+
+    int fd = ::open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0600);
+    if (fd < 0) {
+        log::cerr << "Cannot create trace file " << m_path << std::endl;
+        return false;
+    }
+
+    try {
+        m_writer.open(fd);
+    } catch (Exception &e) {
+        log::cerr << "Cannot open trace file " << m_path << ", " << e.what()
+                  << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    m_dataSize = 0;
+    m_opened = true;
+    m_failed = false;
+    return true;
+}
+
+bool DirectFileSerializer::close() {
+    if (!m_opened) {
+        return !m_failed;
+    }
+
+    if (!m_writer.finish()) {
+        log::cerr << "Cannot write trace file " << m_path << std::endl;
+        m_failed = true;
+    }
+    if (m_stats) {
+        *m_stats = m_writer.getStats();
+    }
+
+    m_writer.close();
+    m_opened = false;
+    return !m_failed;
+}
+
+bool DirectFileSerializer::serialize(const void *blob, uint32_t size) {
+    if (!m_opened || m_failed) {
+        return false;
+    }
+
+    if (!m_writer.write(blob, size)) {
+        log::cerr << "Cannot write trace file " << m_path << std::endl;
+        m_failed = true;
+        return false;
+    }
+
+    m_dataSize += size;
+    return true;
+}
+
+uint64_t DirectFileSerializer::getDataSize() const {
+    return m_dataSize;
+}
+
+bool DirectFileSerializer::isOpen() {
+    return m_opened;
+}
+
+bool DirectFileSerializer::flush() {
+    return !m_failed;
+}
+
+bool DirectFileSerializer::remove() {
+    m_writer.close();
+    m_opened = false;
+    m_dataSize = 0;
+
+    return ::unlink(m_path.c_str()) == 0;
+}
+
+}  // namespace octf
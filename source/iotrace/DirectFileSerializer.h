@@ -0,0 +1,69 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_DIRECTFILESERIALIZER_H
+#define SOURCE_USERSPACE_DIRECTFILESERIALIZER_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <octf/serializer/ISerializer.h>
+#include <octf/utils/NonCopyable.h>
+#include "AsyncDirectFileWriter.h"
+
+namespace octf {
+
+/**
+ * @brief Serializer of a trace queue file using AsyncDirectFileWriter
+ *
+ * Used by the trace manager instead of OCTF's FileSerializer, so trace files
+ * are written with asynchronous direct IO, like the trace extension. Each
+ * trace queue has a serializer of its own, with its own write buffers.
+ *
+ * Buffered data reaches the file when the serializer is closed, flush() only
+ * reports write errors, because a partial buffer cannot be written without
+ * padding the file.
+ *
+ * @note This class is not thread safe, it is used by the trace job of its
+ * queue only.
+ */
+class DirectFileSerializer : public ISerializer, public NonCopyable {
+public:
+    /**
+     * @param path Path of the trace file
+     * @param memoryLimit Maximum memory (in bytes) used for write buffers
+     * @param[out] stats Write statistics, set when the file is closed
+     */
+    DirectFileSerializer(const std::string &path,
+                         uint64_t memoryLimit,
+                         std::shared_ptr<AsyncWriterStats> stats);
+    virtual ~DirectFileSerializer();
+
+    bool open() override;
+
+    bool close() override;
+
+    bool serialize(const void *blob, uint32_t size) override;
+
+    uint64_t getDataSize() const override;
+
+    bool isOpen() override;
+
+    bool flush() override;
+
+    bool remove() override;
+
+private:
+    const std::string m_path;
+    AsyncDirectFileWriter m_writer;
+    std::shared_ptr<AsyncWriterStats> m_stats;
+    uint64_t m_dataSize;
+    bool m_opened;
+    bool m_failed;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_DIRECTFILESERIALIZER_H
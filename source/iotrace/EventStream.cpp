@@ -0,0 +1,380 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "EventStream.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "LocalSocket.h"
+#include "iotrace_event_compact.h"
+#include "iotrace_stream.h"
+
+namespace octf {
+
+/* Maximum time (in ms) events wait in the ring before being sent */
+static constexpr int STREAM_FLUSH_INTERVAL_MS = 10;
+
+/* Timeout of sending a batch, checked against stopping the stream */
+static constexpr int STREAM_SEND_TIMEOUT_SEC = 1;
+
+static bool wake(int fd) {
+    char value = 0;
+    return ::write(fd, &value, sizeof(value)) == sizeof(value);
+}
+
+EventStream::EventStream(const std::string &name,
+                         uint64_t bufferSize,
+                         std::function<KernelRingDevList()> getDevices)
+        : m_socketPath()
+        , m_socket(-1)
+        , m_wakeFd{-1, -1}
+        , m_getDevices(getDevices)
+        , m_ring()
+        , m_mask(0)
+        , m_head(0)
+        , m_tail(0)
+        , m_connected(false)
+        , m_stopping(false)
+        , m_dropped(0)
+        , m_totalDropped(0)
+        , m_sent(0)
+        , m_thread() {
+    uint64_t size = IOTRACE_STREAM_BATCH_MAX_SIZE;
+    while (size < bufferSize) {
+        size *= 2;
+    }
+    m_ring.resize(size);
+    m_mask = size - 1;
+
+    if (name.empty() || name.find('/') != std::string::npos) {
+        throw Exception("Invalid stream name " + name);
+    }
+
+    auto path = getSocketPath(name);
+    m_socket = localsocket::listen(path);
+    m_socketPath = path;
+
+    if (::pipe2(m_wakeFd, O_CLOEXEC)) {
+        ::close(m_socket);
+        ::unlink(m_socketPath.c_str());
+        throw Exception("Cannot start event stream");
+    }
+
+    m_thread = std::thread([this]() { run(); });
+}
+
+EventStream::~EventStream() {
+    m_stopping = true;
+    if (m_thread.joinable()) {
+        wake(m_wakeFd[1]);
+        m_thread.join();
+    }
+
+    for (auto fd : {m_wakeFd[0], m_wakeFd[1], m_socket}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    ::unlink(m_socketPath.c_str());
+}
+
+std::string EventStream::getSocketPath(const std::string &name) {
+    return std::string(localsocket::SOCKET_DIR) + "/" + name +
+           IOTRACE_STREAM_SOCKET_SUFFIX;
+}
+
+uint64_t EventStream::getSentCount() const {
+    return m_sent;
+}
+
+uint64_t EventStream::getDroppedCount() const {
+    return m_totalDropped;
+}
+
+bool EventStream::reserve(uint64_t size) {
+    uint64_t used = m_head.load(std::memory_order_relaxed) -
+                    m_tail.load(std::memory_order_acquire);
+
+    return size <= m_ring.size() - used;
+}
+
+void EventStream::write(uint64_t offset, const void *data, uint64_t size) {
+    uint64_t pos = (m_head.load(std::memory_order_relaxed) + offset) & m_mask;
+    uint64_t first = std::min<uint64_t>(size, m_ring.size() - pos);
+    auto src = static_cast<const char *>(data);
+
+    std::memcpy(&m_ring[pos], src, first);
+    std::memcpy(&m_ring[0], src + first, size - first);
+}
+
+void EventStream::read(uint64_t position, void *data, uint64_t size) const {
+    uint64_t pos = position & m_mask;
+    uint64_t first = std::min<uint64_t>(size, m_ring.size() - pos);
+    auto dst = static_cast<char *>(data);
+
+    std::memcpy(dst, &m_ring[pos], first);
+    std::memcpy(dst + first, &m_ring[0], size - first);
+}
+
+void EventStream::push(const struct iotrace_event_hdr *hdr) {
+    if (!m_connected.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+
+    if (hdr->type == iotrace_event_type_io_fs) {
+        // Expanded into IO and fs_meta events, as in trace rings
+        if (hdr->size != sizeof(struct iotrace_event_io_fs)) {
+            return;
+        }
+
+        auto ev = reinterpret_cast<const struct iotrace_event_io_fs *>(hdr);
+        struct iotrace_event io = ev->io;
+        struct iotrace_event_fs_meta meta = {};
+
+        io.hdr.type = iotrace_event_type_io;
+        io.hdr.size = sizeof(io);
+        iotrace_event_init_hdr(&meta.hdr, iotrace_event_type_fs_meta,
+                               ev->io.hdr.sid + 1, ev->io.hdr.timestamp,
+                               sizeof(meta));
+        meta.ref_id = ev->io.id;
+        meta.file_id = ev->file_id;
+        meta.file_offset = ev->file_offset;
+        meta.file_size = ev->file_size;
+        meta.partition_id = ev->partition_id;
+
+        if (!reserve(sizeof(io) + sizeof(meta))) {
+            m_dropped += 2;
+            m_totalDropped += 2;
+            return;
+        }
+        write(0, &io, sizeof(io));
+        write(sizeof(io), &meta, sizeof(meta));
+        m_head.store(head + sizeof(io) + sizeof(meta),
+                     std::memory_order_release);
+    } else if (hdr->type == iotrace_event_type_io_cmpl_rq) {
+        auto ev = reinterpret_cast<const struct iotrace_event_io_cmpl_rq *>(
+                hdr);
+        if (hdr->size < offsetof(struct iotrace_event_io_cmpl_rq, bios) ||
+            ev->count > IOTRACE_EVENT_CMPL_RQ_MAX ||
+            hdr->size != offsetof(struct iotrace_event_io_cmpl_rq, bios) +
+                                 ev->count * sizeof(ev->bios[0])) {
+            return;
+        }
+
+        uint64_t size = ev->count * sizeof(struct iotrace_event_completion);
+        if (!reserve(size)) {
+            m_dropped += ev->count;
+            m_totalDropped += ev->count;
+            return;
+        }
+
+        for (uint32_t i = 0; i < ev->count; i++) {
+            const auto &bio = ev->bios[i];
+            struct iotrace_event_completion cmpl = {};
+
+            iotrace_event_init_hdr(&cmpl.hdr, iotrace_event_type_io_cmpl,
+                                   ev->hdr.sid + i, ev->hdr.timestamp,
+                                   sizeof(cmpl));
+            cmpl.ref_id = bio.ref_id;
+            cmpl.lba = bio.lba;
+            cmpl.len = bio.len;
+            cmpl.error = bio.error;
+            cmpl.dev_id = ev->dev_id;
+            write(i * sizeof(cmpl), &cmpl, sizeof(cmpl));
+        }
+        m_head.store(head + size, std::memory_order_release);
+    } else {
+        if (hdr->size < sizeof(*hdr) ||
+            hdr->size > IOTRACE_STREAM_BATCH_MAX_SIZE) {
+            return;
+        }
+
+        if (!reserve(hdr->size)) {
+            m_dropped++;
+            m_totalDropped++;
+            return;
+        }
+        write(0, hdr, hdr->size);
+        m_head.store(head + hdr->size, std::memory_order_release);
+    }
+}
+
+void EventStream::run() {
+    while (!m_stopping) {
+        struct pollfd fds[2] = {};
+        fds[0].fd = m_socket;
+        fds[0].events = POLLIN;
+        fds[1].fd = m_wakeFd[0];
+        fds[1].events = POLLIN;
+
+        int result = ::poll(fds, 2, -1);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            log::cerr << "Error polling event stream socket" << std::endl;
+            break;
+        }
+
+        if (fds[1].revents) {
+            // Stopping
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = ::accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                serve(fd);
+                ::close(fd);
+            }
+        }
+    }
+}
+
+void EventStream::serve(int fd) {
+    localsocket::setTimeout(fd, STREAM_SEND_TIMEOUT_SEC);
+
+    // Devices go first, so the consumer can interpret device IDs of IOs
+    std::vector<char> events;
+    uint32_t count = 0;
+    for (const auto &desc : m_getDevices()) {
+        auto data = reinterpret_cast<const char *>(&desc);
+        events.insert(events.end(), data, data + sizeof(desc));
+        count++;
+    }
+
+    // Events pushed before connecting are not sent
+    m_tail.store(m_head.load(std::memory_order_acquire),
+                 std::memory_order_release);
+    m_dropped = 0;
+    m_connected = true;
+
+    if (sendBatch(fd, events, count)) {
+        while (sendBatches(fd)) {
+        }
+    }
+
+    m_connected = false;
+
+    if (m_dropped) {
+        log::cerr << "Event stream consumer did not keep up, dropped "
+                  << m_dropped << " events" << std::endl;
+    }
+}
+
+bool EventStream::sendBatches(int fd) {
+    struct pollfd fds[2] = {};
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeFd[0];
+    fds[1].events = POLLIN;
+
+    int result = ::poll(fds, 2, STREAM_FLUSH_INTERVAL_MS);
+    if (result < 0 && errno != EINTR) {
+        return false;
+    }
+
+    if (fds[0].revents) {
+        // The consumer does not send anything, it closed the connection
+        char value;
+        if (::recv(fd, &value, sizeof(value), MSG_DONTWAIT) <= 0) {
+            return false;
+        }
+    }
+
+    std::vector<char> events;
+    events.reserve(IOTRACE_STREAM_BATCH_MAX_SIZE);
+
+    uint64_t head = m_head.load(std::memory_order_acquire);
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    while (tail != head) {
+        uint32_t count = 0;
+        events.clear();
+
+        // Whole events up to the batch size
+        while (tail != head) {
+            struct iotrace_event_hdr hdr;
+            read(tail, &hdr, sizeof(hdr));
+            if (events.size() + hdr.size > IOTRACE_STREAM_BATCH_MAX_SIZE) {
+                break;
+            }
+
+            events.resize(events.size() + hdr.size);
+            read(tail, &events[events.size() - hdr.size], hdr.size);
+            tail += hdr.size;
+            count++;
+        }
+
+        m_tail.store(tail, std::memory_order_release);
+        if (!sendBatch(fd, events, count)) {
+            return false;
+        }
+    }
+
+    // Events pushed before stopping are sent
+    return !fds[1].revents;
+}
+
+bool EventStream::sendBatch(int fd,
+                            const std::vector<char> &events,
+                            uint32_t count) {
+    struct iotrace_stream_batch batch = {};
+    batch.magic = IOTRACE_STREAM_MAGIC;
+    batch.version = IOTRACE_STREAM_VERSION;
+    batch.count = count;
+    batch.size = events.size();
+    batch.dropped = m_dropped;
+
+    struct iovec iov[2] = {};
+    iov[0].iov_base = &batch;
+    iov[0].iov_len = sizeof(batch);
+    iov[1].iov_base = const_cast<char *>(events.data());
+    iov[1].iov_len = events.size();
+
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = events.empty() ? 1 : 2;
+
+    while (msg.msg_iovlen) {
+        // No SIGPIPE if the consumer disconnects
+        ssize_t result = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR ||
+                ((errno == EAGAIN || errno == EWOULDBLOCK) && !m_stopping)) {
+                continue;
+            }
+            return false;
+        }
+
+        // Skip sent data of partially sent batch
+        while (msg.msg_iovlen && static_cast<size_t>(result) >=
+                                         msg.msg_iov[0].iov_len) {
+            result -= msg.msg_iov[0].iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen) {
+            msg.msg_iov[0].iov_base =
+                    static_cast<char *>(msg.msg_iov[0].iov_base) + result;
+            msg.msg_iov[0].iov_len -= result;
+        }
+    }
+
+    m_sent += count;
+    return true;
+}
+
+}  // namespace octf
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_EVENTSTREAM_H
+#define SOURCE_USERSPACE_EVENTSTREAM_H
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <octf/trace/iotrace_event.h>
+#include <octf/utils/NonCopyable.h>
+#include "KernelRingTraceProducer.h"
+
+namespace octf {
+
+/**
+ * @brief Streams trace events to a local consumer over a Unix socket
+ *
+ * Events are pushed by the perf buffer polling thread into a single producer,
+ * single consumer ring. The sender thread takes whole events from the ring
+ * and sends them in batches (see iotrace_stream.h). The producer never waits
+ * for the consumer, events which do not fit into the ring are dropped and
+ * counted, so a slow consumer does not slow down tracing.
+ */
+class EventStream : public NonCopyable {
+public:
+    /**
+     * @param name Name of the stream, the socket is created in the iotrace
+     * socket directory
+     * @param bufferSize Size of the ring in bytes, rounded up to power of two
+     * @param getDevices Returns devices traced currently, their descriptions
+     * are sent to each consumer first
+     */
+    EventStream(const std::string &name,
+                uint64_t bufferSize,
+                std::function<KernelRingDevList()> getDevices);
+    virtual ~EventStream();
+
+    /**
+     * @return Path of the socket of the stream
+     */
+    static std::string getSocketPath(const std::string &name);
+
+    /**
+     * @brief Pushes event into the stream, compact events are expanded
+     *
+     * Called by the producer thread only. Events are discarded, not counted
+     * as dropped, while no consumer is connected.
+     */
+    void push(const struct iotrace_event_hdr *hdr);
+
+    /**
+     * @return Events sent to consumers
+     */
+    uint64_t getSentCount() const;
+
+    /**
+     * @return Events dropped, because consumers did not keep up
+     */
+    uint64_t getDroppedCount() const;
+
+private:
+    void run();
+
+    void serve(int fd);
+
+    /**
+     * @brief Sends events of the ring in batches until the consumer
+     * disconnects or the stream stops
+     */
+    bool sendBatches(int fd);
+
+    bool sendBatch(int fd, const std::vector<char> &events, uint32_t count);
+
+    /**
+     * @brief Reserves space for the event in the ring
+     *
+     * @retval true Space reserved at the head of the ring
+     * @retval false Ring full, the event is dropped
+     */
+    bool reserve(uint64_t size);
+
+    /**
+     * @brief Copies data at the offset from the head of the ring
+     */
+    void write(uint64_t offset, const void *data, uint64_t size);
+
+    void read(uint64_t position, void *data, uint64_t size) const;
+
+private:
+    std::string m_socketPath;
+    int m_socket;
+    int m_wakeFd[2];
+    std::function<KernelRingDevList()> m_getDevices;
+    std::vector<char> m_ring;
+    uint64_t m_mask;
+    /** Written by the producer only */
+    std::atomic<uint64_t> m_head;
+    /** Written by the sender thread only */
+    std::atomic<uint64_t> m_tail;
+    std::atomic<bool> m_connected;
+    std::atomic<bool> m_stopping;
+    /** Dropped events of the current consumer */
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_totalDropped;
+    std::atomic<uint64_t> m_sent;
+    std::thread m_thread;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_EVENTSTREAM_H
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "EventStreamClient.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <octf/utils/Exception.h>
+#include "LocalSocket.h"
+#include "iotrace_stream.h"
+
+namespace octf {
+
+EventStreamClient::EventStreamClient(const std::string &name)
+        : m_fd(-1)
+        , m_batch()
+        , m_offset(0)
+        , m_dropped(0) {
+    m_fd = localsocket::connect(std::string(localsocket::SOCKET_DIR) + "/" +
+                                name + IOTRACE_STREAM_SOCKET_SUFFIX);
+}
+
+EventStreamClient::~EventStreamClient() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+uint64_t EventStreamClient::getDroppedCount() const {
+    return m_dropped;
+}
+
+const struct iotrace_event_hdr *EventStreamClient::next() {
+    while (m_offset >= m_batch.size()) {
+        if (!receiveBatch()) {
+            return nullptr;
+        }
+    }
+
+    auto hdr = reinterpret_cast<const struct iotrace_event_hdr *>(
+            &m_batch[m_offset]);
+    if (m_batch.size() - m_offset < sizeof(*hdr) || hdr->size < sizeof(*hdr) ||
+        hdr->size > m_batch.size() - m_offset) {
+        throw Exception("Invalid event in stream");
+    }
+
+    m_offset += hdr->size;
+    return hdr;
+}
+
+bool EventStreamClient::receiveBatch() {
+    struct iotrace_stream_batch batch = {};
+    if (!receive(&batch, sizeof(batch))) {
+        return false;
+    }
+
+    if (batch.magic != IOTRACE_STREAM_MAGIC ||
+        batch.version != IOTRACE_STREAM_VERSION ||
+        batch.size > IOTRACE_STREAM_BATCH_MAX_SIZE) {
+        throw Exception("Invalid event stream");
+    }
+
+    m_dropped = batch.dropped;
+    m_batch.resize(batch.size);
+    m_offset = 0;
+
+    if (!receive(m_batch.data(), m_batch.size())) {
+        throw Exception("Event stream ended within batch");
+    }
+
+    return true;
+}
+
+bool EventStreamClient::receive(void *data, uint64_t size) {
+    auto buffer = static_cast<char *>(data);
+
+    while (size) {
+        ssize_t result = ::recv(m_fd, buffer, size, 0);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        } else if (result <= 0) {
+            return false;
+        }
+
+        buffer += result;
+        size -= result;
+    }
+
+    return true;
+}
+
+}  // namespace octf
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_EVENTSTREAMCLIENT_H
+#define SOURCE_USERSPACE_EVENTSTREAMCLIENT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <octf/trace/iotrace_event.h>
+#include <octf/utils/NonCopyable.h>
+
+namespace octf {
+
+/**
+ * @brief Consumer of the live event stream of a running trace
+ *
+ * Connects to the stream started with --stream and iterates over streamed
+ * events. The consumer should take events as fast as they are produced,
+ * events which the tracing process cannot buffer are dropped and counted in
+ * getDroppedCount().
+ *
+ * @code
+ * EventStreamClient client("my-stream");
+ * while (auto hdr = client.next()) {
+ *     // handle event by hdr->type
+ * }
+ * @endcode
+ */
+class EventStreamClient : public NonCopyable {
+public:
+    /**
+     * @param name Name of the stream given to the tracing process
+     *
+     * @throws Exception if the stream is not served
+     */
+    EventStreamClient(const std::string &name);
+    virtual ~EventStreamClient();
+
+    /**
+     * @brief Returns the next event, waiting for it if needed
+     *
+     * Device descriptions of traced devices come first. The event is valid
+     * until the next call.
+     *
+     * @return Event, nullptr if the stream ended
+     *
+     * @throws Exception if the stream is corrupted
+     */
+    const struct iotrace_event_hdr *next();
+
+    /**
+     * @return Events dropped by the tracing process since connecting
+     */
+    uint64_t getDroppedCount() const;
+
+private:
+    /**
+     * @retval true Batch received
+     * @retval false Stream ended
+     */
+    bool receiveBatch();
+
+    bool receive(void *data, uint64_t size);
+
+private:
+    int m_fd;
+    std::vector<char> m_batch;
+    uint64_t m_offset;
+    uint64_t m_dropped;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_EVENTSTREAMCLIENT_H
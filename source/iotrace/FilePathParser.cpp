@@ -0,0 +1,155 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FilePathParser.h"
+
+#include <google/protobuf/util/json_util.h>
+#include <algorithm>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+
+namespace octf {
+
+/* Sector size of IO events */
+static constexpr uint64_t SECTOR_SIZE = 512;
+
+FilePathParser::FilePathParser(const std::string &tracePath,
+                               bool printIo,
+                               const std::string &filter)
+        : FilteredTraceEventHandler(tracePath, filter)
+        , m_printIo(printIo)
+        , m_paths(tracePath)
+        , m_ios()
+        , m_pathStats(m_paths.getPathIdCount()) {}
+
+void FilePathParser::handleFilteredEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    const auto &header = traceEvent->header();
+    m_paths.apply(header.sid());
+
+    if (traceEvent->has_io()) {
+        const auto &event = traceEvent->io();
+        if (!event.id()) {
+            return;
+        }
+
+        PendingIo io = {};
+        io.sid = header.sid();
+        io.timestamp = header.timestamp();
+        io.deviceId = event.deviceid();
+        io.lba = event.lba();
+        io.len = event.len();
+        io.operation = event.operation();
+        m_ios[event.id()] = io;
+    } else if (traceEvent->has_filesystemmeta()) {
+        handleFsMeta(traceEvent->filesystemmeta());
+    } else if (traceEvent->has_iocompletion()) {
+        // IO without file system metadata
+        m_ios.erase(traceEvent->iocompletion().refsid());
+    }
+}
+
+void FilePathParser::handleFsMeta(
+        const proto::trace::EventIoFilesystemMeta &meta) {
+    auto iter = m_ios.find(meta.refsid());
+    if (iter == m_ios.end()) {
+        return;
+    }
+    const auto io = iter->second;
+    m_ios.erase(iter);
+
+    auto pathId = m_paths.getPathId(meta.fileid().partitionid(),
+                                    meta.fileid().id());
+    if (!pathId) {
+        // File opened before tracing, or not opened at all (metadata)
+        return;
+    }
+
+    auto &stats = m_pathStats[pathId];
+    if (io.operation == proto::trace::IoType::Read) {
+        stats.readCount++;
+        stats.readBytes += io.len * SECTOR_SIZE;
+    } else if (io.operation == proto::trace::IoType::Write) {
+        stats.writeCount++;
+        stats.writeBytes += io.len * SECTOR_SIZE;
+    }
+
+    if (m_printIo) {
+        proto::IoPath result;
+        result.set_sid(io.sid);
+        result.set_timestamp(io.timestamp);
+        result.set_deviceid(io.deviceId);
+        result.set_lba(io.lba);
+        result.set_len(io.len);
+        result.set_operation(proto::trace::IoType_Name(io.operation));
+        result.set_path(m_paths.getPath(pathId));
+        result.set_fileoffset(meta.fileoffset());
+
+        std::string json;
+        google::protobuf::util::MessageToJsonString(result, &json);
+        log::cout << json << std::endl;
+    }
+}
+
+void FilePathParser::addStatistics(Statistics &to, const Statistics &from) {
+    to.fileCount++;
+    to.readCount += from.readCount;
+    to.writeCount += from.writeCount;
+    to.readBytes += from.readBytes;
+    to.writeBytes += from.writeBytes;
+}
+
+void FilePathParser::fillStatistics(const std::string &path,
+                                    const Statistics &stats,
+                                    proto::PathIoStatistics *result) {
+    result->set_path(path);
+    result->set_filecount(stats.fileCount);
+    result->set_readcount(stats.readCount);
+    result->set_writecount(stats.writeCount);
+    result->set_readbytes(stats.readBytes);
+    result->set_writebytes(stats.writeBytes);
+}
+
+void FilePathParser::getSummary(proto::PathStatisticsSummary *summary) {
+    summary->Clear();
+
+    // Only paths of files with IOs are rolled up, by their directory
+    std::map<std::string, Statistics> directories;
+    std::map<std::string, Statistics> extensions;
+    uint64_t fileCount = 0;
+
+    for (size_t id = 0; id < m_pathStats.size(); id++) {
+        const auto &stats = m_pathStats[id];
+        if (!stats.readCount && !stats.writeCount) {
+            continue;
+        }
+        fileCount++;
+
+        const auto &path = m_paths.getPath(id);
+        auto slash = path.rfind('/');
+        auto name = slash == std::string::npos ? 0 : slash + 1;
+        auto dot = path.rfind('.');
+
+        std::string directory = slash ? path.substr(0, slash) : "/";
+        addStatistics(directories[directory], stats);
+
+        // Hidden files with no other dot have no extension
+        if (dot != std::string::npos && dot > name) {
+            addStatistics(extensions[path.substr(dot + 1)], stats);
+        }
+    }
+
+    auto pathIdCount = m_paths.getPathIdCount();
+    summary->set_pathcount(pathIdCount ? pathIdCount - 1 : 0);
+    summary->set_filecount(fileCount);
+    for (const auto &entry : directories) {
+        fillStatistics(entry.first, entry.second, summary->add_directories());
+    }
+    for (const auto &entry : extensions) {
+        fillStatistics(entry.first, entry.second, summary->add_extensions());
+    }
+}
+
+}  // namespace octf
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_FILEPATHPARSER_H
+#define SOURCE_USERSPACE_FILEPATHPARSER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <octf/proto/trace.pb.h>
+#include "FilteredTraceEventHandler.h"
+#include "InterfaceTraceExtensionParsing.pb.h"
+#include "TraceFilePaths.h"
+
+namespace octf {
+
+/**
+ * @brief Breaks down IOs by directory and extension of files, using full
+ * paths of files resolved while tracing
+ *
+ * Paths are read from the trace extension, see TraceFilePaths. Unlike
+ * rebuilding paths from names of files and their parents, no tree of the file
+ * system is kept in memory.
+ */
+class FilePathParser : public FilteredTraceEventHandler {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param printIo Print path of the file of each IO
+     * @param filter Filter expression of IOs, see IoFilter
+     */
+    FilePathParser(const std::string &tracePath,
+                   bool printIo,
+                   const std::string &filter);
+    virtual ~FilePathParser() = default;
+
+    void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) override;
+
+    /**
+     * @brief Fills statistics of directories and file extensions, call after
+     * processEvents()
+     */
+    void getSummary(proto::PathStatisticsSummary *summary);
+
+private:
+    /** IO queued and not completed yet */
+    struct PendingIo {
+        uint64_t sid;
+        uint64_t timestamp;
+        uint64_t deviceId;
+        uint64_t lba;
+        uint32_t len;
+        proto::trace::IoType operation;
+    };
+
+    struct Statistics {
+        Statistics()
+                : fileCount(0)
+                , readCount(0)
+                , writeCount(0)
+                , readBytes(0)
+                , writeBytes(0) {}
+
+        uint64_t fileCount;
+        uint64_t readCount;
+        uint64_t writeCount;
+        uint64_t readBytes;
+        uint64_t writeBytes;
+    };
+
+    void handleFsMeta(const proto::trace::EventIoFilesystemMeta &meta);
+
+    static void addStatistics(Statistics &to, const Statistics &from);
+
+    static void fillStatistics(const std::string &path,
+                               const Statistics &stats,
+                               proto::PathIoStatistics *result);
+
+private:
+    const bool m_printIo;
+    TraceFilePaths m_paths;
+    /** IOs waiting for their file system metadata, keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_ios;
+    /** Statistics of paths indexed by path ID */
+    std::vector<Statistics> m_pathStats;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_FILEPATHPARSER_H
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FilteredTraceEventHandler.h"
+
+namespace octf {
+
+/* Sector size of IO events */
+static constexpr uint64_t SECTOR_SIZE = 512;
+
+/* Time after which IOs without completion are evaluated, in ns */
+static constexpr uint64_t COMPLETION_TIMEOUT = 1000ULL * 1000 * 1000;
+
+/* Events held back at most, waiting for completions of IOs */
+static constexpr size_t HELD_EVENTS_MAX = 1 << 20;
+
+FilteredTraceEventHandler::FilteredTraceEventHandler(
+        const std::string &tracePath,
+        const std::string &filter)
+        : TraceEventHandler<proto::trace::Event>(tracePath)
+        , m_filter(filter)
+        , m_filePaths()
+        , m_deviceNames()
+        , m_ios()
+        , m_events() {
+    if (m_filter.isUsingPaths()) {
+        m_filePaths.reset(new TraceFilePaths(tracePath));
+    }
+}
+
+void FilteredTraceEventHandler::processEvents() {
+    TraceEventHandler<proto::trace::Event>::processEvents();
+    release(0, true);
+}
+
+void FilteredTraceEventHandler::handleEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    if (m_filter.isEmpty()) {
+        handleFilteredEvent(traceEvent);
+        return;
+    }
+
+    const auto &header = traceEvent->header();
+    std::shared_ptr<FilteredIo> io;
+    if (m_filePaths) {
+        m_filePaths->apply(header.sid());
+    }
+
+    if (traceEvent->has_devicedescription()) {
+        const auto &desc = traceEvent->devicedescription();
+        m_deviceNames[desc.id()] = desc.name();
+    } else if (traceEvent->has_io()) {
+        const auto &event = traceEvent->io();
+        if (event.id()) {
+            io = std::make_shared<FilteredIo>();
+            io->id = event.id();
+            io->timestamp = header.timestamp();
+            io->deviceId = event.deviceid();
+            io->operation = event.operation();
+            io->size = event.len() * SECTOR_SIZE;
+            io->lba = event.lba();
+            if (!m_filter.isDeferred()) {
+                decide(*io, false, 0);
+            }
+
+            // An IO of the same ID whose completion was lost is replaced
+            m_ios[event.id()] = io;
+        }
+    } else if (traceEvent->has_filesystemmeta()) {
+        const auto &meta = traceEvent->filesystemmeta();
+
+        auto iter = m_ios.find(meta.refsid());
+        if (iter != m_ios.end()) {
+            io = iter->second;
+            if (m_filePaths) {
+                io->pathId = m_filePaths->getPathId(
+                        meta.fileid().partitionid(), meta.fileid().id());
+            }
+        }
+    } else if (traceEvent->has_iocompletion()) {
+        auto iter = m_ios.find(traceEvent->iocompletion().refsid());
+        if (iter != m_ios.end()) {
+            io = iter->second;
+            if (!io->decided) {
+                decide(*io, header.timestamp() >= io->timestamp,
+                       header.timestamp() - io->timestamp);
+            }
+
+            // Completion is the last event of the IO
+            m_ios.erase(iter);
+        }
+    }
+
+    // Events of IOs submitted before the trace started have no IO
+    m_events.emplace_back(traceEvent, io);
+    release(header.timestamp(), false);
+}
+
+void FilteredTraceEventHandler::decide(FilteredIo &io,
+                                       bool hasLatency,
+                                       uint64_t latency) {
+    IoFilter::Io fields = {};
+
+    auto name = m_deviceNames.find(io.deviceId);
+    if (name != m_deviceNames.end()) {
+        fields.device = &name->second;
+    }
+    fields.operation = io.operation;
+    fields.size = io.size;
+    fields.lba = io.lba;
+    fields.hasLatency = hasLatency;
+    fields.latency = latency;
+    if (io.pathId && m_filePaths) {
+        fields.path = &m_filePaths->getPath(io.pathId);
+    }
+
+    io.matching = m_filter.matches(fields);
+    io.decided = true;
+}
+
+void FilteredTraceEventHandler::release(uint64_t timestamp, bool flush) {
+    while (!m_events.empty()) {
+        auto traceEvent = m_events.front().first;
+        auto io = m_events.front().second;
+        bool matching = true;
+
+        if (io) {
+            if (!io->decided) {
+                bool lost = timestamp > io->timestamp + COMPLETION_TIMEOUT ||
+                            m_events.size() > HELD_EVENTS_MAX;
+                if (!flush && !lost) {
+                    break;
+                }
+                decide(*io, false, 0);
+
+                // The completion is not waited for anymore, if it comes
+                // later it is passed on as an event of an unknown IO
+                auto iter = m_ios.find(io->id);
+                if (iter != m_ios.end() && iter->second == io) {
+                    m_ios.erase(iter);
+                }
+            }
+
+            matching = io->matching;
+        }
+
+        m_events.pop_front();
+        if (matching) {
+            handleFilteredEvent(traceEvent);
+        }
+    }
+}
+
+}  // namespace octf
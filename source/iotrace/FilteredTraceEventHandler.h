@@ -0,0 +1,107 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_FILTEREDTRACEEVENTHANDLER_H
+#define SOURCE_USERSPACE_FILTEREDTRACEEVENTHANDLER_H
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <octf/proto/trace.pb.h>
+#include <octf/trace/parser/TraceEventHandler.h>
+#include "IoFilter.h"
+#include "TraceFilePaths.h"
+
+namespace octf {
+
+/**
+ * @brief Handler of trace events which passes on events of IOs matching the
+ * filter expression only, see IoFilter
+ *
+ * Events of IOs which do not match, i.e. the IO, its completion and its file
+ * system metadata, are dropped while the trace is decoded. Other events, e.g.
+ * device descriptions, are passed on.
+ *
+ * Filters of fields known at submission of the IO are evaluated at once. For
+ * filters of latency or path, events are held back until completion of the
+ * IO, and passed on in their order. IOs without completion are evaluated as
+ * IOs of unknown latency, when events of one second later come or too many
+ * events are held back.
+ */
+class FilteredTraceEventHandler
+        : public TraceEventHandler<proto::trace::Event> {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param filter Filter expression, empty to pass all events
+     *
+     * @throws Exception Invalid filter expression, or the filter compares
+     * paths and the trace has none
+     */
+    FilteredTraceEventHandler(const std::string &tracePath,
+                              const std::string &filter);
+    virtual ~FilteredTraceEventHandler() = default;
+
+    void handleEvent(std::shared_ptr<proto::trace::Event> traceEvent) final;
+
+    /**
+     * @brief Processes events of the trace, including events held back by
+     * the filter at the end of the trace
+     */
+    void processEvents();
+
+protected:
+    /**
+     * @brief Handles the event which passed the filter
+     */
+    virtual void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) = 0;
+
+private:
+    /** IO whose events are filtered */
+    struct FilteredIo {
+        uint64_t id;
+        uint64_t timestamp;
+        uint64_t deviceId;
+        proto::trace::IoType operation;
+        uint64_t size;
+        uint64_t lba;
+        uint64_t pathId;
+        bool decided;
+        bool matching;
+    };
+
+    void decide(FilteredIo &io, bool hasLatency, uint64_t latency);
+
+    /**
+     * @brief Passes on events held back, up to the first one of an IO not
+     * decided yet
+     *
+     * @param timestamp Timestamp of the last event
+     * @param flush Pass on all events, at the end of the trace
+     */
+    void release(uint64_t timestamp, bool flush);
+
+private:
+    const IoFilter m_filter;
+    std::unique_ptr<TraceFilePaths> m_filePaths;
+    std::map<uint64_t, std::string> m_deviceNames;
+    /**
+     * IOs keyed by IO ID, until their completion. IO IDs are reused, so held
+     * back events refer to their IO directly.
+     */
+    std::unordered_map<uint64_t, std::shared_ptr<FilteredIo>> m_ios;
+    /** Events held back, with their IO or null */
+    std::deque<std::pair<std::shared_ptr<proto::trace::Event>,
+                         std::shared_ptr<FilteredIo>>>
+            m_events;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_FILTEREDTRACEEVENTHANDLER_H
@@ -0,0 +1,282 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "FingerprintParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace octf {
+
+/* Sector size of IO events */
+static constexpr uint64_t SECTOR_SIZE = 512;
+
+/* Streams tracked at once per device, for sequentiality */
+static constexpr size_t DEVICE_STREAMS_MAX = 64;
+
+/* Zones the device is divided into, for hotness of LBAs */
+static constexpr uint64_t ZONE_COUNT = 65536;
+
+/* Size of zones of devices of unknown size (1 MiB in sectors) */
+static constexpr uint64_t ZONE_SIZE_DEFAULT = 2048;
+
+/* Maximum fitted Zipf exponent, it fits the fixed point field */
+static constexpr double ZIPF_THETA_MAX = 6.0;
+
+/*
+ * Accesses to zones whose variance is below this multiple of their mean are
+ * uniform, like the Poisson distribution whose variance equals its mean
+ */
+static constexpr double UNIFORM_DISPERSION_MAX = 2.0;
+
+static uint16_t getShare(uint64_t value, uint64_t total) {
+    if (!total) {
+        return 0;
+    }
+    return std::min<uint64_t>(value * IOTRACE_FINGERPRINT_SCALE / total,
+                              IOTRACE_FINGERPRINT_SCALE);
+}
+
+static uint64_t toFixed(double value) {
+    return std::llround(value * IOTRACE_FINGERPRINT_SCALE);
+}
+
+FingerprintParser::Device::Device()
+        : name()
+        , size(0)
+        , ios()
+        , bytes()
+        , sequentialBytes()
+        , sizes()
+        , streams(DEVICE_STREAMS_MAX)
+        , zones()
+        , zoneSize(0)
+        , firstTimestamp(0)
+        , lastTimestamp(0)
+        , lastSubmit(0)
+        , gapCount(0)
+        , gapMean(0)
+        , gapM2(0)
+        , gaps()
+        , inflight(0)
+        , maxInflight(0)
+        , latencySum(0) {}
+
+FingerprintParser::FingerprintParser(const std::string &tracePath,
+                                     const std::string &filter)
+        : FilteredTraceEventHandler(tracePath, filter)
+        , m_devices()
+        , m_ios() {}
+
+void FingerprintParser::handleFilteredEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    const auto &header = traceEvent->header();
+
+    if (traceEvent->has_devicedescription()) {
+        const auto &desc = traceEvent->devicedescription();
+        auto &device = m_devices[desc.id()];
+        device.name = desc.name();
+        device.size = desc.size();
+    } else if (traceEvent->has_io()) {
+        handleIo(header.timestamp(), traceEvent->io());
+    } else if (traceEvent->has_iocompletion()) {
+        auto iter = m_ios.find(traceEvent->iocompletion().refsid());
+        if (iter == m_ios.end()) {
+            return;
+        }
+
+        auto &device = m_devices[iter->second.deviceId];
+        if (header.timestamp() > iter->second.timestamp) {
+            device.latencySum += header.timestamp() - iter->second.timestamp;
+            device.lastTimestamp =
+                    std::max(device.lastTimestamp, header.timestamp());
+        }
+        device.inflight--;
+        m_ios.erase(iter);
+    }
+}
+
+void FingerprintParser::handleIo(uint64_t timestamp,
+                                 const proto::trace::EventIo &io) {
+    int direction;
+    switch (io.operation()) {
+    case proto::trace::IoType::Read:
+        direction = iotrace_fingerprint_read;
+        break;
+    case proto::trace::IoType::Write:
+        direction = iotrace_fingerprint_write;
+        break;
+    default:
+        return;
+    }
+    if (!io.id() || !io.len()) {
+        return;
+    }
+
+    auto &device = m_devices[io.deviceid()];
+    uint64_t bytes = io.len() * SECTOR_SIZE;
+
+    device.ios[direction]++;
+    device.bytes[direction] += bytes;
+
+    size_t bucket = 0;
+    while (bucket + 1 < IOTRACE_FINGERPRINT_SIZE_BUCKETS &&
+           bytes > (SECTOR_SIZE << bucket)) {
+        bucket++;
+    }
+    device.sizes[direction][bucket]++;
+
+    auto accessClass = device.streams.classify(direction, io.lba(), io.len(),
+                                               timestamp);
+    if (accessClass == StreamDetector::Sequential) {
+        device.sequentialBytes[direction] += bytes;
+    }
+
+    if (device.zones.empty()) {
+        device.zoneSize = device.size ? (device.size + ZONE_COUNT - 1) /
+                                                ZONE_COUNT
+                                      : ZONE_SIZE_DEFAULT;
+        device.zones.resize(ZONE_COUNT);
+    }
+    device.zones[std::min(io.lba() / device.zoneSize, ZONE_COUNT - 1)]++;
+
+    if (device.ios[0] + device.ios[1] > 1) {
+        uint64_t gap = timestamp > device.lastSubmit
+                               ? timestamp - device.lastSubmit
+                               : 0;
+
+        bucket = 0;
+        while (bucket + 1 < IOTRACE_FINGERPRINT_GAP_BUCKETS &&
+               gap > (1024ULL << bucket)) {
+            bucket++;
+        }
+        device.gaps[bucket]++;
+
+        device.gapCount++;
+        double delta = gap - device.gapMean;
+        device.gapMean += delta / device.gapCount;
+        device.gapM2 += delta * (gap - device.gapMean);
+    } else {
+        device.firstTimestamp = timestamp;
+    }
+    device.lastSubmit = timestamp;
+    device.lastTimestamp = std::max(device.lastTimestamp, timestamp);
+
+    device.inflight++;
+    device.maxInflight = std::max(device.maxInflight, device.inflight);
+
+    PendingIo pending = {};
+    pending.timestamp = timestamp;
+    pending.deviceId = io.deviceid();
+    m_ios[io.id()] = pending;
+}
+
+double FingerprintParser::fitZipfTheta(const std::vector<uint32_t> &zones,
+                                       size_t span) {
+    if (!span) {
+        return 0;
+    }
+
+    double mean = 0, m2 = 0;
+    for (size_t i = 0; i < span; i++) {
+        double delta = zones[i] - mean;
+        mean += delta / (i + 1);
+        m2 += delta * (zones[i] - mean);
+    }
+    if (!mean || m2 / span <= UNIFORM_DISPERSION_MAX * mean) {
+        return 0;
+    }
+
+    // Slope of log-log plot of access counts against their rank
+    std::vector<uint32_t> counts;
+    for (size_t i = 0; i < span; i++) {
+        if (zones[i]) {
+            counts.push_back(zones[i]);
+        }
+    }
+    if (counts.size() < 2) {
+        return 0;
+    }
+    std::sort(counts.begin(), counts.end(), std::greater<uint32_t>());
+
+    double n = counts.size();
+    double sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        double x = std::log(i + 1.0);
+        double y = std::log((double) counts[i]);
+        sumX += x;
+        sumY += y;
+        sumXY += x * y;
+        sumXX += x * x;
+    }
+
+    double slope = (n * sumXY - sumX * sumY) / (n * sumXX - sumX * sumX);
+    return std::min(std::max(-slope, 0.0), ZIPF_THETA_MAX);
+}
+
+struct iotrace_fingerprint_device FingerprintParser::getDeviceFingerprint(
+        const Device &device) {
+    struct iotrace_fingerprint_device result = {};
+    uint64_t ios = device.ios[0] + device.ios[1];
+
+    std::strncpy(result.name, device.name.c_str(), sizeof(result.name) - 1);
+    result.device_size = device.size;
+    result.duration = device.lastTimestamp - device.firstTimestamp;
+    result.io_count = ios;
+    result.bytes = device.bytes[0] + device.bytes[1];
+    result.read_share = getShare(device.ios[iotrace_fingerprint_read], ios);
+
+    for (int dir = 0; dir < iotrace_fingerprint_direction_count; dir++) {
+        for (size_t i = 0; i < IOTRACE_FINGERPRINT_SIZE_BUCKETS; i++) {
+            result.size_shares[dir][i] =
+                    getShare(device.sizes[dir][i], device.ios[dir]);
+        }
+        result.sequential_shares[dir] =
+                getShare(device.sequentialBytes[dir], device.bytes[dir]);
+    }
+
+    size_t touched = 0, span = 0;
+    for (size_t i = 0; i < device.zones.size(); i++) {
+        if (device.zones[i]) {
+            touched++;
+            span = i + 1;
+        }
+    }
+    result.footprint = getShare(touched, device.zones.size());
+    result.lba_span = getShare(span, device.zones.size());
+    result.zipf_theta = toFixed(fitZipfTheta(device.zones, span));
+
+    if (result.duration) {
+        // Little's law
+        result.queue_depth =
+                toFixed(device.latencySum / (double) result.duration);
+    }
+    result.max_queue_depth = device.maxInflight;
+
+    result.interarrival_mean = std::llround(device.gapMean);
+    if (device.gapCount > 1 && device.gapMean > 0) {
+        double stddev = std::sqrt(device.gapM2 / (device.gapCount - 1));
+        result.interarrival_cv = toFixed(stddev / device.gapMean);
+    }
+    for (size_t i = 0; i < IOTRACE_FINGERPRINT_GAP_BUCKETS; i++) {
+        result.interarrival_shares[i] =
+                getShare(device.gaps[i], device.gapCount);
+    }
+
+    return result;
+}
+
+void FingerprintParser::getFingerprint(WorkloadFingerprint &fingerprint) {
+    for (const auto &entry : m_devices) {
+        const auto &device = entry.second;
+        if (device.ios[0] + device.ios[1]) {
+            fingerprint.addDevice(getDeviceFingerprint(device));
+        }
+    }
+}
+
+}  // namespace octf
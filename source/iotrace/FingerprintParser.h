@@ -0,0 +1,99 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_FINGERPRINTPARSER_H
+#define SOURCE_USERSPACE_FINGERPRINTPARSER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <octf/proto/trace.pb.h>
+#include "FilteredTraceEventHandler.h"
+#include "StreamDetector.h"
+#include "WorkloadFingerprint.h"
+
+namespace octf {
+
+/**
+ * @brief Extracts the workload fingerprint of devices from the trace
+ *
+ * Only reads and writes are taken into account. Hotness of LBAs is measured
+ * by accesses to a fixed number of zones of the device, and fitted to a Zipf
+ * distribution, so no LBAs are kept in the fingerprint.
+ */
+class FingerprintParser : public FilteredTraceEventHandler {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param filter Filter expression of IOs, see IoFilter
+     */
+    FingerprintParser(const std::string &tracePath,
+                      const std::string &filter);
+    virtual ~FingerprintParser() = default;
+
+    void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) override;
+
+    /**
+     * @brief Gets fingerprint of devices with IOs, call after processEvents()
+     */
+    void getFingerprint(WorkloadFingerprint &fingerprint);
+
+private:
+    struct Device {
+        Device();
+
+        std::string name;
+        /** Size in sectors */
+        uint64_t size;
+        uint64_t ios[iotrace_fingerprint_direction_count];
+        uint64_t bytes[iotrace_fingerprint_direction_count];
+        uint64_t sequentialBytes[iotrace_fingerprint_direction_count];
+        uint64_t sizes[iotrace_fingerprint_direction_count]
+                      [IOTRACE_FINGERPRINT_SIZE_BUCKETS];
+        StreamDetector streams;
+        /** Accesses to zones of the device */
+        std::vector<uint32_t> zones;
+        /** Size of zones in sectors */
+        uint64_t zoneSize;
+        /** First submission and last submission or completion */
+        uint64_t firstTimestamp;
+        uint64_t lastTimestamp;
+        uint64_t lastSubmit;
+        /** Inter-arrival of IOs, mean and variance by Welford's method */
+        uint64_t gapCount;
+        double gapMean;
+        double gapM2;
+        uint64_t gaps[IOTRACE_FINGERPRINT_GAP_BUCKETS];
+        uint64_t inflight;
+        uint64_t maxInflight;
+        uint64_t latencySum;
+    };
+
+    /** IO queued and not completed yet */
+    struct PendingIo {
+        uint64_t timestamp;
+        uint64_t deviceId;
+    };
+
+    void handleIo(uint64_t timestamp, const proto::trace::EventIo &io);
+
+    static double fitZipfTheta(const std::vector<uint32_t> &zones,
+                               size_t span);
+
+    static struct iotrace_fingerprint_device getDeviceFingerprint(
+            const Device &device);
+
+private:
+    std::map<uint64_t, Device> m_devices;
+    /** IOs in flight keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_ios;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_FINGERPRINTPARSER_H
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "HwQueueParser.h"
+
+#include <google/protobuf/util/json_util.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "TraceExtensionReader.h"
+#include "iotrace_event_ext.h"
+
+namespace octf {
+
+HwQueueParser::HwQueueParser(const std::string &tracePath,
+                             bool printIo,
+                             const std::string &filter)
+        : FilteredTraceEventHandler(tracePath, filter)
+        , m_printIo(printIo)
+        , m_requests()
+        , m_nextRequest(0)
+        , m_ios()
+        , m_devices() {
+    readRequests(tracePath);
+}
+
+void HwQueueParser::readRequests(const std::string &tracePath) {
+    TraceExtensionReader reader(tracePath);
+    if (!reader.isPresent()) {
+        throw Exception("Trace has no hardware queue events, trace with "
+                        "--hw-queue");
+    }
+
+    while (auto hdr = reader.next()) {
+        if (hdr->type != iotrace_event_type_rq_hw_queue) {
+            continue;
+        }
+
+        auto ev = reinterpret_cast<const struct iotrace_event_rq_hw_queue *>(
+                hdr);
+        if (hdr->size < offsetof(struct iotrace_event_rq_hw_queue, ref_ids) ||
+            ev->count > IOTRACE_EVENT_RQ_IO_MAX ||
+            hdr->size != offsetof(struct iotrace_event_rq_hw_queue, ref_ids) +
+                                 ev->count * sizeof(ev->ref_ids[0])) {
+            throw Exception("Invalid hardware queue event in trace extension");
+        }
+
+        RequestHwQueue request;
+        request.sid = hdr->sid;
+        request.hwQueue = ev->hw_queue;
+        request.submitCpu = ev->submit_cpu;
+        request.completeCpu = ev->complete_cpu;
+        request.submitNode = ev->submit_node;
+        request.completeNode = ev->complete_node;
+        request.ioIds.assign(ev->ref_ids, ev->ref_ids + ev->count);
+        m_requests.push_back(std::move(request));
+    }
+
+    // Extension events are written in order of CPUs, not sequence IDs
+    std::sort(m_requests.begin(), m_requests.end(),
+              [](const RequestHwQueue &a, const RequestHwQueue &b) {
+                  return a.sid < b.sid;
+              });
+}
+
+void HwQueueParser::applyRequests(uint64_t sid) {
+    for (; m_nextRequest < m_requests.size(); m_nextRequest++) {
+        const auto &request = m_requests[m_nextRequest];
+        if (request.sid > sid) {
+            break;
+        }
+
+        for (auto id : request.ioIds) {
+            auto iter = m_ios.find(id);
+            if (iter != m_ios.end()) {
+                iter->second.attributed = true;
+                iter->second.request = m_nextRequest;
+            }
+        }
+    }
+}
+
+void HwQueueParser::handleFilteredEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    const auto &header = traceEvent->header();
+    applyRequests(header.sid());
+
+    if (traceEvent->has_devicedescription()) {
+        const auto &desc = traceEvent->devicedescription();
+        m_devices[desc.id()].name = desc.name();
+    } else if (traceEvent->has_io()) {
+        const auto &event = traceEvent->io();
+        if (!event.id()) {
+            return;
+        }
+
+        PendingIo io = {};
+        io.sid = header.sid();
+        io.timestamp = header.timestamp();
+        io.deviceId = event.deviceid();
+        io.lba = event.lba();
+        io.len = event.len();
+        m_ios[event.id()] = io;
+    } else if (traceEvent->has_iocompletion()) {
+        auto iter = m_ios.find(traceEvent->iocompletion().refsid());
+        if (iter == m_ios.end()) {
+            return;
+        }
+
+        handleCompletion(header.timestamp(), iter->second);
+        m_ios.erase(iter);
+    }
+}
+
+void HwQueueParser::handleCompletion(uint64_t timestamp, const PendingIo &io) {
+    if (!io.attributed || timestamp < io.timestamp) {
+        // Completed by a bio based device, or without hardware queue event
+        return;
+    }
+
+    const auto &request = m_requests[io.request];
+    auto &hwQueue = m_devices[io.deviceId].hwQueues[request.hwQueue];
+    bool crossNode = request.submitNode >= 0 && request.completeNode >= 0 &&
+                     request.submitNode != request.completeNode;
+
+    hwQueue.ioCount++;
+    hwQueue.latency.add(timestamp - io.timestamp);
+    hwQueue.inflight.emplace_back(io.timestamp, timestamp);
+    hwQueue.submitCpus.insert(request.submitCpu);
+    hwQueue.completeCpus.insert(request.completeCpu);
+    if (request.submitCpu != request.completeCpu) {
+        hwQueue.crossCpuCount++;
+    }
+    if (crossNode) {
+        hwQueue.crossNodeCount++;
+    }
+
+    if (m_printIo) {
+        proto::IoHwQueue result;
+        result.set_sid(io.sid);
+        result.set_timestamp(io.timestamp);
+        result.set_deviceid(io.deviceId);
+        result.set_lba(io.lba);
+        result.set_len(io.len);
+        result.set_hwqueue(request.hwQueue);
+        result.set_submitcpu(request.submitCpu);
+        result.set_completecpu(request.completeCpu);
+        result.set_submitnode(request.submitNode);
+        result.set_completenode(request.completeNode);
+        result.set_latency(timestamp - io.timestamp);
+
+        std::string json;
+        google::protobuf::util::MessageToJsonString(result, &json);
+        log::cout << json << std::endl;
+    }
+}
+
+void HwQueueParser::fillDepth(HwQueue &hwQueue,
+                              proto::HwQueueStatistics *stats) {
+    // Queueing of IOs increases the depth, completions decrease it
+    std::vector<std::pair<uint64_t, int>> changes;
+    uint64_t begin = UINT64_MAX, end = 0, busy = 0;
+
+    changes.reserve(hwQueue.inflight.size() * 2);
+    for (const auto &io : hwQueue.inflight) {
+        changes.emplace_back(io.first, 1);
+        changes.emplace_back(io.second, -1);
+        begin = std::min(begin, io.first);
+        end = std::max(end, io.second);
+        busy += io.second - io.first;
+    }
+    hwQueue.inflight.clear();
+    hwQueue.inflight.shrink_to_fit();
+
+    /*
+     * Completions go first at equal time, so they do not overlap queueing.
+     * The depth may drop below zero momentarily for IOs completed at once.
+     */
+    std::sort(changes.begin(), changes.end());
+
+    int64_t depth = 0, maxDepth = 0;
+    for (const auto &change : changes) {
+        depth += change.second;
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    // Little's law, the time IOs spent in flight over the traced time
+    if (end > begin) {
+        stats->set_averagedepth(static_cast<double>(busy) / (end - begin));
+    }
+    stats->set_maxdepth(maxDepth);
+}
+
+void HwQueueParser::getSummary(proto::HwQueuesSummary *summary) {
+    summary->Clear();
+
+    for (auto &entry : m_devices) {
+        auto &device = entry.second;
+        if (device.hwQueues.empty()) {
+            continue;
+        }
+
+        auto result = summary->add_devices();
+        uint64_t ioCount = 0, crossCpuCount = 0, crossNodeCount = 0;
+
+        result->set_id(entry.first);
+        result->set_name(device.name);
+
+        for (auto &queueEntry : device.hwQueues) {
+            auto &hwQueue = queueEntry.second;
+            auto stats = result->add_hwqueues();
+
+            stats->set_index(queueEntry.first);
+            stats->set_iocount(hwQueue.ioCount);
+            fillDepth(hwQueue, stats);
+            hwQueue.latency.fill(stats->mutable_latency());
+            stats->set_crosscpucount(hwQueue.crossCpuCount);
+            stats->set_crossnodecount(hwQueue.crossNodeCount);
+            for (auto cpu : hwQueue.submitCpus) {
+                stats->add_submitcpus(cpu);
+            }
+            for (auto cpu : hwQueue.completeCpus) {
+                stats->add_completecpus(cpu);
+            }
+
+            ioCount += hwQueue.ioCount;
+            crossCpuCount += hwQueue.crossCpuCount;
+            crossNodeCount += hwQueue.crossNodeCount;
+        }
+
+        result->set_iocount(ioCount);
+        result->set_crosscpucount(crossCpuCount);
+        result->set_crossnodecount(crossNodeCount);
+        if (ioCount) {
+            result->set_crosscpufraction(static_cast<double>(crossCpuCount) /
+                                         ioCount);
+            result->set_crossnodefraction(
+                    static_cast<double>(crossNodeCount) / ioCount);
+        }
+    }
+}
+
+}  // namespace octf
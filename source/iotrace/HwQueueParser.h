@@ -0,0 +1,130 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_HWQUEUEPARSER_H
+#define SOURCE_USERSPACE_HWQUEUEPARSER_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <octf/proto/trace.pb.h>
+#include "FilteredTraceEventHandler.h"
+#include "InterfaceTraceExtensionParsing.pb.h"
+#include "LatencySamples.h"
+
+namespace octf {
+
+/**
+ * @brief Attributes IOs to hardware queues and CPUs
+ *
+ * Hardware queue events of the trace extension are merged with IO events of
+ * the trace by sequence ID. The event of a request precedes completions of
+ * its IOs, so each IO is attributed to the hardware queue and CPUs of its
+ * request when it completes.
+ */
+class HwQueueParser : public FilteredTraceEventHandler {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param printIo Print hardware queue and CPUs of each IO
+     * @param filter Filter expression of IOs, see IoFilter
+     */
+    HwQueueParser(const std::string &tracePath,
+                  bool printIo,
+                  const std::string &filter);
+    virtual ~HwQueueParser() = default;
+
+    void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) override;
+
+    /**
+     * @brief Fills statistics of hardware queues, call after processEvents()
+     */
+    void getSummary(proto::HwQueuesSummary *summary);
+
+private:
+    /** Completion of a request by a hardware queue, read from extension */
+    struct RequestHwQueue {
+        uint64_t sid;
+        uint32_t hwQueue;
+        uint32_t submitCpu;
+        uint32_t completeCpu;
+        int32_t submitNode;
+        int32_t completeNode;
+        std::vector<uint64_t> ioIds;
+    };
+
+    /** IO queued and not completed yet */
+    struct PendingIo {
+        uint64_t sid;
+        uint64_t timestamp;
+        uint64_t deviceId;
+        uint64_t lba;
+        uint32_t len;
+        /** Request of the IO completed, index of its hardware queue event */
+        bool attributed;
+        size_t request;
+    };
+
+    struct HwQueue {
+        HwQueue()
+                : ioCount(0)
+                , crossCpuCount(0)
+                , crossNodeCount(0)
+                , latency()
+                , inflight()
+                , submitCpus()
+                , completeCpus() {}
+
+        uint64_t ioCount;
+        uint64_t crossCpuCount;
+        uint64_t crossNodeCount;
+        LatencySamples latency;
+        /** Queue and completion time of IOs, for the queue depth */
+        std::vector<std::pair<uint64_t, uint64_t>> inflight;
+        std::set<uint32_t> submitCpus;
+        std::set<uint32_t> completeCpus;
+    };
+
+    struct DeviceHwQueues {
+        DeviceHwQueues()
+                : name()
+                , hwQueues() {}
+
+        std::string name;
+        std::map<uint32_t, HwQueue> hwQueues;
+    };
+
+    void readRequests(const std::string &tracePath);
+
+    /**
+     * @brief Attributes IOs to requests completed before the event
+     */
+    void applyRequests(uint64_t sid);
+
+    void handleCompletion(uint64_t timestamp, const PendingIo &io);
+
+    /**
+     * @brief Fills average and maximum queue depth of the hardware queue
+     */
+    static void fillDepth(HwQueue &hwQueue, proto::HwQueueStatistics *stats);
+
+private:
+    const bool m_printIo;
+    /** Hardware queue events of requests sorted by sequence ID */
+    std::vector<RequestHwQueue> m_requests;
+    size_t m_nextRequest;
+    /** IOs in flight keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_ios;
+    std::map<uint64_t, DeviceHwQueues> m_devices;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_HWQUEUEPARSER_H
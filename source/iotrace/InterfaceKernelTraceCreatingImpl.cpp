@@ -4,8 +4,10 @@
  */
 
 #include <sys/types.h>
+#include <unistd.h>
 #include <chrono>
 #include <cstdio>
+#include <ctime>
 #include <regex>
 #include <string>
 #include <thread>
@@ -14,14 +16,37 @@
 #include <octf/proto/trace.pb.h>
 #include <octf/trace/iotrace_event.h>
 #include <octf/utils/Exception.h>
+#include <octf/utils/FrameworkConfiguration.h>
 #include <octf/utils/Log.h>
 #include "InterfaceKernelTraceCreatingImpl.h"
+#include "InterfaceTraceExtensionParsingImpl.h"
+#include "KernelTraceControl.h"
+#include "KernelTraceDaemon.h"
 #include "KernelTraceExecutor.h"
+#include "TraceSegmentIndex.h"
+#include "TraceSegmentRetention.h"
 
 namespace octf {
 
+static constexpr uint64_t MiB = 1024ULL * 1024ULL;
+
 InterfaceKernelTraceCreatingImpl::InterfaceKernelTraceCreatingImpl()
-        : m_nodePath{NodeId("kernel")} {}
+        : m_nodePath{NodeId("kernel")}
+        , m_bpf()
+        , m_mux()
+        , m_stopEvent()
+        , m_clientPid(::getpid()) {}
+
+InterfaceKernelTraceCreatingImpl::InterfaceKernelTraceCreatingImpl(
+        std::shared_ptr<KernelTraceBpf> bpf,
+        std::shared_ptr<KernelTraceMux> mux,
+        std::shared_ptr<KernelTraceStopEvent> stopEvent,
+        pid_t clientPid)
+        : m_nodePath{NodeId("kernel")}
+        , m_bpf(bpf)
+        , m_mux(mux)
+        , m_stopEvent(stopEvent)
+        , m_clientPid(clientPid) {}
 
 bool InterfaceKernelTraceCreatingImpl::checkIntegerParameters(
         const uint32_t value,
@@ -45,10 +70,19 @@ void InterfaceKernelTraceCreatingImpl::StartTracing(
         ::google::protobuf::Closure *done) {
     (void) response;
     try {
+        if (!m_bpf && !m_mux && KernelTraceDaemonClient::isRunning()) {
+            // Trace with eBPF programs kept loaded by the tracing daemon
+            KernelTraceDaemonClient client;
+            client.startTracing(*request, response);
+            done->Run();
+            return;
+        }
+
         std::map<std::string, std::string> tags;
         uint32_t maxDuration = request->maxduration();
         auto maxSize = request->maxsize();
         auto circBufferSize = request->circbuffersize();
+        auto slowIoThreshold = request->slowiothreshold();
         const auto &descriptor = request->descriptor();
 
         if (!checkIntegerParameters(maxDuration, "maxduration", descriptor)) {
@@ -61,6 +95,10 @@ void InterfaceKernelTraceCreatingImpl::StartTracing(
                                     descriptor)) {
             throw Exception("Invalid circular buffer size");
         }
+        if (!checkIntegerParameters(slowIoThreshold, "slowiothreshold",
+                                    descriptor)) {
+            throw Exception("Invalid slow IO threshold");
+        }
         /* Parse tags */
         for (const auto &tag : request->tag()) {
             parseTag(tag, tags);
@@ -72,27 +110,84 @@ void InterfaceKernelTraceCreatingImpl::StartTracing(
             devices[i] = request->devicepaths(i);
         }
 
-        KernelTraceExecutor kernelExecutor(devices, circBufferSize);
+        KernelTraceOptions options;
+        options.slowIoThreshold = slowIoThreshold * 1000ULL;
+        for (const auto &param : request->slowiodevices()) {
+            parseSlowIoDevice(param, options.deviceSlowIoThreshold);
+        }
 
-        TraceManager manager(m_nodePath, &kernelExecutor);
-        for (const auto &tag : tags) {
-            manager.addTag(tag.first, tag.second);
+        auto segmentSize = request->segmentsize();
+        auto segmentDuration = request->segmentduration();
+        if (!checkIntegerParameters(segmentSize, "segmentsize", descriptor)) {
+            throw Exception("Invalid trace segment size");
+        }
+        if (!checkIntegerParameters(request->retainsize(), "retainsize",
+                                    descriptor)) {
+            throw Exception("Invalid retained trace segments size");
+        }
+        if (!checkIntegerParameters(request->writermemory(), "writermemory",
+                                    descriptor)) {
+            throw Exception("Invalid writer memory");
+        }
+        options.writerMemoryLimit = request->writermemory() * MiB;
+        options.capture = KernelTraceBpf::parseCapture(request->capture());
+        options.requestTime = request->requesttime();
+        options.bioEvents = request->bioevents();
+        options.hwQueue = request->hwqueue();
+        options.process = request->process();
+        options.stream = request->stream();
+        options.streamOnly = request->streamonly();
+        options.hugePages = request->hugepages();
+        options.metrics = request->metrics();
+        options.segmented = segmentSize || segmentDuration;
+        options.bpf = m_bpf;
+        options.mux = m_mux;
+        options.stopEvent = m_stopEvent;
+        if (!options.segmented &&
+            (request->retainsegments() || request->retainsize())) {
+            throw Exception("Retention policy requires trace segments");
         }
 
-        manager.startJobs(maxDuration, maxSize, circBufferSize,
-                          SerializerType::FileSerializer);
+        KernelTraceExecutor kernelExecutor(devices, circBufferSize, options);
 
-        kernelExecutor.waitUntilStopTrace();
+        // Allow changing traced devices while tracing
+        KernelTraceControlServer control(kernelExecutor);
+        try {
+            control.start(m_clientPid);
+        } catch (Exception &e) {
+            log::cerr << e.what() << ", traced devices cannot be changed "
+                      << "while tracing" << std::endl;
+        }
 
-        manager.stopJobs();
+        if (!options.segmented) {
+            traceSegment(kernelExecutor, tags, maxDuration, maxSize,
+                         circBufferSize, true, controller, response);
+            if (request->cache() && !options.streamOnly &&
+                !controller->Failed()) {
+                InterfaceTraceExtensionParsingImpl::fillCache(
+                        response->tracepath());
+            }
+        } else {
+            traceSegments(kernelExecutor, tags, request, controller,
+                          response);
+        }
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
 
-        TracingState state = manager.getState();
-        manager.fillTraceSummary(response, state);
+    done->Run();
+}
 
-        if (state != TracingState::COMPLETE) {
-            controller->SetFailed("Tracing not completed, trace path " +
-                                  response->tracepath());
-        }
+void InterfaceKernelTraceCreatingImpl::ControlTracing(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ControlTracingRequest *request,
+        ::octf::proto::TracedDeviceList *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        KernelTraceControlClient client(request->pid());
+        client.control(*request, response);
     } catch (Exception &e) {
         controller->SetFailed(e.what());
     } catch (std::exception &e) {
@@ -102,6 +197,209 @@ void InterfaceKernelTraceCreatingImpl::StartTracing(
     done->Run();
 }
 
+void InterfaceKernelTraceCreatingImpl::StartDaemon(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::StartDaemonRequest *request,
+        ::octf::proto::Void *response,
+        ::google::protobuf::Closure *done) {
+    (void) response;
+    try {
+        KernelTraceDaemon daemon(request->unload(),
+                                 KernelTraceBpf::parseCapture(
+                                         request->capture()));
+        daemon.run();
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceKernelTraceCreatingImpl::StopTracing(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::StopTracingRequest *request,
+        ::octf::proto::Void *response,
+        ::google::protobuf::Closure *done) {
+    (void) response;
+    try {
+        KernelTraceDaemonClient client;
+        client.stopTracing(*request);
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceKernelTraceCreatingImpl::traceSegments(
+        KernelTraceExecutor &executor,
+        const std::map<std::string, std::string> &tags,
+        const proto::StartIoTraceRequest *request,
+        ::google::protobuf::RpcController *controller,
+        proto::TraceSummary *response) {
+    uint32_t maxDuration = request->maxduration();
+    uint64_t maxSize = request->maxsize() * MiB;
+    uint32_t segmentSize = request->segmentsize();
+    uint32_t segmentDuration = request->segmentduration();
+    uint32_t circBufferSize = request->circbuffersize();
+
+    // With a retention policy, the max size limits the kept segments, and
+    // tracing goes on until the max duration, removing the oldest segments.
+    // Otherwise it limits all segments written in the session.
+    bool retained = request->retainsegments() || request->retainsize();
+    uint64_t retainSize = request->retainsize() * MiB;
+    if (retained && (!retainSize || retainSize > maxSize)) {
+        retainSize = maxSize;
+    }
+
+    TraceSegmentRetention retention(
+            getFrameworkConfiguration().getTraceRepositoryPath(),
+            request->retainsegments(), retainSize);
+    auto start = std::chrono::steady_clock::now();
+    auto session = std::to_string(std::time(nullptr));
+    // Bytes written in the segments limited by the max size
+    uint64_t sessionSize = 0;
+
+    for (uint64_t index = 0;; index++) {
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+        uint32_t size = sessionSize < maxSize
+                                ? (maxSize - sessionSize) / MiB
+                                : 0;
+        if (elapsed >= maxDuration || !size) {
+            // Maximum trace duration or size reached at the end of previous
+            // segment
+            executor.finishSegments();
+            executor.stopTrace();
+            break;
+        }
+
+        // Limits of the session end tracing, limits of the segment rotate it
+        uint32_t duration = maxDuration - elapsed;
+        bool lastSegment = true;
+        if (segmentDuration && segmentDuration < duration) {
+            duration = segmentDuration;
+            lastSegment = false;
+        }
+        if (segmentSize && segmentSize < size) {
+            size = segmentSize;
+            lastSegment = false;
+        }
+        if (retained) {
+            // A segment reaching the max size is rotated, not the last one
+            lastSegment = false;
+        }
+
+        auto segmentTags = tags;
+        segmentTags["segment.session"] = session;
+        segmentTags["segment.index"] = std::to_string(index);
+
+        bool next = traceSegment(executor, segmentTags, duration, size,
+                                 circBufferSize, lastSegment, controller,
+                                 response);
+        if (controller->Failed()) {
+            break;
+        }
+
+        log::cout << "Trace segment " << index
+                  << " sealed, trace path: " << response->tracepath()
+                  << std::endl;
+        TraceSegmentIndex::addSegment(response->tracepath(), session, index);
+        uint64_t segmentBytes = retention.addSegment(response->tracepath());
+        if (!retained) {
+            sessionSize += segmentBytes;
+        }
+
+        if (!next) {
+            break;
+        }
+    }
+
+    if (request->cache() && !request->streamonly()) {
+        // Segments are parsed when tracing ends, not to delay the next ones
+        for (const auto &segment : retention.getSegments()) {
+            InterfaceTraceExtensionParsingImpl::fillCache(segment);
+        }
+    }
+}
+
+bool InterfaceKernelTraceCreatingImpl::traceSegment(
+        KernelTraceExecutor &executor,
+        const std::map<std::string, std::string> &tags,
+        uint32_t maxDuration,
+        uint32_t maxSize,
+        uint32_t circBufferSize,
+        bool lastSegment,
+        ::google::protobuf::RpcController *controller,
+        proto::TraceSummary *response) {
+    if (lastSegment) {
+        executor.finishSegments();
+    }
+
+    TraceManager manager(m_nodePath, &executor);
+    for (const auto &tag : tags) {
+        manager.addTag(tag.first, tag.second);
+    }
+
+    manager.startJobs(maxDuration, maxSize, circBufferSize,
+                      SerializerType::FileSerializer);
+
+    executor.waitUntilStopTrace();
+
+    bool next = executor.isSegmentEnd();
+    if (!next) {
+        executor.finishSegments();
+    }
+
+    manager.stopJobs();
+
+    TracingState state = manager.getState();
+    manager.fillTraceSummary(response, state);
+
+    executor.commitTraceExtension(
+            getFrameworkConfiguration().getTraceRepositoryPath() + "/" +
+            response->tracepath());
+    fillWriterStats("trace", executor.getTraceWriterStats(), response);
+    fillWriterStats("extension", executor.getTraceExtensionWriterStats(),
+                    response);
+
+    if (state != TracingState::COMPLETE) {
+        controller->SetFailed("Tracing not completed, trace path " +
+                              response->tracepath());
+        if (next) {
+            executor.finishSegments();
+            executor.stopTrace();
+        }
+        return false;
+    }
+
+    return next;
+}
+
+void InterfaceKernelTraceCreatingImpl::fillWriterStats(
+        const std::string &prefix,
+        const AsyncWriterStats &stats,
+        proto::TraceSummary *response) {
+    if (!stats.writes) {
+        return;
+    }
+
+    auto &tags = *response->mutable_tags();
+    tags[prefix + ".writes"] = std::to_string(stats.writes);
+    tags[prefix + ".write_latency_avg_us"] =
+            std::to_string(stats.totalLatency / stats.writes / 1000);
+    tags[prefix + ".write_latency_max_us"] =
+            std::to_string(stats.maxLatency / 1000);
+    tags[prefix + ".write_stalls"] = std::to_string(stats.stalls);
+    tags[prefix + ".write_stall_time_us"] =
+            std::to_string(stats.stallTime / 1000);
+}
+
 void InterfaceKernelTraceCreatingImpl::parseTag(
         const std::string &tag,
         std::map<std::string, std::string> &tags) {
@@ -137,4 +435,34 @@ void InterfaceKernelTraceCreatingImpl::parseTag(
     }
 }
 
+void InterfaceKernelTraceCreatingImpl::parseSlowIoDevice(
+        const std::string &param,
+        std::map<std::string, uint64_t> &thresholds) {
+    auto delimiter = param.rfind('=');
+    if (0 == delimiter || delimiter == param.npos) {
+        throw Exception("Invalid slow IO device, expected "
+                        "<device path>=<microseconds>, " +
+                        param);
+    }
+
+    auto device = param.substr(0, delimiter);
+    auto value = param.substr(delimiter + 1);
+
+    uint64_t threshold = 0;
+    size_t pos = 0;
+    try {
+        threshold = std::stoull(value, &pos);
+    } catch (std::exception &) {
+        pos = 0;
+    }
+
+    if (0 == pos || pos != value.length() || threshold > UINT32_MAX ||
+        !checkIntegerParameters(threshold, "slowiothreshold",
+                                proto::StartIoTraceRequest::descriptor())) {
+        throw Exception("Invalid slow IO threshold of device " + device);
+    }
+
+    thresholds[device] = threshold * 1000ULL;
+}
+
 }  // namespace octf
@@ -6,9 +6,12 @@
 #ifndef SOURCE_USERSPACE_INTERFACEKERNELTRACECREATINGIMPL_H
 #define SOURCE_USERSPACE_INTERFACEKERNELTRACECREATINGIMPL_H
 
+#include <sys/types.h>
+#include <memory>
 #include <octf/interface/ITraceExecutor.h>
 #include <octf/node/INode.h>
 #include "InterfaceKernelTraceCreating.pb.h"
+#include "KernelTraceExecutor.h"
 
 namespace octf {
 
@@ -22,6 +25,21 @@ public:
      * @param nodePath Path to owner node
      */
     InterfaceKernelTraceCreatingImpl();
+
+    /**
+     * @brief Interface of tracing sessions run by the tracing daemon
+     *
+     * @param bpf eBPF programs of the session, if not shared
+     * @param mux eBPF programs kept loaded by the daemon, shared by sessions
+     * @param stopEvent Event stopping the tracing session
+     * @param clientPid PID of the client of the session, which names the
+     * control socket of the session
+     */
+    InterfaceKernelTraceCreatingImpl(
+            std::shared_ptr<KernelTraceBpf> bpf,
+            std::shared_ptr<KernelTraceMux> mux,
+            std::shared_ptr<KernelTraceStopEvent> stopEvent,
+            pid_t clientPid);
     virtual ~InterfaceKernelTraceCreatingImpl() = default;
 
     virtual void StartTracing(::google::protobuf::RpcController *controller,
@@ -29,7 +47,58 @@ public:
                               ::octf::proto::TraceSummary *response,
                               ::google::protobuf::Closure *done);
 
+    virtual void ControlTracing(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ControlTracingRequest *request,
+            ::octf::proto::TracedDeviceList *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void StartDaemon(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::StartDaemonRequest *request,
+            ::octf::proto::Void *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void StopTracing(::google::protobuf::RpcController *controller,
+                             const ::octf::proto::StopTracingRequest *request,
+                             ::octf::proto::Void *response,
+                             ::google::protobuf::Closure *done);
+
 private:
+    /**
+     * @brief Runs one trace manager on the kernel trace executor
+     *
+     * @return True if tracing continues in the next segment
+     */
+    bool traceSegment(KernelTraceExecutor &executor,
+                      const std::map<std::string, std::string> &tags,
+                      uint32_t maxDuration,
+                      uint32_t maxSize,
+                      uint32_t circBufferSize,
+                      bool lastSegment,
+                      ::google::protobuf::RpcController *controller,
+                      proto::TraceSummary *response);
+
+    /**
+     * @brief Traces in segments until interrupted or the maximum trace
+     * duration is reached
+     */
+    void traceSegments(KernelTraceExecutor &executor,
+                       const std::map<std::string, std::string> &tags,
+                       const proto::StartIoTraceRequest *request,
+                       ::google::protobuf::RpcController *controller,
+                       proto::TraceSummary *response);
+
+    /**
+     * @brief Reports write statistics of trace files in tags of the trace
+     * summary
+     *
+     * @param prefix Prefix of tags, e.g. "extension" for the trace extension
+     */
+    void fillWriterStats(const std::string &prefix,
+                         const AsyncWriterStats &stats,
+                         proto::TraceSummary *response);
+
     bool checkIntegerParameters(
             const uint32_t value,
             const std::string &fieldName,
@@ -38,8 +107,16 @@ private:
     void parseTag(const std::string &tag,
                   std::map<std::string, std::string> &tags);
 
+    void parseSlowIoDevice(const std::string &param,
+                           std::map<std::string, uint64_t> &thresholds);
+
 private:
     const NodePath m_nodePath;
+    std::shared_ptr<KernelTraceBpf> m_bpf;
+    std::shared_ptr<KernelTraceMux> m_mux;
+    std::shared_ptr<KernelTraceStopEvent> m_stopEvent;
+    /** PID of the process which started tracing */
+    const pid_t m_clientPid;
 };
 
 }  // namespace octf
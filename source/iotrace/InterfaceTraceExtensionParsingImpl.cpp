@@ -0,0 +1,349 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "InterfaceTraceExtensionParsingImpl.h"
+
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "AccessPatternParser.h"
+#include "FilePathParser.h"
+#include "FingerprintParser.h"
+#include "HwQueueParser.h"
+#include "IoStackingParser.h"
+#include "ParserCache.h"
+#include "ProcessIoParser.h"
+#include "RequestLatencyParser.h"
+#include "TimeSeriesParser.h"
+#include "TraceDiffParser.h"
+#include "TraceSegmentIndex.h"
+#include "WorkloadFingerprint.h"
+
+namespace octf {
+
+void InterfaceTraceExtensionParsingImpl::ParseRequestLatency(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ParseRequestLatencyRequest *request,
+        ::octf::proto::RequestLatencySummary *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        auto options = *request;
+        options.clear_path();
+        ParserCache cache(options, {request->path()}, !request->io());
+
+        if (!cache.load(response)) {
+            RequestLatencyParser parser(request->path(), request->io(),
+                                        request->filter());
+            parser.processEvents();
+            parser.getSummary(response);
+            cache.store(*response);
+        }
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceTraceExtensionParsingImpl::ParseIoStacking(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ParseIoStackingRequest *request,
+        ::octf::proto::IoStackingSummary *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        auto options = *request;
+        options.clear_path();
+        ParserCache cache(options, {request->path()}, !request->io());
+
+        if (!cache.load(response)) {
+            IoStackingParser parser(request->path(), request->io(),
+                                    request->filter());
+            parser.processEvents();
+            parser.getSummary(response);
+            cache.store(*response);
+        }
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceTraceExtensionParsingImpl::ParseHwQueues(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ParseHwQueuesRequest *request,
+        ::octf::proto::HwQueuesSummary *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        auto options = *request;
+        options.clear_path();
+        ParserCache cache(options, {request->path()}, !request->io());
+
+        if (!cache.load(response)) {
+            HwQueueParser parser(request->path(), request->io(),
+                                 request->filter());
+            parser.processEvents();
+            parser.getSummary(response);
+            cache.store(*response);
+        }
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceTraceExtensionParsingImpl::ParseProcessIo(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ParseProcessIoRequest *request,
+        ::octf::proto::ProcessIoSummary *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        auto options = *request;
+        options.clear_path();
+        ParserCache cache(options, {request->path()}, !request->io());
+
+        if (!cache.load(response)) {
+            ProcessIoParser parser(request->path(), request->io(),
+                                   request->filter());
+            parser.setFilter(request->cgroup(), request->pid(),
+                             request->comm());
+            parser.processEvents();
+            parser.getSummary(response);
+            cache.store(*response);
+        }
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceTraceExtensionParsingImpl::ParsePathStatistics(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ParsePathStatisticsRequest *request,
+        ::octf::proto::PathStatisticsSummary *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        parsePathStatistics(*request, response);
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceTraceExtensionParsingImpl::ParseAccessPattern(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ParseAccessPatternRequest *request,
+        ::octf::proto::AccessPatternSummary *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        parseAccessPattern(*request, response);
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceTraceExtensionParsingImpl::ParseTimeSeries(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ParseTimeSeriesRequest *request,
+        ::octf::proto::TimeSeriesSummary *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        parseTimeSeries(*request, response);
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceTraceExtensionParsingImpl::ParseFingerprint(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ParseFingerprintRequest *request,
+        ::octf::proto::FingerprintSummary *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        // Only the summary of the trace is cached, not the written files
+        auto options = *request;
+        options.clear_path();
+        ParserCache cache(options, {request->path()},
+                          !request->path().empty() &&
+                                  request->input().empty() &&
+                                  request->output().empty());
+
+        if (!cache.load(response)) {
+            WorkloadFingerprint fingerprint;
+
+            if (!request->input().empty()) {
+                fingerprint.load(request->input());
+            } else if (!request->path().empty()) {
+                FingerprintParser parser(request->path(), request->filter());
+                parser.processEvents();
+                parser.getFingerprint(fingerprint);
+            } else {
+                throw Exception("Path to trace or fingerprint required");
+            }
+
+            if (!request->output().empty()) {
+                fingerprint.save(request->output() + ".fingerprint");
+                fingerprint.writeFioJobs(request->output() + ".fio");
+            }
+
+            fingerprint.getSummary(response);
+            cache.store(*response);
+        }
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceTraceExtensionParsingImpl::ParseTraceDiff(
+        ::google::protobuf::RpcController *controller,
+        const ::octf::proto::ParseTraceDiffRequest *request,
+        ::octf::proto::TraceDiffSummary *response,
+        ::google::protobuf::Closure *done) {
+    try {
+        // Paths of both traces are in the summary, so they are a part of the
+        // key
+        ParserCache cache(*request, {request->path(), request->baseline()},
+                          true);
+
+        if (!cache.load(response)) {
+            TraceDiffParser::diff(request->baseline(), request->path(),
+                                  request->filter(), response);
+            cache.store(*response);
+        }
+    } catch (Exception &e) {
+        controller->SetFailed(e.what());
+    } catch (std::exception &e) {
+        controller->SetFailed(e.what());
+    }
+
+    done->Run();
+}
+
+void InterfaceTraceExtensionParsingImpl::fillCache(
+        const std::string &tracePath) {
+    // Requests as given on the command line with default options
+    proto::ParseTimeSeriesRequest timeSeries;
+    timeSeries.add_path(tracePath);
+    timeSeries.set_interval(1);
+
+    proto::ParseAccessPatternRequest accessPattern;
+    accessPattern.set_path(tracePath);
+    accessPattern.set_interval(1);
+
+    proto::ParsePathStatisticsRequest pathStatistics;
+    pathStatistics.set_path(tracePath);
+
+    try {
+        proto::TimeSeriesSummary timeSeriesSummary;
+        parseTimeSeries(timeSeries, &timeSeriesSummary);
+
+        proto::AccessPatternSummary accessPatternSummary;
+        parseAccessPattern(accessPattern, &accessPatternSummary);
+    } catch (Exception &e) {
+        log::cerr << "Cannot fill parser cache of trace " << tracePath << ", "
+                  << e.what() << std::endl;
+        return;
+    } catch (std::exception &e) {
+        log::cerr << "Cannot fill parser cache of trace " << tracePath << ", "
+                  << e.what() << std::endl;
+        return;
+    }
+
+    try {
+        proto::PathStatisticsSummary pathStatisticsSummary;
+        parsePathStatistics(pathStatistics, &pathStatisticsSummary);
+    } catch (Exception &e) {
+        // The trace was captured without paths
+        log::verbose << e.what() << std::endl;
+    }
+}
+
+void InterfaceTraceExtensionParsingImpl::parsePathStatistics(
+        const proto::ParsePathStatisticsRequest &request,
+        proto::PathStatisticsSummary *response) {
+    auto options = request;
+    options.clear_path();
+    ParserCache cache(options, {request.path()}, !request.io());
+
+    if (!cache.load(response)) {
+        FilePathParser parser(request.path(), request.io(), request.filter());
+        parser.processEvents();
+        parser.getSummary(response);
+        cache.store(*response);
+    }
+}
+
+void InterfaceTraceExtensionParsingImpl::parseAccessPattern(
+        const proto::ParseAccessPatternRequest &request,
+        proto::AccessPatternSummary *response) {
+    auto options = request;
+    options.clear_path();
+    ParserCache cache(options, {request.path()}, !request.io());
+
+    if (!cache.load(response)) {
+        AccessPatternParser parser(request.path(), request.io(),
+                                   request.interval(), request.filter());
+        parser.processEvents();
+        parser.getSummary(response);
+        cache.store(*response);
+    }
+}
+
+void InterfaceTraceExtensionParsingImpl::parseTimeSeries(
+        const proto::ParseTimeSeriesRequest &request,
+        proto::TimeSeriesSummary *response) {
+    std::vector<std::string> paths(request.path().begin(),
+                                   request.path().end());
+    if (!request.segments().empty()) {
+        if (paths.size() != 1) {
+            throw Exception("Segment range requires a single trace path");
+        }
+        paths = TraceSegmentIndex::findSegments(paths.front(),
+                                                request.segments());
+    }
+
+    // Samples written to the CSV file are not cached
+    auto options = request;
+    options.clear_path();
+    options.clear_segments();
+    ParserCache cache(options, paths, request.csv().empty());
+
+    if (!cache.load(response)) {
+        auto parser = TimeSeriesParser::parse(paths, request.interval(),
+                                              request.filter());
+        if (request.csv().empty()) {
+            parser->getSummary(response);
+        } else {
+            parser->writeCsv(request.csv(), response);
+        }
+        cache.store(*response);
+    }
+}
+
+}  // namespace octf
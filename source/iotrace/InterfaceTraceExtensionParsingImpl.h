@@ -0,0 +1,101 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_INTERFACETRACEEXTENSIONPARSINGIMPL_H
+#define SOURCE_USERSPACE_INTERFACETRACEEXTENSIONPARSINGIMPL_H
+
+#include <string>
+#include "InterfaceTraceExtensionParsing.pb.h"
+
+namespace octf {
+
+/**
+ * @brief Interface parsing events of the trace extension file together with
+ * the trace
+ */
+class InterfaceTraceExtensionParsingImpl
+        : public proto::InterfaceTraceExtensionParsing {
+public:
+    InterfaceTraceExtensionParsingImpl() = default;
+    virtual ~InterfaceTraceExtensionParsingImpl() = default;
+
+    virtual void ParseRequestLatency(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ParseRequestLatencyRequest *request,
+            ::octf::proto::RequestLatencySummary *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void ParseIoStacking(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ParseIoStackingRequest *request,
+            ::octf::proto::IoStackingSummary *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void ParseHwQueues(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ParseHwQueuesRequest *request,
+            ::octf::proto::HwQueuesSummary *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void ParseProcessIo(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ParseProcessIoRequest *request,
+            ::octf::proto::ProcessIoSummary *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void ParsePathStatistics(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ParsePathStatisticsRequest *request,
+            ::octf::proto::PathStatisticsSummary *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void ParseAccessPattern(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ParseAccessPatternRequest *request,
+            ::octf::proto::AccessPatternSummary *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void ParseTimeSeries(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ParseTimeSeriesRequest *request,
+            ::octf::proto::TimeSeriesSummary *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void ParseFingerprint(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ParseFingerprintRequest *request,
+            ::octf::proto::FingerprintSummary *response,
+            ::google::protobuf::Closure *done);
+
+    virtual void ParseTraceDiff(
+            ::google::protobuf::RpcController *controller,
+            const ::octf::proto::ParseTraceDiffRequest *request,
+            ::octf::proto::TraceDiffSummary *response,
+            ::google::protobuf::Closure *done);
+
+    /**
+     * @brief Fills the parser cache of the trace with results of commands
+     * with default options: time series, access pattern and path statistics
+     *
+     * @param tracePath Path of the trace, relative to the trace repository
+     */
+    static void fillCache(const std::string &tracePath);
+
+private:
+    static void parsePathStatistics(
+            const proto::ParsePathStatisticsRequest &request,
+            proto::PathStatisticsSummary *response);
+
+    static void parseAccessPattern(
+            const proto::ParseAccessPatternRequest &request,
+            proto::AccessPatternSummary *response);
+
+    static void parseTimeSeries(const proto::ParseTimeSeriesRequest &request,
+                                proto::TimeSeriesSummary *response);
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_INTERFACETRACEEXTENSIONPARSINGIMPL_H
@@ -0,0 +1,460 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "IoFilter.h"
+
+#include <fnmatch.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <octf/utils/Exception.h>
+
+namespace octf {
+
+/* Values evaluated at once, bits of the evaluation stack */
+static constexpr size_t STACK_DEPTH_MAX = 64;
+
+/* Nesting of parentheses and negations */
+static constexpr size_t NESTING_MAX = 32;
+
+struct Unit {
+    const char *name;
+    uint64_t multiplier;
+};
+
+static const Unit SIZE_UNITS[] = {
+        {"", 1},
+        {"b", 1},
+        {"k", 1ULL << 10},
+        {"kb", 1ULL << 10},
+        {"kib", 1ULL << 10},
+        {"m", 1ULL << 20},
+        {"mb", 1ULL << 20},
+        {"mib", 1ULL << 20},
+        {"g", 1ULL << 30},
+        {"gb", 1ULL << 30},
+        {"gib", 1ULL << 30},
+        {nullptr, 0},
+};
+
+static const Unit LATENCY_UNITS[] = {
+        {"", 1},
+        {"ns", 1},
+        {"us", 1000ULL},
+        {"ms", 1000ULL * 1000},
+        {"s", 1000ULL * 1000 * 1000},
+        {nullptr, 0},
+};
+
+static const Unit NO_UNITS[] = {
+        {"", 1},
+        {nullptr, 0},
+};
+
+static const std::string DEVICE_PREFIX = "/dev/";
+
+static std::string stripDevicePrefix(const std::string &name) {
+    if (name.compare(0, DEVICE_PREFIX.size(), DEVICE_PREFIX) == 0) {
+        return name.substr(DEVICE_PREFIX.size());
+    }
+    return name;
+}
+
+/**
+ * @brief Compares name of the device with the name given without /dev/
+ */
+static bool isDeviceName(const std::string &name, const std::string &given) {
+    if (name.compare(0, DEVICE_PREFIX.size(), DEVICE_PREFIX) == 0) {
+        return name.compare(DEVICE_PREFIX.size(), std::string::npos, given) ==
+               0;
+    }
+    return name == given;
+}
+
+/**
+ * @brief Compiles the expression into the program by recursive descent
+ */
+class IoFilter::Compiler {
+public:
+    Compiler(const std::string &expression, IoFilter &filter)
+            : m_expression(expression)
+            , m_filter(filter)
+            , m_pos(0)
+            , m_nesting(0)
+            , m_depth(0) {}
+
+    void compile() {
+        skipSpaces();
+        if (m_pos == m_expression.size()) {
+            return;
+        }
+
+        parseOr();
+        if (m_pos != m_expression.size()) {
+            fail("unexpected '" + rest() + "'");
+        }
+    }
+
+private:
+    void fail(const std::string &reason) {
+        throw Exception("Invalid filter expression, " + reason +
+                        " at position " + std::to_string(m_pos + 1));
+    }
+
+    void skipSpaces() {
+        while (m_pos < m_expression.size() &&
+               std::isspace((unsigned char) m_expression[m_pos])) {
+            m_pos++;
+        }
+    }
+
+    /**
+     * @brief Returns the rest of the expression up to the next space, for
+     * error messages
+     */
+    std::string rest() {
+        skipSpaces();
+        size_t end = m_pos;
+        while (end < m_expression.size() &&
+               !std::isspace((unsigned char) m_expression[end])) {
+            end++;
+        }
+        return m_expression.substr(m_pos, end - m_pos);
+    }
+
+    static bool isOperatorChar(char c) {
+        return std::string("&|!()<>=\"").find(c) != std::string::npos;
+    }
+
+    /**
+     * @brief Returns the next token without consuming it, empty at the end
+     */
+    std::string peek() {
+        static const char *operators[] = {"&&", "||", "==", "!=", "<=", ">=",
+                                          "!",  "(",  ")",  "<",  ">"};
+
+        skipSpaces();
+        for (const auto op : operators) {
+            if (m_expression.compare(m_pos, std::strlen(op), op) == 0) {
+                return op;
+            }
+        }
+        return "";
+    }
+
+    bool accept(const std::string &op) {
+        if (peek() == op) {
+            m_pos += op.size();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Reads the word, a name or a value, quoted if it has spaces or
+     * operators
+     */
+    std::string word() {
+        skipSpaces();
+        std::string result;
+
+        if (m_pos < m_expression.size() && m_expression[m_pos] == '"') {
+            auto end = m_expression.find('"', m_pos + 1);
+            if (end == std::string::npos) {
+                fail("unterminated quote");
+            }
+            result = m_expression.substr(m_pos + 1, end - m_pos - 1);
+            m_pos = end + 1;
+            return result;
+        }
+
+        while (m_pos < m_expression.size() &&
+               !std::isspace((unsigned char) m_expression[m_pos]) &&
+               !isOperatorChar(m_expression[m_pos])) {
+            result += m_expression[m_pos++];
+        }
+        if (result.empty()) {
+            fail(m_pos < m_expression.size() ? "unexpected '" + rest() + "'"
+                                             : "unexpected end");
+        }
+        return result;
+    }
+
+    void emit(Instruction::Code code) {
+        Instruction instruction = {};
+        instruction.code = code;
+        emit(instruction);
+    }
+
+    void emit(const Instruction &instruction) {
+        if (instruction.code == Instruction::Compare) {
+            if (++m_depth > STACK_DEPTH_MAX) {
+                fail("expression is too complex");
+            }
+        } else if (instruction.code != Instruction::Not) {
+            m_depth--;
+        }
+        m_filter.m_program.push_back(instruction);
+    }
+
+    void parseOr() {
+        parseAnd();
+        while (accept("||")) {
+            parseAnd();
+            emit(Instruction::Or);
+        }
+    }
+
+    void parseAnd() {
+        parseUnary();
+        while (accept("&&")) {
+            parseUnary();
+            emit(Instruction::And);
+        }
+    }
+
+    void parseUnary() {
+        if (++m_nesting > NESTING_MAX) {
+            fail("expression is nested too deeply");
+        }
+
+        if (accept("!")) {
+            parseUnary();
+            emit(Instruction::Not);
+        } else if (accept("(")) {
+            parseOr();
+            if (!accept(")")) {
+                fail("missing ')'");
+            }
+        } else {
+            parseComparison();
+        }
+
+        m_nesting--;
+    }
+
+    void parseComparison() {
+        Instruction instruction = {};
+        instruction.code = Instruction::Compare;
+
+        auto field = word();
+        if (field == "dev") {
+            instruction.field = Device;
+        } else if (field == "op") {
+            instruction.field = Operation;
+        } else if (field == "size") {
+            instruction.field = Size;
+        } else if (field == "lba") {
+            instruction.field = Lba;
+        } else if (field == "lat") {
+            instruction.field = Latency;
+            m_filter.m_deferred = true;
+        } else if (field == "path") {
+            instruction.field = Path;
+            m_filter.m_deferred = true;
+            m_filter.m_usingPaths = true;
+        } else {
+            m_pos -= field.size();
+            fail("unknown field '" + field + "'");
+        }
+
+        if (accept("==")) {
+            instruction.comparison = Equal;
+        } else if (accept("!=")) {
+            instruction.comparison = NotEqual;
+        } else if (accept("<=")) {
+            instruction.comparison = LessEqual;
+        } else if (accept(">=")) {
+            instruction.comparison = GreaterEqual;
+        } else if (accept("<")) {
+            instruction.comparison = Less;
+        } else if (accept(">")) {
+            instruction.comparison = Greater;
+        } else {
+            fail("missing comparison of '" + field + "'");
+        }
+
+        auto value = word();
+        switch (instruction.field) {
+        case Device:
+            instruction.text = stripDevicePrefix(value);
+            break;
+        case Path:
+            instruction.text = value;
+            break;
+        case Operation:
+            if (value == "read") {
+                instruction.number = proto::trace::IoType::Read;
+            } else if (value == "write") {
+                instruction.number = proto::trace::IoType::Write;
+            } else if (value == "discard") {
+                instruction.number = proto::trace::IoType::Discard;
+            } else {
+                fail("unknown operation '" + value + "'");
+            }
+            break;
+        case Size:
+            instruction.number = parseNumber(value, SIZE_UNITS);
+            break;
+        case Lba:
+            instruction.number = parseNumber(value, NO_UNITS);
+            break;
+        case Latency:
+            instruction.number = parseNumber(value, LATENCY_UNITS);
+            break;
+        }
+
+        bool ordered = instruction.comparison != Equal &&
+                       instruction.comparison != NotEqual;
+        if (ordered && (instruction.field == Device ||
+                        instruction.field == Operation ||
+                        instruction.field == Path)) {
+            fail("'" + field + "' is compared by == or != only");
+        }
+
+        emit(instruction);
+    }
+
+    uint64_t parseNumber(const std::string &value, const Unit *units) {
+        size_t end = 0;
+        while (end < value.size() &&
+               (std::isdigit((unsigned char) value[end]) ||
+                value[end] == '.')) {
+            end++;
+        }
+
+        std::string unit = value.substr(end);
+        std::transform(unit.begin(), unit.end(), unit.begin(), ::tolower);
+        for (; units->name; units++) {
+            if (unit != units->name) {
+                continue;
+            }
+
+            char *numberEnd = nullptr;
+            auto number = value.substr(0, end);
+            double result = std::strtod(number.c_str(), &numberEnd);
+            if (number.empty() || *numberEnd) {
+                break;
+            }
+
+            result = std::round(result * units->multiplier);
+            if (result >= 18446744073709551615.0) {
+                fail("value '" + value + "' is too large");
+            }
+            return (uint64_t) result;
+        }
+
+        fail("invalid value '" + value + "'");
+        return 0;
+    }
+
+private:
+    const std::string &m_expression;
+    IoFilter &m_filter;
+    size_t m_pos;
+    size_t m_nesting;
+    size_t m_depth;
+};
+
+IoFilter::IoFilter(const std::string &expression)
+        : m_program()
+        , m_deferred(false)
+        , m_usingPaths(false) {
+    Compiler(expression, *this).compile();
+}
+
+bool IoFilter::isEmpty() const {
+    return m_program.empty();
+}
+
+bool IoFilter::isDeferred() const {
+    return m_deferred;
+}
+
+bool IoFilter::isUsingPaths() const {
+    return m_usingPaths;
+}
+
+bool IoFilter::compare(const Instruction &instruction, const Io &io) const {
+    uint64_t value = 0;
+
+    switch (instruction.field) {
+    case Device:
+        if (!io.device) {
+            return false;
+        }
+        return isDeviceName(*io.device, instruction.text) ==
+               (instruction.comparison == Equal);
+    case Path:
+        if (!io.path) {
+            return false;
+        }
+        return (fnmatch(instruction.text.c_str(), io.path->c_str(), 0) ==
+                0) == (instruction.comparison == Equal);
+    case Operation:
+        value = io.operation;
+        break;
+    case Size:
+        value = io.size;
+        break;
+    case Lba:
+        value = io.lba;
+        break;
+    case Latency:
+        if (!io.hasLatency) {
+            return false;
+        }
+        value = io.latency;
+        break;
+    }
+
+    switch (instruction.comparison) {
+    case Equal:
+        return value == instruction.number;
+    case NotEqual:
+        return value != instruction.number;
+    case Less:
+        return value < instruction.number;
+    case LessEqual:
+        return value <= instruction.number;
+    case Greater:
+        return value > instruction.number;
+    case GreaterEqual:
+        return value >= instruction.number;
+    }
+    return false;
+}
+
+bool IoFilter::matches(const Io &io) const {
+    // Stack of results of the postfix program, one bit per result
+    uint64_t stack = 1;
+    bool top;
+
+    for (const auto &instruction : m_program) {
+        switch (instruction.code) {
+        case Instruction::Compare:
+            stack = (stack << 1) | compare(instruction, io);
+            break;
+        case Instruction::And:
+            top = stack & 1;
+            stack >>= 1;
+            stack = (stack & ~1ULL) | ((stack & 1) && top);
+            break;
+        case Instruction::Or:
+            top = stack & 1;
+            stack >>= 1;
+            stack = (stack & ~1ULL) | ((stack & 1) || top);
+            break;
+        case Instruction::Not:
+            stack ^= 1;
+            break;
+        }
+    }
+    return stack & 1;
+}
+
+}  // namespace octf
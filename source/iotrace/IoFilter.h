@@ -0,0 +1,93 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_IOFILTER_H
+#define SOURCE_USERSPACE_IOFILTER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <octf/proto/trace.pb.h>
+
+namespace octf {
+
+/**
+ * @brief Filter expression of IOs, compiled once and evaluated per IO
+ *
+ * The expression compares fields of IOs with values, and combines the
+ * comparisons with &&, || and !, grouped by parentheses, e.g.
+ * "dev==nvme0n1 && op==write && (size>128k || lat>5ms)". Fields are:
+ *
+ * - dev, name of the device, with or without /dev/
+ * - op, operation: read, write or discard
+ * - size, size in bytes, with an optional unit: k, m, g (powers of 1024)
+ * - lba, first sector of the IO
+ * - lat, latency in ns, with an optional unit: ns, us, ms, s
+ * - path, path of the file, a pattern with * and ? wildcards
+ *
+ * Names and paths are compared by == and != only, other fields by any of
+ * ==, !=, <, <=, > and >=. Comparisons of fields the IO lacks, e.g. latency
+ * of an IO without completion, are false.
+ */
+class IoFilter {
+public:
+    /** Fields of the IO, null or without latency when unknown */
+    struct Io {
+        const std::string *device;
+        proto::trace::IoType operation;
+        uint64_t size;
+        uint64_t lba;
+        bool hasLatency;
+        uint64_t latency;
+        const std::string *path;
+    };
+
+    /**
+     * @param expression Filter expression, empty to pass all IOs
+     *
+     * @throws Exception Invalid expression
+     */
+    IoFilter(const std::string &expression);
+    virtual ~IoFilter() = default;
+
+    bool isEmpty() const;
+
+    /**
+     * @retval true The filter compares latency or path, which are known
+     * after submission of the IO
+     */
+    bool isDeferred() const;
+
+    bool isUsingPaths() const;
+
+    bool matches(const Io &io) const;
+
+private:
+    enum Field { Device, Operation, Size, Lba, Latency, Path };
+
+    enum Comparison { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+    /** Instruction of the program, the expression in postfix notation */
+    struct Instruction {
+        enum Code { Compare, And, Or, Not } code;
+        Field field;
+        Comparison comparison;
+        uint64_t number;
+        std::string text;
+    };
+
+    class Compiler;
+
+    bool compare(const Instruction &instruction, const Io &io) const;
+
+private:
+    std::vector<Instruction> m_program;
+    bool m_deferred;
+    bool m_usingPaths;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_IOFILTER_H
@@ -0,0 +1,334 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "IoStackingParser.h"
+
+#include <google/protobuf/util/json_util.h>
+#include <algorithm>
+#include <cstdint>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "TraceExtensionReader.h"
+#include "iotrace_event_ext.h"
+
+namespace octf {
+
+IoStackingParser::IoStackingParser(const std::string &tracePath,
+                                   bool printIo,
+                                   const std::string &filter)
+        : FilteredTraceEventHandler(tracePath, filter)
+        , m_printIo(printIo)
+        , m_events()
+        , m_nextEvent(0)
+        , m_ios()
+        , m_splits()
+        , m_devices()
+        , m_remaps() {
+    readBioEvents(tracePath);
+}
+
+void IoStackingParser::readBioEvents(const std::string &tracePath) {
+    TraceExtensionReader reader(tracePath);
+    if (!reader.isPresent()) {
+        throw Exception("Trace has no bio events, trace with --bio-events");
+    }
+
+    while (auto hdr = reader.next()) {
+        BioEvent event = {};
+        event.sid = hdr->sid;
+        event.timestamp = hdr->timestamp;
+        event.type = hdr->type;
+
+        if (hdr->type == iotrace_event_type_bio_split) {
+            if (hdr->size != sizeof(struct iotrace_event_bio_split)) {
+                throw Exception("Invalid split event in trace extension");
+            }
+
+            auto ev = reinterpret_cast<const struct iotrace_event_bio_split *>(
+                    hdr);
+            event.id = ev->ref_id;
+            event.deviceId = ev->dev_id;
+            event.lba = ev->lba;
+            event.len = ev->len;
+            event.parentId = ev->parent_id;
+        } else if (hdr->type == iotrace_event_type_bio_merge) {
+            if (hdr->size != sizeof(struct iotrace_event_bio_merge)) {
+                throw Exception("Invalid merge event in trace extension");
+            }
+
+            auto ev = reinterpret_cast<const struct iotrace_event_bio_merge *>(
+                    hdr);
+            event.id = ev->ref_id;
+            event.deviceId = ev->dev_id;
+            event.lba = ev->lba;
+            event.len = ev->len;
+            event.front = ev->front;
+        } else if (hdr->type == iotrace_event_type_bio_remap) {
+            if (hdr->size != sizeof(struct iotrace_event_bio_remap)) {
+                throw Exception("Invalid remap event in trace extension");
+            }
+
+            auto ev = reinterpret_cast<const struct iotrace_event_bio_remap *>(
+                    hdr);
+            event.id = ev->ref_id;
+            event.deviceId = ev->dev_id;
+            event.lba = ev->lba;
+            event.len = ev->len;
+            event.fromDeviceId = ev->from_dev_id;
+            event.fromPartitionId = ev->from_partition_id;
+            event.fromLba = ev->from_lba;
+        } else {
+            continue;
+        }
+
+        m_events.push_back(event);
+    }
+
+    // Extension events are written in order of CPUs, not sequence IDs
+    std::sort(m_events.begin(), m_events.end(),
+              [](const BioEvent &a, const BioEvent &b) {
+                  return a.sid < b.sid;
+              });
+}
+
+void IoStackingParser::applyBioEvents(uint64_t sid) {
+    for (; m_nextEvent < m_events.size(); m_nextEvent++) {
+        const auto &event = m_events[m_nextEvent];
+        if (event.sid > sid) {
+            break;
+        }
+
+        if (event.type == iotrace_event_type_bio_split) {
+            handleSplit(event);
+        } else if (event.type == iotrace_event_type_bio_remap) {
+            handleRemap(event);
+        } else if (event.front) {
+            m_devices[event.deviceId].frontMergeCount++;
+        } else {
+            m_devices[event.deviceId].backMergeCount++;
+        }
+    }
+}
+
+void IoStackingParser::handleSplit(const BioEvent &event) {
+    m_devices[event.deviceId].splitCount++;
+
+    // The parent IO is split into the split off IO and its remaining part
+    auto iter = m_splits.find(event.parentId);
+    if (iter == m_splits.end()) {
+        m_splits[event.parentId] = {event.deviceId, 2};
+    } else {
+        iter->second.pieces++;
+    }
+}
+
+void IoStackingParser::handleRemap(const BioEvent &event) {
+    auto &remap = m_remaps[std::make_tuple(
+            event.fromDeviceId, event.fromPartitionId, event.deviceId)];
+    int64_t offset = static_cast<int64_t>(event.lba - event.fromLba);
+
+    if (!remap.count) {
+        remap.minOffset = offset;
+        remap.maxOffset = offset;
+    } else {
+        remap.minOffset = std::min(remap.minOffset, offset);
+        remap.maxOffset = std::max(remap.maxOffset, offset);
+    }
+    remap.count++;
+
+    // Partitions remap the IO itself, stacked devices remap clones of it
+    const PendingIo *upper = nullptr;
+    if (!event.fromPartitionId) {
+        upper = findIo(event.fromDeviceId, event.fromLba);
+    }
+    if (upper) {
+        remap.linkedCount++;
+    }
+
+    if (m_printIo) {
+        proto::IoRemapLink result;
+        result.set_sid(event.sid);
+        result.set_timestamp(event.timestamp);
+        result.set_id(event.id);
+        result.set_deviceid(event.deviceId);
+        result.set_lba(event.lba);
+        result.set_len(event.len);
+        result.set_fromdeviceid(event.fromDeviceId);
+        result.set_frompartitionid(event.fromPartitionId);
+        result.set_fromlba(event.fromLba);
+        if (upper) {
+            result.set_uppersid(upper->sid);
+            result.set_upperlba(upper->lba);
+            result.set_upperlen(upper->len);
+        }
+
+        std::string json;
+        google::protobuf::util::MessageToJsonString(result, &json);
+        log::cout << json << std::endl;
+    }
+}
+
+void IoStackingParser::handleIo(uint64_t sid,
+                                const proto::trace::EventIo &event) {
+    if (!event.id()) {
+        return;
+    }
+
+    // Remaining part of a split IO may be queued again with the same ID
+    bool requeued = m_ios.count(event.id());
+    removeIo(event.id());
+
+    auto &device = m_devices[event.deviceid()];
+    if (!requeued) {
+        device.ioCount++;
+    }
+    device.ios.emplace(event.lba(), event.id());
+    device.maxLen = std::max(device.maxLen, event.len());
+
+    PendingIo io = {};
+    io.sid = sid;
+    io.deviceId = event.deviceid();
+    io.lba = event.lba();
+    io.len = event.len();
+    m_ios[event.id()] = io;
+}
+
+void IoStackingParser::removeIo(uint64_t id) {
+    auto iter = m_ios.find(id);
+    if (iter != m_ios.end()) {
+        auto &ios = m_devices[iter->second.deviceId].ios;
+        auto range = ios.equal_range(iter->second.lba);
+        for (auto io = range.first; io != range.second; io++) {
+            if (io->second == id) {
+                ios.erase(io);
+                break;
+            }
+        }
+        m_ios.erase(iter);
+    }
+}
+
+void IoStackingParser::finishSplit(uint64_t deviceId, uint64_t pieces) {
+    auto &device = m_devices[deviceId];
+    device.splitIoCount++;
+    device.fanOutSum += pieces;
+    device.maxFanOut = std::max(device.maxFanOut, pieces);
+}
+
+const IoStackingParser::PendingIo *IoStackingParser::findIo(uint64_t deviceId,
+                                                            uint64_t lba) {
+    auto device = m_devices.find(deviceId);
+    if (device == m_devices.end()) {
+        return nullptr;
+    }
+
+    // IOs starting at most the longest IO length before the LBA are checked
+    const auto &ios = device->second.ios;
+    auto iter = ios.upper_bound(lba);
+    while (iter != ios.begin()) {
+        iter--;
+        if (iter->first + device->second.maxLen <= lba) {
+            break;
+        }
+
+        const auto &io = m_ios.at(iter->second);
+        if (lba < io.lba + io.len) {
+            return &io;
+        }
+    }
+
+    return nullptr;
+}
+
+void IoStackingParser::handleFilteredEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    const auto &header = traceEvent->header();
+    applyBioEvents(header.sid());
+
+    if (traceEvent->has_devicedescription()) {
+        const auto &desc = traceEvent->devicedescription();
+        m_devices[desc.id()].name = desc.name();
+    } else if (traceEvent->has_io()) {
+        handleIo(header.sid(), traceEvent->io());
+    } else if (traceEvent->has_iocompletion()) {
+        auto id = traceEvent->iocompletion().refsid();
+        removeIo(id);
+
+        auto iter = m_splits.find(id);
+        if (iter != m_splits.end()) {
+            finishSplit(iter->second.deviceId, iter->second.pieces);
+            m_splits.erase(iter);
+        }
+    }
+}
+
+void IoStackingParser::getSummary(proto::IoStackingSummary *summary) {
+    summary->Clear();
+
+    // Events after the last IO event of the trace
+    applyBioEvents(UINT64_MAX);
+
+    // IOs split and not completed while tracing
+    for (const auto &split : m_splits) {
+        finishSplit(split.second.deviceId, split.second.pieces);
+    }
+    m_splits.clear();
+
+    for (const auto &entry : m_devices) {
+        const auto &device = entry.second;
+        if (!device.ioCount && !device.splitCount && !device.backMergeCount &&
+            !device.frontMergeCount) {
+            continue;
+        }
+
+        auto result = summary->add_devices();
+        result->set_id(entry.first);
+        result->set_name(device.name);
+        result->set_iocount(device.ioCount);
+        result->set_splitcount(device.splitCount);
+        result->set_splitiocount(device.splitIoCount);
+        if (device.splitIoCount) {
+            result->set_averagefanout(static_cast<double>(device.fanOutSum) /
+                                      device.splitIoCount);
+        }
+        result->set_maxfanout(device.maxFanOut);
+        result->set_backmergecount(device.backMergeCount);
+        result->set_frontmergecount(device.frontMergeCount);
+        if (device.ioCount) {
+            result->set_mergerate(
+                    static_cast<double>(device.backMergeCount +
+                                        device.frontMergeCount) /
+                    device.ioCount);
+        }
+    }
+
+    for (const auto &entry : m_remaps) {
+        const auto &remap = entry.second;
+        auto result = summary->add_remaps();
+
+        uint64_t fromDeviceId = std::get<0>(entry.first);
+        uint64_t deviceId = std::get<2>(entry.first);
+
+        result->set_fromdeviceid(fromDeviceId);
+        result->set_frompartitionid(std::get<1>(entry.first));
+        result->set_deviceid(deviceId);
+
+        auto from = m_devices.find(fromDeviceId);
+        if (from != m_devices.end()) {
+            result->set_fromdevicename(from->second.name);
+        }
+        auto to = m_devices.find(deviceId);
+        if (to != m_devices.end()) {
+            result->set_devicename(to->second.name);
+        }
+
+        result->set_count(remap.count);
+        result->set_linkedcount(remap.linkedCount);
+        result->set_minoffset(remap.minOffset);
+        result->set_maxoffset(remap.maxOffset);
+    }
+}
+
+}  // namespace octf
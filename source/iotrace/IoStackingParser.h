@@ -0,0 +1,165 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_IOSTACKINGPARSER_H
+#define SOURCE_USERSPACE_IOSTACKINGPARSER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <tuple>
+#include <vector>
+#include <octf/proto/trace.pb.h>
+#include "FilteredTraceEventHandler.h"
+#include "InterfaceTraceExtensionParsing.pb.h"
+
+namespace octf {
+
+/**
+ * @brief Links IOs across partitions and stacked devices
+ *
+ * Split, merge and remap events of the trace extension are merged with IO
+ * events of the trace by sequence ID. A split is linked with its parent IO by
+ * ID, and a remapped IO with the pending IO of the upper device containing
+ * the LBA it was remapped from.
+ */
+class IoStackingParser : public FilteredTraceEventHandler {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param printIo Print each remap linked with the IO of the upper device
+     * @param filter Filter expression of IOs, see IoFilter
+     */
+    IoStackingParser(const std::string &tracePath,
+                     bool printIo,
+                     const std::string &filter);
+    virtual ~IoStackingParser() = default;
+
+    void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) override;
+
+    /**
+     * @brief Fills statistics of devices and remaps, call after
+     * processEvents()
+     */
+    void getSummary(proto::IoStackingSummary *summary);
+
+private:
+    /** Split, merge or remap, read from the trace extension */
+    struct BioEvent {
+        uint64_t sid;
+        uint64_t timestamp;
+        uint32_t type;
+        uint64_t id;
+        uint64_t deviceId;
+        uint64_t lba;
+        uint32_t len;
+        /** Parent IO of split, device and LBA before remap */
+        uint64_t parentId;
+        uint64_t fromDeviceId;
+        /** Partition before remap, zero for stacked devices */
+        uint64_t fromPartitionId;
+        uint64_t fromLba;
+        bool front;
+    };
+
+    /** IO split and not completed yet */
+    struct SplitIo {
+        uint64_t deviceId;
+        uint64_t pieces;
+    };
+
+    /** IO queued and not completed yet */
+    struct PendingIo {
+        uint64_t sid;
+        uint64_t deviceId;
+        uint64_t lba;
+        uint32_t len;
+    };
+
+    struct DeviceStacking {
+        DeviceStacking()
+                : name()
+                , ioCount(0)
+                , splitCount(0)
+                , splitIoCount(0)
+                , fanOutSum(0)
+                , maxFanOut(0)
+                , backMergeCount(0)
+                , frontMergeCount(0)
+                , ios()
+                , maxLen(0) {}
+
+        std::string name;
+        uint64_t ioCount;
+        uint64_t splitCount;
+        uint64_t splitIoCount;
+        uint64_t fanOutSum;
+        uint64_t maxFanOut;
+        uint64_t backMergeCount;
+        uint64_t frontMergeCount;
+        /** IDs of pending IOs keyed by LBA */
+        std::multimap<uint64_t, uint64_t> ios;
+        /** Length of the longest IO, bounds lookup of LBA in pending IOs */
+        uint32_t maxLen;
+    };
+
+    struct DeviceRemap {
+        DeviceRemap()
+                : count(0)
+                , linkedCount(0)
+                , minOffset(0)
+                , maxOffset(0) {}
+
+        uint64_t count;
+        uint64_t linkedCount;
+        int64_t minOffset;
+        int64_t maxOffset;
+    };
+
+    void readBioEvents(const std::string &tracePath);
+
+    /**
+     * @brief Applies splits, merges and remaps which happened before the
+     * event
+     */
+    void applyBioEvents(uint64_t sid);
+
+    void handleSplit(const BioEvent &event);
+
+    void handleRemap(const BioEvent &event);
+
+    void handleIo(uint64_t sid, const proto::trace::EventIo &event);
+
+    void removeIo(uint64_t id);
+
+    /**
+     * @brief Counts pieces of a split IO, once it completes or tracing ends
+     */
+    void finishSplit(uint64_t deviceId, uint64_t pieces);
+
+    /**
+     * @return Pending IO of the device containing the LBA, nullptr if none
+     */
+    const PendingIo *findIo(uint64_t deviceId, uint64_t lba);
+
+private:
+    const bool m_printIo;
+    /** Splits, merges and remaps sorted by sequence ID */
+    std::vector<BioEvent> m_events;
+    size_t m_nextEvent;
+    /** IOs in flight keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_ios;
+    /** Pieces of split IOs keyed by ID of the parent IO */
+    std::unordered_map<uint64_t, SplitIo> m_splits;
+    std::map<uint64_t, DeviceStacking> m_devices;
+    /** Remaps keyed by device and partition before, and device after remap */
+    std::map<std::tuple<uint64_t, uint64_t, uint64_t>, DeviceRemap> m_remaps;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_IOSTACKINGPARSER_H
@@ -5,7 +5,9 @@
 
 #include "KernelRingTraceProducer.h"
 
+#include <algorithm>
 #include <octf/utils/Exception.h>
+#include "CpuTopology.h"
 
 namespace octf {
 
@@ -14,21 +16,20 @@ KernelRingTraceProducer::KernelRingTraceProducer(
         int cpuId)
         : TraceProducerLocal(cpuId)
         , m_traceBuffer(traceBuffer)
-        , m_cpuId(cpuId) {
-    traceBuffer->pushTrace = [this](const void *trace,
-                                    const uint32_t traceSize) {
-        pushTrace(trace, traceSize);
-    };
-
-    traceBuffer->lostTrace = [this](const uint64_t lost) {
-        octf_trace_add_lost(getTraceProducerHandle(), lost);
-    };
-}
+        , m_cpuId(cpuId) {}
 
 KernelRingTraceProducer::~KernelRingTraceProducer() {}
 
 void KernelRingTraceProducer::initRing(uint32_t memoryPoolSize) {
-    TraceProducerLocal::initRing(memoryPoolSize);
+    if (m_traceBuffer->ringSize) {
+        memoryPoolSize = std::min(memoryPoolSize, m_traceBuffer->ringSize);
+    }
+
+    {
+        // Allocate the ring on the NUMA node of the CPU producing events
+        cputopology::NumaNodePreference numa(cputopology::getCpuNode(m_cpuId));
+        TraceProducerLocal::initRing(memoryPoolSize);
+    }
 
     auto hndl = getTraceProducerHandle();
     auto &refSeqId = *m_traceBuffer->refSeqId;
@@ -42,6 +43,9 @@ void KernelRingTraceProducer::initRing(uint32_t memoryPoolSize) {
             throw Exception("Cannot trace device description");
         }
     }
+
+    // The ring is ready for events polled from the perf buffer
+    m_traceBuffer->trace.store(hndl, std::memory_order_release);
 }
 
 int KernelRingTraceProducer::getCpuAffinity(void) {
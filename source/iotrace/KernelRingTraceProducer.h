@@ -6,14 +6,19 @@
 #ifndef SOURCE_USERSPACE_KERNELRINGTRACEPRODUCER_H
 #define SOURCE_USERSPACE_KERNELRINGTRACEPRODUCER_H
 
+#include <algorithm>
 #include <atomic>
-#include <functional>
+#include <cstddef>
+#include <cstring>
 #include <list>
 #include <memory>
 #include <vector>
 #include <octf/interface/TraceProducerLocal.h>
 #include <octf/trace/iotrace_event.h>
+#include <octf/trace/trace.h>
 #include <octf/utils/NonCopyable.h>
+#include "TraceRingOverflow.h"
+#include "iotrace_event_compact.h"
 
 namespace octf {
 
@@ -22,24 +27,231 @@ typedef std::shared_ptr<KernelRingDevList> KernelRingDevListShRef;
 typedef std::atomic<uint64_t> KernelRingSeqId;
 typedef std::shared_ptr<KernelRingSeqId> KernelRingSeqIdShRef;
 
+/**
+ * @brief Trace ring of one trace queue, fed by the perf buffer polling thread
+ *
+ * Events are pushed without type erased callbacks. Events of fixed size
+ * types are copied with the size known at compile time. Events of a perf
+ * sample, with compact events expanded, are gathered in a batch, which takes
+ * one reservation in the OCTF trace ring and one copy when flushed. Batches
+ * which do not fit into the ring are kept in the overflow buffer until the
+ * ring is drained.
+ */
 struct KernelRingTraceBuffer : public NonCopyable {
     KernelRingTraceBuffer()
             : devs()
-            , refSeqId() {}
+            , refSeqId()
+            , ringSize(0)
+            , trace(nullptr)
+            , overflow()
+            , batch()
+            , batchSize(0)
+            , batchCount(0)
+            , failed(0) {}
     virtual ~KernelRingTraceBuffer() {}
 
+    /**
+     * @brief Appends space of the event to the batch
+     *
+     * @return Space of the event, valid until the next append
+     */
+    inline void *append(uint32_t size) {
+        if (batch.size() < batchSize + size) {
+            batch.resize(std::max<size_t>(2 * batch.size(), batchSize + size));
+        }
+
+        void *event = batch.data() + batchSize;
+        batchSize += size;
+        batchCount++;
+
+        return event;
+    }
+
+    /**
+     * @brief Pushes batched events into the trace ring, or into the overflow
+     * buffer if the ring is full or events are kept there already
+     */
+    inline void flush() {
+        if (!batchSize) {
+            return;
+        }
+
+        octf_trace_t ring = trace.load(std::memory_order_acquire);
+        octf_trace_event_handle_t handle;
+        void *buffer;
+
+        if (overflow.empty() &&
+            !octf_trace_get_wr_buffer(ring, &handle, &buffer, batchSize)) {
+            std::memcpy(buffer, batch.data(), batchSize);
+            octf_trace_commit_wr_buffer(ring, handle);
+        } else if (!overflow.push(batch.data(), batchSize, batchCount)) {
+            failed += batchCount;
+        }
+
+        batchSize = 0;
+        batchCount = 0;
+    }
+
+    /**
+     * @brief Pushes event of the given size
+     */
+    inline void push(const void *event, uint32_t size) {
+        std::memcpy(append(size), event, size);
+    }
+
+    /**
+     * @brief Pushes event of fixed size type
+     */
+    template <typename Event>
+    inline void push(const void *event) {
+        push(event, sizeof(Event));
+    }
+
+    /**
+     * @brief Builds event of fixed size type directly in the batch
+     *
+     * @param fill Function filling the event
+     */
+    template <typename Event, typename Fill>
+    inline void emplace(Fill fill) {
+        fill(*static_cast<Event *>(append(sizeof(Event))));
+    }
+
+    /**
+     * @brief Expands compact IO event into IO and fs_meta events
+     */
+    inline void push(const struct iotrace_event_io_fs *ev) {
+        emplace<struct iotrace_event>([ev](struct iotrace_event &io) {
+            io = ev->io;
+            io.hdr.type = iotrace_event_type_io;
+            io.hdr.size = sizeof(io);
+        });
+
+        emplace<struct iotrace_event_fs_meta>(
+                [ev](struct iotrace_event_fs_meta &meta) {
+                    iotrace_event_init_hdr(
+                            &meta.hdr, iotrace_event_type_fs_meta,
+                            ev->io.hdr.sid + 1, ev->io.hdr.timestamp,
+                            sizeof(meta));
+                    meta.ref_id = ev->io.id;
+                    meta.file_id = ev->file_id;
+                    meta.file_offset = ev->file_offset;
+                    meta.file_size = ev->file_size;
+                    meta.partition_id = ev->partition_id;
+                });
+    }
+
+    /**
+     * @brief Expands compact request completion into bio completion events
+     */
+    inline void push(const struct iotrace_event_io_cmpl_rq *ev) {
+        for (uint32_t i = 0; i < ev->count; i++) {
+            const auto &bio = ev->bios[i];
+
+            emplace<struct iotrace_event_completion>(
+                    [ev, &bio, i](struct iotrace_event_completion &cmpl) {
+                        iotrace_event_init_hdr(
+                                &cmpl.hdr, iotrace_event_type_io_cmpl,
+                                ev->hdr.sid + i, ev->hdr.timestamp,
+                                sizeof(cmpl));
+                        cmpl.ref_id = bio.ref_id;
+                        cmpl.lba = bio.lba;
+                        cmpl.len = bio.len;
+                        cmpl.error = bio.error;
+                        cmpl.dev_id = ev->dev_id;
+                    });
+        }
+    }
+
+    /**
+     * @brief Pushes event of any type, compact events are expanded
+     *
+     * @param hdr Header of the event, the event size is taken from it
+     */
+    inline void push(const struct iotrace_event_hdr *hdr) {
+        switch (hdr->type) {
+        case iotrace_event_type_io:
+            if (hdr->size == sizeof(struct iotrace_event)) {
+                push<struct iotrace_event>(hdr);
+                return;
+            }
+            break;
+        case iotrace_event_type_io_cmpl:
+            if (hdr->size == sizeof(struct iotrace_event_completion)) {
+                push<struct iotrace_event_completion>(hdr);
+                return;
+            }
+            break;
+        case iotrace_event_type_fs_meta:
+            if (hdr->size == sizeof(struct iotrace_event_fs_meta)) {
+                push<struct iotrace_event_fs_meta>(hdr);
+                return;
+            }
+            break;
+        case iotrace_event_type_io_fs:
+            if (hdr->size == sizeof(struct iotrace_event_io_fs)) {
+                push(reinterpret_cast<const struct iotrace_event_io_fs *>(
+                        hdr));
+            } else {
+                failed++;
+            }
+            return;
+        case iotrace_event_type_io_cmpl_rq: {
+            auto ev = reinterpret_cast<const struct iotrace_event_io_cmpl_rq *>(
+                    hdr);
+            if (hdr->size >= offsetof(struct iotrace_event_io_cmpl_rq, bios) &&
+                ev->count <= IOTRACE_EVENT_CMPL_RQ_MAX &&
+                hdr->size == offsetof(struct iotrace_event_io_cmpl_rq, bios) +
+                                     ev->count * sizeof(ev->bios[0])) {
+                push(ev);
+            } else {
+                failed++;
+            }
+            return;
+        }
+        default:
+            break;
+        }
+
+        push(hdr, hdr->size);
+    }
+
+    /**
+     * @brief Reports events lost before reaching the ring
+     */
+    inline void lost(uint64_t count) {
+        octf_trace_add_lost(trace.load(std::memory_order_acquire), count);
+    }
+
     KernelRingDevListShRef devs;
     KernelRingSeqIdShRef refSeqId;
-    std::function<void(const void *trace, const uint32_t traceSize)> pushTrace;
-    std::function<void(const uint64_t lost)> lostTrace;
+    /**
+     * Size of the trace ring (in MiB), limited by the size requested by the
+     * trace manager. Zero allocates the requested size.
+     */
+    uint32_t ringSize;
+    /**
+     * Handle of the OCTF trace ring, set by the trace job when the ring is
+     * initialized, read by the perf buffer polling thread
+     */
+    std::atomic<octf_trace_t> trace;
+    /** Batches of events waiting for space in the trace ring */
+    TraceRingOverflow overflow;
+    /** Events of the perf sample being handled */
+    std::vector<char> batch;
+    /** Size (in bytes) of batched events */
+    uint32_t batchSize;
+    /** Number of batched events */
+    uint32_t batchCount;
+    /** Number of events which did not fit into the ring */
+    uint64_t failed;
 };
 
 /**
  * @brief Producer which utilizes ring buffer.
  *
- * This producer allows reading traces produced in kernel,
- * and utilizes procfs files. Because of this, pushTrace method
- * is not used.
+ * This producer allows reading traces produced in kernel. Events are
+ * pushed through KernelRingTraceBuffer, so pushTrace method is not used.
  */
 class KernelRingTraceProducer : public TraceProducerLocal {
 public:
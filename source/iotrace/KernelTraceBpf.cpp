@@ -0,0 +1,460 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "KernelTraceBpf.h"
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <type_traits>
+#include <vector>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "iotrace.bpf.common.h"
+#include "iotrace.skel.h"
+
+namespace octf {
+
+/* Global variables of eBPF programs, the type is declared in the skeleton */
+typedef std::remove_pointer<decltype(iotrace_bpf::bss)>::type IotraceBss;
+/* Read only variables, set before loading eBPF programs */
+typedef std::remove_pointer<decltype(iotrace_bpf::rodata)>::type IotraceRodata;
+
+/* Names of pinned maps */
+static constexpr const char *PIN_EVENTS = "events";
+static constexpr const char *PIN_DEVICE = "device_map";
+static constexpr const char *PIN_DEVICE_INFLIGHT = "device_inflight_map";
+static constexpr const char *PIN_INFLIGHT = "inflight_map";
+static constexpr const char *PIN_INODE_CACHE = "inode_cache_map";
+static constexpr const char *PIN_INODE_STORAGE = "inode_storage_map";
+static constexpr const char *PIN_NAME_CACHE = "name_cache_map";
+static constexpr const char *PIN_PATH_CACHE = "path_cache_map";
+static constexpr const char *PIN_BSS = "bss";
+static constexpr const char *PIN_RODATA = "rodata";
+/* Prefix of pinned links of attached programs */
+static constexpr const char *PIN_LINK_PREFIX = "link_";
+
+static void clearMap(int fd) {
+    struct bpf_map_info info = {};
+    uint32_t infoSize = sizeof(info);
+
+    if (bpf_obj_get_info_by_fd(fd, &info, &infoSize)) {
+        return;
+    }
+
+    // Deleting the first key each time, since deletion breaks iteration
+    std::vector<char> key(info.key_size);
+    while (!bpf_map_get_next_key(fd, nullptr, key.data())) {
+        if (bpf_map_delete_elem(fd, key.data())) {
+            break;
+        }
+    }
+}
+
+static bool checkValueSize(int fd, uint32_t size) {
+    struct bpf_map_info info = {};
+    uint32_t infoSize = sizeof(info);
+
+    if (bpf_obj_get_info_by_fd(fd, &info, &infoSize)) {
+        return false;
+    }
+
+    return info.value_size == size;
+}
+
+static void pinMap(struct bpf_map *map, const std::string &path) {
+    if (bpf_map__pin(map, path.c_str())) {
+        throw Exception("Cannot pin BPF iotrace map " + path);
+    }
+}
+
+KernelTraceBpf::KernelTraceBpf(KernelTraceCapture capture)
+        : m_skel(nullptr)
+        , m_capture(capture)
+        , m_bss(nullptr)
+        , m_bssMapSize(0)
+        , m_eventsFd(-1)
+        , m_deviceFd(-1)
+        , m_deviceInflightFd(-1)
+        , m_inflightFd(-1)
+        , m_inodeCacheFd(-1)
+        , m_nameCacheFd(-1)
+        , m_pathCacheFd(-1)
+        , m_bssFd(-1) {
+    m_skel = iotrace_bpf__open();
+    if (!m_skel) {
+        throw Exception("Cannot open BPF iotrace program");
+    }
+    setCapture(m_skel, capture);
+
+    /* Load & verify BPF programs */
+    if (iotrace_bpf__load(m_skel)) {
+        close();
+        throw Exception("Cannot load BPF iotrace program");
+    }
+
+    /* Attach trace points handlers */
+    if (iotrace_bpf__attach(m_skel)) {
+        close();
+        throw Exception("Cannot attach BPF iotrace program");
+    }
+
+    m_bss = m_skel->bss;
+    m_eventsFd = bpf_map__fd(m_skel->maps.events);
+    m_deviceFd = bpf_map__fd(m_skel->maps.device_map);
+    m_deviceInflightFd = bpf_map__fd(m_skel->maps.device_inflight_map);
+    m_inflightFd = bpf_map__fd(m_skel->maps.inflight_map);
+    m_inodeCacheFd = bpf_map__fd(m_skel->maps.inode_cache_map);
+    m_nameCacheFd = bpf_map__fd(m_skel->maps.name_cache_map);
+    m_pathCacheFd = bpf_map__fd(m_skel->maps.path_cache_map);
+}
+
+KernelTraceBpf::KernelTraceBpf(const std::string &pinPath,
+                               KernelTraceCapture capture)
+        : m_skel(nullptr)
+        , m_capture(capture)
+        , m_bss(nullptr)
+        , m_bssMapSize(0)
+        , m_eventsFd(-1)
+        , m_deviceFd(-1)
+        , m_deviceInflightFd(-1)
+        , m_inflightFd(-1)
+        , m_inodeCacheFd(-1)
+        , m_nameCacheFd(-1)
+        , m_pathCacheFd(-1)
+        , m_bssFd(-1) {
+    struct stat st;
+    if (::stat(pinPath.c_str(), &st)) {
+        log::cout << "Loading and pinning eBPF programs in " << pinPath
+                  << std::endl;
+        pin(pinPath, capture);
+    }
+
+    try {
+        open(pinPath);
+    } catch (Exception &) {
+        close();
+        throw;
+    }
+
+    if (m_capture != capture) {
+        log::cout << "Pinned eBPF programs capture "
+                  << getCaptureName(m_capture) << " events, pinning them "
+                  << "again to capture " << getCaptureName(capture)
+                  << " events" << std::endl;
+        close();
+        unpin(pinPath);
+        pin(pinPath, capture);
+
+        try {
+            open(pinPath);
+        } catch (Exception &) {
+            close();
+            throw;
+        }
+    }
+}
+
+KernelTraceBpf::~KernelTraceBpf() {
+    close();
+}
+
+KernelTraceCapture KernelTraceBpf::parseCapture(const std::string &name) {
+    if (name.empty()) {
+        return KernelTraceCapture::full;
+    }
+
+    for (auto capture : {KernelTraceCapture::block, KernelTraceCapture::fs,
+                         KernelTraceCapture::full, KernelTraceCapture::paths}) {
+        if (name == getCaptureName(capture)) {
+            return capture;
+        }
+    }
+
+    throw Exception("Invalid captured events " + name +
+                    ", expected block, block+fs, full or paths");
+}
+
+std::string KernelTraceBpf::getCaptureName(KernelTraceCapture capture) {
+    switch (capture) {
+    case KernelTraceCapture::block:
+        return "block";
+    case KernelTraceCapture::fs:
+        return "block+fs";
+    case KernelTraceCapture::full:
+        return "full";
+    case KernelTraceCapture::paths:
+        return "paths";
+    }
+
+    return "unknown";
+}
+
+KernelTraceCapture KernelTraceBpf::getCapture() const {
+    return m_capture;
+}
+
+void KernelTraceBpf::setCapture(struct iotrace_bpf *skel,
+                                KernelTraceCapture capture) {
+    skel->rodata->capture_fs = capture != KernelTraceCapture::block;
+    skel->rodata->capture_file_names = capture == KernelTraceCapture::full;
+    skel->rodata->capture_file_paths = capture == KernelTraceCapture::paths;
+
+    /* Not loaded programs are not attached either */
+    struct bpf_program *fileProgs[] = {
+            skel->progs.post_open,    skel->progs.post_create,
+            skel->progs.pre_unlink,   skel->progs.post_unlink,
+            skel->progs.pre_rename,   skel->progs.post_rename,
+            skel->progs.pre_truncate, skel->progs.post_truncate,
+    };
+    for (auto prog : fileProgs) {
+        bpf_program__set_autoload(prog, skel->rodata->capture_file_names);
+    }
+    bpf_program__set_autoload(skel->progs.open_path,
+                              skel->rodata->capture_file_paths);
+}
+
+void KernelTraceBpf::pin(const std::string &pinPath,
+                         KernelTraceCapture capture) {
+    /*
+     * Pin into temporary directory and rename it at the end, so incompletely
+     * pinned programs are never opened
+     */
+    std::string tmpPath = pinPath + ".tmp";
+    unpin(tmpPath);
+
+    struct iotrace_bpf *skel = iotrace_bpf__open();
+    if (!skel) {
+        throw Exception("Cannot open BPF iotrace program");
+    }
+    setCapture(skel, capture);
+
+    try {
+        if (iotrace_bpf__load(skel)) {
+            throw Exception("Cannot load BPF iotrace program");
+        }
+
+        if (::mkdir(tmpPath.c_str(), 0700)) {
+            throw Exception("Cannot create directory " + tmpPath);
+        }
+
+        pinMap(skel->maps.events, tmpPath + "/" + PIN_EVENTS);
+        pinMap(skel->maps.device_map, tmpPath + "/" + PIN_DEVICE);
+        pinMap(skel->maps.device_inflight_map,
+               tmpPath + "/" + PIN_DEVICE_INFLIGHT);
+        pinMap(skel->maps.inflight_map, tmpPath + "/" + PIN_INFLIGHT);
+        pinMap(skel->maps.inode_cache_map, tmpPath + "/" + PIN_INODE_CACHE);
+        pinMap(skel->maps.inode_storage_map,
+               tmpPath + "/" + PIN_INODE_STORAGE);
+        pinMap(skel->maps.name_cache_map, tmpPath + "/" + PIN_NAME_CACHE);
+        pinMap(skel->maps.path_cache_map, tmpPath + "/" + PIN_PATH_CACHE);
+        pinMap(skel->maps.bss, tmpPath + "/" + PIN_BSS);
+        pinMap(skel->maps.rodata, tmpPath + "/" + PIN_RODATA);
+
+        struct bpf_program *prog;
+        bpf_object__for_each_program(prog, skel->obj) {
+            if (!bpf_program__autoload(prog)) {
+                continue;
+            }
+
+            std::string name = bpf_program__name(prog);
+            std::string path = tmpPath + "/" + PIN_LINK_PREFIX + name;
+
+            struct bpf_link *link = bpf_program__attach(prog);
+            if (libbpf_get_error(link)) {
+                throw Exception("Cannot attach BPF iotrace program " + name);
+            }
+
+            int result = bpf_link__pin(link, path.c_str());
+            bpf_link__destroy(link);
+            if (result) {
+                throw Exception("Cannot pin BPF iotrace program " + name);
+            }
+        }
+
+        if (::rename(tmpPath.c_str(), pinPath.c_str())) {
+            throw Exception("Cannot move pinned eBPF programs to " + pinPath);
+        }
+    } catch (Exception &) {
+        iotrace_bpf__destroy(skel);
+        unpin(tmpPath);
+        throw;
+    }
+
+    /* Pinned links keep programs attached after destroying the skeleton */
+    iotrace_bpf__destroy(skel);
+}
+
+void KernelTraceBpf::unpin(const std::string &pinPath) {
+    DIR *dir = ::opendir(pinPath.c_str());
+    if (!dir) {
+        return;
+    }
+
+    while (struct dirent *entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+
+        /* Removing the last reference to a link detaches its program */
+        std::string path = pinPath + "/" + name;
+        if (::unlink(path.c_str())) {
+            log::cerr << "Cannot unpin " << path << std::endl;
+        }
+    }
+    ::closedir(dir);
+
+    if (::rmdir(pinPath.c_str())) {
+        log::cerr << "Cannot remove directory " << pinPath << std::endl;
+    }
+}
+
+void KernelTraceBpf::open(const std::string &pinPath) {
+    auto get = [&pinPath](const char *name) {
+        std::string path = pinPath + "/" + name;
+
+        int fd = bpf_obj_get(path.c_str());
+        if (fd < 0) {
+            throw Exception("Cannot open pinned BPF iotrace map " + path);
+        }
+
+        return fd;
+    };
+
+    m_eventsFd = get(PIN_EVENTS);
+    m_deviceFd = get(PIN_DEVICE);
+    m_deviceInflightFd = get(PIN_DEVICE_INFLIGHT);
+    m_inflightFd = get(PIN_INFLIGHT);
+    m_inodeCacheFd = get(PIN_INODE_CACHE);
+    m_nameCacheFd = get(PIN_NAME_CACHE);
+    m_pathCacheFd = get(PIN_PATH_CACHE);
+    m_bssFd = get(PIN_BSS);
+    int rodataFd = get(PIN_RODATA);
+
+    IotraceRodata rodata = {};
+    uint32_t key = 0;
+    bool valid = checkValueSize(m_bssFd, sizeof(IotraceBss)) &&
+                 checkValueSize(m_deviceFd,
+                                sizeof(struct iotrace_device_info)) &&
+                 checkValueSize(rodataFd, sizeof(rodata)) &&
+                 !bpf_map_lookup_elem(rodataFd, &key, &rodata);
+    ::close(rodataFd);
+
+    if (!valid) {
+        throw Exception("Pinned eBPF programs do not match this version of "
+                        "iotrace, remove " +
+                        pinPath);
+    }
+
+    if (rodata.capture_file_paths) {
+        m_capture = KernelTraceCapture::paths;
+    } else if (rodata.capture_file_names) {
+        m_capture = KernelTraceCapture::full;
+    } else if (rodata.capture_fs) {
+        m_capture = KernelTraceCapture::fs;
+    } else {
+        m_capture = KernelTraceCapture::block;
+    }
+
+    long pageSize = ::sysconf(_SC_PAGESIZE);
+    m_bssMapSize = (sizeof(IotraceBss) + pageSize - 1) /
+                   pageSize * pageSize;
+
+    void *addr = ::mmap(nullptr, m_bssMapSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, m_bssFd, 0);
+    if (addr == MAP_FAILED) {
+        throw Exception("Cannot map pinned BPF iotrace variables");
+    }
+    m_bss = addr;
+}
+
+void KernelTraceBpf::close() {
+    if (m_skel) {
+        iotrace_bpf__destroy(m_skel);
+        m_skel = nullptr;
+        m_bss = nullptr;
+        return;
+    }
+
+    if (m_bss) {
+        ::munmap(m_bss, m_bssMapSize);
+        m_bss = nullptr;
+    }
+
+    for (auto fd : {m_eventsFd, m_deviceFd, m_deviceInflightFd, m_inflightFd,
+                    m_inodeCacheFd, m_nameCacheFd, m_pathCacheFd, m_bssFd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    m_eventsFd = m_deviceFd = m_deviceInflightFd = m_inflightFd =
+            m_inodeCacheFd = m_nameCacheFd = m_pathCacheFd = m_bssFd = -1;
+}
+
+void KernelTraceBpf::reset(uint64_t refSid) {
+    /* Drop perf buffers of the previous session */
+    clearMap(m_eventsFd);
+    clearMap(m_deviceFd);
+    clearMap(m_deviceInflightFd);
+    clearMap(m_inflightFd);
+    /* File, thread and cgroup names are traced again for each session */
+    clearCaches();
+
+    auto bss = static_cast<IotraceBss *>(m_bss);
+    bss->timebase = 0;
+    bss->path_id = 0;
+    bss->ref_sid = refSid;
+}
+
+void KernelTraceBpf::clearCaches() {
+    clearMap(m_inodeCacheFd);
+    clearMap(m_nameCacheFd);
+    clearMap(m_pathCacheFd);
+}
+
+void KernelTraceBpf::reserveSid(uint64_t sid) {
+    auto bss = static_cast<IotraceBss *>(m_bss);
+    uint64_t current = bss->ref_sid;
+
+    while (current < sid) {
+        uint64_t prev =
+                __sync_val_compare_and_swap(&bss->ref_sid, current, sid);
+        if (prev == current) {
+            break;
+        }
+        current = prev;
+    }
+}
+
+uint64_t KernelTraceBpf::getNextSid() {
+    auto bss = static_cast<IotraceBss *>(m_bss);
+    return __sync_add_and_fetch(&bss->ref_sid, 1);
+}
+
+uint64_t KernelTraceBpf::getTimebase() {
+    auto bss = static_cast<IotraceBss *>(m_bss);
+    return bss->timebase;
+}
+
+int KernelTraceBpf::getEventsMapFd() const {
+    return m_eventsFd;
+}
+
+int KernelTraceBpf::getDeviceMapFd() const {
+    return m_deviceFd;
+}
+
+void KernelTraceBpf::removeDevice(uint64_t id) {
+    bpf_map_delete_elem(m_deviceFd, &id);
+    bpf_map_delete_elem(m_deviceInflightFd, &id);
+}
+
+}  // namespace octf
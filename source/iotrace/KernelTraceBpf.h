@@ -0,0 +1,163 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_KERNELTRACEBPF_H
+#define SOURCE_USERSPACE_KERNELTRACEBPF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <octf/utils/NonCopyable.h>
+
+struct iotrace_bpf;
+
+namespace octf {
+
+/** Default bpffs directory of eBPF programs and maps pinned by the daemon */
+constexpr const char *KERNEL_TRACE_BPF_PIN_PATH = "/sys/fs/bpf/iotrace";
+
+/**
+ * @brief Events captured by eBPF programs
+ *
+ * Features which are not captured are removed by the verifier when loading
+ * eBPF programs, and programs used only by them are not attached.
+ */
+enum class KernelTraceCapture {
+    /** Block IO events only */
+    block,
+
+    /** Block IO events with file system metadata of IOs */
+    fs,
+
+    /** Block IO events with file system metadata and names of files */
+    full,
+
+    /**
+     * Block IO events with file system metadata and full paths of files,
+     * resolved once per file by the kernel
+     */
+    paths,
+};
+
+/**
+ * @brief Loaded and attached eBPF programs of iotrace
+ *
+ * The programs are either private to this process and detached when the
+ * object is destroyed, or pinned in bpffs. Pinned programs and maps stay
+ * loaded and attached after the process exits, so the next process only
+ * opens them, without verification and attaching.
+ */
+class KernelTraceBpf : public NonCopyable {
+public:
+    /**
+     * @brief Loads and attaches eBPF programs private to this process
+     *
+     * @param capture Events captured by the programs
+     */
+    KernelTraceBpf(KernelTraceCapture capture);
+
+    /**
+     * @brief Opens eBPF programs and maps pinned in bpffs
+     *
+     * If not pinned yet, or pinned with other captured events, the programs
+     * are loaded, attached and pinned first.
+     *
+     * @param pinPath bpffs directory of pinned programs and maps
+     * @param capture Events captured by the programs
+     */
+    KernelTraceBpf(const std::string &pinPath, KernelTraceCapture capture);
+
+    virtual ~KernelTraceBpf();
+
+    /**
+     * @brief Detaches and unloads eBPF programs pinned in bpffs
+     *
+     * @param pinPath bpffs directory of pinned programs and maps
+     */
+    static void unpin(const std::string &pinPath);
+
+    /**
+     * @brief Parses name of captured events: block, block+fs, full or paths
+     *
+     * Empty name captures all events (full).
+     *
+     * @throws Exception Unknown name
+     */
+    static KernelTraceCapture parseCapture(const std::string &name);
+
+    static std::string getCaptureName(KernelTraceCapture capture);
+
+    KernelTraceCapture getCapture() const;
+
+    /**
+     * @brief Clears state left in maps by the previous tracing session
+     *
+     * @param refSid Initial sequence ID of events
+     */
+    void reset(uint64_t refSid);
+
+    /**
+     * @brief Clears caches of traced file, thread and cgroup names, so they
+     * are traced again
+     */
+    void clearCaches();
+
+    /**
+     * @brief Makes next sequence IDs of events greater than the given one
+     */
+    void reserveSid(uint64_t sid);
+
+    /**
+     * @return Next sequence ID of events, shared with eBPF programs
+     */
+    uint64_t getNextSid();
+
+    /**
+     * @return Time base of event timestamps (CLOCK_MONOTONIC in ns), zero if
+     * not set yet by eBPF programs
+     */
+    uint64_t getTimebase();
+
+    int getEventsMapFd() const;
+
+    int getDeviceMapFd() const;
+
+    /**
+     * @brief Stops tracing the device and drops its count of IOs in flight
+     */
+    void removeDevice(uint64_t id);
+
+private:
+    static void pin(const std::string &pinPath, KernelTraceCapture capture);
+
+    /**
+     * @brief Sets captured events of opened, not loaded yet programs
+     */
+    static void setCapture(struct iotrace_bpf *skel,
+                           KernelTraceCapture capture);
+
+    void open(const std::string &pinPath);
+
+    void close();
+
+private:
+    struct iotrace_bpf *m_skel;
+    KernelTraceCapture m_capture;
+    /** Global variables of eBPF programs */
+    void *m_bss;
+    size_t m_bssMapSize;
+    int m_eventsFd;
+    int m_deviceFd;
+    int m_deviceInflightFd;
+    int m_inflightFd;
+    int m_inodeCacheFd;
+    int m_nameCacheFd;
+    int m_pathCacheFd;
+    int m_bssFd;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_KERNELTRACEBPF_H
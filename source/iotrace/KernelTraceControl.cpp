@@ -0,0 +1,228 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "KernelTraceControl.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "KernelTraceExecutor.h"
+#include "LocalSocket.h"
+
+namespace octf {
+
+static constexpr const char *CONTROL_SOCKET_SUFFIX = ".sock";
+static constexpr int CONTROL_TIMEOUT_SEC = 5;
+
+static bool wake(int fd) {
+    char value = 0;
+    return ::write(fd, &value, sizeof(value)) == sizeof(value);
+}
+
+KernelTraceControlServer::KernelTraceControlServer(
+        KernelTraceExecutor &executor)
+        : m_executor(executor)
+        , m_socketPath()
+        , m_socket(-1)
+        , m_wakeFd{-1, -1}
+        , m_thread() {}
+
+KernelTraceControlServer::~KernelTraceControlServer() {
+    stop();
+}
+
+std::string KernelTraceControlServer::getSocketPath(pid_t pid) {
+    return std::string(localsocket::SOCKET_DIR) + "/" + std::to_string(pid) +
+           CONTROL_SOCKET_SUFFIX;
+}
+
+void KernelTraceControlServer::start(pid_t pid) {
+    auto path = getSocketPath(pid);
+
+    // Another tracing started by the process serves the socket
+    bool served = false;
+    try {
+        ::close(localsocket::connect(path));
+        served = true;
+    } catch (Exception &) {
+    }
+    if (served) {
+        throw Exception("Tracing control of process " + std::to_string(pid) +
+                        " served already");
+    }
+
+    m_socket = localsocket::listen(path);
+    m_socketPath = path;
+
+    if (::pipe2(m_wakeFd, O_CLOEXEC)) {
+        stop();
+        throw Exception("Cannot start tracing control");
+    }
+
+    m_thread = std::thread([this]() { run(); });
+}
+
+void KernelTraceControlServer::stop() {
+    if (m_thread.joinable()) {
+        wake(m_wakeFd[1]);
+        m_thread.join();
+    }
+
+    for (auto &fd : m_wakeFd) {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    if (m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+
+    if (!m_socketPath.empty()) {
+        ::unlink(m_socketPath.c_str());
+        m_socketPath.clear();
+    }
+}
+
+void KernelTraceControlServer::run() {
+    while (true) {
+        struct pollfd fds[2] = {};
+        fds[0].fd = m_socket;
+        fds[0].events = POLLIN;
+        fds[1].fd = m_wakeFd[0];
+        fds[1].events = POLLIN;
+
+        int result = ::poll(fds, 2, -1);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            log::cerr << "Error polling tracing control socket" << std::endl;
+            break;
+        }
+
+        if (fds[1].revents) {
+            // Stopping
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = ::accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                handleConnection(fd);
+                ::close(fd);
+            }
+        }
+    }
+}
+
+void KernelTraceControlServer::handleConnection(int fd) {
+    proto::ControlTracingRequest request;
+    proto::ControlTracingReply reply;
+
+    localsocket::setTimeout(fd, CONTROL_TIMEOUT_SEC);
+    if (!localsocket::receiveMessage(fd, request)) {
+        log::cerr << "Invalid tracing control request" << std::endl;
+        return;
+    }
+
+    try {
+        for (const auto &device : request.removedevices()) {
+            m_executor.removeDevice(device);
+        }
+        for (const auto &device : request.adddevices()) {
+            m_executor.addDevice(device);
+        }
+    } catch (Exception &e) {
+        reply.set_error(e.what());
+    } catch (std::exception &e) {
+        reply.set_error(e.what());
+    }
+
+    for (const auto &desc : m_executor.getDevices()) {
+        auto device = reply.mutable_devices()->add_device();
+        device->set_name(desc.device_name);
+        device->set_id(desc.id);
+        device->set_size(desc.device_size);
+        device->set_model(desc.device_model);
+    }
+
+    if (!localsocket::sendMessage(fd, reply)) {
+        log::cerr << "Cannot reply to tracing control request" << std::endl;
+    }
+}
+
+KernelTraceControlClient::KernelTraceControlClient(pid_t pid)
+        : m_socketPath() {
+    if (pid) {
+        m_socketPath = KernelTraceControlServer::getSocketPath(pid);
+        return;
+    }
+
+    // Look for the only running tracing
+    DIR *dir = ::opendir(localsocket::SOCKET_DIR);
+    if (!dir) {
+        throw Exception("No running tracing found");
+    }
+
+    std::vector<pid_t> pids;
+    while (struct dirent *entry = ::readdir(dir)) {
+        char *end = nullptr;
+        auto value = std::strtoul(entry->d_name, &end, 10);
+        if (end == entry->d_name || std::strcmp(end, CONTROL_SOCKET_SUFFIX)) {
+            continue;
+        }
+
+        // Skip sockets left by killed tracing
+        pid_t tracingPid = value;
+        if (::kill(tracingPid, 0) == 0 || errno == EPERM) {
+            pids.push_back(tracingPid);
+        }
+    }
+    ::closedir(dir);
+
+    if (pids.empty()) {
+        throw Exception("No running tracing found");
+    } else if (pids.size() > 1) {
+        throw Exception("More than one tracing running, select it by PID");
+    }
+
+    m_socketPath = KernelTraceControlServer::getSocketPath(pids.front());
+}
+
+void KernelTraceControlClient::control(
+        const proto::ControlTracingRequest &request,
+        proto::TracedDeviceList *devices) {
+    int fd = localsocket::connect(m_socketPath);
+
+    proto::ControlTracingReply reply;
+    localsocket::setTimeout(fd, CONTROL_TIMEOUT_SEC);
+    bool result = localsocket::sendMessage(fd, request) &&
+                  localsocket::receiveMessage(fd, reply);
+    ::close(fd);
+
+    if (!result) {
+        throw Exception("No reply from tracing, " + m_socketPath);
+    }
+
+    devices->CopyFrom(reply.devices());
+    if (!reply.error().empty()) {
+        throw Exception(reply.error());
+    }
+}
+
+}  // namespace octf
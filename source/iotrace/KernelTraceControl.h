@@ -0,0 +1,91 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_KERNELTRACECONTROL_H
+#define SOURCE_USERSPACE_KERNELTRACECONTROL_H
+
+#include <sys/types.h>
+#include <string>
+#include <thread>
+#include <octf/utils/NonCopyable.h>
+#include "InterfaceKernelTraceCreating.pb.h"
+
+namespace octf {
+
+class KernelTraceExecutor;
+
+/**
+ * @brief Control server of the running tracing
+ *
+ * The server listens on a Unix socket named after PID of the process which
+ * started tracing: the tracing process, or the client of a tracing session of
+ * the tracing daemon, so each session is controlled on its own.
+ * It receives ControlTracingRequest, adds and removes traced devices of the
+ * kernel trace executor, and replies with ControlTracingReply. Messages are
+ * prefixed with their size (32-bit, host byte order).
+ */
+class KernelTraceControlServer : public NonCopyable {
+public:
+    KernelTraceControlServer(KernelTraceExecutor &executor);
+    virtual ~KernelTraceControlServer();
+
+    /**
+     * @brief Creates control socket and starts serving requests
+     *
+     * @param pid PID of the process which started tracing
+     */
+    void start(pid_t pid);
+
+    /**
+     * @brief Stops serving requests and removes control socket
+     */
+    void stop();
+
+    /**
+     * @return Path of the control socket of the tracing started by the process
+     */
+    static std::string getSocketPath(pid_t pid);
+
+private:
+    void run();
+
+    void handleConnection(int fd);
+
+private:
+    KernelTraceExecutor &m_executor;
+    std::string m_socketPath;
+    int m_socket;
+    int m_wakeFd[2];
+    std::thread m_thread;
+};
+
+/**
+ * @brief Client of the tracing control server
+ */
+class KernelTraceControlClient : public NonCopyable {
+public:
+    /**
+     * @param pid PID of the process which started tracing, zero selects the
+     * only running tracing
+     */
+    KernelTraceControlClient(pid_t pid);
+    virtual ~KernelTraceControlClient() = default;
+
+    /**
+     * @brief Sends control request to the tracing
+     *
+     * @param request Control request
+     * @param[out] devices Devices traced after the request
+     */
+    void control(const proto::ControlTracingRequest &request,
+                 proto::TracedDeviceList *devices);
+
+private:
+    std::string m_socketPath;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_KERNELTRACECONTROL_H
@@ -0,0 +1,457 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "KernelTraceDaemon.h"
+
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <google/protobuf/service.h>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "InterfaceKernelTraceCreatingImpl.h"
+#include "LocalSocket.h"
+
+namespace octf {
+
+static constexpr const char *DAEMON_SOCKET_NAME = "daemon.sock";
+
+namespace {
+
+/**
+ * @brief Controller of tracing sessions started in the daemon
+ */
+class DaemonRpcController : public google::protobuf::RpcController {
+public:
+    DaemonRpcController()
+            : m_failed(false)
+            , m_error() {}
+    virtual ~DaemonRpcController() = default;
+
+    void Reset() override {
+        m_failed = false;
+        m_error.clear();
+    }
+
+    bool Failed() const override {
+        return m_failed;
+    }
+
+    std::string ErrorText() const override {
+        return m_error;
+    }
+
+    void StartCancel() override {}
+
+    void SetFailed(const std::string &reason) override {
+        m_failed = true;
+        m_error = reason;
+    }
+
+    bool IsCanceled() const override {
+        return false;
+    }
+
+    void NotifyOnCancel(google::protobuf::Closure *callback) override {
+        (void) callback;
+    }
+
+private:
+    bool m_failed;
+    std::string m_error;
+};
+
+class DaemonRpcClosure : public google::protobuf::Closure {
+public:
+    void Run() override {}
+};
+
+/**
+ * @brief Blocks SIGINT and SIGTERM, so they are received by signalfd
+ */
+class SignalFd : public NonCopyable {
+public:
+    SignalFd()
+            : m_fd(-1)
+            , m_oldMask() {
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+
+        pthread_sigmask(SIG_BLOCK, &mask, &m_oldMask);
+        m_fd = ::signalfd(-1, &mask, SFD_CLOEXEC);
+        if (m_fd < 0) {
+            pthread_sigmask(SIG_SETMASK, &m_oldMask, nullptr);
+            throw Exception("Cannot create signal file descriptor");
+        }
+    }
+
+    virtual ~SignalFd() {
+        ::close(m_fd);
+        pthread_sigmask(SIG_SETMASK, &m_oldMask, nullptr);
+    }
+
+    int getFd() const {
+        return m_fd;
+    }
+
+    /**
+     * @brief Consumes received signal
+     */
+    void read() {
+        struct signalfd_siginfo info;
+        while (::read(m_fd, &info, sizeof(info)) < 0 && errno == EINTR) {
+        }
+    }
+
+private:
+    int m_fd;
+    sigset_t m_oldMask;
+};
+
+}  // namespace
+
+KernelTraceDaemon::KernelTraceDaemon(bool unload, KernelTraceCapture capture)
+        : m_unload(unload)
+        , m_capture(capture)
+        , m_bpf()
+        , m_mux()
+        , m_sessionMutex()
+        , m_sessions()
+        , m_connections() {}
+
+KernelTraceDaemon::~KernelTraceDaemon() {
+    stopSession();
+    joinConnections(true);
+
+    if (m_bpf) {
+        m_mux.reset();
+        m_bpf.reset();
+
+        if (m_unload) {
+            log::cout << "Unloading eBPF programs" << std::endl;
+            KernelTraceBpf::unpin(KERNEL_TRACE_BPF_PIN_PATH);
+        }
+    }
+}
+
+std::string KernelTraceDaemon::getSocketPath() {
+    return std::string(localsocket::SOCKET_DIR) + "/" + DAEMON_SOCKET_NAME;
+}
+
+void KernelTraceDaemon::run() {
+    if (KernelTraceDaemonClient::isRunning()) {
+        throw Exception("Tracing daemon already running");
+    }
+
+    // Block signals before starting any thread, so all threads inherit it
+    SignalFd signal;
+
+    m_bpf = std::make_shared<KernelTraceBpf>(KERNEL_TRACE_BPF_PIN_PATH,
+                                             m_capture);
+    m_mux = std::make_shared<KernelTraceMux>(m_bpf);
+
+    auto path = getSocketPath();
+    int sock = localsocket::listen(path);
+
+    log::cout << "Tracing daemon ready, eBPF programs pinned in "
+              << KERNEL_TRACE_BPF_PIN_PATH << std::endl;
+
+    while (true) {
+        struct pollfd fds[2] = {};
+        fds[0].fd = sock;
+        fds[0].events = POLLIN;
+        fds[1].fd = signal.getFd();
+        fds[1].events = POLLIN;
+
+        int result = ::poll(fds, 2, -1);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            log::cerr << "Error polling tracing daemon socket" << std::endl;
+            break;
+        }
+
+        if (fds[1].revents) {
+            signal.read();
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = ::accept4(sock, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+
+            joinConnections(false);
+
+            Connection connection;
+            connection.finished = std::make_shared<std::atomic<bool>>(false);
+            auto finished = connection.finished;
+            connection.thread = std::thread([this, fd, finished]() {
+                handleConnection(fd);
+                ::close(fd);
+                *finished = true;
+            });
+            m_connections.push_back(std::move(connection));
+        }
+    }
+
+    log::cout << "Stopping tracing daemon" << std::endl;
+
+    ::close(sock);
+    ::unlink(path.c_str());
+
+    stopSession();
+    joinConnections(true);
+}
+
+void KernelTraceDaemon::joinConnections(bool all) {
+    for (auto iter = m_connections.begin(); iter != m_connections.end();) {
+        if (all || *iter->finished) {
+            iter->thread.join();
+            iter = m_connections.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+}
+
+void KernelTraceDaemon::handleConnection(int fd) {
+    proto::DaemonRequest request;
+
+    if (!localsocket::receiveMessage(fd, request)) {
+        // Client only checked if the daemon is running
+        return;
+    }
+
+    if (request.has_starttracing()) {
+        runSession(fd, request.starttracing());
+    } else {
+        proto::DaemonReply reply;
+
+        if (request.has_stoptracing()) {
+            reply.set_error(stopSessions(request.stoptracing()));
+        }
+
+        localsocket::sendMessage(fd, reply);
+    }
+}
+
+void KernelTraceDaemon::runSession(int fd,
+                                   const proto::StartIoTraceRequest &request) {
+    proto::DaemonReply reply;
+    auto stopEvent = std::make_shared<KernelTraceStopEvent>();
+    pid_t pid = localsocket::getPeerPid(fd);
+
+    {
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        if (!pid || !m_sessions.emplace(pid, stopEvent).second) {
+            reply.set_error("Cannot identify tracing session client");
+            localsocket::sendMessage(fd, reply);
+            return;
+        }
+    }
+
+    // Client going away or shutting down its sending side stops tracing
+    std::atomic<bool> finished(false);
+    std::atomic<bool> hungUp(false);
+    std::thread watcher([fd, &finished, &hungUp, &stopEvent]() {
+        while (!finished) {
+            struct pollfd pfd = {};
+            pfd.fd = fd;
+            pfd.events = POLLRDHUP;
+
+            if (::poll(&pfd, 1, 100) > 0) {
+                // Only a client which shut down its sending side waits for
+                // the reply
+                hungUp = pfd.revents & (POLLHUP | POLLERR);
+                stopEvent->signal();
+                break;
+            }
+        }
+    });
+
+    DaemonRpcController controller;
+    DaemonRpcClosure done;
+
+    try {
+        std::shared_ptr<KernelTraceBpf> bpf;
+        auto mux = m_mux;
+        auto capture = KernelTraceBpf::parseCapture(request.capture());
+        if (capture != m_bpf->getCapture()) {
+            log::cout << "Session captures "
+                      << KernelTraceBpf::getCaptureName(capture)
+                      << " events, loading eBPF programs of the session"
+                      << std::endl;
+            bpf = std::make_shared<KernelTraceBpf>(capture);
+            mux.reset();
+        }
+
+        InterfaceKernelTraceCreatingImpl tracing(bpf, mux, stopEvent, pid);
+
+        log::cout << "Tracing session of process " << pid << " started"
+                  << std::endl;
+        tracing.StartTracing(&controller, &request, reply.mutable_summary(),
+                             &done);
+        if (controller.Failed()) {
+            reply.set_error(controller.ErrorText());
+        }
+    } catch (Exception &e) {
+        reply.set_error(e.what());
+    }
+    log::cout << "Tracing session of process " << pid
+              << " finished, trace path: " << reply.summary().tracepath()
+              << std::endl;
+
+    finished = true;
+    watcher.join();
+
+    {
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        m_sessions.erase(pid);
+    }
+
+    if (!hungUp) {
+        localsocket::sendMessage(fd, reply);
+    }
+}
+
+void KernelTraceDaemon::stopSession() {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    for (const auto &session : m_sessions) {
+        session.second->signal();
+    }
+}
+
+std::string KernelTraceDaemon::stopSessions(
+        const proto::StopTracingRequest &request) {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    if (m_sessions.empty()) {
+        return "Tracing is not running";
+    }
+
+    if (request.all()) {
+        for (const auto &session : m_sessions) {
+            session.second->signal();
+        }
+    } else if (request.pid()) {
+        auto iter = m_sessions.find(request.pid());
+        if (iter == m_sessions.end()) {
+            return "No tracing session of process " +
+                   std::to_string(request.pid());
+        }
+        iter->second->signal();
+    } else if (m_sessions.size() == 1) {
+        m_sessions.begin()->second->signal();
+    } else {
+        return "More than one tracing session running, select it by PID or "
+               "stop all of them";
+    }
+
+    return "";
+}
+
+KernelTraceDaemonClient::KernelTraceDaemonClient()
+        : m_fd(-1) {
+    try {
+        m_fd = localsocket::connect(KernelTraceDaemon::getSocketPath());
+    } catch (Exception &) {
+        throw Exception("Tracing daemon is not running");
+    }
+}
+
+KernelTraceDaemonClient::~KernelTraceDaemonClient() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+bool KernelTraceDaemonClient::isRunning() {
+    try {
+        int fd = localsocket::connect(KernelTraceDaemon::getSocketPath());
+        ::close(fd);
+        return true;
+    } catch (Exception &) {
+        return false;
+    }
+}
+
+void KernelTraceDaemonClient::startTracing(
+        const proto::StartIoTraceRequest &request,
+        proto::TraceSummary *summary) {
+    SignalFd signal;
+    proto::DaemonRequest daemonRequest;
+    daemonRequest.mutable_starttracing()->CopyFrom(request);
+
+    if (!localsocket::sendMessage(m_fd, daemonRequest)) {
+        throw Exception("Cannot start tracing in tracing daemon");
+    }
+
+    log::cout << "Tracing in tracing daemon" << std::endl;
+
+    bool interrupted = false;
+    while (true) {
+        struct pollfd fds[2] = {};
+        fds[0].fd = m_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = signal.getFd();
+        fds[1].events = POLLIN;
+
+        int result = ::poll(fds, interrupted ? 1 : 2, -1);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents) {
+            break;
+        }
+
+        if (fds[1].revents) {
+            // Stop tracing, the daemon replies with the trace summary
+            signal.read();
+            ::shutdown(m_fd, SHUT_WR);
+            interrupted = true;
+        }
+    }
+
+    proto::DaemonReply reply;
+    if (!localsocket::receiveMessage(m_fd, reply)) {
+        throw Exception("Tracing daemon disconnected");
+    }
+
+    summary->CopyFrom(reply.summary());
+    if (!reply.error().empty()) {
+        throw Exception(reply.error());
+    }
+}
+
+void KernelTraceDaemonClient::stopTracing(
+        const proto::StopTracingRequest &stopRequest) {
+    proto::DaemonRequest request;
+    proto::DaemonReply reply;
+
+    request.mutable_stoptracing()->CopyFrom(stopRequest);
+    if (!localsocket::sendMessage(m_fd, request) ||
+        !localsocket::receiveMessage(m_fd, reply)) {
+        throw Exception("No reply from tracing daemon");
+    }
+
+    if (!reply.error().empty()) {
+        throw Exception(reply.error());
+    }
+}
+
+}  // namespace octf
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_KERNELTRACEDAEMON_H
+#define SOURCE_USERSPACE_KERNELTRACEDAEMON_H
+
+#include <sys/types.h>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <octf/utils/NonCopyable.h>
+#include "InterfaceKernelTraceCreating.pb.h"
+#include "KernelTraceBpf.h"
+#include "KernelTraceExecutor.h"
+#include "KernelTraceMux.h"
+
+namespace octf {
+
+/**
+ * @brief Tracing daemon
+ *
+ * The daemon pins eBPF programs and maps in bpffs, so they are loaded,
+ * verified and attached once. Clients start and stop tracing sessions over
+ * a Unix socket, and each session only reparameterizes the maps and starts
+ * consuming events. Sessions run concurrently on the pinned eBPF programs,
+ * each tracing its own devices into its own trace (see KernelTraceMux).
+ * Sessions are identified by PID of their clients.
+ */
+class KernelTraceDaemon : public NonCopyable {
+public:
+    /**
+     * @param unload Unpin eBPF programs and maps when the daemon exits
+     * @param capture Events captured by pinned eBPF programs. Sessions which
+     * capture other events load eBPF programs of their own.
+     */
+    KernelTraceDaemon(bool unload, KernelTraceCapture capture);
+    virtual ~KernelTraceDaemon();
+
+    /**
+     * @brief Serves tracing sessions until receiving SIGINT or SIGTERM
+     */
+    void run();
+
+    /**
+     * @return Path of the daemon socket
+     */
+    static std::string getSocketPath();
+
+private:
+    void handleConnection(int fd);
+
+    void runSession(int fd, const proto::StartIoTraceRequest &request);
+
+    void stopSession();
+
+    /**
+     * @brief Stops sessions selected by the request
+     *
+     * @return Error message, empty if sessions were stopped
+     */
+    std::string stopSessions(const proto::StopTracingRequest &request);
+
+    void joinConnections(bool all);
+
+private:
+    struct Connection {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+
+    const bool m_unload;
+    const KernelTraceCapture m_capture;
+    std::shared_ptr<KernelTraceBpf> m_bpf;
+    std::shared_ptr<KernelTraceMux> m_mux;
+    std::mutex m_sessionMutex;
+    /** Stop events of running sessions by PID of their clients */
+    std::map<pid_t, std::shared_ptr<KernelTraceStopEvent>> m_sessions;
+    std::list<Connection> m_connections;
+};
+
+/**
+ * @brief Client of the tracing daemon
+ */
+class KernelTraceDaemonClient : public NonCopyable {
+public:
+    /**
+     * @brief Connects to the tracing daemon
+     */
+    KernelTraceDaemonClient();
+    virtual ~KernelTraceDaemonClient();
+
+    /**
+     * @retval true Tracing daemon is running
+     */
+    static bool isRunning();
+
+    /**
+     * @brief Runs tracing in the daemon until it ends
+     *
+     * SIGINT or SIGTERM received by the client stops tracing.
+     *
+     * @param request Tracing parameters
+     * @param[out] summary Summary of the trace
+     */
+    void startTracing(const proto::StartIoTraceRequest &request,
+                      proto::TraceSummary *summary);
+
+    /**
+     * @brief Stops tracing sessions running in the daemon
+     *
+     * @param request PID of the client of the stopped session, zero selects
+     * the only running session, or stopping of all sessions
+     */
+    void stopTracing(const proto::StopTracingRequest &request);
+
+private:
+    int m_fd;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_KERNELTRACEDAEMON_H
@@ -6,6 +6,7 @@
 #include "KernelTraceExecutor.h"
 
 #include <blkid/blkid.h>
+#include <bpf/bpf.h>
 #include <fcntl.h>
 #include <linux/fs.h>
 #include <linux/perf_event.h>
@@ -14,6 +15,11 @@
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
 #include <third_party/safestringlib.h>
+#include <time.h>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <exception>
 #include <fstream>
 #include <thread>
 #include <octf/interface/TraceConverter.h>
@@ -21,12 +27,47 @@
 #include <octf/utils/FileOperations.h>
 #include <octf/utils/Log.h>
 #include <octf/utils/SignalHandler.h>
+#include "CpuTopology.h"
+#include "DirectFileSerializer.h"
 #include "KernelRingTraceProducer.h"
 #include "iotrace.bpf.common.h"
-#include "iotrace.skel.h"
+#include "iotrace_event_ext.h"
 
 namespace octf {
 
+/*
+ * Time for which completions of a removed device are still traced, so IOs in
+ * flight at the time of removal are complete in the trace
+ */
+static constexpr auto DEVICE_REMOVAL_GRACE_TIME = std::chrono::seconds(5);
+
+static constexpr uint64_t MiB = 1024ULL * 1024ULL;
+
+/*
+ * Trace rings of the next segment hold events produced at the peak rate of
+ * the previous segment for this time, until the consumer catches up
+ */
+static constexpr uint64_t RING_BACKLOG_TIME_S = 4;
+
+/*
+ * Initial size (in MiB) of trace rings, and minimum size of a trace ring
+ * sized by the observed event rate
+ */
+static constexpr uint64_t RING_MIN_SIZE = 4;
+
+/* Time of waiting for trace rings to take overflowed events at stop */
+static constexpr auto RING_OVERFLOW_FLUSH_TIME = std::chrono::seconds(2);
+
+/* Per CPU perf buffer is this fraction of the trace ring size */
+static constexpr uint64_t PERF_BUFFER_RING_RATIO = 100;
+
+/* Limits of the per CPU perf buffer size (in pages, power of two) */
+static constexpr uint64_t PERF_BUFFER_MIN_PAGES = 8;
+static constexpr uint64_t PERF_BUFFER_MAX_PAGES = 2048;
+
+/* Events buffered for the live stream consumer before being dropped */
+static constexpr uint64_t STREAM_BUFFER_SIZE = 64 * MiB;
+
 static int libbpf_print_fn(enum libbpf_print_level level,
                            const char *format,
                            va_list args) {
@@ -51,30 +92,115 @@ static int libbpf_print_fn(enum libbpf_print_level level,
 
 KernelTraceExecutor::KernelTraceExecutor(
         const std::vector<std::string> &devices,
-        uint32_t ringSizeMiB)
-        : m_traceQueueCount(std::thread::hardware_concurrency())
-        , m_bpf(nullptr)
+        uint32_t ringSizeMiB,
+        const KernelTraceOptions &options)
+        : m_queueCpus(cputopology::getOnlineCpus())
+        , m_traceQueueCount(m_queueCpus.size())
+        , m_cpuQueue()
+        , m_ringSize(ringSizeMiB)
+        , m_perfBufferPages(getPerfBufferPages(ringSizeMiB))
+        , m_capture(options.capture)
+        , m_bpf(options.mux ? options.mux->getBpf() : options.bpf)
+        , m_mux(options.mux)
+        , m_muxSession()
+        , m_stopEvent(options.stopEvent)
         , m_bpfPerf(nullptr)
         , m_bpfPerfBufOpts()
         , m_bpfThread()
         , m_traceProducerRings(m_traceQueueCount)
+        , m_ringLoad(m_traceQueueCount)
+        , m_ringLoadTime()
+        , m_ringLoadObserved(false)
         , m_devList(std::make_shared<KernelRingDevList>())
         , m_refSeqId(std::make_shared<KernelRingSeqId>())
-        , m_running(true) {
-    initDeviceList(devices);
+        , m_devSlowIoThreshold()
+        , m_slowIoThreshold(options.slowIoThreshold)
+        , m_deviceFlags(
+                  (options.requestTime ? IOTRACE_DEVICE_FLAG_RQ_TIME : 0) |
+                  (options.bioEvents ? IOTRACE_DEVICE_FLAG_BIO_EVENTS : 0) |
+                  (options.hwQueue ? IOTRACE_DEVICE_FLAG_HW_QUEUE : 0) |
+                  (options.process ? IOTRACE_DEVICE_FLAG_PROCESS : 0))
+        , m_removedDevices()
+        , m_hugePages(options.hugePages)
+        , m_traceExt(options.writerMemoryLimit)
+        , m_traceWriterMemory(options.writerMemoryLimit / m_traceQueueCount)
+        , m_traceWriterStats(m_traceQueueCount)
+        , m_stream()
+        , m_streamOnly(options.streamOnly)
+        , m_metrics()
+        , m_running(true)
+        , m_segmented(options.segmented)
+        , m_segmentEnd(false)
+        , m_lastSegment(false)
+        , m_pollMutex()
+        , m_pollCv()
+        , m_paused(false)
+        , m_attached(false)
+        , m_controlPending(false) {
+    initDeviceList(devices, options);
+
+    /*
+     * Trace queues are created for online CPUs only. Events of CPUs brought
+     * online later go to queues of other CPUs.
+     */
+    int possibleCpus = libbpf_num_possible_cpus();
+    if (possibleCpus <= m_queueCpus.back()) {
+        possibleCpus = m_queueCpus.back() + 1;
+    }
+    m_cpuQueue.resize(possibleCpus);
+    for (int cpu = 0; cpu < possibleCpus; cpu++) {
+        m_cpuQueue[cpu] = cpu % m_traceQueueCount;
+    }
+    for (uint32_t queue = 0; queue < m_traceQueueCount; queue++) {
+        m_cpuQueue[m_queueCpus[queue]] = queue;
+    }
 
     libbpf_set_strict_mode(LIBBPF_STRICT_ALL);
     libbpf_set_print(libbpf_print_fn);
 
-    /* Open BPF application */
-    m_bpf = iotrace_bpf__open();
-    if (!m_bpf) {
-        throw Exception("Cannot open BPF iotrace program");
+    if (!options.stream.empty()) {
+        m_stream.reset(new EventStream(options.stream, STREAM_BUFFER_SIZE,
+                                       [this]() { return getDevices(); }));
+        log::cout << "Streaming events to "
+                  << EventStream::getSocketPath(options.stream) << std::endl;
+    } else if (m_streamOnly) {
+        throw Exception("Streaming only requires a stream");
+    }
+
+    if (!options.metrics.empty()) {
+        m_metrics.reset(new TraceMetrics(options.metrics,
+                                         [this]() { return getDevices(); }));
+    }
+
+    if (m_mux) {
+        m_muxSession = m_mux->attach();
+        try {
+            for (const auto &dev : *m_devList) {
+                m_mux->claimDevice(m_muxSession, dev.id);
+            }
+        } catch (...) {
+            m_mux->detach(m_muxSession);
+            throw;
+        }
     }
 }
 
 KernelTraceExecutor::~KernelTraceExecutor() {
+    if (m_bpfThread.joinable()) {
+        m_running = false;
+        m_pollCv.notify_all();
+        m_bpfThread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_pollMutex);
     destroyBpf();
+
+    updateMetrics(true);
+
+    if (m_stream) {
+        log::cout << "Streamed events: " << m_stream->getSentCount()
+                  << ", dropped: " << m_stream->getDroppedCount() << std::endl;
+    }
 }
 
 void KernelTraceExecutor::initPerfBuffer() {
@@ -87,54 +213,209 @@ void KernelTraceExecutor::initPerfBuffer() {
     m_bpfPerfBufOpts.lost_cb = perfEventLost;
     m_bpfPerfBufOpts.ctx = this;
 
-    m_bpfPerf = perf_buffer__new(bpf_map__fd(m_bpf->maps.events),
-                                 256 /* 1MiB per CPU */, &m_bpfPerfBufOpts);
+    m_bpfPerf = perf_buffer__new(m_bpf->getEventsMapFd(), m_perfBufferPages,
+                                 &m_bpfPerfBufOpts);
 #else
     m_bpfPerfBufOpts = {};
     m_bpfPerfBufOpts.sz = sizeof(m_bpfPerfBufOpts);
 
-    m_bpfPerf = perf_buffer__new(bpf_map__fd(m_bpf->maps.events),
-                                 256 /* 1MiB per CPU */, perfEventHandler,
-                                 perfEventLost, this, &m_bpfPerfBufOpts);
+    m_bpfPerf = perf_buffer__new(m_bpf->getEventsMapFd(), m_perfBufferPages,
+                                 perfEventHandler, perfEventLost, this,
+                                 &m_bpfPerfBufOpts);
 #endif
 }
 
+uint32_t KernelTraceExecutor::getPerfBufferPages(uint32_t ringSizeMiB) {
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t size = ringSizeMiB * MiB / PERF_BUFFER_RING_RATIO;
+
+    uint64_t pages = PERF_BUFFER_MIN_PAGES;
+    while (pages < PERF_BUFFER_MAX_PAGES && 2 * pages * pageSize <= size) {
+        pages *= 2;
+    }
+
+    return pages;
+}
+
+void KernelTraceExecutor::updateRingLoad() {
+    auto now = std::chrono::steady_clock::now();
+    uint64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               now - m_ringLoadTime)
+                               .count();
+    if (elapsed < 1000) {
+        return;
+    }
+
+    for (auto &load : m_ringLoad) {
+        uint64_t rate = (load.bytes - load.lastBytes) * 1000 / elapsed;
+        load.peakRate = std::max(load.peakRate, rate);
+        load.lastBytes = load.bytes;
+    }
+
+    m_ringLoadTime = now;
+    m_ringLoadObserved = true;
+}
+
+void KernelTraceExecutor::updateMetrics(bool force) {
+    if (!m_metrics) {
+        return;
+    }
+
+    if (m_stream) {
+        m_metrics->setStreamDropped(m_stream->getDroppedCount());
+    }
+    m_metrics->update(force);
+}
+
+int KernelTraceExecutor::pollEvents(int timeoutMs) {
+    if (m_muxSession) {
+        return m_muxSession->poll(timeoutMs, this, perfEventHandler,
+                                  perfEventLost);
+    }
+
+    return perf_buffer__poll(m_bpfPerf, timeoutMs);
+}
+
+void KernelTraceExecutor::releaseDevice(uint64_t devId) {
+    if (m_muxSession) {
+        m_mux->releaseDevice(devId);
+    }
+}
+
+void KernelTraceExecutor::drainOverflow() {
+    for (const auto &ring : m_traceProducerRings) {
+        if (!ring || ring->overflow.empty()) {
+            continue;
+        }
+
+        octf_trace_t trace = ring->trace.load(std::memory_order_acquire);
+        if (trace) {
+            ring->overflow.drain(trace);
+        }
+    }
+}
+
+void KernelTraceExecutor::flushOverflow() {
+    auto deadline = std::chrono::steady_clock::now() + RING_OVERFLOW_FLUSH_TIME;
+
+    for (const auto &ring : m_traceProducerRings) {
+        octf_trace_t trace =
+                ring ? ring->trace.load(std::memory_order_acquire) : nullptr;
+        if (!trace) {
+            continue;
+        }
+
+        while (!ring->overflow.drain(trace) &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        uint64_t dropped = ring->overflow.clear();
+        if (dropped) {
+            ring->failed += dropped;
+            ring->lost(dropped);
+            if (m_metrics) {
+                m_metrics->addDropped(dropped);
+            }
+        }
+    }
+}
+
+uint32_t KernelTraceExecutor::getRingSize(uint32_t queue) {
+    auto &load = m_ringLoad[queue];
+    uint64_t size = RING_MIN_SIZE;
+    if (load.lost) {
+        size = m_ringSize;
+    } else if (m_ringLoadObserved) {
+        size = (load.peakRate * RING_BACKLOG_TIME_S + MiB - 1) / MiB;
+        size = std::max(size, RING_MIN_SIZE);
+    }
+
+    // A ring which overflowed takes the overflowed events in the next segment
+    auto &previous = m_traceProducerRings[queue];
+    uint64_t overflowed = previous ? previous->overflow.getPeakSize() : 0;
+    if (overflowed) {
+        size = std::max<uint64_t>(
+                size, previous->ringSize + (overflowed + MiB - 1) / MiB);
+    }
+    size = std::min<uint64_t>(size, m_ringSize);
+
+    // Observe the load again in the next segment
+    load.peakRate = 0;
+    load.lost = false;
+
+    return size;
+}
+
 bool KernelTraceExecutor::startTrace() {
-    /* Load & verify BPF programs */
-    int result = iotrace_bpf__load(m_bpf);
-    if (result) {
-        throw Exception("Cannot load BPF iotrace program");
+    if (m_bpfThread.joinable()) {
+        /* Next trace segment, eBPF programs are already attached */
+        m_segmentEnd = false;
+        resumeTrace();
+        return true;
     }
 
-    /* Parameterize BPF program */
-    m_bpf->bss->ref_sid = *m_refSeqId;
-    uint64_t i = 0;
-    uint64_t count = sizeof(m_bpf->bss->device) / sizeof(m_bpf->bss->device[0]);
-    const auto &devList = *m_devList;
-    auto iter = devList.begin();
+    if (m_mux) {
+        /* eBPF programs are shared, state of other sessions is kept */
+        m_bpf->reserveSid(*m_refSeqId);
+    } else {
+        if (!m_bpf) {
+            /* Load, verify and attach BPF programs */
+            m_bpf = std::make_shared<KernelTraceBpf>(m_capture);
+        }
 
-    for (; i < count && iter != devList.end(); i++, iter++) {
-        m_bpf->bss->device[i] = iter->id;
+        /* Parameterize BPF program */
+        m_bpf->reset(*m_refSeqId);
     }
 
-    initPerfBuffer();
-    if (libbpf_get_error(m_bpfPerf)) {
-        m_bpfPerf = nullptr;
-        log::cerr << "Cannot setup perf buffer" << std::endl;
-        return false;
+    for (const auto &dev : *std::atomic_load(&m_devList)) {
+        struct iotrace_device_info info = {};
+        uint64_t key = dev.id;
+
+        info.slow_ns = m_devSlowIoThreshold[dev.id];
+        info.flags = m_deviceFlags;
+        if (bpf_map_update_elem(m_bpf->getDeviceMapFd(), &key, &info,
+                                BPF_ANY)) {
+            log::cerr << "Cannot set device to trace, " << dev.device_name
+                      << std::endl;
+            return false;
+        }
+    }
+
+    if (!m_mux) {
+        initPerfBuffer();
+        if (libbpf_get_error(m_bpfPerf)) {
+            m_bpfPerf = nullptr;
+            log::cerr << "Cannot setup perf buffer" << std::endl;
+            return false;
+        }
     }
 
-    /* Attach trace points handlers */
-    result = iotrace_bpf__attach(m_bpf);
-    if (result) {
-        log::cerr << "Cannot load BPF iotrace program" << std::endl;
-        return false;
+    {
+        std::lock_guard<std::mutex> lock(m_pollMutex);
+        m_attached = true;
     }
 
     // Start thread polling on perf event buffer
+    m_ringLoadTime = std::chrono::steady_clock::now();
     m_bpfThread = std::thread([this]() {
         while (m_running) {
-            int err = perf_buffer__poll(m_bpfPerf, 100);
+            int err;
+            {
+                std::unique_lock<std::mutex> lock(m_pollMutex);
+                m_pollCv.wait(lock, [this]() {
+                    return (!m_paused && !m_controlPending) || !m_running;
+                });
+                if (!m_running) {
+                    break;
+                }
+
+                err = pollEvents(100);
+                drainOverflow();
+                reapRemovedDevices();
+                updateRingLoad();
+                updateMetrics(false);
+            }
 
             if (err == -EINTR) {
                 break;
@@ -151,13 +432,30 @@ bool KernelTraceExecutor::startTrace() {
 }
 
 bool KernelTraceExecutor::stopTrace() {
+    if (m_segmented && !m_lastSegment) {
+        /*
+         * End of trace segment. Stop polling, so events wait in the perf
+         * buffer until the trace rings of the next segment are ready.
+         */
+        pauseTrace();
+        flushOverflow();
+        if (!m_segmentEnd.exchange(true)) {
+            notifyStop();
+        }
+
+        return true;
+    }
+
     m_running = false;
-    SignalHandler::get().sendSignal(SIGTERM);
+    m_pollCv.notify_all();
+    notifyStop();
 
     if (m_bpfThread.joinable()) {
         m_bpfThread.join();
     }
+    flushOverflow();
 
+    std::lock_guard<std::mutex> lock(m_pollMutex);
     destroyBpf();
 
     return true;
@@ -173,12 +471,18 @@ std::unique_ptr<IRingTraceProducer> KernelTraceExecutor::createProducer(
         throw Exception("Invalid queue id when creating trace producer");
     }
 
+    uint32_t ringSize = getRingSize(queue);
     m_traceProducerRings[queue] = std::make_shared<KernelRingTraceBuffer>();
-    m_traceProducerRings[queue]->devs = m_devList;
+    m_traceProducerRings[queue]->devs = std::atomic_load(&m_devList);
     m_traceProducerRings[queue]->refSeqId = m_refSeqId;
+    m_traceProducerRings[queue]->ringSize = ringSize;
+    // The ring and its overflow together grow up to the requested size
+    m_traceProducerRings[queue]->overflow.init((m_ringSize - ringSize) * MiB,
+                                               m_hugePages);
 
     auto producer = std::unique_ptr<IRingTraceProducer>(
-            new KernelRingTraceProducer(m_traceProducerRings[queue], queue));
+            new KernelRingTraceProducer(m_traceProducerRings[queue],
+                                        m_queueCpus[queue]));
 
     return producer;
 }
@@ -187,20 +491,275 @@ std::unique_ptr<ITraceConverter> KernelTraceExecutor::createTraceConverter() {
     return std::unique_ptr<TraceConverter>(new TraceConverter());
 }
 
+std::unique_ptr<ISerializer> KernelTraceExecutor::createSerializer(
+        uint32_t queue,
+        const std::string &path) {
+    if (queue >= m_traceWriterStats.size()) {
+        throw Exception("Invalid queue id when creating trace serializer");
+    }
+
+    // Each queue gets at least two buffers, the writer rounds memory up
+    m_traceWriterStats[queue] = std::make_shared<AsyncWriterStats>();
+    return std::unique_ptr<ISerializer>(new DirectFileSerializer(
+            path, m_traceWriterMemory, m_traceWriterStats[queue]));
+}
+
 void KernelTraceExecutor::waitUntilStopTrace() {
+    if (m_stopEvent) {
+        m_stopEvent->wait();
+        return;
+    }
+
     // Register signal handler for SIGINT and SIGTERM
     SignalHandler::get().registerSignal(SIGINT);
     SignalHandler::get().registerSignal(SIGTERM);
     SignalHandler::get().wait();
 }
 
+void KernelTraceExecutor::notifyStop() {
+    if (m_stopEvent) {
+        m_stopEvent->signal();
+    } else {
+        SignalHandler::get().sendSignal(SIGTERM);
+    }
+}
+
+bool KernelTraceExecutor::isSegmentEnd() const {
+    return m_segmented && m_segmentEnd && !m_lastSegment;
+}
+
+void KernelTraceExecutor::finishSegments() {
+    m_lastSegment = true;
+}
+
+void KernelTraceExecutor::pauseTrace() {
+    std::lock_guard<std::mutex> lock(m_pollMutex);
+    m_paused = true;
+}
+
+void KernelTraceExecutor::resumeTrace() {
+    {
+        std::lock_guard<std::mutex> lock(m_pollMutex);
+        m_paused = false;
+    }
+    m_pollCv.notify_all();
+}
+
+void KernelTraceExecutor::commitTraceExtension(const std::string &traceDir) {
+    std::lock_guard<std::mutex> lock(m_pollMutex);
+    if (m_running && !m_paused) {
+        throw Exception("Cannot store trace extension while tracing");
+    }
+
+    m_traceExt.commit(traceDir);
+}
+
+const AsyncWriterStats &KernelTraceExecutor::getTraceExtensionWriterStats()
+        const {
+    return m_traceExt.getWriterStats();
+}
+
+AsyncWriterStats KernelTraceExecutor::getTraceWriterStats() const {
+    AsyncWriterStats stats;
+    for (const auto &queueStats : m_traceWriterStats) {
+        if (queueStats) {
+            stats.add(*queueStats);
+        }
+    }
+    return stats;
+}
+
+void KernelTraceExecutor::addDevice(const std::string &device) {
+    auto desc = createDeviceDesc(device);
+
+    controlTrace([this, &desc]() {
+        auto devList = std::atomic_load(&m_devList);
+        for (const auto &dev : *devList) {
+            if (dev.id == desc.id) {
+                throw Exception("Device already traced, " +
+                                std::string(desc.device_name));
+            }
+        }
+        if (devList->size() >= IOTRACE_DEVICE_MAX) {
+            throw Exception("Limit of traced devices reached");
+        }
+
+        /* Describe the device in the trace before its first IO */
+        pushDeviceDesc(desc);
+
+        struct iotrace_device_info info = {};
+        uint64_t key = desc.id;
+
+        if (m_muxSession) {
+            m_mux->claimDevice(m_muxSession, key);
+        }
+
+        info.slow_ns = m_slowIoThreshold;
+        info.flags = m_deviceFlags;
+        if (bpf_map_update_elem(m_bpf->getDeviceMapFd(), &key, &info,
+                                BPF_ANY)) {
+            releaseDevice(key);
+            throw Exception("Cannot add device to trace, " +
+                            std::string(desc.device_name));
+        }
+        m_removedDevices.erase(key);
+        m_devSlowIoThreshold[key] = m_slowIoThreshold;
+
+        auto newDevList = std::make_shared<KernelRingDevList>(*devList);
+        newDevList->push_back(desc);
+        std::atomic_store(&m_devList, newDevList);
+    });
+
+    log::cout << "Add device to running trace, name: " << desc.device_name
+              << ", id: " << desc.id << ", size: " << desc.device_size
+              << " sectors" << std::endl;
+}
+
+void KernelTraceExecutor::removeDevice(const std::string &device) {
+    std::string name = device;
+
+    char *realPath = ::realpath(device.c_str(), nullptr);
+    if (realPath) {
+        name = realPath;
+        ::free(realPath);
+    }
+    name = name.substr(name.rfind('/') + 1);
+
+    controlTrace([this, &device, &name]() {
+        auto devList = std::atomic_load(&m_devList);
+        auto iter = std::find_if(
+                devList->begin(), devList->end(),
+                [&name](const struct iotrace_event_device_desc &desc) {
+                    return name == desc.device_name;
+                });
+        if (iter == devList->end()) {
+            throw Exception("Device is not traced, " + device);
+        }
+
+        /*
+         * Keep tracing completions of the device for a while, so IOs in
+         * flight are not left without completion in the trace
+         */
+        struct iotrace_device_info info = {};
+        uint64_t key = iter->id;
+
+        if (bpf_map_lookup_elem(m_bpf->getDeviceMapFd(), &key, &info)) {
+            throw Exception("Cannot remove device from trace, " + device);
+        }
+        info.flags |= IOTRACE_DEVICE_FLAG_REMOVED;
+        if (bpf_map_update_elem(m_bpf->getDeviceMapFd(), &key, &info,
+                                BPF_EXIST)) {
+            throw Exception("Cannot remove device from trace, " + device);
+        }
+        m_removedDevices[key] = std::chrono::steady_clock::now();
+
+        auto newDevList = std::make_shared<KernelRingDevList>();
+        for (const auto &dev : *devList) {
+            if (dev.id != key) {
+                newDevList->push_back(dev);
+            }
+        }
+        std::atomic_store(&m_devList, newDevList);
+    });
+
+    log::cout << "Remove device from running trace, name: " << name
+              << std::endl;
+}
+
+KernelRingDevList KernelTraceExecutor::getDevices() const {
+    return *std::atomic_load(&m_devList);
+}
+
+void KernelTraceExecutor::controlTrace(const std::function<void()> &action) {
+    std::exception_ptr error;
+
+    /* Make the polling thread release the lock */
+    m_controlPending = true;
+    {
+        std::unique_lock<std::mutex> lock(m_pollMutex);
+
+        /* Wait for the next segment, if switching segments now */
+        m_pollCv.wait(lock, [this]() { return !m_paused || !m_running; });
+
+        if (!m_running || !m_attached) {
+            error = std::make_exception_ptr(
+                    Exception("Tracing is not running"));
+        } else {
+            try {
+                action();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        m_controlPending = false;
+    }
+    m_pollCv.notify_all();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void KernelTraceExecutor::pushDeviceDesc(
+        struct iotrace_event_device_desc desc) {
+    struct timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    /* eBPF timestamps are relative to the time base of the first event */
+    uint64_t timestamp = now.tv_sec * 1000000000ULL + now.tv_nsec;
+    uint64_t timebase = m_bpf->getTimebase();
+    desc.hdr.timestamp = timebase && timestamp > timebase
+                                 ? timestamp - timebase
+                                 : 0;
+
+    for (const auto &ring : m_traceProducerRings) {
+        if (ring && ring->trace) {
+            desc.hdr.sid = m_bpf->getNextSid();
+            ring->push<struct iotrace_event_device_desc>(&desc);
+            ring->flush();
+        }
+    }
+
+    if (m_stream) {
+        m_stream->push(&desc.hdr);
+    }
+}
+
+void KernelTraceExecutor::reapRemovedDevices() {
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto iter = m_removedDevices.begin();
+         iter != m_removedDevices.end();) {
+        if (now - iter->second < DEVICE_REMOVAL_GRACE_TIME) {
+            iter++;
+            continue;
+        }
+
+        uint64_t key = iter->first;
+        m_bpf->removeDevice(key);
+        releaseDevice(key);
+        m_devSlowIoThreshold.erase(key);
+        iter = m_removedDevices.erase(iter);
+    }
+}
+
 void KernelTraceExecutor::perfEventLost(void *ctx,
                                         int cpu,
                                         long long unsigned int lost) {
     auto executor = static_cast<KernelTraceExecutor *>(ctx);
 
-    if (cpu < executor->m_traceQueueCount) {
-        executor->m_traceProducerRings[cpu]->lostTrace(lost);
+    if (cpu >= 0 && cpu < static_cast<int>(executor->m_cpuQueue.size())) {
+        uint32_t queue = executor->m_cpuQueue[cpu];
+        auto &ring = executor->m_traceProducerRings[queue];
+
+        executor->m_ringLoad[queue].lost = true;
+        if (executor->m_metrics) {
+            executor->m_metrics->addLost(lost);
+        }
+        if (ring && ring->trace) {
+            ring->lost(lost);
+        }
     } else {
         log::cerr << "Invalid CPU number" << std::endl;
     }
@@ -211,114 +770,119 @@ void KernelTraceExecutor::perfEventHandler(void *ctx,
                                            void *data,
                                            unsigned int data_sz) {
     auto executor = static_cast<KernelTraceExecutor *>(ctx);
-    auto hdr = static_cast<iotrace_event_hdr *>(data);
 
-    if (cpu < executor->m_traceQueueCount && sizeof(*hdr) < data_sz &&
-        hdr->size < data_sz) {
-        executor->m_traceProducerRings[cpu]->pushTrace(data, hdr->size);
-    } else {
+    if (cpu < 0 || cpu >= static_cast<int>(executor->m_cpuQueue.size())) {
         log::cerr << "Invalid CPU number" << std::endl;
+        return;
     }
-}
 
-void KernelTraceExecutor::destroyBpf() {
-    if (m_bpfPerf) {
-        perf_buffer__free(m_bpfPerf);
-        m_bpfPerf = nullptr;
-    }
+    uint32_t queue = executor->m_cpuQueue[cpu];
+    auto &ring = *executor->m_traceProducerRings[queue];
+    auto &load = executor->m_ringLoad[queue];
+    auto event = static_cast<const char *>(data);
 
-    if (m_bpf) {
-        iotrace_bpf__destroy(m_bpf);
-        m_bpf = nullptr;
+    octf_trace_t trace = ring.trace.load(std::memory_order_acquire);
+    if (!trace) {
+        return;
     }
-}
-
-void KernelTraceExecutor::initDeviceList(
-        const std::vector<std::string> &devices) {
-    for (auto const &dev : devices) {
-        struct iotrace_event_device_desc dev_desc;
-        std::string path(PATH_MAX, '\0');
-        std::string basename;
-        struct stat bStats;
-
-        memset_s(&dev_desc, sizeof(dev_desc), 0);
-        iotrace_event_init_hdr(&dev_desc.hdr, iotrace_event_type_device_desc, 0,
-                               0, sizeof(dev_desc));
+    if (!ring.overflow.empty()) {
+        // Events kept earlier go into the ring first
+        ring.overflow.drain(trace);
+    }
+    uint64_t failed = ring.failed;
 
-        if (::stat(dev.c_str(), &bStats)) {
-            throw Exception("ERROR, cannot get device status of, " + dev);
+    /*
+     * A sample holds one or more events (e.g. all events of a slow IO),
+     * followed by the perf padding which is shorter than the event header
+     */
+    while (data_sz > sizeof(struct iotrace_event_hdr)) {
+        auto hdr = reinterpret_cast<const struct iotrace_event_hdr *>(event);
+        if (hdr->size <= sizeof(*hdr) || hdr->size > data_sz) {
+            break;
         }
 
-        if (S_ISLNK(bStats.st_mode)) {
-            int result = readlink(dev.c_str(), &path[0], path.length() - 1);
-            if (result <= 0) {
-                throw Exception("ERROR, cannot resolve link of device " + dev);
-            }
+        if (executor->m_stream) {
+            executor->m_stream->push(hdr);
+        }
+        if (executor->m_metrics) {
+            executor->m_metrics->handleEvent(hdr);
+        }
 
-            log::verbose << "Resolve symbolic link from " << dev << "to "
-                         << path << std::endl;
+        if (executor->m_streamOnly) {
+            // Not written to the trace
+        } else if (iotrace_event_is_ext(hdr->type)) {
+            executor->m_traceExt.write(hdr, hdr->size);
         } else {
-            path = dev;
+            load.bytes += hdr->size;
+            ring.push(hdr);
         }
 
-        int fd = ::open(path.c_str(), O_RDONLY);
-        if (fd < 0) {
-            close(fd);
-            throw Exception("ERROR, cannot open device, " + path);
-        }
+        event += hdr->size;
+        data_sz -= hdr->size;
+    }
 
-        if (::fstat(fd, &bStats)) {
-            ::close(fd);
-            throw Exception("ERROR, cannot get device status of, " + path);
+    // Events of the sample take one reservation in the trace ring
+    ring.flush();
+    if (ring.failed != failed) {
+        // Events which did not fit are lost for the trace too
+        load.lost = true;
+        ring.lost(ring.failed - failed);
+        if (executor->m_metrics) {
+            executor->m_metrics->addDropped(ring.failed - failed);
         }
+    }
+}
 
-        if (!S_ISBLK(bStats.st_mode)) {
-            ::close(fd);
-            throw Exception("ERROR, expected block device, " + path);
-        }
+void KernelTraceExecutor::destroyBpf() {
+    if (m_bpfPerf) {
+        perf_buffer__free(m_bpfPerf);
+        m_bpfPerf = nullptr;
+    }
 
-        // Use whole disk instead of partition if such defined
-        char wholeDisk[sizeof(dev_desc.device_name)] = {0};
-        dev_t wholeDiskId;
-        if (blkid_devno_to_wholedisk(bStats.st_rdev, wholeDisk,
-                                     sizeof(wholeDisk) - 1, &wholeDiskId)) {
-            close(fd);
-            throw Exception("ERROR, cannot get whole disk info");
+    if (m_muxSession) {
+        /* Other sessions keep tracing, only devices of this one are removed */
+        for (const auto &dev : *std::atomic_load(&m_devList)) {
+            m_bpf->removeDevice(dev.id);
         }
-        if (wholeDiskId != bStats.st_rdev) {
-            log::verbose << "Switch to whole disk, form " << path << " to /dev/"
-                         << wholeDisk << std::endl;
+        for (const auto &dev : m_removedDevices) {
+            m_bpf->removeDevice(dev.first);
         }
+        m_removedDevices.clear();
+
+        m_mux->detach(m_muxSession);
+        m_muxSession.reset();
+        m_bpf.reset();
+    } else if (m_bpf) {
+        /* eBPF programs kept by the daemon stop tracing devices */
+        m_bpf->reset(0);
+        m_bpf.reset();
+    }
 
-        // Get model name
-        path = "/sys/block/" + std::string(wholeDisk) + "/device/model";
-        std::ifstream iModel;
-        iModel.open(path);
-        if (iModel.good()) {
-            std::string model;
+    m_attached = false;
+}
 
-            while (!iModel.eof()) {
-                std::string n;
-                iModel >> n;
+void KernelTraceExecutor::initDeviceList(
+        const std::vector<std::string> &devices,
+        const KernelTraceOptions &options) {
+    for (const auto &slowIoDev : options.deviceSlowIoThreshold) {
+        if (std::find(devices.begin(), devices.end(), slowIoDev.first) ==
+            devices.end()) {
+            throw Exception("ERROR, slow IO threshold set for device which "
+                            "is not traced, " +
+                            slowIoDev.first);
+        }
+    }
 
-                if (std::isprint(n[0])) {
-                    if (model.length()) {
-                        model += " ";
-                    }
-                    model += n;
-                }
-            }
+    for (auto const &dev : devices) {
+        auto dev_desc = createDeviceDesc(dev);
 
-            strcpy_s(dev_desc.device_model, sizeof(dev_desc.device_model) - 1,
-                     model.c_str());
+        // Set latency threshold of slow IO mode
+        uint64_t slowIoThreshold = options.slowIoThreshold;
+        auto slowIoDev = options.deviceSlowIoThreshold.find(dev);
+        if (slowIoDev != options.deviceSlowIoThreshold.end()) {
+            slowIoThreshold = slowIoDev->second;
         }
-
-        // Set device ID of whole deivce which will be traced
-        dev_desc.id = MKDEV(major(wholeDiskId), minor(wholeDiskId));
-        // Get device size
-        dev_desc.device_size = blkid_get_dev_size(fd) >> 9;
-        /* Copy user defined block device name */
-        strcpy_s(dev_desc.device_name, sizeof(dev_desc.device_name), wholeDisk);
+        m_devSlowIoThreshold[dev_desc.id] = slowIoThreshold;
 
         log::cout << "Add device to trace, name: " << dev_desc.device_name
                   << ", id: " << dev_desc.id
@@ -326,11 +890,103 @@ void KernelTraceExecutor::initDeviceList(
         if (dev_desc.device_model[0]) {
             log::cout << ", model: " << dev_desc.device_model;
         }
+        if (slowIoThreshold) {
+            log::cout << ", slow IO threshold: " << slowIoThreshold << " ns";
+        }
         log::cout << std::endl;
 
-        close(fd);
         m_devList->push_back(dev_desc);
     }
 }
 
+struct iotrace_event_device_desc KernelTraceExecutor::createDeviceDesc(
+        const std::string &dev) {
+    struct iotrace_event_device_desc dev_desc;
+    std::string path(PATH_MAX, '\0');
+    std::string basename;
+    struct stat bStats;
+
+    memset_s(&dev_desc, sizeof(dev_desc), 0);
+    iotrace_event_init_hdr(&dev_desc.hdr, iotrace_event_type_device_desc, 0, 0,
+                           sizeof(dev_desc));
+
+    if (::stat(dev.c_str(), &bStats)) {
+        throw Exception("ERROR, cannot get device status of, " + dev);
+    }
+
+    if (S_ISLNK(bStats.st_mode)) {
+        int result = readlink(dev.c_str(), &path[0], path.length() - 1);
+        if (result <= 0) {
+            throw Exception("ERROR, cannot resolve link of device " + dev);
+        }
+
+        log::verbose << "Resolve symbolic link from " << dev << "to " << path
+                     << std::endl;
+    } else {
+        path = dev;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        close(fd);
+        throw Exception("ERROR, cannot open device, " + path);
+    }
+
+    if (::fstat(fd, &bStats)) {
+        ::close(fd);
+        throw Exception("ERROR, cannot get device status of, " + path);
+    }
+
+    if (!S_ISBLK(bStats.st_mode)) {
+        ::close(fd);
+        throw Exception("ERROR, expected block device, " + path);
+    }
+
+    // Use whole disk instead of partition if such defined
+    char wholeDisk[sizeof(dev_desc.device_name)] = {0};
+    dev_t wholeDiskId;
+    if (blkid_devno_to_wholedisk(bStats.st_rdev, wholeDisk,
+                                 sizeof(wholeDisk) - 1, &wholeDiskId)) {
+        close(fd);
+        throw Exception("ERROR, cannot get whole disk info");
+    }
+    if (wholeDiskId != bStats.st_rdev) {
+        log::verbose << "Switch to whole disk, form " << path << " to /dev/"
+                     << wholeDisk << std::endl;
+    }
+
+    // Get model name
+    path = "/sys/block/" + std::string(wholeDisk) + "/device/model";
+    std::ifstream iModel;
+    iModel.open(path);
+    if (iModel.good()) {
+        std::string model;
+
+        while (!iModel.eof()) {
+            std::string n;
+            iModel >> n;
+
+            if (std::isprint(n[0])) {
+                if (model.length()) {
+                    model += " ";
+                }
+                model += n;
+            }
+        }
+
+        strcpy_s(dev_desc.device_model, sizeof(dev_desc.device_model) - 1,
+                 model.c_str());
+    }
+
+    // Set device ID of whole deivce which will be traced
+    dev_desc.id = MKDEV(major(wholeDiskId), minor(wholeDiskId));
+    // Get device size
+    dev_desc.device_size = blkid_get_dev_size(fd) >> 9;
+    /* Copy user defined block device name */
+    strcpy_s(dev_desc.device_name, sizeof(dev_desc.device_name), wholeDisk);
+
+    close(fd);
+    return dev_desc;
+}
+
 }  // namespace octf
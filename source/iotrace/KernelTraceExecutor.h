@@ -8,32 +8,190 @@
 
 #include <bpf/libbpf.h>
 #include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
 #include <octf/interface/ITraceExecutor.h>
 #include <octf/trace/trace.h>
+#include <octf/utils/NonCopyable.h>
+#include "AsyncDirectFileWriter.h"
+#include "EventStream.h"
 #include "KernelRingTraceProducer.h"
+#include "KernelTraceBpf.h"
+#include "KernelTraceMux.h"
+#include "TraceExtensionWriter.h"
+#include "TraceMetrics.h"
 
-struct iotrace_bpf;
 struct perf_buffer;
 
 namespace octf {
 
+/**
+ * @brief Event ending the wait for the end of tracing
+ *
+ * Used instead of SIGINT and SIGTERM when tracing runs in the tracing daemon,
+ * which serves requests of many clients.
+ */
+class KernelTraceStopEvent : public NonCopyable {
+public:
+    KernelTraceStopEvent()
+            : m_mutex()
+            , m_cv()
+            , m_signaled(false) {}
+    virtual ~KernelTraceStopEvent() = default;
+
+    void signal() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_signaled = true;
+        }
+        m_cv.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_signaled; });
+        m_signaled = false;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_signaled;
+};
+
+/**
+ * @brief Optional capture settings of the kernel trace executor
+ */
+struct KernelTraceOptions {
+    KernelTraceOptions()
+            : slowIoThreshold(0)
+            , deviceSlowIoThreshold()
+            , segmented(false)
+            , writerMemoryLimit(0)
+            , capture(KernelTraceCapture::full)
+            , requestTime(false)
+            , bioEvents(false)
+            , hwQueue(false)
+            , process(false)
+            , stream()
+            , streamOnly(false)
+            , hugePages(false)
+            , metrics()
+            , bpf()
+            , mux()
+            , stopEvent() {}
+
+    /**
+     * Latency threshold (in ns) of IOs to be traced, IOs which complete
+     * faster are not traced. Zero traces all IOs.
+     */
+    uint64_t slowIoThreshold;
+
+    /** Per device slow IO threshold (in ns), keyed by device path */
+    std::map<std::string, uint64_t> deviceSlowIoThreshold;
+
+    /**
+     * Trace is cut into segments. Reaching limits of a trace manager ends
+     * the current segment only, and eBPF programs stay attached until
+     * finishSegments() is called.
+     */
+    bool segmented;
+
+    /**
+     * Maximum memory (in bytes) of write buffers of the trace extension, and
+     * of trace files of all trace queues together
+     */
+    uint64_t writerMemoryLimit;
+
+    /** Events captured by eBPF programs loaded by the executor */
+    KernelTraceCapture capture;
+
+    /**
+     * Insertion into the IO scheduler and dispatch to the device of requests
+     * are traced in the trace extension
+     */
+    bool requestTime;
+
+    /**
+     * Split, merge and remap of IOs are traced in the trace extension
+     */
+    bool bioEvents;
+
+    /**
+     * Hardware queue, submission and completion CPU of requests are traced in
+     * the trace extension
+     */
+    bool hwQueue;
+
+    /**
+     * Process, thread and cgroup submitting IOs are traced in the trace
+     * extension
+     */
+    bool process;
+
+    /**
+     * Name of the live event stream to a local consumer. If empty, events
+     * are not streamed.
+     */
+    std::string stream;
+
+    /** Events are streamed only, not written to the trace */
+    bool streamOnly;
+
+    /** Overflow buffers of trace rings are backed by huge pages */
+    bool hugePages;
+
+    /**
+     * Path of the file to which live metrics are written. If empty, metrics
+     * are not collected.
+     */
+    std::string metrics;
+
+    /**
+     * eBPF programs kept loaded by the tracing daemon. If not set, the
+     * executor loads eBPF programs of its own.
+     */
+    std::shared_ptr<KernelTraceBpf> bpf;
+
+    /**
+     * eBPF programs of the tracing daemon shared with concurrent sessions.
+     * If set, bpf is ignored, and traced devices must not be traced by
+     * other sessions.
+     */
+    std::shared_ptr<KernelTraceMux> mux;
+
+    /**
+     * Ends waiting for the end of tracing. If not set, SIGINT and SIGTERM do.
+     */
+    std::shared_ptr<KernelTraceStopEvent> stopEvent;
+};
+
 /**
  * @brief Trace executor which allows tracing from kernel
  *
- * @note This executor sends SIGUSR1 to SignalHandler
- * to indicate end of tracing.
+ * @note This executor sends SIGTERM to SignalHandler, or signals the stop
+ * event if set in options, to indicate end of tracing.
  */
 class KernelTraceExecutor : public ITraceExecutor {
 public:
     /**
      * @param devices Vector with paths of block devices to be traced
+     * @param circBufferSize Maximum size of the trace ring of each online CPU
+     * (in MiB), the per CPU perf buffer is sized proportionally
+     * @param options Optional capture settings
      */
     KernelTraceExecutor(const std::vector<std::string> &devices,
-                        uint32_t circBufferSize);
+                        uint32_t circBufferSize,
+                        const KernelTraceOptions &options);
 
     virtual ~KernelTraceExecutor();
 
@@ -47,11 +205,78 @@ public:
 
     std::unique_ptr<ITraceConverter> createTraceConverter() override;
 
+    /**
+     * @brief Creates serializer of the trace file of the queue, writing with
+     * asynchronous direct IO
+     */
+    std::unique_ptr<ISerializer> createSerializer(
+            uint32_t queue,
+            const std::string &path) override;
+
     /**
      * @brief Waits until receiving signal for stopping traces
      */
     void waitUntilStopTrace();
 
+    /**
+     * @brief Checks if the current trace segment reached its limits
+     *
+     * @retval true Segment limits reached, tracing shall continue in the next
+     * segment
+     * @retval false Tracing was interrupted or not segmented
+     */
+    bool isSegmentEnd() const;
+
+    /**
+     * @brief Marks the current segment as the last one
+     *
+     * Next stopTrace() detaches eBPF programs.
+     */
+    void finishSegments();
+
+    /**
+     * @brief Stores trace extension events in the trace directory
+     *
+     * @param traceDir Absolute path of the trace directory
+     */
+    void commitTraceExtension(const std::string &traceDir);
+
+    /**
+     * @return Write statistics of the last committed trace extension
+     */
+    const AsyncWriterStats &getTraceExtensionWriterStats() const;
+
+    /**
+     * @return Write statistics of trace files of all trace queues, of the
+     * last closed trace
+     */
+    AsyncWriterStats getTraceWriterStats() const;
+
+    /**
+     * @brief Adds device to the running tracing
+     *
+     * The device description is pushed into each trace ring before any IO of
+     * the device is traced.
+     *
+     * @param device Path of the block device
+     */
+    void addDevice(const std::string &device);
+
+    /**
+     * @brief Removes device from the running tracing
+     *
+     * New IOs of the device are not traced anymore, but IOs in flight are
+     * traced until completion for a grace period.
+     *
+     * @param device Path or name of the block device
+     */
+    void removeDevice(const std::string &device);
+
+    /**
+     * @return Devices which are traced currently
+     */
+    KernelRingDevList getDevices() const;
+
 private:
     static void perfEventHandler(void *ctx,
                                  int cpu,
@@ -62,20 +287,136 @@ private:
 
     void destroyBpf();
 
-    void initDeviceList(const std::vector<std::string> &devices);
+    void notifyStop();
+
+    void initDeviceList(const std::vector<std::string> &devices,
+                        const KernelTraceOptions &options);
+
+    struct iotrace_event_device_desc createDeviceDesc(
+            const std::string &device);
+
+    void controlTrace(const std::function<void()> &action);
+
+    void pushDeviceDesc(struct iotrace_event_device_desc desc);
+
+    void reapRemovedDevices();
 
     void initPerfBuffer();
 
+    static uint32_t getPerfBufferPages(uint32_t ringSizeMiB);
+
+    /**
+     * @brief Updates the peak event rate of trace rings once per second
+     */
+    void updateRingLoad();
+
+    /**
+     * @brief Writes live metrics, once per second unless forced
+     */
+    void updateMetrics(bool force);
+
+    /**
+     * @brief Polls events of the perf buffer, or of the multiplexer session
+     * if eBPF programs are shared
+     */
+    int pollEvents(int timeoutMs);
+
+    /**
+     * @brief Stops routing events of the device to this executor, if eBPF
+     * programs are shared
+     */
+    void releaseDevice(uint64_t devId);
+
+    /**
+     * @brief Sizes the trace ring of the next segment by the peak event rate
+     * and overflow observed in the previous one
+     *
+     * Rings start small, and events which do not fit are kept in the overflow
+     * buffer of the ring, which grows up to the size requested by the user.
+     *
+     * @return Size of the ring (in MiB)
+     */
+    uint32_t getRingSize(uint32_t queue);
+
+    /**
+     * @brief Moves overflowed events into trace rings, while they fit
+     */
+    void drainOverflow();
+
+    /**
+     * @brief Waits until trace rings take overflowed events, events which do
+     * not fit in time are lost
+     */
+    void flushOverflow();
+
+    void pauseTrace();
+
+    void resumeTrace();
+
 private:
+    /** Load of the trace ring, updated by the perf buffer polling thread */
+    struct RingLoad {
+        RingLoad()
+                : bytes(0)
+                , lastBytes(0)
+                , peakRate(0)
+                , lost(false) {}
+
+        uint64_t bytes;
+        uint64_t lastBytes;
+        /** Peak rate of events (in bytes per second) */
+        uint64_t peakRate;
+        /** Events of the CPU were lost in the perf buffer */
+        bool lost;
+    };
+
+    /** Online CPUs, trace queue ID is the index in this vector */
+    const std::vector<int> m_queueCpus;
     const uint32_t m_traceQueueCount;
-    struct iotrace_bpf *m_bpf;
+    /** Trace queue of each possible CPU */
+    std::vector<uint32_t> m_cpuQueue;
+    const uint32_t m_ringSize;
+    const uint32_t m_perfBufferPages;
+    const KernelTraceCapture m_capture;
+    std::shared_ptr<KernelTraceBpf> m_bpf;
+    std::shared_ptr<KernelTraceMux> m_mux;
+    /** Events routed to this executor, if eBPF programs are shared */
+    std::shared_ptr<KernelTraceMuxSession> m_muxSession;
+    std::shared_ptr<KernelTraceStopEvent> m_stopEvent;
     struct perf_buffer *m_bpfPerf;
     struct perf_buffer_opts m_bpfPerfBufOpts;
     std::thread m_bpfThread;
     std::vector<std::shared_ptr<KernelRingTraceBuffer>> m_traceProducerRings;
+    std::vector<RingLoad> m_ringLoad;
+    std::chrono::steady_clock::time_point m_ringLoadTime;
+    bool m_ringLoadObserved;
     KernelRingDevListShRef m_devList;
     KernelRingSeqIdShRef m_refSeqId;
-    bool m_running;
+    std::map<uint64_t, uint64_t> m_devSlowIoThreshold;
+    const uint64_t m_slowIoThreshold;
+    /** Flags of traced devices in the eBPF device map */
+    const uint32_t m_deviceFlags;
+    /** Removed devices still traced for completions, with removal time */
+    std::map<uint64_t, std::chrono::steady_clock::time_point> m_removedDevices;
+    /** Overflow buffers of trace rings are backed by huge pages */
+    const bool m_hugePages;
+    TraceExtensionWriter m_traceExt;
+    /** Memory (in bytes) of write buffers of a trace file of each queue */
+    const uint64_t m_traceWriterMemory;
+    /** Write statistics of trace files of queues */
+    std::vector<std::shared_ptr<AsyncWriterStats>> m_traceWriterStats;
+    std::unique_ptr<EventStream> m_stream;
+    const bool m_streamOnly;
+    std::unique_ptr<TraceMetrics> m_metrics;
+    std::atomic<bool> m_running;
+    const bool m_segmented;
+    std::atomic<bool> m_segmentEnd;
+    std::atomic<bool> m_lastSegment;
+    std::mutex m_pollMutex;
+    std::condition_variable m_pollCv;
+    bool m_paused;
+    bool m_attached;
+    std::atomic<bool> m_controlPending;
 };
 
 }  // namespace octf
@@ -0,0 +1,384 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "KernelTraceMux.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "iotrace_event_compact.h"
+#include "iotrace_event_ext.h"
+
+namespace octf {
+
+/* Per CPU perf buffer shared by sessions (in pages, power of two) */
+static constexpr uint32_t MUX_PERF_BUFFER_PAGES = 1024;
+
+/* Events waiting for a session which does not poll, before being lost */
+static constexpr uint64_t MUX_SESSION_BACKLOG_SIZE = 64ULL * 1024 * 1024;
+
+/* Records of the backlog are aligned, as events in the perf buffer */
+static constexpr uint32_t MUX_RECORD_ALIGN = 8;
+
+static uint32_t alignRecord(uint32_t size) {
+    return (size + MUX_RECORD_ALIGN - 1) & ~(MUX_RECORD_ALIGN - 1);
+}
+
+/**
+ * @brief Gets device of the event, if the event holds the device ID
+ */
+template <typename Event>
+static bool getDeviceId(const struct iotrace_event_hdr *hdr, uint64_t &devId) {
+    auto event = reinterpret_cast<const Event *>(hdr);
+    if (hdr->size < offsetof(Event, dev_id) + sizeof(event->dev_id)) {
+        return false;
+    }
+
+    devId = event->dev_id;
+    return true;
+}
+
+/**
+ * @brief Gets devices the event is bound to, other events (e.g. names of
+ * files and processes) are not bound to a device
+ *
+ * @param devIds Devices of the event, a remap is bound to the devices
+ * before and after the remap
+ *
+ * @return Number of devices of the event
+ */
+static size_t getEventDevices(const struct iotrace_event_hdr *hdr,
+                              uint64_t devIds[2]) {
+    switch (hdr->type) {
+    case iotrace_event_type_io:
+        if (hdr->size == sizeof(struct iotrace_event)) {
+            devIds[0] =
+                    reinterpret_cast<const struct iotrace_event *>(hdr)->dev_id;
+            return 1;
+        }
+        break;
+    case iotrace_event_type_io_fs:
+        if (hdr->size == sizeof(struct iotrace_event_io_fs)) {
+            devIds[0] = reinterpret_cast<const struct iotrace_event_io_fs *>(
+                                hdr)
+                                ->io.dev_id;
+            return 1;
+        }
+        break;
+    case iotrace_event_type_io_cmpl:
+        return getDeviceId<struct iotrace_event_completion>(hdr, devIds[0]);
+    case iotrace_event_type_io_cmpl_rq:
+        return getDeviceId<struct iotrace_event_io_cmpl_rq>(hdr, devIds[0]);
+    case iotrace_event_type_io_ctx:
+        return getDeviceId<struct iotrace_event_io_ctx>(hdr, devIds[0]);
+    case iotrace_event_type_rq_issue:
+        return getDeviceId<struct iotrace_event_rq_issue>(hdr, devIds[0]);
+    case iotrace_event_type_rq_hw_queue:
+        return getDeviceId<struct iotrace_event_rq_hw_queue>(hdr,
+                                                             devIds[0]);
+    case iotrace_event_type_bio_split:
+        return getDeviceId<struct iotrace_event_bio_split>(hdr, devIds[0]);
+    case iotrace_event_type_bio_merge:
+        return getDeviceId<struct iotrace_event_bio_merge>(hdr, devIds[0]);
+    case iotrace_event_type_io_process:
+        return getDeviceId<struct iotrace_event_io_process>(hdr,
+                                                            devIds[0]);
+    case iotrace_event_type_bio_remap:
+        if (hdr->size == sizeof(struct iotrace_event_bio_remap)) {
+            auto ev = reinterpret_cast<const struct iotrace_event_bio_remap *>(
+                    hdr);
+            devIds[0] = ev->dev_id;
+            devIds[1] = ev->from_dev_id;
+            return devIds[0] == devIds[1] ? 1 : 2;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+KernelTraceMuxSession::KernelTraceMuxSession()
+        : m_mutex()
+        , m_cv()
+        , m_backlog()
+        , m_polled()
+        , m_lostRecords() {}
+
+void KernelTraceMuxSession::push(int cpu, const struct iotrace_event_hdr *hdr) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint64_t size = sizeof(Record) + alignRecord(hdr->size);
+        if (m_backlog.size() + size > MUX_SESSION_BACKLOG_SIZE) {
+            // Reported as lost in the perf buffer
+            addLost(cpu, 1);
+            return;
+        }
+
+        m_backlog.resize(m_backlog.size() + size);
+        auto record =
+                reinterpret_cast<Record *>(&m_backlog[m_backlog.size() - size]);
+        record->cpu = cpu;
+        record->size = hdr->size;
+        record->lost = 0;
+        std::memcpy(record + 1, hdr, hdr->size);
+    }
+    m_cv.notify_one();
+}
+
+void KernelTraceMuxSession::pushLost(int cpu, uint64_t count) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        addLost(cpu, count);
+    }
+    m_cv.notify_one();
+}
+
+void KernelTraceMuxSession::addLost(int cpu, uint64_t count) {
+    // While the backlog is full, each event would add a record of its own
+    auto iter = m_lostRecords.find(cpu);
+    if (iter != m_lostRecords.end()) {
+        reinterpret_cast<Record *>(&m_backlog[iter->second])->lost += count;
+        return;
+    }
+
+    m_lostRecords[cpu] = m_backlog.size();
+    m_backlog.resize(m_backlog.size() + sizeof(Record));
+    auto record = reinterpret_cast<Record *>(
+            &m_backlog[m_backlog.size() - sizeof(Record)]);
+    record->cpu = cpu;
+    record->size = 0;
+    record->lost = count;
+}
+
+int KernelTraceMuxSession::poll(int timeoutMs,
+                                void *ctx,
+                                perf_buffer_sample_fn sample,
+                                perf_buffer_lost_fn lost) {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                      [this]() { return !m_backlog.empty(); });
+
+        m_polled.clear();
+        m_polled.swap(m_backlog);
+        m_lostRecords.clear();
+    }
+
+    int count = 0;
+    size_t offset = 0;
+    while (offset + sizeof(Record) <= m_polled.size()) {
+        auto record = reinterpret_cast<Record *>(&m_polled[offset]);
+        offset += sizeof(*record);
+
+        if (record->size) {
+            sample(ctx, record->cpu, record + 1, record->size);
+            offset += alignRecord(record->size);
+            count++;
+        } else {
+            lost(ctx, record->cpu, record->lost);
+        }
+    }
+
+    return count;
+}
+
+KernelTraceMux::KernelTraceMux(std::shared_ptr<KernelTraceBpf> bpf)
+        : m_bpf(bpf)
+        , m_attachMutex()
+        , m_mutex()
+        , m_sessions()
+        , m_devices()
+        , m_perf(nullptr)
+        , m_thread()
+        , m_running(false) {}
+
+KernelTraceMux::~KernelTraceMux() {
+    stopPolling();
+}
+
+std::shared_ptr<KernelTraceBpf> KernelTraceMux::getBpf() const {
+    return m_bpf;
+}
+
+std::shared_ptr<KernelTraceMuxSession> KernelTraceMux::attach() {
+    std::lock_guard<std::mutex> attachLock(m_attachMutex);
+    auto session = std::make_shared<KernelTraceMuxSession>();
+    bool first;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        first = m_sessions.empty();
+        m_sessions.push_back(session);
+    }
+
+    if (!first) {
+        // Names of files and processes are traced again for the new session
+        m_bpf->clearCaches();
+        return session;
+    }
+
+    m_bpf->reset(0);
+    try {
+        startPolling();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sessions.clear();
+        throw;
+    }
+
+    return session;
+}
+
+void KernelTraceMux::detach(
+        const std::shared_ptr<KernelTraceMuxSession> &session) {
+    std::lock_guard<std::mutex> attachLock(m_attachMutex);
+    bool last;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sessions.remove(session);
+        for (auto iter = m_devices.begin(); iter != m_devices.end();) {
+            if (iter->second == session.get()) {
+                iter = m_devices.erase(iter);
+            } else {
+                iter++;
+            }
+        }
+        last = m_sessions.empty();
+    }
+
+    if (last) {
+        stopPolling();
+
+        /* eBPF programs stop tracing devices */
+        m_bpf->reset(0);
+    }
+}
+
+void KernelTraceMux::claimDevice(
+        const std::shared_ptr<KernelTraceMuxSession> &session,
+        uint64_t devId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto iter = m_devices.find(devId);
+    if (iter != m_devices.end() && iter->second != session.get()) {
+        throw Exception("Device traced by another tracing session");
+    }
+    m_devices[devId] = session.get();
+}
+
+void KernelTraceMux::releaseDevice(uint64_t devId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_devices.erase(devId);
+}
+
+void KernelTraceMux::route(int cpu, const struct iotrace_event_hdr *hdr) {
+    uint64_t devIds[2];
+    size_t count = getEventDevices(hdr, devIds);
+
+    if (count) {
+        KernelTraceMuxSession *routed = nullptr;
+        for (size_t i = 0; i < count; i++) {
+            auto iter = m_devices.find(devIds[i]);
+            if (iter != m_devices.end() && iter->second != routed) {
+                routed = iter->second;
+                routed->push(cpu, hdr);
+            }
+        }
+    } else {
+        for (const auto &session : m_sessions) {
+            session->push(cpu, hdr);
+        }
+    }
+}
+
+void KernelTraceMux::perfEventHandler(void *ctx,
+                                      int cpu,
+                                      void *data,
+                                      unsigned int data_sz) {
+    auto mux = static_cast<KernelTraceMux *>(ctx);
+    auto event = static_cast<const char *>(data);
+
+    std::lock_guard<std::mutex> lock(mux->m_mutex);
+
+    /* A sample holds one or more events, followed by the perf padding */
+    while (data_sz > sizeof(struct iotrace_event_hdr)) {
+        auto hdr = reinterpret_cast<const struct iotrace_event_hdr *>(event);
+        if (hdr->size <= sizeof(*hdr) || hdr->size > data_sz) {
+            break;
+        }
+
+        mux->route(cpu, hdr);
+
+        event += hdr->size;
+        data_sz -= hdr->size;
+    }
+}
+
+void KernelTraceMux::perfEventLost(void *ctx,
+                                   int cpu,
+                                   long long unsigned int lost) {
+    auto mux = static_cast<KernelTraceMux *>(ctx);
+
+    // Lost events can belong to any session
+    std::lock_guard<std::mutex> lock(mux->m_mutex);
+    for (const auto &session : mux->m_sessions) {
+        session->pushLost(cpu, lost);
+    }
+}
+
+void KernelTraceMux::startPolling() {
+#if LIBBPF_MAJOR_VERSION <= 1 && LIBBPF_MINOR_VERSION < 1
+    struct perf_buffer_opts opts = {};
+    opts.sample_cb = perfEventHandler;
+    opts.lost_cb = perfEventLost;
+    opts.ctx = this;
+
+    m_perf = perf_buffer__new(m_bpf->getEventsMapFd(), MUX_PERF_BUFFER_PAGES,
+                              &opts);
+#else
+    struct perf_buffer_opts opts = {};
+    opts.sz = sizeof(opts);
+
+    m_perf = perf_buffer__new(m_bpf->getEventsMapFd(), MUX_PERF_BUFFER_PAGES,
+                              perfEventHandler, perfEventLost, this, &opts);
+#endif
+    if (libbpf_get_error(m_perf)) {
+        m_perf = nullptr;
+        throw Exception("Cannot setup perf buffer");
+    }
+
+    m_running = true;
+    m_thread = std::thread([this]() {
+        while (m_running) {
+            int err = perf_buffer__poll(m_perf, 100);
+            if (err < 0 && err != -EINTR) {
+                log::cerr << "Error polling trace event perf buffer"
+                          << std::endl;
+                break;
+            }
+        }
+    });
+}
+
+void KernelTraceMux::stopPolling() {
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    if (m_perf) {
+        perf_buffer__free(m_perf);
+        m_perf = nullptr;
+    }
+}
+
+}  // namespace octf
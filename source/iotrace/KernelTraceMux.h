@@ -0,0 +1,155 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_KERNELTRACEMUX_H
+#define SOURCE_USERSPACE_KERNELTRACEMUX_H
+
+#include <bpf/libbpf.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <octf/trace/iotrace_event.h>
+#include <octf/utils/NonCopyable.h>
+#include "KernelTraceBpf.h"
+
+namespace octf {
+
+class KernelTraceMux;
+
+/**
+ * @brief Events of one tracing session sharing eBPF programs
+ *
+ * The session is polled by the kernel trace executor instead of the perf
+ * buffer. Events wait in the session backlog while the executor does not
+ * poll, e.g. when switching trace segments, as they would in the perf
+ * buffer. Events which do not fit into the backlog are reported as lost.
+ */
+class KernelTraceMuxSession : public NonCopyable {
+public:
+    KernelTraceMuxSession();
+    virtual ~KernelTraceMuxSession() = default;
+
+    /**
+     * @brief Waits for events and hands them to callbacks, like
+     * perf_buffer__poll()
+     *
+     * @param timeoutMs Maximum time to wait for events
+     * @param ctx Context of callbacks
+     *
+     * @return Number of handled events
+     */
+    int poll(int timeoutMs,
+             void *ctx,
+             perf_buffer_sample_fn sample,
+             perf_buffer_lost_fn lost);
+
+private:
+    friend class KernelTraceMux;
+
+    /** Record of the backlog, followed by the event */
+    struct Record {
+        int32_t cpu;
+        uint32_t size;
+        /** Events lost, if no event follows */
+        uint64_t lost;
+    };
+
+    void push(int cpu, const struct iotrace_event_hdr *hdr);
+
+    void pushLost(int cpu, uint64_t count);
+
+    /**
+     * @brief Adds lost events to the lost record of the CPU in the backlog,
+     * appending one if there is none, called with the mutex held
+     */
+    void addLost(int cpu, uint64_t count);
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<char> m_backlog;
+    /** Backlog handed to callbacks, kept to reuse its memory */
+    std::vector<char> m_polled;
+    /** Offsets of lost records in the backlog keyed by CPU */
+    std::unordered_map<int, size_t> m_lostRecords;
+};
+
+/**
+ * @brief Shares one set of attached eBPF programs between tracing sessions
+ *
+ * The tracing daemon runs concurrent sessions on its pinned eBPF programs.
+ * The multiplexer polls the perf buffer once for all sessions and routes
+ * events to them. Traced devices are exclusive to sessions, so IO events and
+ * extension events holding a device ID are routed to the session tracing
+ * their device. Events not bound to a device
+ * (e.g. names of files and processes) go to all sessions.
+ *
+ * The perf buffer is polled while at least one session is attached. State
+ * of eBPF programs is reset when the first session attaches.
+ */
+class KernelTraceMux : public NonCopyable {
+public:
+    KernelTraceMux(std::shared_ptr<KernelTraceBpf> bpf);
+    virtual ~KernelTraceMux();
+
+    std::shared_ptr<KernelTraceBpf> getBpf() const;
+
+    /**
+     * @brief Attaches a new session, starting polling if it is the first
+     */
+    std::shared_ptr<KernelTraceMuxSession> attach();
+
+    /**
+     * @brief Detaches the session and releases its devices
+     */
+    void detach(const std::shared_ptr<KernelTraceMuxSession> &session);
+
+    /**
+     * @brief Routes events of the device to the session
+     *
+     * @throws Exception Device traced by another session
+     */
+    void claimDevice(const std::shared_ptr<KernelTraceMuxSession> &session,
+                     uint64_t devId);
+
+    void releaseDevice(uint64_t devId);
+
+private:
+    static void perfEventHandler(void *ctx,
+                                 int cpu,
+                                 void *data,
+                                 unsigned int data_sz);
+
+    static void perfEventLost(void *ctx, int cpu, long long unsigned int lost);
+
+    void route(int cpu, const struct iotrace_event_hdr *hdr);
+
+    void startPolling();
+
+    void stopPolling();
+
+private:
+    std::shared_ptr<KernelTraceBpf> m_bpf;
+    /** Serializes attaching and detaching of sessions */
+    std::mutex m_attachMutex;
+    /** Protects sessions and devices, held while routing events */
+    std::mutex m_mutex;
+    std::list<std::shared_ptr<KernelTraceMuxSession>> m_sessions;
+    std::map<uint64_t, KernelTraceMuxSession *> m_devices;
+    struct perf_buffer *m_perf;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_KERNELTRACEMUX_H
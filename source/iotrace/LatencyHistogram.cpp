@@ -0,0 +1,150 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace octf {
+
+/* Buckets per power of two, as a power of two */
+static constexpr uint64_t SUB_BUCKET_BITS = 3;
+static constexpr uint64_t SUB_BUCKETS = 1ULL << SUB_BUCKET_BITS;
+
+/* Latencies below this have a bucket each */
+static constexpr uint64_t LINEAR_MAX = 2 * SUB_BUCKETS;
+
+/* Buckets of linear latencies, and of each power of two up to 2^63 */
+static constexpr size_t BUCKET_COUNT =
+        LINEAR_MAX + (64 - SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+LatencyHistogram::LatencyHistogram()
+        : m_buckets()
+        , m_first(0)
+        , m_count(0)
+        , m_sum(0)
+        , m_min(0)
+        , m_max(0) {}
+
+size_t LatencyHistogram::getBucket(uint64_t latency) {
+    if (latency < LINEAR_MAX) {
+        return latency;
+    }
+
+    uint64_t msb = 63 - __builtin_clzll(latency);
+    uint64_t sub = (latency >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return LINEAR_MAX + (msb - SUB_BUCKET_BITS - 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::getValue(size_t bucket) {
+    if (bucket < LINEAR_MAX) {
+        return bucket;
+    }
+
+    uint64_t msb = (bucket - LINEAR_MAX) / SUB_BUCKETS + SUB_BUCKET_BITS + 1;
+    uint64_t sub = (bucket - LINEAR_MAX) % SUB_BUCKETS;
+    uint64_t width = 1ULL << (msb - SUB_BUCKET_BITS);
+    return (SUB_BUCKETS + sub) * width + width / 2;
+}
+
+void LatencyHistogram::addToBucket(size_t bucket, uint64_t count) {
+    if (m_buckets.empty()) {
+        m_first = bucket;
+        m_buckets.resize(1);
+    } else if (bucket < m_first) {
+        m_buckets.insert(m_buckets.begin(), m_first - bucket, 0);
+        m_first = bucket;
+    } else if (bucket >= m_first + m_buckets.size()) {
+        m_buckets.resize(bucket - m_first + 1);
+    }
+
+    m_buckets[bucket - m_first] += count;
+}
+
+uint64_t LatencyHistogram::getBucketCount(size_t bucket) const {
+    if (bucket < m_first || bucket >= m_first + m_buckets.size()) {
+        return 0;
+    }
+    return m_buckets[bucket - m_first];
+}
+
+void LatencyHistogram::add(uint64_t latency) {
+    addToBucket(getBucket(latency), 1);
+    if (!m_count || latency < m_min) {
+        m_min = latency;
+    }
+    m_max = std::max(m_max, latency);
+    m_count++;
+    m_sum += latency;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    if (!other.m_count) {
+        return;
+    }
+
+    for (size_t i = 0; i < other.m_buckets.size(); i++) {
+        addToBucket(other.m_first + i, other.m_buckets[i]);
+    }
+    m_min = m_count ? std::min(m_min, other.m_min) : other.m_min;
+    m_max = std::max(m_max, other.m_max);
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+}
+
+uint64_t LatencyHistogram::getCount() const {
+    return m_count;
+}
+
+uint64_t LatencyHistogram::getPercentile(uint64_t permille) const {
+    if (!m_count) {
+        return 0;
+    }
+
+    uint64_t rank = (m_count - 1) * permille / 1000;
+    uint64_t count = 0;
+    for (size_t i = 0; i < m_buckets.size(); i++) {
+        count += m_buckets[i];
+        if (count > rank) {
+            return std::min(std::max(getValue(m_first + i), m_min), m_max);
+        }
+    }
+    return m_max;
+}
+
+void LatencyHistogram::fill(proto::LatencyStatistics *stats) const {
+    stats->Clear();
+    if (!m_count) {
+        return;
+    }
+
+    stats->set_count(m_count);
+    stats->set_average(m_sum / m_count);
+    stats->set_min(m_min);
+    stats->set_max(m_max);
+    stats->set_median(getPercentile(500));
+    stats->set_p99(getPercentile(990));
+}
+
+double LatencyHistogram::getDistance(const LatencyHistogram &a,
+                                     const LatencyHistogram &b) {
+    if (!a.m_count || !b.m_count) {
+        return 0;
+    }
+
+    uint64_t countA = 0, countB = 0;
+    double distance = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        countA += a.getBucketCount(i);
+        countB += b.getBucketCount(i);
+        distance = std::max(distance,
+                            std::fabs((double) countA / a.m_count -
+                                      (double) countB / b.m_count));
+    }
+    return distance;
+}
+
+}  // namespace octf
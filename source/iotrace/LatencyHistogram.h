@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_LATENCYHISTOGRAM_H
+#define SOURCE_USERSPACE_LATENCYHISTOGRAM_H
+
+#include <stdint.h>
+#include <vector>
+#include "InterfaceTraceExtensionParsing.pb.h"
+
+namespace octf {
+
+/**
+ * @brief Histogram of latencies of IOs, in constant memory
+ *
+ * Unlike LatencySamples, samples are not kept. Each power of two is split
+ * into eight buckets, so percentiles are within 1/16 of the exact ones. Only
+ * buckets between the lowest and the highest latency are allocated, so
+ * histograms of e.g. short time intervals stay small.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    virtual ~LatencyHistogram() = default;
+
+    void add(uint64_t latency);
+
+    void merge(const LatencyHistogram &other);
+
+    uint64_t getCount() const;
+
+    /**
+     * @param permille Percentile in units of 0.1%, e.g. 990 for p99
+     */
+    uint64_t getPercentile(uint64_t permille) const;
+
+    void fill(proto::LatencyStatistics *stats) const;
+
+    /**
+     * @brief Kolmogorov-Smirnov distance between the histograms, the largest
+     * difference of their cumulative distributions
+     */
+    static double getDistance(const LatencyHistogram &a,
+                              const LatencyHistogram &b);
+
+private:
+    static size_t getBucket(uint64_t latency);
+
+    void addToBucket(size_t bucket, uint64_t count);
+
+    uint64_t getBucketCount(size_t bucket) const;
+
+    /** Middle of the bucket */
+    static uint64_t getValue(size_t bucket);
+
+private:
+    /** Allocated buckets, the first of which is m_first */
+    std::vector<uint64_t> m_buckets;
+    size_t m_first;
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_min;
+    uint64_t m_max;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_LATENCYHISTOGRAM_H
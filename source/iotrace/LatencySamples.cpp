@@ -0,0 +1,52 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "LatencySamples.h"
+
+#include <algorithm>
+
+namespace octf {
+
+LatencySamples::LatencySamples()
+        : m_samples()
+        , m_sum(0) {}
+
+void LatencySamples::add(uint64_t latency) {
+    m_samples.push_back(latency);
+    m_sum += latency;
+}
+
+void LatencySamples::merge(const LatencySamples &other) {
+    m_samples.insert(m_samples.end(), other.m_samples.begin(),
+                     other.m_samples.end());
+    m_sum += other.m_sum;
+}
+
+uint64_t LatencySamples::getCount() const {
+    return m_samples.size();
+}
+
+void LatencySamples::fill(proto::LatencyStatistics *stats) {
+    stats->Clear();
+    if (m_samples.empty()) {
+        return;
+    }
+
+    auto count = m_samples.size();
+    auto percentile = [this, count](uint64_t permille) {
+        auto nth = m_samples.begin() + (count - 1) * permille / 1000;
+        std::nth_element(m_samples.begin(), nth, m_samples.end());
+        return *nth;
+    };
+
+    stats->set_count(count);
+    stats->set_average(m_sum / count);
+    stats->set_min(*std::min_element(m_samples.begin(), m_samples.end()));
+    stats->set_max(*std::max_element(m_samples.begin(), m_samples.end()));
+    stats->set_median(percentile(500));
+    stats->set_p99(percentile(990));
+}
+
+}  // namespace octf
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_LATENCYSAMPLES_H
+#define SOURCE_USERSPACE_LATENCYSAMPLES_H
+
+#include <stdint.h>
+#include <vector>
+#include "InterfaceTraceExtensionParsing.pb.h"
+
+namespace octf {
+
+/**
+ * @brief Latency samples of IOs, summarized into statistics
+ */
+class LatencySamples {
+public:
+    LatencySamples();
+    virtual ~LatencySamples() = default;
+
+    void add(uint64_t latency);
+
+    /**
+     * @brief Adds samples of the other set, e.g. parsed in parallel
+     */
+    void merge(const LatencySamples &other);
+
+    uint64_t getCount() const;
+
+    /**
+     * @brief Fills statistics of the samples, percentiles are exact
+     */
+    void fill(proto::LatencyStatistics *stats);
+
+private:
+    std::vector<uint64_t> m_samples;
+    uint64_t m_sum;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_LATENCYSAMPLES_H
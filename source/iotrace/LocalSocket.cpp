@@ -0,0 +1,165 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "LocalSocket.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <octf/utils/Exception.h>
+
+namespace octf {
+namespace localsocket {
+
+static constexpr uint32_t MESSAGE_MAX_SIZE = 1024 * 1024;
+
+static bool writeAll(int fd, const void *data, size_t size) {
+    auto buf = static_cast<const char *>(data);
+
+    while (size) {
+        // No SIGPIPE if the peer disconnects
+        ssize_t result = ::send(fd, buf, size, MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        buf += result;
+        size -= result;
+    }
+
+    return true;
+}
+
+static bool readAll(int fd, void *data, size_t size) {
+    auto buf = static_cast<char *>(data);
+
+    while (size) {
+        ssize_t result = ::read(fd, buf, size);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        } else if (result == 0) {
+            return false;
+        }
+
+        buf += result;
+        size -= result;
+    }
+
+    return true;
+}
+
+static void initAddress(const std::string &path, struct sockaddr_un &addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (path.length() >= sizeof(addr.sun_path)) {
+        throw Exception("Socket path too long, " + path);
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+}
+
+int listen(const std::string &path) {
+    if (::mkdir(SOCKET_DIR, 0700) && errno != EEXIST) {
+        throw Exception("Cannot create directory " + std::string(SOCKET_DIR));
+    }
+
+    struct sockaddr_un addr;
+    initAddress(path, addr);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw Exception("Cannot create socket " + path);
+    }
+
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr))) {
+        ::close(fd);
+        throw Exception("Cannot bind socket " + path);
+    }
+
+    if (::chmod(path.c_str(), 0600) || ::listen(fd, 8)) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        throw Exception("Cannot listen on socket " + path);
+    }
+
+    return fd;
+}
+
+int connect(const std::string &path) {
+    struct sockaddr_un addr;
+    initAddress(path, addr);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw Exception("Cannot create socket");
+    }
+
+    if (::connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                  sizeof(addr))) {
+        ::close(fd);
+        throw Exception("Cannot connect to " + path);
+    }
+
+    return fd;
+}
+
+pid_t getPeerPid(int fd) {
+    struct ucred cred = {};
+    socklen_t size = sizeof(cred);
+
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &size)) {
+        return 0;
+    }
+
+    return cred.pid;
+}
+
+void setTimeout(int fd, int seconds) {
+    struct timeval timeout = {};
+    timeout.tv_sec = seconds;
+
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+bool sendMessage(int fd, const google::protobuf::Message &message) {
+    std::string data;
+    if (!message.SerializeToString(&data)) {
+        return false;
+    }
+
+    uint32_t size = data.size();
+    return writeAll(fd, &size, sizeof(size)) &&
+           writeAll(fd, data.data(), data.size());
+}
+
+bool receiveMessage(int fd, google::protobuf::Message &message) {
+    uint32_t size = 0;
+    if (!readAll(fd, &size, sizeof(size)) || size > MESSAGE_MAX_SIZE) {
+        return false;
+    }
+
+    std::vector<char> data(size);
+    if (size && !readAll(fd, &data[0], size)) {
+        return false;
+    }
+
+    return message.ParseFromArray(data.data(), size);
+}
+
+}  // namespace localsocket
+}  // namespace octf
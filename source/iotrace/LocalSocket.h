@@ -0,0 +1,65 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_LOCALSOCKET_H
+#define SOURCE_USERSPACE_LOCALSOCKET_H
+
+#include <sys/types.h>
+#include <string>
+#include <google/protobuf/message.h>
+
+namespace octf {
+namespace localsocket {
+
+/** Directory of Unix sockets served by iotrace processes */
+constexpr const char *SOCKET_DIR = "/var/run/iotrace";
+
+/**
+ * @brief Creates Unix socket accessible by the owner only and listens on it
+ *
+ * @param path Path of the socket in SOCKET_DIR
+ *
+ * @return File descriptor of the listening socket
+ */
+int listen(const std::string &path);
+
+/**
+ * @brief Connects to Unix socket
+ *
+ * @return File descriptor of the connected socket
+ */
+int connect(const std::string &path);
+
+/**
+ * @return PID of the process connected to the socket, zero if unknown
+ */
+pid_t getPeerPid(int fd);
+
+/**
+ * @brief Sets send and receive timeout of the socket
+ */
+void setTimeout(int fd, int seconds);
+
+/**
+ * @brief Sends protobuf message prefixed with its size (32-bit, host byte
+ * order)
+ *
+ * @retval true Message sent
+ * @retval false Connection error
+ */
+bool sendMessage(int fd, const google::protobuf::Message &message);
+
+/**
+ * @brief Receives protobuf message sent by sendMessage()
+ *
+ * @retval true Message received
+ * @retval false Connection closed, connection error or invalid message
+ */
+bool receiveMessage(int fd, google::protobuf::Message &message);
+
+}  // namespace localsocket
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_LOCALSOCKET_H
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "ParserCache.h"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <octf/utils/Log.h>
+#include "InterfaceTraceExtensionParsing.pb.h"
+#include "TraceExtensionReader.h"
+
+namespace octf {
+
+/* Prefix of cache files in the trace directory, they are not hashed */
+static const std::string CACHE_FILE_PREFIX = "iotrace.cache.";
+
+/* Data hashed at the beginning and at the end of each file of the trace */
+static constexpr uint64_t SAMPLE_SIZE = 64 * 1024;
+
+/* 64-bit FNV-1a */
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+static void hashBytes(uint64_t &hash, const void *data, size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+}
+
+static void hashString(uint64_t &hash, const std::string &value) {
+    // Hash the terminating null too, so that concatenations differ
+    hashBytes(hash, value.c_str(), value.size() + 1);
+}
+
+static void hashNumber(uint64_t &hash, uint64_t value) {
+    hashBytes(hash, &value, sizeof(value));
+}
+
+ParserCache::ParserCache(const google::protobuf::Message &options,
+                         const std::vector<std::string> &tracePaths,
+                         bool enabled)
+        : m_enabled(enabled && !tracePaths.empty())
+        , m_path()
+        , m_options()
+        , m_traceHash(FNV_OFFSET_BASIS) {
+    if (!m_enabled) {
+        return;
+    }
+
+    // Requests have no map fields, so their serialization is deterministic
+    m_options = options.GetDescriptor()->full_name();
+    m_options += '\0';
+    m_options += options.SerializeAsString();
+
+    for (const auto &tracePath : tracePaths) {
+        if (!hashTrace(tracePath, m_traceHash)) {
+            // The parser reports the missing trace
+            m_enabled = false;
+            return;
+        }
+    }
+
+    uint64_t key = FNV_OFFSET_BASIS;
+    hashString(key, m_options);
+
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016" PRIx64, key);
+    m_path = TraceExtensionReader::getTraceDirectory(tracePaths.front()) +
+             "/" + CACHE_FILE_PREFIX + name;
+}
+
+bool ParserCache::load(google::protobuf::Message *response) {
+    if (!m_enabled) {
+        return false;
+    }
+
+    std::ifstream file(m_path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    proto::ParserCacheEntry entry;
+    if (!entry.ParseFromIstream(&file)) {
+        log::verbose << "Invalid parser cache " << m_path << std::endl;
+        return false;
+    }
+
+    // Hashes of options may collide, the options themselves may not
+    if (entry.options() != m_options || entry.tracehash() != m_traceHash) {
+        return false;
+    }
+
+    return response->ParseFromString(entry.response());
+}
+
+void ParserCache::store(const google::protobuf::Message &response) {
+    if (!m_enabled) {
+        return;
+    }
+
+    proto::ParserCacheEntry entry;
+    entry.set_options(m_options);
+    entry.set_tracehash(m_traceHash);
+    entry.set_response(response.SerializeAsString());
+
+    // Concurrent readers see either the previous or the complete entry
+    std::string tmpPath = m_path + ".tmp." + std::to_string(::getpid());
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    bool stored = file.is_open() && entry.SerializeToOstream(&file);
+    file.close();
+
+    if (!stored || file.fail() || ::rename(tmpPath.c_str(), m_path.c_str())) {
+        // E.g. read-only trace repository, the result is just not cached
+        log::verbose << "Cannot write parser cache " << m_path << std::endl;
+        ::remove(tmpPath.c_str());
+    }
+}
+
+bool ParserCache::hashTrace(const std::string &tracePath, uint64_t &hash) {
+    std::string dir = TraceExtensionReader::getTraceDirectory(tracePath);
+    std::vector<std::string> names;
+
+    DIR *stream = ::opendir(dir.c_str());
+    if (!stream) {
+        return false;
+    }
+    while (auto entry = ::readdir(stream)) {
+        std::string name = entry->d_name;
+        if (name.compare(0, CACHE_FILE_PREFIX.size(), CACHE_FILE_PREFIX) != 0) {
+            names.push_back(name);
+        }
+    }
+    ::closedir(stream);
+
+    // Order of directory entries is not stable
+    std::sort(names.begin(), names.end());
+
+    for (const auto &name : names) {
+        struct stat sb;
+        std::string path = dir + "/" + name;
+        if (::stat(path.c_str(), &sb) || !S_ISREG(sb.st_mode)) {
+            continue;
+        }
+
+        hashString(hash, name);
+        hashNumber(hash, sb.st_size);
+        hashNumber(hash, sb.st_mtim.tv_sec);
+        hashNumber(hash, sb.st_mtim.tv_nsec);
+        if (!hashFile(path, hash)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ParserCache::hashFile(const std::string &path, uint64_t &hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.seekg(0, std::ios::end);
+    uint64_t size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    std::vector<char> buffer(std::min(size, SAMPLE_SIZE));
+    file.read(buffer.data(), buffer.size());
+    hashBytes(hash, buffer.data(), file.gcount());
+
+    if (size > SAMPLE_SIZE) {
+        uint64_t tail = std::max(SAMPLE_SIZE, size - SAMPLE_SIZE);
+        buffer.resize(size - tail);
+        file.seekg(tail, std::ios::beg);
+        file.read(buffer.data(), buffer.size());
+        hashBytes(hash, buffer.data(), file.gcount());
+    }
+
+    return !file.bad();
+}
+
+}  // namespace octf
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_PARSERCACHE_H
+#define SOURCE_USERSPACE_PARSERCACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <google/protobuf/message.h>
+#include <octf/utils/NonCopyable.h>
+
+namespace octf {
+
+/**
+ * @brief Cache of results of parser commands, kept in the trace directory
+ *
+ * Results are keyed by the command and its options, and are valid as long as
+ * the traces they were parsed from do not change. Traces are identified by
+ * their content rather than by their paths: name, size and modification time
+ * of each file of the trace, and the data at the beginning and at the end of
+ * it. Hashing whole traces would take as long as parsing them.
+ */
+class ParserCache : public NonCopyable {
+public:
+    /**
+     * @param options Request of the command, without paths of traces
+     * @param tracePaths Paths of parsed traces, relative to the trace
+     * repository, the cache is kept in the directory of the first one
+     * @param enabled False if the command has side effects the cache cannot
+     * reproduce, e.g. it prints each IO, then nothing is cached
+     */
+    ParserCache(const google::protobuf::Message &options,
+                const std::vector<std::string> &tracePaths,
+                bool enabled);
+    virtual ~ParserCache() = default;
+
+    /**
+     * @brief Loads the cached result of the command
+     *
+     * @retval true Response loaded
+     * @retval false Result not cached, or cached for other traces
+     */
+    bool load(google::protobuf::Message *response);
+
+    /**
+     * @brief Stores the result of the command, if the trace directory is
+     * writable
+     */
+    void store(const google::protobuf::Message &response);
+
+private:
+    /**
+     * @brief Hashes files of the trace, except for cached results
+     *
+     * @retval false The trace directory cannot be read
+     */
+    static bool hashTrace(const std::string &tracePath, uint64_t &hash);
+
+    static bool hashFile(const std::string &path, uint64_t &hash);
+
+private:
+    bool m_enabled;
+    /** Path of the cache file */
+    std::string m_path;
+    /** Name of the command and its serialized options */
+    std::string m_options;
+    uint64_t m_traceHash;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_PARSERCACHE_H
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "ProcessIoParser.h"
+
+#include <google/protobuf/util/json_util.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "TraceExtensionReader.h"
+#include "iotrace_event_ext.h"
+
+namespace octf {
+
+/* Sector size of IO events */
+static constexpr uint64_t SECTOR_SIZE = 512;
+
+/* Maximum depth of the cgroup hierarchy, protects against cycles */
+static constexpr int CGROUP_DEPTH_MAX = 64;
+
+ProcessIoParser::ProcessIoParser(const std::string &tracePath,
+                                 bool printIo,
+                                 const std::string &filter)
+        : FilteredTraceEventHandler(tracePath, filter)
+        , m_printIo(printIo)
+        , m_cgroupFilter()
+        , m_pidFilter(0)
+        , m_commFilter()
+        , m_events(tracePath,
+                   {iotrace_event_type_io_process,
+                    iotrace_event_type_process_name,
+                    iotrace_event_type_cgroup_name})
+        , m_threadNames()
+        , m_cgroupNames()
+        , m_cgroupPaths()
+        , m_ios()
+        , m_cgroups()
+        , m_processes()
+        , m_firstTimestamp(UINT64_MAX)
+        , m_lastTimestamp(0) {
+    if (!m_events.isPresent()) {
+        throw Exception("Trace has no process events, trace with --process");
+    }
+}
+
+void ProcessIoParser::setFilter(const std::string &cgroup,
+                                uint64_t pid,
+                                const std::string &comm) {
+    m_cgroupFilter = cgroup;
+    m_pidFilter = pid;
+    m_commFilter = comm;
+}
+
+void ProcessIoParser::applyProcessEvents(uint64_t sid) {
+    while (auto hdr = m_events.next(sid)) {
+        if (hdr->type == iotrace_event_type_process_name) {
+            if (hdr->size != sizeof(struct iotrace_event_process_name)) {
+                throw Exception("Invalid process name event in trace "
+                                "extension");
+            }
+
+            auto ev = reinterpret_cast<
+                    const struct iotrace_event_process_name *>(hdr);
+            m_threadNames[ev->pid].assign(ev->comm,
+                                          strnlen(ev->comm, sizeof(ev->comm)));
+        } else if (hdr->type == iotrace_event_type_cgroup_name) {
+            if (hdr->size != sizeof(struct iotrace_event_cgroup_name)) {
+                throw Exception("Invalid cgroup name event in trace "
+                                "extension");
+            }
+
+            auto ev = reinterpret_cast<
+                    const struct iotrace_event_cgroup_name *>(hdr);
+            auto &cgroup = m_cgroupNames[ev->cgroup_id];
+            cgroup.parentId = ev->parent_id;
+            cgroup.name.assign(ev->name, strnlen(ev->name, sizeof(ev->name)));
+            m_cgroupPaths.clear();
+        } else {
+            if (hdr->size != sizeof(struct iotrace_event_io_process)) {
+                throw Exception("Invalid process event in trace extension");
+            }
+
+            auto ev = reinterpret_cast<const struct iotrace_event_io_process *>(
+                    hdr);
+            auto iter = m_ios.find(ev->ref_id);
+            if (iter == m_ios.end()) {
+                continue;
+            }
+
+            auto &io = iter->second;
+            io.attributed = true;
+            io.pid = ev->pid;
+            io.tgid = ev->tgid;
+            io.cgroupId = ev->cgroup_id;
+
+            auto name = m_threadNames.find(ev->pid);
+            if (name != m_threadNames.end()) {
+                io.comm = name->second;
+            }
+        }
+    }
+}
+
+void ProcessIoParser::handleFilteredEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    const auto &header = traceEvent->header();
+    applyProcessEvents(header.sid());
+
+    if (traceEvent->has_io()) {
+        const auto &event = traceEvent->io();
+        if (!event.id()) {
+            return;
+        }
+
+        PendingIo io = {};
+        io.sid = header.sid();
+        io.timestamp = header.timestamp();
+        io.deviceId = event.deviceid();
+        io.lba = event.lba();
+        io.len = event.len();
+        io.operation = event.operation();
+        m_ios[event.id()] = io;
+
+        m_firstTimestamp = std::min(m_firstTimestamp, header.timestamp());
+    } else if (traceEvent->has_iocompletion()) {
+        auto iter = m_ios.find(traceEvent->iocompletion().refsid());
+        if (iter == m_ios.end()) {
+            return;
+        }
+
+        handleCompletion(header.timestamp(), iter->second);
+        m_ios.erase(iter);
+    }
+}
+
+const std::string &ProcessIoParser::getCgroupPath(uint64_t cgroupId) {
+    auto iter = m_cgroupPaths.find(cgroupId);
+    if (iter != m_cgroupPaths.end()) {
+        return iter->second;
+    }
+
+    // Names of the cgroup and its ancestors, the root cgroup has no parent
+    std::vector<const std::string *> names;
+    auto id = cgroupId;
+    for (int i = 0; i < CGROUP_DEPTH_MAX; i++) {
+        auto name = m_cgroupNames.find(id);
+        if (name == m_cgroupNames.end() || !name->second.parentId) {
+            break;
+        }
+
+        names.push_back(&name->second.name);
+        id = name->second.parentId;
+    }
+
+    std::string path;
+    for (auto name = names.rbegin(); name != names.rend(); name++) {
+        path += "/" + **name;
+    }
+    if (path.empty()) {
+        path = m_cgroupNames.count(cgroupId) ? "/" : "";
+    }
+
+    return m_cgroupPaths[cgroupId] = path;
+}
+
+bool ProcessIoParser::isFiltered(const PendingIo &io,
+                                 const std::string &cgroup) const {
+    if (m_pidFilter && io.pid != m_pidFilter && io.tgid != m_pidFilter) {
+        return true;
+    }
+    if (!m_commFilter.empty() && io.comm != m_commFilter) {
+        return true;
+    }
+    if (!m_cgroupFilter.empty() && cgroup.compare(0, m_cgroupFilter.size(),
+                                                  m_cgroupFilter) != 0) {
+        return true;
+    }
+
+    return false;
+}
+
+void ProcessIoParser::addIo(Statistics &stats,
+                            const PendingIo &io,
+                            uint64_t latency) {
+    switch (io.operation) {
+    case proto::trace::IoType::Read:
+        stats.readCount++;
+        stats.readBytes += io.len * SECTOR_SIZE;
+        break;
+    case proto::trace::IoType::Write:
+        stats.writeCount++;
+        stats.writeBytes += io.len * SECTOR_SIZE;
+        break;
+    case proto::trace::IoType::Discard:
+        stats.discardCount++;
+        break;
+    default:
+        break;
+    }
+
+    stats.latency.add(latency);
+}
+
+void ProcessIoParser::handleCompletion(uint64_t timestamp,
+                                       const PendingIo &io) {
+    if (!io.attributed || timestamp < io.timestamp) {
+        return;
+    }
+
+    const auto &cgroup = getCgroupPath(io.cgroupId);
+    if (isFiltered(io, cgroup)) {
+        return;
+    }
+
+    uint64_t latency = timestamp - io.timestamp;
+    m_lastTimestamp = std::max(m_lastTimestamp, timestamp);
+
+    auto &cgroupStats = m_cgroups[io.cgroupId];
+    cgroupStats.name = cgroup;
+    addIo(cgroupStats, io, latency);
+
+    // The process is named after its main thread if it submitted IO
+    auto &processStats = m_processes[io.tgid];
+    if (processStats.name.empty() || io.pid == io.tgid) {
+        processStats.name = io.comm;
+    }
+    addIo(processStats, io, latency);
+
+    if (m_printIo) {
+        proto::IoProcess result;
+        result.set_sid(io.sid);
+        result.set_timestamp(io.timestamp);
+        result.set_deviceid(io.deviceId);
+        result.set_lba(io.lba);
+        result.set_len(io.len);
+        result.set_operation(proto::trace::IoType_Name(io.operation));
+        result.set_pid(io.pid);
+        result.set_tgid(io.tgid);
+        result.set_comm(io.comm);
+        result.set_cgroupid(io.cgroupId);
+        result.set_cgroup(cgroup);
+        result.set_latency(latency);
+
+        std::string json;
+        google::protobuf::util::MessageToJsonString(result, &json);
+        log::cout << json << std::endl;
+    }
+}
+
+void ProcessIoParser::fillStatistics(
+        uint64_t id,
+        Statistics &stats,
+        proto::ProcessIoStatistics *result) const {
+    uint64_t count = stats.readCount + stats.writeCount + stats.discardCount;
+
+    result->set_id(id);
+    result->set_name(stats.name);
+    result->set_readcount(stats.readCount);
+    result->set_writecount(stats.writeCount);
+    result->set_discardcount(stats.discardCount);
+    result->set_readbytes(stats.readBytes);
+    result->set_writebytes(stats.writeBytes);
+
+    if (m_lastTimestamp > m_firstTimestamp) {
+        double seconds = (m_lastTimestamp - m_firstTimestamp) / 1e9;
+        result->set_iops(count / seconds);
+        result->set_bandwidth((stats.readBytes + stats.writeBytes) / seconds);
+    }
+
+    stats.latency.fill(result->mutable_latency());
+}
+
+void ProcessIoParser::getSummary(proto::ProcessIoSummary *summary) {
+    summary->Clear();
+
+    if (m_lastTimestamp > m_firstTimestamp) {
+        summary->set_duration(m_lastTimestamp - m_firstTimestamp);
+    }
+
+    for (auto &entry : m_cgroups) {
+        fillStatistics(entry.first, entry.second, summary->add_cgroups());
+    }
+    for (auto &entry : m_processes) {
+        fillStatistics(entry.first, entry.second, summary->add_processes());
+    }
+}
+
+}  // namespace octf
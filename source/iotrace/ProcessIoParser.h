@@ -0,0 +1,146 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_PROCESSIOPARSER_H
+#define SOURCE_USERSPACE_PROCESSIOPARSER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <octf/proto/trace.pb.h>
+#include "FilteredTraceEventHandler.h"
+#include "InterfaceTraceExtensionParsing.pb.h"
+#include "LatencyHistogram.h"
+#include "SortedTraceExtensionReader.h"
+
+namespace octf {
+
+/**
+ * @brief Breaks down IOs by cgroup and process submitting them
+ *
+ * Process events of the trace extension are streamed and merged with IO
+ * events of the trace by sequence ID. Names of threads and cgroups are
+ * emitted once per trace, before the first IO referring to them. Latencies
+ * are kept in histograms, so memory does not grow with the trace.
+ */
+class ProcessIoParser : public FilteredTraceEventHandler {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param printIo Print process and cgroup of each IO
+     * @param filter Filter expression of IOs, see IoFilter
+     */
+    ProcessIoParser(const std::string &tracePath,
+                    bool printIo,
+                    const std::string &filter);
+    virtual ~ProcessIoParser() = default;
+
+    /**
+     * @brief Sets IOs taken into account, empty (or zero) values match all
+     *
+     * @param cgroup Prefix of the cgroup path
+     * @param pid ID of the process or thread
+     * @param comm Name of the thread
+     */
+    void setFilter(const std::string &cgroup,
+                   uint64_t pid,
+                   const std::string &comm);
+
+    void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) override;
+
+    /**
+     * @brief Fills statistics of cgroups and processes, call after
+     * processEvents()
+     */
+    void getSummary(proto::ProcessIoSummary *summary);
+
+private:
+    /** IO queued and not completed yet */
+    struct PendingIo {
+        uint64_t sid;
+        uint64_t timestamp;
+        uint64_t deviceId;
+        uint64_t lba;
+        uint32_t len;
+        proto::trace::IoType operation;
+        bool attributed;
+        uint32_t pid;
+        uint32_t tgid;
+        uint64_t cgroupId;
+        /** Name of the thread at submission */
+        std::string comm;
+    };
+
+    struct CgroupName {
+        uint64_t parentId;
+        std::string name;
+    };
+
+    struct Statistics {
+        Statistics()
+                : name()
+                , readCount(0)
+                , writeCount(0)
+                , discardCount(0)
+                , readBytes(0)
+                , writeBytes(0)
+                , latency() {}
+
+        std::string name;
+        uint64_t readCount;
+        uint64_t writeCount;
+        uint64_t discardCount;
+        uint64_t readBytes;
+        uint64_t writeBytes;
+        LatencyHistogram latency;
+    };
+
+    /**
+     * @brief Applies process attributions and names which happened before
+     * the event
+     */
+    void applyProcessEvents(uint64_t sid);
+
+    void handleCompletion(uint64_t timestamp, const PendingIo &io);
+
+    bool isFiltered(const PendingIo &io, const std::string &cgroup) const;
+
+    /**
+     * @return Path of the cgroup built from names of its ancestors
+     */
+    const std::string &getCgroupPath(uint64_t cgroupId);
+
+    static void addIo(Statistics &stats,
+                      const PendingIo &io,
+                      uint64_t latency);
+
+    void fillStatistics(uint64_t id,
+                        Statistics &stats,
+                        proto::ProcessIoStatistics *result) const;
+
+private:
+    const bool m_printIo;
+    std::string m_cgroupFilter;
+    uint64_t m_pidFilter;
+    std::string m_commFilter;
+    SortedTraceExtensionReader m_events;
+    /** Names of threads keyed by thread ID */
+    std::unordered_map<uint32_t, std::string> m_threadNames;
+    std::unordered_map<uint64_t, CgroupName> m_cgroupNames;
+    std::unordered_map<uint64_t, std::string> m_cgroupPaths;
+    /** IOs in flight keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_ios;
+    std::map<uint64_t, Statistics> m_cgroups;
+    /** Statistics of processes keyed by process ID */
+    std::map<uint64_t, Statistics> m_processes;
+    uint64_t m_firstTimestamp;
+    uint64_t m_lastTimestamp;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_PROCESSIOPARSER_H
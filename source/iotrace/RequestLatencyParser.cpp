@@ -0,0 +1,159 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "RequestLatencyParser.h"
+
+#include <google/protobuf/util/json_util.h>
+#include <cstddef>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+#include "TraceExtensionReader.h"
+#include "iotrace_event_ext.h"
+
+namespace octf {
+
+RequestLatencyParser::RequestLatencyParser(const std::string &tracePath,
+                                           bool printIo,
+                                           const std::string &filter)
+        : FilteredTraceEventHandler(tracePath, filter)
+        , m_printIo(printIo)
+        , m_issues(tracePath, {iotrace_event_type_rq_issue})
+        , m_ios()
+        , m_devices() {
+    if (!m_issues.isPresent()) {
+        throw Exception("Trace has no request events, trace with "
+                        "--request-time");
+    }
+}
+
+void RequestLatencyParser::applyRequestIssues(uint64_t sid) {
+    while (auto hdr = m_issues.next(sid)) {
+        auto issue = reinterpret_cast<const struct iotrace_event_rq_issue *>(
+                hdr);
+        if (hdr->size < offsetof(struct iotrace_event_rq_issue, ref_ids) ||
+            issue->count > IOTRACE_EVENT_RQ_IO_MAX ||
+            hdr->size != offsetof(struct iotrace_event_rq_issue, ref_ids) +
+                                 issue->count * sizeof(issue->ref_ids[0])) {
+            throw Exception("Invalid request event in trace extension");
+        }
+
+        for (uint32_t i = 0; i < issue->count; i++) {
+            auto iter = m_ios.find(issue->ref_ids[i]);
+            if (iter == m_ios.end()) {
+                continue;
+            }
+
+            auto &io = iter->second;
+            if (hdr->timestamp < io.timestamp) {
+                continue;
+            }
+
+            // A requeued request is dispatched again, the last one counts
+            io.issueTimestamp = hdr->timestamp;
+            io.insertTimestamp = 0;
+
+            // Insertion left by a request of the previous tracing is ignored
+            if (issue->insert_timestamp >= io.timestamp &&
+                issue->insert_timestamp <= hdr->timestamp) {
+                io.insertTimestamp = issue->insert_timestamp;
+            }
+        }
+    }
+}
+
+void RequestLatencyParser::handleFilteredEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    const auto &header = traceEvent->header();
+    applyRequestIssues(header.sid());
+
+    if (traceEvent->has_devicedescription()) {
+        const auto &desc = traceEvent->devicedescription();
+        m_devices[desc.id()].name = desc.name();
+    } else if (traceEvent->has_io()) {
+        const auto &event = traceEvent->io();
+        if (!event.id()) {
+            return;
+        }
+
+        PendingIo io = {};
+        io.sid = header.sid();
+        io.timestamp = header.timestamp();
+        io.deviceId = event.deviceid();
+        io.lba = event.lba();
+        io.len = event.len();
+        io.operation = event.operation();
+        m_ios[event.id()] = io;
+    } else if (traceEvent->has_iocompletion()) {
+        auto iter = m_ios.find(traceEvent->iocompletion().refsid());
+        if (iter == m_ios.end()) {
+            return;
+        }
+
+        handleCompletion(header.timestamp(), iter->second);
+        m_ios.erase(iter);
+    }
+}
+
+void RequestLatencyParser::handleCompletion(uint64_t timestamp,
+                                            const PendingIo &io) {
+    if (timestamp < io.timestamp) {
+        return;
+    }
+
+    auto &device = m_devices[io.deviceId];
+    device.ioCount++;
+    device.latency.add(timestamp - io.timestamp);
+
+    if (!io.issueTimestamp || io.issueTimestamp > timestamp) {
+        // IO of a request not dispatched while tracing
+        return;
+    }
+
+    proto::IoRequestLatency result;
+    result.set_sid(io.sid);
+    result.set_timestamp(io.timestamp);
+    result.set_deviceid(io.deviceId);
+    result.set_lba(io.lba);
+    result.set_len(io.len);
+    result.set_operation(proto::trace::IoType_Name(io.operation));
+    if (io.insertTimestamp) {
+        result.set_q2i(io.insertTimestamp - io.timestamp);
+        device.insertedCount++;
+    }
+    result.set_q2d(io.issueTimestamp - io.timestamp);
+    result.set_d2c(timestamp - io.issueTimestamp);
+    result.set_latency(timestamp - io.timestamp);
+
+    device.q2d.add(result.q2d());
+    device.d2c.add(result.d2c());
+
+    if (m_printIo) {
+        std::string json;
+        google::protobuf::util::MessageToJsonString(result, &json);
+        log::cout << json << std::endl;
+    }
+}
+
+void RequestLatencyParser::getSummary(proto::RequestLatencySummary *summary) {
+    summary->Clear();
+
+    for (auto &entry : m_devices) {
+        auto &device = entry.second;
+        if (!device.ioCount) {
+            continue;
+        }
+
+        auto result = summary->add_devices();
+        result->set_id(entry.first);
+        result->set_name(device.name);
+        result->set_iocount(device.ioCount);
+        result->set_insertedcount(device.insertedCount);
+        device.q2d.fill(result->mutable_q2d());
+        device.d2c.fill(result->mutable_d2c());
+        device.latency.fill(result->mutable_latency());
+    }
+}
+
+}  // namespace octf
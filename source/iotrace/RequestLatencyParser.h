@@ -0,0 +1,97 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_REQUESTLATENCYPARSER_H
+#define SOURCE_USERSPACE_REQUESTLATENCYPARSER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <octf/proto/trace.pb.h>
+#include "FilteredTraceEventHandler.h"
+#include "InterfaceTraceExtensionParsing.pb.h"
+#include "LatencyHistogram.h"
+#include "SortedTraceExtensionReader.h"
+
+namespace octf {
+
+/**
+ * @brief Splits latency of IOs into queue and device time
+ *
+ * Request dispatch events of the trace extension are streamed and merged
+ * with IO events of the trace by sequence ID. The IO is dispatched to the
+ * device when its request is, so queue time (Q2D) ends and device time (D2C)
+ * starts at the last dispatch of the request before the IO completes.
+ * Latencies are kept in histograms, so memory does not grow with the trace.
+ */
+class RequestLatencyParser : public FilteredTraceEventHandler {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param printIo Print queue and device time of each IO
+     * @param filter Filter expression of IOs, see IoFilter
+     */
+    RequestLatencyParser(const std::string &tracePath,
+                         bool printIo,
+                         const std::string &filter);
+    virtual ~RequestLatencyParser() = default;
+
+    void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) override;
+
+    /**
+     * @brief Fills latency statistics of devices, call after processEvents()
+     */
+    void getSummary(proto::RequestLatencySummary *summary);
+
+private:
+    /** IO queued and not completed yet */
+    struct PendingIo {
+        uint64_t sid;
+        uint64_t timestamp;
+        uint64_t deviceId;
+        uint64_t lba;
+        uint32_t len;
+        proto::trace::IoType operation;
+        uint64_t issueTimestamp;
+        uint64_t insertTimestamp;
+    };
+
+    struct DeviceLatency {
+        DeviceLatency()
+                : name()
+                , ioCount(0)
+                , insertedCount(0)
+                , q2d()
+                , d2c()
+                , latency() {}
+
+        std::string name;
+        uint64_t ioCount;
+        uint64_t insertedCount;
+        LatencyHistogram q2d;
+        LatencyHistogram d2c;
+        LatencyHistogram latency;
+    };
+
+    /**
+     * @brief Applies request dispatches which happened before the event
+     */
+    void applyRequestIssues(uint64_t sid);
+
+    void handleCompletion(uint64_t timestamp, const PendingIo &io);
+
+private:
+    const bool m_printIo;
+    SortedTraceExtensionReader m_issues;
+    /** IOs in flight keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_ios;
+    std::map<uint64_t, DeviceLatency> m_devices;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_REQUESTLATENCYPARSER_H
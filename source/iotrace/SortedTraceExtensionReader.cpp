@@ -0,0 +1,79 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "SortedTraceExtensionReader.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace octf {
+
+/*
+ * Number of read ahead events. Perf buffers of all CPUs are drained in turn,
+ * and each holds thousands of events, so events of one CPU are displaced by
+ * at most the contents of perf buffers of the other ones.
+ */
+static constexpr size_t REORDER_WINDOW = 256 * 1024;
+
+SortedTraceExtensionReader::SortedTraceExtensionReader(
+        const std::string &tracePath,
+        const std::set<uint32_t> &types)
+        : m_reader(tracePath)
+        , m_types(types)
+        , m_window()
+        , m_index(0)
+        , m_eof(!m_reader.isPresent())
+        , m_current() {}
+
+bool SortedTraceExtensionReader::isPresent() const {
+    return m_reader.isPresent();
+}
+
+bool SortedTraceExtensionReader::isLater(const Entry &a, const Entry &b) {
+    if (a.sid != b.sid) {
+        return a.sid > b.sid;
+    }
+    return a.index > b.index;
+}
+
+void SortedTraceExtensionReader::fill() {
+    while (!m_eof && m_window.size() < REORDER_WINDOW) {
+        auto hdr = m_reader.next();
+        if (!hdr) {
+            m_eof = true;
+            break;
+        }
+        if (!m_types.count(hdr->type)) {
+            continue;
+        }
+
+        auto data = reinterpret_cast<const char *>(hdr);
+        Entry entry;
+        entry.sid = hdr->sid;
+        entry.index = m_index++;
+        entry.data.assign(data, data + hdr->size);
+
+        m_window.push_back(std::move(entry));
+        std::push_heap(m_window.begin(), m_window.end(), isLater);
+    }
+}
+
+const struct iotrace_event_hdr *SortedTraceExtensionReader::next(
+        uint64_t sid) {
+    fill();
+
+    if (m_window.empty() || m_window.front().sid > sid) {
+        return nullptr;
+    }
+
+    std::pop_heap(m_window.begin(), m_window.end(), isLater);
+    m_current = std::move(m_window.back());
+    m_window.pop_back();
+
+    return reinterpret_cast<const struct iotrace_event_hdr *>(
+            m_current.data.data());
+}
+
+}  // namespace octf
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_SORTEDTRACEEXTENSIONREADER_H
+#define SOURCE_USERSPACE_SORTEDTRACEEXTENSIONREADER_H
+
+#include <stdint.h>
+#include <set>
+#include <string>
+#include <vector>
+#include <octf/trace/iotrace_event.h>
+#include <octf/utils/NonCopyable.h>
+#include "TraceExtensionReader.h"
+
+namespace octf {
+
+/**
+ * @brief Reader of extension events in order of sequence IDs
+ *
+ * Extension events are written as perf buffers of CPUs are drained, so they
+ * are nearly, but not exactly, in order of sequence IDs. Instead of loading
+ * and sorting the whole file, events are read ahead into a reorder window of
+ * bounded size, and the one with the lowest sequence ID is returned. An event
+ * displaced by more than the window is returned late, out of order.
+ */
+class SortedTraceExtensionReader : public NonCopyable {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param types Types of returned events, other events are skipped
+     *
+     * @throws Exception The extension file is not valid
+     */
+    SortedTraceExtensionReader(const std::string &tracePath,
+                               const std::set<uint32_t> &types);
+    virtual ~SortedTraceExtensionReader() = default;
+
+    /**
+     * @retval true The trace has the extension file
+     * @retval false The trace has no extension events
+     */
+    bool isPresent() const;
+
+    /**
+     * @brief Reads the next event which happened before the given one
+     *
+     * @param sid Sequence ID of the trace event being handled
+     *
+     * @return Event valid until the next call, nullptr if the next event has
+     * a higher sequence ID, or at the end of file
+     *
+     * @throws Exception The extension file is corrupted
+     */
+    const struct iotrace_event_hdr *next(uint64_t sid);
+
+private:
+    struct Entry {
+        uint64_t sid;
+        /** Order of reading, keeps events of equal sequence IDs in order */
+        uint64_t index;
+        std::vector<char> data;
+    };
+
+    /**
+     * @brief Fills the reorder window from the file
+     */
+    void fill();
+
+    static bool isLater(const Entry &a, const Entry &b);
+
+private:
+    TraceExtensionReader m_reader;
+    const std::set<uint32_t> m_types;
+    /** Min-heap of read ahead events */
+    std::vector<Entry> m_window;
+    uint64_t m_index;
+    bool m_eof;
+    Entry m_current;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_SORTEDTRACEEXTENSIONREADER_H
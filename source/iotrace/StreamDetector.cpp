@@ -0,0 +1,227 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "StreamDetector.h"
+
+#include <algorithm>
+
+namespace octf {
+
+/* Sector size of IO events */
+static constexpr uint64_t SECTOR_SIZE = 512;
+
+/* Stream ends if it has no IO for this time (in ns) */
+static constexpr uint64_t STREAM_IDLE_TIME = 1000ULL * 1000 * 1000;
+
+/* Maximum distance between IOs of a strided stream (64 MiB in sectors) */
+static constexpr int64_t STREAM_STRIDE_MAX = 128 * 1024;
+
+/* Upper bounds of stream length buckets in bytes, the last one is unbounded */
+static const uint64_t STREAM_LENGTH_BUCKETS[] = {
+        128ULL * 1024,
+        1024ULL * 1024,
+        8ULL * 1024 * 1024,
+        64ULL * 1024 * 1024,
+};
+
+static constexpr size_t STREAM_LENGTH_BUCKET_COUNT =
+        sizeof(STREAM_LENGTH_BUCKETS) / sizeof(STREAM_LENGTH_BUCKETS[0]);
+
+StreamLengths::StreamLengths()
+        : m_count(0)
+        , m_sum(0)
+        , m_max(0)
+        , m_buckets(STREAM_LENGTH_BUCKET_COUNT + 1) {}
+
+void StreamLengths::add(uint64_t bytes) {
+    size_t bucket = 0;
+    while (bucket < STREAM_LENGTH_BUCKET_COUNT &&
+           bytes > STREAM_LENGTH_BUCKETS[bucket]) {
+        bucket++;
+    }
+
+    m_buckets[bucket]++;
+    m_count++;
+    m_sum += bytes;
+    m_max = std::max(m_max, bytes);
+}
+
+void StreamLengths::merge(const StreamLengths &other) {
+    for (size_t i = 0; i < m_buckets.size(); i++) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_max = std::max(m_max, other.m_max);
+}
+
+void StreamLengths::fill(proto::StreamStatistics *stats) const {
+    stats->Clear();
+    stats->set_count(m_count);
+    if (m_count) {
+        stats->set_averagelength(m_sum / m_count);
+    }
+    stats->set_maxlength(m_max);
+
+    for (size_t i = 0; i < m_buckets.size(); i++) {
+        auto bucket = stats->add_lengths();
+        if (i < STREAM_LENGTH_BUCKET_COUNT) {
+            bucket->set_maxlength(STREAM_LENGTH_BUCKETS[i]);
+        }
+        bucket->set_count(m_buckets[i]);
+    }
+}
+
+StreamDetector::StreamDetector(size_t capacity)
+        : m_capacity(capacity)
+        , m_streams()
+        , m_used(0)
+        , m_lastRandom(0)
+        , m_lastRandomOperation(0)
+        , m_hasLastRandom(false)
+        , m_active(0)
+        , m_maxActive(0)
+        , m_sequential()
+        , m_strided() {}
+
+StreamDetector::AccessClass StreamDetector::classify(uint32_t operation,
+                                                     uint64_t offset,
+                                                     uint32_t len,
+                                                     uint64_t timestamp) {
+    m_used++;
+
+    for (size_t i = 0; i < m_streams.size();) {
+        auto &stream = m_streams[i];
+
+        if (timestamp > stream.timestamp + STREAM_IDLE_TIME) {
+            endStream(stream);
+            stream = m_streams.back();
+            m_streams.pop_back();
+            continue;
+        }
+
+        AccessClass accessClass;
+        if (stream.operation != operation) {
+            i++;
+            continue;
+        } else if (offset == stream.next) {
+            accessClass = Sequential;
+        } else if (stream.accessClass != Sequential && stream.stride &&
+                   offset == stream.last + stream.stride) {
+            accessClass = Strided;
+        } else {
+            i++;
+            continue;
+        }
+
+        if (stream.accessClass == Strided && accessClass == Sequential) {
+            // Pattern changed, a new stream starts with the last IO
+            endStream(stream);
+            stream.bytes = stream.lastBytes;
+        }
+        if (stream.accessClass == Random) {
+            m_active++;
+            m_maxActive = std::max(m_maxActive, m_active);
+        }
+
+        stream.accessClass = accessClass;
+        stream.stride = offset - stream.last;
+        stream.last = offset;
+        stream.next = offset + len;
+        stream.lastBytes = len * SECTOR_SIZE;
+        stream.bytes += stream.lastBytes;
+        stream.timestamp = timestamp;
+        stream.used = m_used;
+        return accessClass;
+    }
+
+    startStream(operation, offset, len, timestamp);
+    return Random;
+}
+
+void StreamDetector::startStream(uint32_t operation,
+                                 uint64_t offset,
+                                 uint32_t len,
+                                 uint64_t timestamp) {
+    Stream stream = {};
+    stream.operation = operation;
+    stream.accessClass = Random;
+    stream.last = offset;
+    stream.next = offset + len;
+    stream.lastBytes = len * SECTOR_SIZE;
+    stream.bytes = stream.lastBytes;
+    stream.timestamp = timestamp;
+    stream.used = m_used;
+
+    // Distance from the previous random IO is a candidate stride, confirmed
+    // if the next IO of the stream is at the same distance
+    if (m_hasLastRandom && m_lastRandomOperation == operation) {
+        int64_t stride = offset - m_lastRandom;
+        if (stride && stride >= -STREAM_STRIDE_MAX &&
+            stride <= STREAM_STRIDE_MAX) {
+            stream.stride = stride;
+        }
+    }
+    m_lastRandom = offset;
+    m_lastRandomOperation = operation;
+    m_hasLastRandom = true;
+
+    if (m_streams.size() < m_capacity) {
+        m_streams.push_back(stream);
+        return;
+    }
+
+    auto lru = std::min_element(m_streams.begin(), m_streams.end(),
+                                [](const Stream &a, const Stream &b) {
+                                    return a.used < b.used;
+                                });
+    endStream(*lru);
+    *lru = stream;
+}
+
+void StreamDetector::endStream(Stream &stream) {
+    if (stream.accessClass == Sequential) {
+        m_sequential.add(stream.bytes);
+        m_active--;
+    } else if (stream.accessClass == Strided) {
+        m_strided.add(stream.bytes);
+        m_active--;
+    }
+
+    stream.accessClass = Random;
+}
+
+void StreamDetector::finish() {
+    for (auto &stream : m_streams) {
+        endStream(stream);
+    }
+    m_streams.clear();
+    m_hasLastRandom = false;
+}
+
+uint64_t StreamDetector::getMaxActiveStreams() const {
+    return m_maxActive;
+}
+
+const StreamLengths &StreamDetector::getSequentialStreams() const {
+    return m_sequential;
+}
+
+const StreamLengths &StreamDetector::getStridedStreams() const {
+    return m_strided;
+}
+
+const char *StreamDetector::getName(AccessClass accessClass) {
+    switch (accessClass) {
+    case Sequential:
+        return "sequential";
+    case Strided:
+        return "strided";
+    default:
+        return "random";
+    }
+}
+
+}  // namespace octf
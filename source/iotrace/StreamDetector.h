@@ -0,0 +1,139 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_STREAMDETECTOR_H
+#define SOURCE_USERSPACE_STREAMDETECTOR_H
+
+#include <stdint.h>
+#include <vector>
+#include "InterfaceTraceExtensionParsing.pb.h"
+
+namespace octf {
+
+/**
+ * @brief Lengths of ended streams, summarized into statistics
+ */
+class StreamLengths {
+public:
+    StreamLengths();
+    virtual ~StreamLengths() = default;
+
+    /**
+     * @param bytes Length of the stream
+     */
+    void add(uint64_t bytes);
+
+    void merge(const StreamLengths &other);
+
+    void fill(proto::StreamStatistics *stats) const;
+
+private:
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_max;
+    std::vector<uint64_t> m_buckets;
+};
+
+/**
+ * @brief Detects concurrent sequential and strided streams of IOs and
+ * classifies IOs by their access pattern
+ *
+ * IOs are classified in order of submission, in a single pass. The IO is
+ * sequential if it starts where an IO of a stream ended, and strided if it is
+ * at the same distance from the previous IO of the stream as that IO was from
+ * its predecessor. Other IOs are random and start new streams.
+ *
+ * A stream becomes sequential with its second IO, and strided with its third
+ * one. Up to the given number of streams is tracked, the least recently used
+ * stream and streams idle for too long end. Lengths of sequential and strided
+ * streams are counted when they end.
+ */
+class StreamDetector {
+public:
+    enum AccessClass { Sequential, Strided, Random, AccessClassCount };
+
+    /**
+     * @param capacity Maximum number of streams tracked at once
+     */
+    StreamDetector(size_t capacity);
+    virtual ~StreamDetector() = default;
+
+    /**
+     * @param operation Type of the IO, streams do not mix IO types
+     * @param offset Offset of the IO in sectors
+     * @param len Length of the IO in sectors
+     * @param timestamp Time of submission of the IO in ns
+     *
+     * @return Access class of the IO
+     */
+    AccessClass classify(uint32_t operation,
+                         uint64_t offset,
+                         uint32_t len,
+                         uint64_t timestamp);
+
+    /**
+     * @brief Ends all streams, e.g. at the end of the trace
+     */
+    void finish();
+
+    /**
+     * @return Maximum number of sequential and strided streams in progress at
+     * once
+     */
+    uint64_t getMaxActiveStreams() const;
+
+    const StreamLengths &getSequentialStreams() const;
+
+    const StreamLengths &getStridedStreams() const;
+
+    static const char *getName(AccessClass accessClass);
+
+private:
+    struct Stream {
+        uint32_t operation;
+        AccessClass accessClass;
+        /** Offset of the last IO */
+        uint64_t last;
+        /** End of the last IO */
+        uint64_t next;
+        /** Length of the last IO in bytes */
+        uint64_t lastBytes;
+        /** Distance between the last two IOs, zero if not known */
+        int64_t stride;
+        /** Length of the stream in bytes */
+        uint64_t bytes;
+        uint64_t timestamp;
+        /** Order of the last use, for eviction */
+        uint64_t used;
+    };
+
+    void endStream(Stream &stream);
+
+    /**
+     * @brief Starts a stream with the IO, ending the least recently used
+     * stream if there is no room
+     */
+    void startStream(uint32_t operation,
+                     uint64_t offset,
+                     uint32_t len,
+                     uint64_t timestamp);
+
+private:
+    const size_t m_capacity;
+    std::vector<Stream> m_streams;
+    uint64_t m_used;
+    /** Offset of the last random IO, candidate stride of a new stream */
+    uint64_t m_lastRandom;
+    uint32_t m_lastRandomOperation;
+    bool m_hasLastRandom;
+    uint64_t m_active;
+    uint64_t m_maxActive;
+    StreamLengths m_sequential;
+    StreamLengths m_strided;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_STREAMDETECTOR_H
@@ -0,0 +1,260 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TimeSeriesParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <octf/utils/Exception.h>
+
+namespace octf {
+
+/* Sector size of IO events */
+static constexpr uint64_t SECTOR_SIZE = 512;
+
+/* Upper bounds of IO size classes in bytes, the last class is unbounded */
+static const uint64_t SIZE_CLASSES[] = {
+        4ULL * 1024,
+        16ULL * 1024,
+        64ULL * 1024,
+        128ULL * 1024,
+};
+
+static constexpr size_t SIZE_CLASS_COUNT =
+        sizeof(SIZE_CLASSES) / sizeof(SIZE_CLASSES[0]);
+
+TimeSeriesParser::TimeSeriesParser(const std::string &tracePath,
+                                   uint64_t interval,
+                                   const std::string &filter)
+        : FilteredTraceEventHandler(tracePath, filter)
+        , m_interval(interval * 1000ULL * 1000 * 1000)
+        , m_deviceNames()
+        , m_ios()
+        , m_samples() {}
+
+std::unique_ptr<TimeSeriesParser> TimeSeriesParser::parse(
+        const std::vector<std::string> &tracePaths,
+        uint64_t interval,
+        const std::string &filter) {
+    if (tracePaths.empty()) {
+        throw Exception("No trace to parse");
+    }
+
+    std::vector<std::unique_ptr<TimeSeriesParser>> parsers(tracePaths.size());
+    std::atomic<size_t> next(0);
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < tracePaths.size(); i = next++) {
+            try {
+                parsers[i].reset(
+                        new TimeSeriesParser(tracePaths[i], interval, filter));
+                parsers[i]->processEvents();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                return;
+            }
+        }
+    };
+
+    size_t threadCount = std::min<size_t>(
+            tracePaths.size(),
+            std::max<size_t>(1, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    for (size_t i = 1; i < parsers.size(); i++) {
+        parsers[0]->merge(*parsers[i]);
+    }
+    return std::move(parsers[0]);
+}
+
+void TimeSeriesParser::handleFilteredEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    const auto &header = traceEvent->header();
+
+    if (traceEvent->has_devicedescription()) {
+        const auto &desc = traceEvent->devicedescription();
+        m_deviceNames[desc.id()] = desc.name();
+    } else if (traceEvent->has_io()) {
+        const auto &event = traceEvent->io();
+        if (!event.id()) {
+            return;
+        }
+
+        PendingIo io = {};
+        switch (event.operation()) {
+        case proto::trace::IoType::Read:
+            io.operation = Read;
+            break;
+        case proto::trace::IoType::Write:
+            io.operation = Write;
+            break;
+        case proto::trace::IoType::Discard:
+            io.operation = Discard;
+            break;
+        default:
+            return;
+        }
+
+        io.timestamp = header.timestamp();
+        io.deviceId = event.deviceid();
+        io.len = event.len();
+        m_ios[event.id()] = io;
+    } else if (traceEvent->has_iocompletion()) {
+        auto iter = m_ios.find(traceEvent->iocompletion().refsid());
+        if (iter == m_ios.end()) {
+            return;
+        }
+
+        handleCompletion(header.timestamp(), iter->second);
+        m_ios.erase(iter);
+    }
+}
+
+void TimeSeriesParser::handleCompletion(uint64_t timestamp,
+                                        const PendingIo &io) {
+    if (timestamp < io.timestamp) {
+        return;
+    }
+
+    auto &sample = m_samples[SampleKey(timestamp / m_interval, io.deviceId)];
+    uint64_t bytes = io.len * SECTOR_SIZE;
+    uint64_t latency = timestamp - io.timestamp;
+
+    sample.ios[io.operation]++;
+    sample.bytes[io.operation] += bytes;
+
+    size_t sizeClass = 0;
+    while (sizeClass < SIZE_CLASS_COUNT && bytes > SIZE_CLASSES[sizeClass]) {
+        sizeClass++;
+    }
+    sample.sizes[sizeClass]++;
+
+    sample.latencySum += latency;
+    sample.latency.add(latency);
+}
+
+void TimeSeriesParser::merge(TimeSeriesParser &other) {
+    for (const auto &entry : other.m_deviceNames) {
+        m_deviceNames[entry.first] = entry.second;
+    }
+
+    for (auto &entry : other.m_samples) {
+        auto &sample = m_samples[entry.first];
+        const auto &from = entry.second;
+
+        for (int op = Read; op < OperationCount; op++) {
+            sample.ios[op] += from.ios[op];
+            sample.bytes[op] += from.bytes[op];
+        }
+        for (size_t i = 0; i <= SIZE_CLASS_COUNT; i++) {
+            sample.sizes[i] += from.sizes[i];
+        }
+        sample.latencySum += from.latencySum;
+        sample.latency.merge(from.latency);
+    }
+    other.m_samples.clear();
+}
+
+void TimeSeriesParser::fillSample(const SampleKey &key,
+                                  Sample &sample,
+                                  proto::TimeSeriesSample *result) {
+    double seconds = m_interval / 1e9;
+    uint64_t count = sample.ios[Read] + sample.ios[Write] + sample.ios[Discard];
+
+    result->set_start(key.first * m_interval);
+    result->set_deviceid(key.second);
+    auto name = m_deviceNames.find(key.second);
+    if (name != m_deviceNames.end()) {
+        result->set_devicename(name->second);
+    }
+
+    result->set_readcount(sample.ios[Read]);
+    result->set_writecount(sample.ios[Write]);
+    result->set_discardcount(sample.ios[Discard]);
+    result->set_readbytes(sample.bytes[Read]);
+    result->set_writebytes(sample.bytes[Write]);
+    result->set_iops(count / seconds);
+    result->set_bandwidth((sample.bytes[Read] + sample.bytes[Write]) /
+                          seconds);
+
+    result->set_size4k(sample.sizes[0]);
+    result->set_size16k(sample.sizes[1]);
+    result->set_size64k(sample.sizes[2]);
+    result->set_size128k(sample.sizes[3]);
+    result->set_sizelarger(sample.sizes[4]);
+
+    // Time IOs spent in flight divided by the interval
+    result->set_queuedepth(sample.latencySum / (double) m_interval);
+    sample.latency.fill(result->mutable_latency());
+}
+
+void TimeSeriesParser::getSummary(proto::TimeSeriesSummary *summary) {
+    summary->Clear();
+    summary->set_interval(m_interval);
+    summary->set_samplecount(m_samples.size());
+
+    for (auto &entry : m_samples) {
+        fillSample(entry.first, entry.second, summary->add_samples());
+    }
+}
+
+void TimeSeriesParser::writeCsv(const std::string &path,
+                                proto::TimeSeriesSummary *summary) {
+    summary->Clear();
+    summary->set_interval(m_interval);
+    summary->set_samplecount(m_samples.size());
+
+    std::ofstream file(path, std::ios::trunc);
+    file << "start,device_id,device_name,read_count,write_count,"
+            "discard_count,read_bytes,write_bytes,iops,bandwidth,size_4k,"
+            "size_16k,size_64k,size_128k,size_larger,queue_depth,"
+            "latency_average,latency_min,latency_median,latency_p99,"
+            "latency_max\n";
+
+    for (auto &entry : m_samples) {
+        proto::TimeSeriesSample sample;
+        fillSample(entry.first, entry.second, &sample);
+
+        const auto &latency = sample.latency();
+        file << sample.start() << "," << sample.deviceid() << ","
+             << sample.devicename() << "," << sample.readcount() << ","
+             << sample.writecount() << "," << sample.discardcount() << ","
+             << sample.readbytes() << "," << sample.writebytes() << ","
+             << sample.iops() << "," << sample.bandwidth() << ","
+             << sample.size4k() << "," << sample.size16k() << ","
+             << sample.size64k() << "," << sample.size128k() << ","
+             << sample.sizelarger() << "," << sample.queuedepth() << ","
+             << latency.average() << "," << latency.min() << ","
+             << latency.median() << "," << latency.p99() << ","
+             << latency.max() << "\n";
+    }
+
+    file.close();
+    if (file.fail()) {
+        throw Exception("Cannot write CSV file " + path);
+    }
+}
+
+}  // namespace octf
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TIMESERIESPARSER_H
+#define SOURCE_USERSPACE_TIMESERIESPARSER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <octf/proto/trace.pb.h>
+#include "FilteredTraceEventHandler.h"
+#include "InterfaceTraceExtensionParsing.pb.h"
+#include "LatencyHistogram.h"
+
+namespace octf {
+
+/**
+ * @brief Buckets IOs of devices into intervals of time
+ *
+ * IOs are counted in the interval of their completion. Intervals are aligned
+ * to the start of the tracing session, which segments of the session share,
+ * so results of segments parsed in parallel are merged by interval. IOs
+ * submitted in one segment and completed in the next one are not counted.
+ */
+class TimeSeriesParser : public FilteredTraceEventHandler {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param interval Length of intervals in seconds
+     * @param filter Filter expression of IOs, see IoFilter
+     */
+    TimeSeriesParser(const std::string &tracePath,
+                     uint64_t interval,
+                     const std::string &filter);
+    virtual ~TimeSeriesParser() = default;
+
+    /**
+     * @brief Parses traces, each in its own thread, and merges their results
+     *
+     * @param filter Filter expression of IOs, see IoFilter
+     *
+     * @return Parser holding results of all traces
+     */
+    static std::unique_ptr<TimeSeriesParser> parse(
+            const std::vector<std::string> &tracePaths,
+            uint64_t interval,
+            const std::string &filter);
+
+    void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) override;
+
+    /**
+     * @brief Moves results of the other parser into this one
+     */
+    void merge(TimeSeriesParser &other);
+
+    /**
+     * @brief Fills samples of intervals, call after processEvents()
+     */
+    void getSummary(proto::TimeSeriesSummary *summary);
+
+    /**
+     * @brief Writes samples of intervals as CSV, call after processEvents()
+     *
+     * @throws Exception Cannot write the file
+     */
+    void writeCsv(const std::string &path, proto::TimeSeriesSummary *summary);
+
+private:
+    enum Operation { Read, Write, Discard, OperationCount };
+
+    /** IO queued and not completed yet */
+    struct PendingIo {
+        uint64_t timestamp;
+        uint64_t deviceId;
+        uint32_t len;
+        Operation operation;
+    };
+
+    /** IOs of a device completed in an interval */
+    struct Sample {
+        Sample()
+                : ios()
+                , bytes()
+                , sizes()
+                , latencySum(0)
+                , latency() {}
+
+        uint64_t ios[OperationCount];
+        uint64_t bytes[OperationCount];
+        /** IOs by size class */
+        uint64_t sizes[5];
+        uint64_t latencySum;
+        LatencyHistogram latency;
+    };
+
+    /** Index of the interval and ID of the device */
+    typedef std::pair<uint64_t, uint64_t> SampleKey;
+
+    void handleCompletion(uint64_t timestamp, const PendingIo &io);
+
+    void fillSample(const SampleKey &key,
+                    Sample &sample,
+                    proto::TimeSeriesSample *result);
+
+private:
+    /** Length of intervals in ns */
+    const uint64_t m_interval;
+    std::map<uint64_t, std::string> m_deviceNames;
+    /** IOs in flight keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_ios;
+    std::map<SampleKey, Sample> m_samples;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TIMESERIESPARSER_H
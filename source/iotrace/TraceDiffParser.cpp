@@ -0,0 +1,404 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TraceDiffParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <octf/utils/Exception.h>
+
+namespace octf {
+
+/* Sector size of IO events */
+static constexpr uint64_t SECTOR_SIZE = 512;
+
+/* Upper bounds of IO size classes in bytes, the last class is unbounded */
+static const uint64_t SIZE_CLASSES[] = {
+        4ULL * 1024,
+        16ULL * 1024,
+        64ULL * 1024,
+        128ULL * 1024,
+};
+
+static constexpr size_t SIZE_CLASS_COUNT =
+        sizeof(SIZE_CLASSES) / sizeof(SIZE_CLASSES[0]);
+
+static const char *OPERATION_NAMES[] = {"read", "write", "discard"};
+
+/* Operation or size class of getIoClass() standing for all of them */
+static constexpr int ALL = -1;
+
+/* Zones the device is divided into, for hotness of LBAs */
+static constexpr uint64_t ZONE_COUNT = 1024;
+
+/* Size of zones of devices of unknown size (1 GiB in sectors) */
+static constexpr uint64_t ZONE_SIZE_DEFAULT = 2 * 1024 * 1024;
+
+/* Zones counted as hot, the hottest 10% */
+static constexpr uint64_t HOT_ZONE_COUNT = ZONE_COUNT / 10;
+
+/* Latency shifts whose p-value is below this are significant */
+static constexpr double SIGNIFICANCE_LEVEL = 0.05;
+
+static double getSeconds(uint64_t first, uint64_t last) {
+    return last > first ? (last - first) / 1e9 : 0;
+}
+
+static double getRate(double value, double seconds) {
+    return seconds > 0 ? value / seconds : 0;
+}
+
+static void fillMetric(double baseline,
+                       double compared,
+                       proto::MetricDiff *result) {
+    result->set_baseline(baseline);
+    result->set_compared(compared);
+    if (baseline) {
+        result->set_change(compared / baseline - 1);
+    }
+}
+
+/**
+ * @brief Probability of the Kolmogorov-Smirnov distance of two samples of
+ * the same distribution, by the asymptotic Kolmogorov distribution
+ */
+static double getPValue(double distance, uint64_t countA, uint64_t countB) {
+    if (!countA || !countB) {
+        return 1;
+    }
+
+    double n = std::sqrt((double) countA * countB / (countA + countB));
+    double lambda = (n + 0.12 + 0.11 / n) * distance;
+    if (lambda < 0.3) {
+        // The series converges slowly, and its sum is one here anyway
+        return 1;
+    }
+
+    double sum = 0, sign = 1;
+    for (int k = 1; k <= 100; k++) {
+        double term = sign * 2 * std::exp(-2 * k * k * lambda * lambda);
+        sum += term;
+        if (std::fabs(term) <= 1e-10 * std::fabs(sum)) {
+            break;
+        }
+        sign = -sign;
+    }
+    return std::min(std::max(sum, 0.0), 1.0);
+}
+
+static void fillLatency(const LatencyHistogram &baseline,
+                        const LatencyHistogram &compared,
+                        proto::LatencyDiff *result) {
+    baseline.fill(result->mutable_baseline());
+    compared.fill(result->mutable_compared());
+
+    auto getChange = [](uint64_t baseline, uint64_t compared) {
+        return baseline ? (double) compared / baseline - 1 : 0;
+    };
+    result->set_medianchange(getChange(baseline.getPercentile(500),
+                                       compared.getPercentile(500)));
+    result->set_p99change(getChange(baseline.getPercentile(990),
+                                    compared.getPercentile(990)));
+
+    double distance = LatencyHistogram::getDistance(baseline, compared);
+    double pValue =
+            getPValue(distance, baseline.getCount(), compared.getCount());
+    result->set_distance(distance);
+    result->set_pvalue(pValue);
+    result->set_significant(baseline.getCount() && compared.getCount() &&
+                            pValue < SIGNIFICANCE_LEVEL);
+}
+
+static double getHotShare(const std::vector<uint64_t> &zones) {
+    std::vector<uint64_t> sorted(zones);
+    std::partial_sort(sorted.begin(), sorted.begin() + HOT_ZONE_COUNT,
+                      sorted.end(), std::greater<uint64_t>());
+
+    uint64_t total = 0, hot = 0;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        total += sorted[i];
+        if (i < HOT_ZONE_COUNT) {
+            hot += sorted[i];
+        }
+    }
+    return total ? (double) hot / total : 0;
+}
+
+static double getHotnessDistance(const std::vector<uint64_t> &a,
+                                 const std::vector<uint64_t> &b) {
+    uint64_t totalA = 0, totalB = 0;
+    for (size_t i = 0; i < ZONE_COUNT; i++) {
+        totalA += a[i];
+        totalB += b[i];
+    }
+    if (!totalA || !totalB) {
+        return 0;
+    }
+
+    double distance = 0;
+    for (size_t i = 0; i < ZONE_COUNT; i++) {
+        distance += std::fabs((double) a[i] / totalA - (double) b[i] / totalB);
+    }
+    return distance / 2;
+}
+
+TraceDiffParser::Device::Device()
+        : name()
+        , size(0)
+        , firstTimestamp(0)
+        , lastTimestamp(0)
+        , bytes(0)
+        , zones()
+        , zoneSize(0)
+        , classes(OperationCount,
+                  std::vector<IoClass>(SIZE_CLASS_COUNT + 1)) {}
+
+TraceDiffParser::TraceDiffParser(const std::string &tracePath,
+                                 const std::string &filter)
+        : FilteredTraceEventHandler(tracePath, filter)
+        , m_devices()
+        , m_ios() {}
+
+void TraceDiffParser::diff(const std::string &baselinePath,
+                           const std::string &comparedPath,
+                           const std::string &filter,
+                           proto::TraceDiffSummary *summary) {
+    TraceDiffParser baseline(baselinePath, filter);
+    TraceDiffParser compared(comparedPath, filter);
+    std::exception_ptr comparedError;
+
+    std::thread thread([&compared, &comparedError]() {
+        try {
+            compared.processEvents();
+        } catch (...) {
+            comparedError = std::current_exception();
+        }
+    });
+    try {
+        baseline.processEvents();
+    } catch (...) {
+        thread.join();
+        throw;
+    }
+    thread.join();
+    if (comparedError) {
+        std::rethrow_exception(comparedError);
+    }
+
+    summary->Clear();
+    summary->set_baseline(baselinePath);
+    summary->set_compared(comparedPath);
+    summary->set_significancelevel(SIGNIFICANCE_LEVEL);
+
+    auto baselineDevices = baseline.getDevices();
+    auto comparedDevices = compared.getDevices();
+    std::map<std::string, std::pair<const Device *, const Device *>> devices;
+    for (const auto &entry : baselineDevices) {
+        devices[entry.first].first = entry.second;
+    }
+    for (const auto &entry : comparedDevices) {
+        devices[entry.first].second = entry.second;
+    }
+
+    for (const auto &entry : devices) {
+        auto result = summary->add_devices();
+        result->set_name(entry.first);
+        fillDevice(entry.second.first, entry.second.second, result);
+    }
+}
+
+void TraceDiffParser::handleFilteredEvent(
+        std::shared_ptr<proto::trace::Event> traceEvent) {
+    const auto &header = traceEvent->header();
+
+    if (traceEvent->has_devicedescription()) {
+        const auto &desc = traceEvent->devicedescription();
+        auto &device = m_devices[desc.id()];
+        device.name = desc.name();
+        device.size = desc.size();
+    } else if (traceEvent->has_io()) {
+        handleIo(header.timestamp(), traceEvent->io());
+    } else if (traceEvent->has_iocompletion()) {
+        auto iter = m_ios.find(traceEvent->iocompletion().refsid());
+        if (iter == m_ios.end()) {
+            return;
+        }
+
+        handleCompletion(header.timestamp(), iter->second);
+        m_ios.erase(iter);
+    }
+}
+
+void TraceDiffParser::handleIo(uint64_t timestamp,
+                               const proto::trace::EventIo &io) {
+    PendingIo pending = {};
+    switch (io.operation()) {
+    case proto::trace::IoType::Read:
+        pending.operation = Read;
+        break;
+    case proto::trace::IoType::Write:
+        pending.operation = Write;
+        break;
+    case proto::trace::IoType::Discard:
+        pending.operation = Discard;
+        break;
+    default:
+        return;
+    }
+    if (!io.id()) {
+        return;
+    }
+
+    auto &device = m_devices[io.deviceid()];
+    if (device.zones.empty()) {
+        device.zoneSize = device.size ? (device.size + ZONE_COUNT - 1) /
+                                                ZONE_COUNT
+                                      : ZONE_SIZE_DEFAULT;
+        device.zones.resize(ZONE_COUNT);
+        device.firstTimestamp = timestamp;
+    }
+    device.zones[std::min(io.lba() / device.zoneSize, ZONE_COUNT - 1)]++;
+
+    pending.timestamp = timestamp;
+    pending.deviceId = io.deviceid();
+    pending.len = io.len();
+    m_ios[io.id()] = pending;
+}
+
+void TraceDiffParser::handleCompletion(uint64_t timestamp,
+                                       const PendingIo &io) {
+    if (timestamp < io.timestamp) {
+        return;
+    }
+
+    auto &device = m_devices[io.deviceId];
+    uint64_t bytes = io.len * SECTOR_SIZE;
+    uint64_t latency = timestamp - io.timestamp;
+
+    size_t sizeClass = 0;
+    while (sizeClass < SIZE_CLASS_COUNT && bytes > SIZE_CLASSES[sizeClass]) {
+        sizeClass++;
+    }
+
+    auto &ioClass = device.classes[io.operation][sizeClass];
+    ioClass.latencySum += latency;
+    ioClass.latency.add(latency);
+
+    device.bytes += bytes;
+    device.lastTimestamp = std::max(device.lastTimestamp, timestamp);
+}
+
+std::map<std::string, const TraceDiffParser::Device *>
+TraceDiffParser::getDevices() const {
+    std::map<std::string, const Device *> devices;
+
+    for (const auto &entry : m_devices) {
+        const auto &device = entry.second;
+        if (device.lastTimestamp) {
+            auto name = device.name.empty() ? std::to_string(entry.first)
+                                            : device.name;
+            devices[name] = &device;
+        }
+    }
+    return devices;
+}
+
+TraceDiffParser::IoClass TraceDiffParser::getIoClass(const Device *device,
+                                                     int operation,
+                                                     int sizeClass) {
+    IoClass result;
+    if (!device) {
+        return result;
+    }
+
+    for (int op = Read; op < OperationCount; op++) {
+        if (operation != ALL && operation != op) {
+            continue;
+        }
+        for (int size = 0; size <= (int) SIZE_CLASS_COUNT; size++) {
+            if (sizeClass != ALL && sizeClass != size) {
+                continue;
+            }
+            const auto &from = device->classes[op][size];
+            result.latencySum += from.latencySum;
+            result.latency.merge(from.latency);
+        }
+    }
+    return result;
+}
+
+void TraceDiffParser::fillIoClass(const IoClass &baseline,
+                                  double baselineSeconds,
+                                  const IoClass &compared,
+                                  double comparedSeconds,
+                                  proto::IoClassDiff *result) {
+    fillMetric(getRate(baseline.latency.getCount(), baselineSeconds),
+               getRate(compared.latency.getCount(), comparedSeconds),
+               result->mutable_iops());
+    fillMetric(getRate(baseline.latencySum / 1e9, baselineSeconds),
+               getRate(compared.latencySum / 1e9, comparedSeconds),
+               result->mutable_queuedepth());
+    fillLatency(baseline.latency, compared.latency, result->mutable_latency());
+}
+
+void TraceDiffParser::fillDevice(const Device *baseline,
+                                 const Device *compared,
+                                 proto::DeviceDiff *result) {
+    double baselineSeconds =
+            baseline ? getSeconds(baseline->firstTimestamp,
+                                  baseline->lastTimestamp)
+                     : 0;
+    double comparedSeconds =
+            compared ? getSeconds(compared->firstTimestamp,
+                                  compared->lastTimestamp)
+                     : 0;
+
+    auto baselineAll = getIoClass(baseline, ALL, ALL);
+    auto comparedAll = getIoClass(compared, ALL, ALL);
+    proto::IoClassDiff all;
+    fillIoClass(baselineAll, baselineSeconds, comparedAll, comparedSeconds,
+                &all);
+    result->mutable_iops()->CopyFrom(all.iops());
+    result->mutable_queuedepth()->CopyFrom(all.queuedepth());
+    result->mutable_latency()->CopyFrom(all.latency());
+
+    fillMetric(getRate(baseline ? baseline->bytes : 0, baselineSeconds),
+               getRate(compared ? compared->bytes : 0, comparedSeconds),
+               result->mutable_bandwidth());
+
+    fillMetric(baseline ? getHotShare(baseline->zones) : 0,
+               compared ? getHotShare(compared->zones) : 0,
+               result->mutable_hotshare());
+    if (baseline && compared) {
+        result->set_hotnessdistance(
+                getHotnessDistance(baseline->zones, compared->zones));
+    }
+
+    for (int op = Read; op < OperationCount; op++) {
+        for (int size = ALL; size <= (int) SIZE_CLASS_COUNT; size++) {
+            auto baselineClass = getIoClass(baseline, op, size);
+            auto comparedClass = getIoClass(compared, op, size);
+            if (!baselineClass.latency.getCount() &&
+                !comparedClass.latency.getCount()) {
+                continue;
+            }
+
+            auto ioClass = result->add_classes();
+            ioClass->set_operation(OPERATION_NAMES[op]);
+            if (size == ALL) {
+                ioClass->set_allsizes(true);
+            } else if (size < (int) SIZE_CLASS_COUNT) {
+                ioClass->set_maxsize(SIZE_CLASSES[size]);
+            }
+            fillIoClass(baselineClass, baselineSeconds, comparedClass,
+                        comparedSeconds, ioClass);
+        }
+    }
+}
+
+}  // namespace octf
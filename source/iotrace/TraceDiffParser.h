@@ -0,0 +1,129 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TRACEDIFFPARSER_H
+#define SOURCE_USERSPACE_TRACEDIFFPARSER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <octf/proto/trace.pb.h>
+#include "FilteredTraceEventHandler.h"
+#include "InterfaceTraceExtensionParsing.pb.h"
+#include "LatencyHistogram.h"
+
+namespace octf {
+
+/**
+ * @brief Compares IO statistics of two traces, e.g. captured before and after
+ * a change of the kernel, firmware or configuration
+ *
+ * Each trace is summarized per device, operation and IO size class into
+ * histograms and counters, so memory does not grow with length of the traces.
+ * Devices of the traces are matched by name.
+ *
+ * Shifts of latency distributions are tested by the two-sample
+ * Kolmogorov-Smirnov test on the histograms. Latencies of IOs are not
+ * independent samples, so on long traces even small shifts are significant;
+ * the relative changes of percentiles show whether they matter.
+ */
+class TraceDiffParser : public FilteredTraceEventHandler {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     * @param filter Filter expression of IOs, see IoFilter
+     */
+    TraceDiffParser(const std::string &tracePath, const std::string &filter);
+    virtual ~TraceDiffParser() = default;
+
+    /**
+     * @brief Parses both traces at once, each in its own thread, and
+     * compares them
+     *
+     * @param filter Filter expression of IOs of both traces, see IoFilter
+     */
+    static void diff(const std::string &baselinePath,
+                     const std::string &comparedPath,
+                     const std::string &filter,
+                     proto::TraceDiffSummary *summary);
+
+    void handleFilteredEvent(
+            std::shared_ptr<proto::trace::Event> traceEvent) override;
+
+private:
+    enum Operation { Read, Write, Discard, OperationCount };
+
+    /** IO queued and not completed yet */
+    struct PendingIo {
+        uint64_t timestamp;
+        uint64_t deviceId;
+        uint32_t len;
+        Operation operation;
+    };
+
+    /** Completed IOs of an operation and a size class */
+    struct IoClass {
+        IoClass()
+                : latencySum(0)
+                , latency() {}
+
+        uint64_t latencySum;
+        LatencyHistogram latency;
+    };
+
+    struct Device {
+        Device();
+
+        std::string name;
+        /** Size in sectors */
+        uint64_t size;
+        /** First submission and last completion */
+        uint64_t firstTimestamp;
+        uint64_t lastTimestamp;
+        uint64_t bytes;
+        /** Accesses to zones of the device */
+        std::vector<uint64_t> zones;
+        /** Size of zones in sectors */
+        uint64_t zoneSize;
+        /** Indexed by operation and size class */
+        std::vector<std::vector<IoClass>> classes;
+    };
+
+    void handleIo(uint64_t timestamp, const proto::trace::EventIo &io);
+
+    void handleCompletion(uint64_t timestamp, const PendingIo &io);
+
+    /** Devices with completed IOs by name */
+    std::map<std::string, const Device *> getDevices() const;
+
+    /**
+     * @brief Merges IO classes of the device, of all operations or sizes
+     * when given ALL, of no IOs when the device is null
+     */
+    static IoClass getIoClass(const Device *device,
+                              int operation,
+                              int sizeClass);
+
+    static void fillIoClass(const IoClass &baseline,
+                            double baselineSeconds,
+                            const IoClass &compared,
+                            double comparedSeconds,
+                            proto::IoClassDiff *result);
+
+    static void fillDevice(const Device *baseline,
+                           const Device *compared,
+                           proto::DeviceDiff *result);
+
+private:
+    std::map<uint64_t, Device> m_devices;
+    /** IOs in flight keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_ios;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TRACEDIFFPARSER_H
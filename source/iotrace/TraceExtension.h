@@ -0,0 +1,35 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TRACEEXTENSION_H
+#define SOURCE_USERSPACE_TRACEEXTENSION_H
+
+#include <stdint.h>
+
+namespace octf {
+
+/** Name of the trace extension file stored in the trace directory */
+constexpr const char *TRACE_EXTENSION_FILE_NAME = "iotrace.ext";
+
+/** Magic number of the trace extension file ("IOTX") */
+constexpr uint32_t TRACE_EXTENSION_MAGIC = 0x58544f49;
+
+/** Version of the trace extension file format */
+constexpr uint32_t TRACE_EXTENSION_VERSION = 1;
+
+/**
+ * @brief Header of the trace extension file
+ *
+ * The header is followed by extension events (see iotrace_event_ext.h). Each
+ * of them starts with iotrace_event_hdr which holds the event size.
+ */
+struct TraceExtensionFileHeader {
+    uint32_t magic;
+    uint32_t version;
+} __attribute__((packed, aligned(8)));
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TRACEEXTENSION_H
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TraceExtensionReader.h"
+
+#include <cstring>
+#include <octf/utils/Exception.h>
+#include <octf/utils/FrameworkConfiguration.h>
+#include "TraceExtension.h"
+
+namespace octf {
+
+/* Upper limit of the event size, protects against corrupted files */
+static constexpr uint32_t EVENT_MAX_SIZE = 64 * 1024;
+
+TraceExtensionReader::TraceExtensionReader(const std::string &tracePath)
+        : m_path(getTraceDirectory(tracePath) + "/" +
+                 TRACE_EXTENSION_FILE_NAME)
+        , m_file()
+        , m_event() {
+    m_file.open(m_path, std::ios::binary);
+    if (!m_file.is_open()) {
+        // No extension events in the trace
+        return;
+    }
+
+    TraceExtensionFileHeader hdr = {};
+    if (!m_file.read(reinterpret_cast<char *>(&hdr), sizeof(hdr)) ||
+        hdr.magic != TRACE_EXTENSION_MAGIC) {
+        throw Exception("Invalid trace extension file " + m_path);
+    }
+    if (hdr.version != TRACE_EXTENSION_VERSION) {
+        throw Exception("Unsupported version of trace extension file " +
+                        m_path);
+    }
+}
+
+bool TraceExtensionReader::isPresent() const {
+    return m_file.is_open();
+}
+
+const struct iotrace_event_hdr *TraceExtensionReader::next() {
+    struct iotrace_event_hdr hdr;
+
+    if (!m_file.is_open() ||
+        !m_file.read(reinterpret_cast<char *>(&hdr), sizeof(hdr))) {
+        return nullptr;
+    }
+
+    if (hdr.size < sizeof(hdr) || hdr.size > EVENT_MAX_SIZE) {
+        throw Exception("Corrupted trace extension file " + m_path);
+    }
+
+    m_event.resize(hdr.size);
+    std::memcpy(m_event.data(), &hdr, sizeof(hdr));
+    if (!m_file.read(m_event.data() + sizeof(hdr), hdr.size - sizeof(hdr))) {
+        throw Exception("Truncated trace extension file " + m_path);
+    }
+
+    return reinterpret_cast<const struct iotrace_event_hdr *>(m_event.data());
+}
+
+std::string TraceExtensionReader::getTraceDirectory(
+        const std::string &tracePath) {
+    if (!tracePath.empty() && tracePath[0] == '/') {
+        return tracePath;
+    }
+
+    return getFrameworkConfiguration().getTraceRepositoryPath() + "/" +
+           tracePath;
+}
+
+}  // namespace octf
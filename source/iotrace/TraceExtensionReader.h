@@ -0,0 +1,61 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TRACEEXTENSIONREADER_H
+#define SOURCE_USERSPACE_TRACEEXTENSIONREADER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <octf/trace/iotrace_event.h>
+#include <octf/utils/NonCopyable.h>
+
+namespace octf {
+
+/**
+ * @brief Reader of the trace extension file
+ *
+ * Reads extension events in the order they were written, which is not the
+ * order of sequence IDs.
+ */
+class TraceExtensionReader : public NonCopyable {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     *
+     * @throws Exception The extension file is not valid
+     */
+    TraceExtensionReader(const std::string &tracePath);
+    virtual ~TraceExtensionReader() = default;
+
+    /**
+     * @retval true The trace has the extension file
+     * @retval false The trace has no extension events
+     */
+    bool isPresent() const;
+
+    /**
+     * @brief Reads the next extension event
+     *
+     * @return Event valid until the next call, nullptr at the end of file
+     *
+     * @throws Exception The extension file is corrupted
+     */
+    const struct iotrace_event_hdr *next();
+
+    /**
+     * @return Absolute path of the trace directory
+     */
+    static std::string getTraceDirectory(const std::string &tracePath);
+
+private:
+    std::string m_path;
+    std::ifstream m_file;
+    std::vector<char> m_event;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TRACEEXTENSIONREADER_H
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TraceExtensionWriter.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <cstdio>
+#include <octf/utils/Exception.h>
+#include <octf/utils/FrameworkConfiguration.h>
+#include <octf/utils/Log.h>
+#include "TraceExtension.h"
+
+namespace octf {
+
+TraceExtensionWriter::TraceExtensionWriter(uint64_t memoryLimit)
+        : m_tmpPath()
+        , m_writer(memoryLimit)
+        , m_opened(false)
+        , m_eventCount(0)
+        , m_stats()
+        , m_failed(false) {}
+
+TraceExtensionWriter::~TraceExtensionWriter() {
+    m_writer.close();
+
+    if (!m_tmpPath.empty()) {
+        // Not committed, remove the temporary file
+        ::unlink(m_tmpPath.c_str());
+    }
+}
+
+void TraceExtensionWriter::open() {
+    std::string path = getFrameworkConfiguration().getTraceRepositoryPath() +
+                       "/.iotrace.ext.XXXXXX";
+
+    int fd = ::mkstemp(&path[0]);
+    if (fd < 0) {
+        log::cerr << "Cannot create trace extension file" << std::endl;
+        return;
+    }
+
+    m_tmpPath = path;
+
+    try {
+        m_writer.open(fd);
+    } catch (Exception &e) {
+        log::cerr << "Cannot open trace extension file, " << e.what()
+                  << std::endl;
+        ::close(fd);
+        return;
+    }
+    m_opened = true;
+
+    TraceExtensionFileHeader hdr = {};
+    hdr.magic = TRACE_EXTENSION_MAGIC;
+    hdr.version = TRACE_EXTENSION_VERSION;
+    if (!m_writer.write(&hdr, sizeof(hdr))) {
+        m_failed = true;
+    }
+}
+
+void TraceExtensionWriter::write(const void *event, uint32_t size) {
+    if (m_failed) {
+        return;
+    }
+
+    if (!m_opened) {
+        open();
+        if (!m_opened) {
+            m_failed = true;
+            return;
+        }
+    }
+
+    if (!m_writer.write(event, size)) {
+        log::cerr << "Cannot write trace extension file" << std::endl;
+        m_writer.close();
+        m_failed = true;
+        return;
+    }
+
+    m_eventCount++;
+}
+
+void TraceExtensionWriter::commit(const std::string &traceDir) {
+    if (m_failed) {
+        throw Exception("Trace extension file incomplete");
+    }
+
+    m_stats = AsyncWriterStats();
+    if (m_tmpPath.empty()) {
+        // No extension events
+        return;
+    }
+
+    bool finished = m_writer.finish();
+    m_stats = m_writer.getStats();
+    m_writer.close();
+    m_opened = false;
+    if (!finished) {
+        m_failed = true;
+        throw Exception("Trace extension file incomplete");
+    }
+
+    std::string path = traceDir + "/" + TRACE_EXTENSION_FILE_NAME;
+    if (::rename(m_tmpPath.c_str(), path.c_str())) {
+        throw Exception("Cannot move trace extension file to " + path);
+    }
+
+    m_tmpPath.clear();
+}
+
+uint64_t TraceExtensionWriter::getEventCount() const {
+    return m_eventCount;
+}
+
+const AsyncWriterStats &TraceExtensionWriter::getWriterStats() const {
+    return m_stats;
+}
+
+}  // namespace octf
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TRACEEXTENSIONWRITER_H
+#define SOURCE_USERSPACE_TRACEEXTENSIONWRITER_H
+
+#include <stdint.h>
+#include <string>
+#include <octf/utils/NonCopyable.h>
+#include "AsyncDirectFileWriter.h"
+
+namespace octf {
+
+/**
+ * @brief Writer of the trace extension file
+ *
+ * Extension events are written to a temporary file in the trace repository,
+ * because the trace directory is known only when tracing is finished. Then
+ * the file is moved into the trace directory by commit(). The file is created
+ * on the first written event, so traces without extension events have no
+ * extension file. Writes are asynchronous and bypass the page cache, see
+ * AsyncDirectFileWriter.
+ *
+ * @note This class is not thread safe, it is used by the perf buffer polling
+ * thread only.
+ */
+class TraceExtensionWriter : public NonCopyable {
+public:
+    /**
+     * @param memoryLimit Maximum memory (in bytes) used for write buffers
+     */
+    TraceExtensionWriter(uint64_t memoryLimit);
+    virtual ~TraceExtensionWriter();
+
+    /**
+     * @brief Writes extension event
+     *
+     * @param event Extension event starting with iotrace_event_hdr
+     * @param size Size of event
+     */
+    void write(const void *event, uint32_t size);
+
+    /**
+     * @brief Flushes pending events and moves the file into trace directory
+     *
+     * @param traceDir Absolute path of the trace directory
+     */
+    void commit(const std::string &traceDir);
+
+    /**
+     * @return Number of extension events written
+     */
+    uint64_t getEventCount() const;
+
+    /**
+     * @return Write statistics of the last committed extension file, zeros
+     * if it had no events
+     */
+    const AsyncWriterStats &getWriterStats() const;
+
+private:
+    void open();
+
+private:
+    std::string m_tmpPath;
+    AsyncDirectFileWriter m_writer;
+    bool m_opened;
+    uint64_t m_eventCount;
+    AsyncWriterStats m_stats;
+    bool m_failed;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TRACEEXTENSIONWRITER_H
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TraceFilePaths.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <octf/utils/Exception.h>
+#include "TraceExtensionReader.h"
+#include "iotrace_event_ext.h"
+
+namespace octf {
+
+TraceFilePaths::TraceFilePaths(const std::string &tracePath)
+        : m_paths()
+        , m_filePaths()
+        , m_nextFilePath(0)
+        , m_files() {
+    TraceExtensionReader reader(tracePath);
+    if (!reader.isPresent()) {
+        throw Exception("Trace has no file paths, trace with --capture paths");
+    }
+
+    while (auto hdr = reader.next()) {
+        if (hdr->type == iotrace_event_type_fs_path) {
+            auto ev = reinterpret_cast<const struct iotrace_event_fs_path *>(
+                    hdr);
+            if (hdr->size < offsetof(struct iotrace_event_fs_path, path) ||
+                ev->len >= sizeof(ev->path) ||
+                hdr->size < offsetof(struct iotrace_event_fs_path, path) +
+                                    ev->len) {
+                throw Exception("Invalid path event in trace extension");
+            }
+
+            // IDs are dense, the dictionary is a vector indexed by them
+            if (ev->path_id >= m_paths.size()) {
+                m_paths.resize(ev->path_id + 1);
+            }
+            m_paths[ev->path_id].assign(ev->path, ev->len);
+        } else if (hdr->type == iotrace_event_type_fs_file_path) {
+            if (hdr->size != sizeof(struct iotrace_event_fs_file_path)) {
+                throw Exception("Invalid file path event in trace extension");
+            }
+
+            auto ev = reinterpret_cast<
+                    const struct iotrace_event_fs_file_path *>(hdr);
+            FilePath file;
+            file.sid = hdr->sid;
+            file.partitionId = ev->partition_id;
+            file.fileId = ev->file_id.id;
+            file.pathId = ev->path_id;
+            m_filePaths.push_back(file);
+        }
+    }
+
+    // Extension events are written in order of CPUs, not sequence IDs
+    std::sort(m_filePaths.begin(), m_filePaths.end(),
+              [](const FilePath &a, const FilePath &b) {
+                  return a.sid < b.sid;
+              });
+}
+
+void TraceFilePaths::apply(uint64_t sid) {
+    for (; m_nextFilePath < m_filePaths.size(); m_nextFilePath++) {
+        const auto &file = m_filePaths[m_nextFilePath];
+        if (file.sid > sid) {
+            break;
+        }
+
+        if (file.pathId < m_paths.size()) {
+            m_files[std::make_pair(file.partitionId, file.fileId)] =
+                    file.pathId;
+        }
+    }
+}
+
+uint64_t TraceFilePaths::getPathId(uint64_t partitionId,
+                                   uint64_t fileId) const {
+    auto file = m_files.find(std::make_pair(partitionId, fileId));
+    return file == m_files.end() ? 0 : file->second;
+}
+
+const std::string &TraceFilePaths::getPath(uint64_t pathId) const {
+    return m_paths[pathId];
+}
+
+size_t TraceFilePaths::getPathIdCount() const {
+    return m_paths.size();
+}
+
+}  // namespace octf
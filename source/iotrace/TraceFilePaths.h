@@ -0,0 +1,78 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TRACEFILEPATHS_H
+#define SOURCE_USERSPACE_TRACEFILEPATHS_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace octf {
+
+/**
+ * @brief Full paths of files resolved while tracing, read from the trace
+ * extension
+ *
+ * Paths are read into a dictionary indexed by path ID, files refer to paths
+ * by ID. Paths of files are applied in order of sequence IDs, as events of
+ * the trace are parsed, so renamed files have the path they had at the time.
+ */
+class TraceFilePaths {
+public:
+    /**
+     * @param tracePath Path of the trace, relative to the trace repository
+     *
+     * @throws Exception The trace has no file paths, or they are invalid
+     */
+    TraceFilePaths(const std::string &tracePath);
+    virtual ~TraceFilePaths() = default;
+
+    /**
+     * @brief Applies paths of files resolved before the event
+     */
+    void apply(uint64_t sid);
+
+    /**
+     * @return ID of the path of the file, zero if the path is not known, e.g.
+     * the file was opened before tracing
+     */
+    uint64_t getPathId(uint64_t partitionId, uint64_t fileId) const;
+
+    const std::string &getPath(uint64_t pathId) const;
+
+    /**
+     * @return Number of path IDs, IDs are allocated from one
+     */
+    size_t getPathIdCount() const;
+
+private:
+    /** Path of a file, read from the trace extension */
+    struct FilePath {
+        uint64_t sid;
+        uint64_t partitionId;
+        uint64_t fileId;
+        uint64_t pathId;
+    };
+
+private:
+    /** Paths indexed by path ID */
+    std::vector<std::string> m_paths;
+    /** Paths of files sorted by sequence ID */
+    std::vector<FilePath> m_filePaths;
+    size_t m_nextFilePath;
+    /**
+     * Path IDs of files keyed by partition and inode number. The file ID of
+     * IOs includes the inode change time, which changes on rename, so the
+     * last path of the inode is used.
+     */
+    std::map<std::pair<uint64_t, uint64_t>, uint64_t> m_files;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TRACEFILEPATHS_H
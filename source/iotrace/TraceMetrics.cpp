@@ -0,0 +1,333 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TraceMetrics.h"
+
+#include <sys/resource.h>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <octf/utils/Log.h>
+#include "iotrace_event_compact.h"
+
+namespace octf {
+
+/* Sector size of IO events */
+static constexpr uint64_t SECTOR_SIZE = 512;
+
+/* Minimum interval between writes of the metrics file */
+static constexpr auto METRICS_UPDATE_INTERVAL = std::chrono::seconds(1);
+
+/*
+ * IOs waiting for completion are limited, IOs whose completion is lost
+ * (e.g. in the perf buffer) are forgotten, the oldest first. The oldest IO is
+ * forgotten also after this many IOs were submitted while it was pending
+ * (times the order factor), which bounds the submission order.
+ */
+static constexpr size_t METRICS_PENDING_MAX = 1024 * 1024;
+static constexpr size_t METRICS_PENDING_ORDER_FACTOR = 4;
+
+/* Upper bounds of latency histogram buckets */
+static const struct {
+    uint64_t ns;
+    const char *le;
+} LATENCY_BUCKETS[] = {
+        {50000ULL, "0.00005"},   {100000ULL, "0.0001"},
+        {250000ULL, "0.00025"},  {500000ULL, "0.0005"},
+        {1000000ULL, "0.001"},   {2500000ULL, "0.0025"},
+        {5000000ULL, "0.005"},   {10000000ULL, "0.01"},
+        {25000000ULL, "0.025"},  {50000000ULL, "0.05"},
+        {100000000ULL, "0.1"},   {250000000ULL, "0.25"},
+        {1000000000ULL, "1"},
+};
+
+static constexpr size_t LATENCY_BUCKET_COUNT =
+        sizeof(LATENCY_BUCKETS) / sizeof(LATENCY_BUCKETS[0]);
+
+static const char *OPERATION_NAMES[] = {"read", "write", "discard"};
+
+TraceMetrics::TraceMetrics(const std::string &path,
+                           std::function<KernelRingDevList()> getDevices)
+        : m_path(path)
+        , m_getDevices(getDevices)
+        , m_devices()
+        , m_deviceNames()
+        , m_pending()
+        , m_pendingOrder()
+        , m_events(0)
+        , m_lost(0)
+        , m_dropped(0)
+        , m_streamDropped(0)
+        , m_lastUpdate(std::chrono::steady_clock::now())
+        , m_writeFailed(false) {}
+
+TraceMetrics::DeviceMetrics &TraceMetrics::getDevice(uint64_t devId) {
+    auto &device = m_devices[devId];
+    if (device.latencyBuckets.empty()) {
+        device.latencyBuckets.resize(LATENCY_BUCKET_COUNT + 1);
+    }
+    return device;
+}
+
+void TraceMetrics::handleEvent(const struct iotrace_event_hdr *hdr) {
+    m_events++;
+
+    switch (hdr->type) {
+    case iotrace_event_type_io:
+        if (hdr->size == sizeof(struct iotrace_event)) {
+            handleIo(*reinterpret_cast<const struct iotrace_event *>(hdr));
+        }
+        break;
+    case iotrace_event_type_io_fs:
+        if (hdr->size == sizeof(struct iotrace_event_io_fs)) {
+            handleIo(reinterpret_cast<const struct iotrace_event_io_fs *>(hdr)
+                             ->io);
+        }
+        break;
+    case iotrace_event_type_io_cmpl:
+        if (hdr->size == sizeof(struct iotrace_event_completion)) {
+            auto ev = reinterpret_cast<const struct iotrace_event_completion *>(
+                    hdr);
+            handleCompletion(ev->ref_id, hdr->timestamp);
+        }
+        break;
+    case iotrace_event_type_io_cmpl_rq: {
+        auto ev = reinterpret_cast<const struct iotrace_event_io_cmpl_rq *>(
+                hdr);
+        if (hdr->size >= offsetof(struct iotrace_event_io_cmpl_rq, bios) &&
+            ev->count <= IOTRACE_EVENT_CMPL_RQ_MAX &&
+            hdr->size == offsetof(struct iotrace_event_io_cmpl_rq, bios) +
+                                 ev->count * sizeof(ev->bios[0])) {
+            for (uint32_t i = 0; i < ev->count; i++) {
+                handleCompletion(ev->bios[i].ref_id, hdr->timestamp);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void TraceMetrics::handleIo(const struct iotrace_event &io) {
+    Operation operation;
+    switch (io.operation) {
+    case iotrace_event_operation_rd:
+        operation = Read;
+        break;
+    case iotrace_event_operation_wr:
+        operation = Write;
+        break;
+    case iotrace_event_operation_discard:
+        operation = Discard;
+        break;
+    default:
+        return;
+    }
+
+    auto &device = getDevice(io.dev_id);
+    device.ios[operation]++;
+    device.bytes[operation] += io.len * SECTOR_SIZE;
+
+    // IO IDs are reused, the completion of the previous IO was lost
+    auto stale = m_pending.find(io.id);
+    if (stale != m_pending.end()) {
+        forgetIo(stale);
+    }
+
+    while (!m_pendingOrder.empty()) {
+        auto front = m_pendingOrder.front();
+        auto oldest = m_pending.find(front.second);
+        bool live = oldest != m_pending.end() &&
+                    oldest->second.sid == front.first;
+
+        if (live && m_pending.size() < METRICS_PENDING_MAX &&
+            m_pendingOrder.size() <
+                    METRICS_PENDING_MAX * METRICS_PENDING_ORDER_FACTOR) {
+            break;
+        }
+
+        m_pendingOrder.pop_front();
+        if (live) {
+            forgetIo(oldest);
+        }
+    }
+
+    PendingIo pending = {};
+    pending.sid = io.hdr.sid;
+    pending.timestamp = io.hdr.timestamp;
+    pending.devId = io.dev_id;
+    m_pending[io.id] = pending;
+    m_pendingOrder.emplace_back(io.hdr.sid, io.id);
+    device.inflight++;
+}
+
+void TraceMetrics::forgetIo(
+        std::unordered_map<uint64_t, PendingIo>::iterator iter) {
+    getDevice(iter->second.devId).inflight--;
+    m_pending.erase(iter);
+}
+
+void TraceMetrics::handleCompletion(uint64_t refId, uint64_t timestamp) {
+    auto iter = m_pending.find(refId);
+    if (iter == m_pending.end()) {
+        return;
+    }
+
+    auto &device = getDevice(iter->second.devId);
+    uint64_t latency = timestamp > iter->second.timestamp
+                               ? timestamp - iter->second.timestamp
+                               : 0;
+    m_pending.erase(iter);
+
+    size_t bucket = 0;
+    while (bucket < LATENCY_BUCKET_COUNT &&
+           latency > LATENCY_BUCKETS[bucket].ns) {
+        bucket++;
+    }
+    device.latencyBuckets[bucket]++;
+    device.latencyCount++;
+    device.latencySum += latency;
+    device.inflight--;
+}
+
+void TraceMetrics::addLost(uint64_t count) {
+    m_lost += count;
+}
+
+void TraceMetrics::addDropped(uint64_t count) {
+    m_dropped += count;
+}
+
+void TraceMetrics::setStreamDropped(uint64_t count) {
+    m_streamDropped = count;
+}
+
+std::string TraceMetrics::format() {
+    // Names of removed devices are kept, their metrics stay exported
+    for (const auto &desc : m_getDevices()) {
+        m_deviceNames[desc.id] = desc.device_name;
+    }
+
+    std::ostringstream out;
+    auto label = [this](uint64_t devId) {
+        auto iter = m_deviceNames.find(devId);
+        return "device=\"" +
+               (iter != m_deviceNames.end() ? iter->second
+                                            : std::to_string(devId)) +
+               "\"";
+    };
+
+    out << "# TYPE iotrace_device_ios counter\n"
+        << "# HELP iotrace_device_ios IOs queued to the device\n";
+    for (const auto &entry : m_devices) {
+        for (int op = Read; op <= Discard; op++) {
+            out << "iotrace_device_ios_total{" << label(entry.first)
+                << ",operation=\"" << OPERATION_NAMES[op] << "\"} "
+                << entry.second.ios[op] << "\n";
+        }
+    }
+
+    out << "# TYPE iotrace_device_bytes counter\n"
+        << "# UNIT iotrace_device_bytes bytes\n"
+        << "# HELP iotrace_device_bytes Bytes of IOs queued to the device\n";
+    for (const auto &entry : m_devices) {
+        for (int op = Read; op <= Discard; op++) {
+            out << "iotrace_device_bytes_total{" << label(entry.first)
+                << ",operation=\"" << OPERATION_NAMES[op] << "\"} "
+                << entry.second.bytes[op] << "\n";
+        }
+    }
+
+    out << "# TYPE iotrace_device_latency_seconds histogram\n"
+        << "# UNIT iotrace_device_latency_seconds seconds\n"
+        << "# HELP iotrace_device_latency_seconds Latency of completed IOs\n";
+    for (const auto &entry : m_devices) {
+        const auto &device = entry.second;
+        uint64_t cumulative = 0;
+
+        for (size_t i = 0; i <= LATENCY_BUCKET_COUNT; i++) {
+            cumulative += device.latencyBuckets[i];
+            out << "iotrace_device_latency_seconds_bucket{"
+                << label(entry.first) << ",le=\""
+                << (i < LATENCY_BUCKET_COUNT ? LATENCY_BUCKETS[i].le : "+Inf")
+                << "\"} " << cumulative << "\n";
+        }
+
+        char sum[32];
+        std::snprintf(sum, sizeof(sum), "%.9f", device.latencySum / 1e9);
+        out << "iotrace_device_latency_seconds_sum{" << label(entry.first)
+            << "} " << sum << "\n";
+        out << "iotrace_device_latency_seconds_count{" << label(entry.first)
+            << "} " << device.latencyCount << "\n";
+    }
+
+    out << "# TYPE iotrace_device_inflight_ios gauge\n"
+        << "# HELP iotrace_device_inflight_ios IOs queued and not completed\n";
+    for (const auto &entry : m_devices) {
+        out << "iotrace_device_inflight_ios{" << label(entry.first) << "} "
+            << entry.second.inflight << "\n";
+    }
+
+    out << "# TYPE iotrace_events counter\n"
+        << "# HELP iotrace_events Events produced by eBPF programs\n"
+        << "iotrace_events_total " << m_events << "\n";
+
+    out << "# TYPE iotrace_lost_events counter\n"
+        << "# HELP iotrace_lost_events Events lost before reaching the "
+           "tracer\n"
+        << "iotrace_lost_events_total{sink=\"perf_buffer\"} " << m_lost << "\n"
+        << "iotrace_lost_events_total{sink=\"trace\"} " << m_dropped << "\n"
+        << "iotrace_lost_events_total{sink=\"stream\"} " << m_streamDropped
+        << "\n";
+
+    struct rusage usage = {};
+    ::getrusage(RUSAGE_SELF, &usage);
+    char user[32], system[32];
+    std::snprintf(user, sizeof(user), "%ld.%06ld", (long) usage.ru_utime.tv_sec,
+                  (long) usage.ru_utime.tv_usec);
+    std::snprintf(system, sizeof(system), "%ld.%06ld",
+                  (long) usage.ru_stime.tv_sec, (long) usage.ru_stime.tv_usec);
+
+    out << "# TYPE iotrace_cpu_seconds counter\n"
+        << "# UNIT iotrace_cpu_seconds seconds\n"
+        << "# HELP iotrace_cpu_seconds CPU time of the tracing process\n"
+        << "iotrace_cpu_seconds_total{mode=\"user\"} " << user << "\n"
+        << "iotrace_cpu_seconds_total{mode=\"system\"} " << system << "\n";
+
+    out << "# EOF\n";
+    return out.str();
+}
+
+void TraceMetrics::update(bool force) {
+    auto now = std::chrono::steady_clock::now();
+    if (!force && now - m_lastUpdate < METRICS_UPDATE_INTERVAL) {
+        return;
+    }
+    m_lastUpdate = now;
+
+    // Replaced by rename, readers see either the previous or the new file
+    std::string tmpPath = m_path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        file << format();
+        file.close();
+
+        if (file.fail() || std::rename(tmpPath.c_str(), m_path.c_str())) {
+            if (!m_writeFailed) {
+                log::cerr << "Cannot write metrics to " << m_path
+                          << std::endl;
+                m_writeFailed = true;
+            }
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+
+    m_writeFailed = false;
+}
+
+}  // namespace octf
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TRACEMETRICS_H
+#define SOURCE_USERSPACE_TRACEMETRICS_H
+
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <octf/trace/iotrace_event.h>
+#include <octf/utils/NonCopyable.h>
+#include "KernelRingTraceProducer.h"
+
+namespace octf {
+
+/**
+ * @brief Live IO metrics of traced devices and health of the tracer
+ *
+ * Events are aggregated by the perf buffer polling thread as they are
+ * produced, and the metrics are written periodically in the OpenMetrics text
+ * format into a file, e.g. for the textfile collector of the node exporter.
+ * The file is replaced atomically, so readers never see a partial update.
+ *
+ * Per device, IO and byte counters (rates give IOPS and bandwidth), the
+ * latency histogram and the number of IOs in flight are exported.
+ */
+class TraceMetrics : public NonCopyable {
+public:
+    /**
+     * @param path Path of the metrics file
+     * @param getDevices Returns devices traced currently, to label metrics
+     * with device names
+     */
+    TraceMetrics(const std::string &path,
+                 std::function<KernelRingDevList()> getDevices);
+    virtual ~TraceMetrics() = default;
+
+    /**
+     * @brief Aggregates event, compact events are handled
+     */
+    void handleEvent(const struct iotrace_event_hdr *hdr);
+
+    /**
+     * @brief Counts events lost in the perf buffer
+     */
+    void addLost(uint64_t count);
+
+    /**
+     * @brief Counts events which did not fit into trace rings
+     */
+    void addDropped(uint64_t count);
+
+    /**
+     * @brief Sets count of events dropped by the live event stream
+     */
+    void setStreamDropped(uint64_t count);
+
+    /**
+     * @brief Writes the metrics file, if the update interval elapsed
+     *
+     * @param force Write regardless of the interval, e.g. at the end of
+     * tracing
+     */
+    void update(bool force = false);
+
+private:
+    struct DeviceMetrics {
+        DeviceMetrics()
+                : ios()
+                , bytes()
+                , latencyBuckets()
+                , latencyCount(0)
+                , latencySum(0)
+                , inflight(0) {}
+
+        /** Indexed by Operation */
+        uint64_t ios[3];
+        uint64_t bytes[3];
+        /** Non-cumulative counts, the last bucket is +Inf */
+        std::vector<uint64_t> latencyBuckets;
+        uint64_t latencyCount;
+        /** Sum of latencies in ns */
+        uint64_t latencySum;
+        uint64_t inflight;
+    };
+
+    enum Operation { Read, Write, Discard };
+
+    struct PendingIo {
+        uint64_t sid;
+        uint64_t timestamp;
+        uint32_t devId;
+    };
+
+    /**
+     * @brief Forgets the IO, its completion is not expected anymore
+     */
+    void forgetIo(std::unordered_map<uint64_t, PendingIo>::iterator iter);
+
+    void handleIo(const struct iotrace_event &io);
+
+    void handleCompletion(uint64_t refId, uint64_t timestamp);
+
+    DeviceMetrics &getDevice(uint64_t devId);
+
+    std::string format();
+
+private:
+    const std::string m_path;
+    std::function<KernelRingDevList()> m_getDevices;
+    std::map<uint64_t, DeviceMetrics> m_devices;
+    std::map<uint64_t, std::string> m_deviceNames;
+    /** IOs waiting for completion, keyed by IO ID */
+    std::unordered_map<uint64_t, PendingIo> m_pending;
+    /**
+     * Sequence and IO IDs of pending IOs in order of submission, entries of
+     * completed IOs are skipped when they reach the front
+     */
+    std::deque<std::pair<uint64_t, uint64_t>> m_pendingOrder;
+    uint64_t m_events;
+    uint64_t m_lost;
+    uint64_t m_dropped;
+    uint64_t m_streamDropped;
+    std::chrono::steady_clock::time_point m_lastUpdate;
+    bool m_writeFailed;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TRACEMETRICS_H
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TraceRingOverflow.h"
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstring>
+
+namespace octf {
+
+/* Size of a chunk of kept events, the size of a huge page */
+static constexpr uint64_t OVERFLOW_CHUNK_SIZE = 2 * 1024 * 1024;
+
+/* Batches are kept aligned, so their headers can be read in place */
+static constexpr uint64_t OVERFLOW_ALIGNMENT = 8;
+
+static uint64_t alignUp(uint64_t size) {
+    return (size + OVERFLOW_ALIGNMENT - 1) & ~(OVERFLOW_ALIGNMENT - 1);
+}
+
+TraceRingOverflow::TraceRingOverflow()
+        : m_chunks()
+        , m_spare(nullptr)
+        , m_capacity(0)
+        , m_hugePages(false)
+        , m_size(0)
+        , m_peakSize(0)
+        , m_count(0) {}
+
+TraceRingOverflow::~TraceRingOverflow() {
+    clear();
+
+    if (m_spare) {
+        ::munmap(m_spare, OVERFLOW_CHUNK_SIZE);
+    }
+}
+
+void TraceRingOverflow::init(uint64_t capacity, bool hugePages) {
+    m_capacity = capacity;
+    m_hugePages = hugePages;
+}
+
+char *TraceRingOverflow::allocate() {
+    if (m_spare) {
+        char *data = m_spare;
+        m_spare = nullptr;
+        return data;
+    }
+
+    if (m_size + OVERFLOW_CHUNK_SIZE > m_capacity) {
+        return nullptr;
+    }
+
+    void *data = MAP_FAILED;
+    if (m_hugePages) {
+        // Huge pages reserved by the administrator, if any
+        data = ::mmap(nullptr, OVERFLOW_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (data == MAP_FAILED) {
+        data = ::mmap(nullptr, OVERFLOW_CHUNK_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            return nullptr;
+        }
+        if (m_hugePages) {
+            // Transparent huge pages otherwise
+            ::madvise(data, OVERFLOW_CHUNK_SIZE, MADV_HUGEPAGE);
+        }
+    }
+
+    m_size += OVERFLOW_CHUNK_SIZE;
+    return static_cast<char *>(data);
+}
+
+void TraceRingOverflow::release(Chunk &chunk) {
+    if (!m_spare) {
+        m_spare = chunk.data;
+    } else {
+        ::munmap(chunk.data, OVERFLOW_CHUNK_SIZE);
+        m_size -= OVERFLOW_CHUNK_SIZE;
+    }
+    chunk.data = nullptr;
+}
+
+bool TraceRingOverflow::push(const void *batch,
+                             uint32_t size,
+                             uint32_t count) {
+    uint64_t alignedSize = sizeof(Batch) + alignUp(size);
+    if (alignedSize > OVERFLOW_CHUNK_SIZE) {
+        return false;
+    }
+
+    if (m_chunks.empty() ||
+        m_chunks.back().tail + alignedSize > OVERFLOW_CHUNK_SIZE) {
+        char *data = allocate();
+        if (!data) {
+            return false;
+        }
+
+        Chunk chunk = {data, 0, 0};
+        m_chunks.push_back(chunk);
+        m_peakSize = std::max<uint64_t>(
+                m_peakSize, m_chunks.size() * OVERFLOW_CHUNK_SIZE);
+    }
+
+    auto &chunk = m_chunks.back();
+    auto hdr = reinterpret_cast<Batch *>(chunk.data + chunk.tail);
+    hdr->size = size;
+    hdr->count = count;
+    std::memcpy(hdr + 1, batch, size);
+    chunk.tail += alignedSize;
+    m_count += count;
+
+    return true;
+}
+
+bool TraceRingOverflow::drain(octf_trace_t trace) {
+    while (!m_chunks.empty()) {
+        auto &chunk = m_chunks.front();
+
+        while (chunk.head < chunk.tail) {
+            auto hdr = reinterpret_cast<const Batch *>(chunk.data + chunk.head);
+            if (octf_trace_push(trace, hdr + 1, hdr->size)) {
+                // Trace ring is full
+                return false;
+            }
+
+            chunk.head += sizeof(Batch) + alignUp(hdr->size);
+            m_count -= hdr->count;
+        }
+
+        release(chunk);
+        m_chunks.pop_front();
+    }
+
+    return true;
+}
+
+uint64_t TraceRingOverflow::clear() {
+    uint64_t count = m_count;
+
+    for (auto &chunk : m_chunks) {
+        release(chunk);
+    }
+    m_chunks.clear();
+    m_count = 0;
+
+    return count;
+}
+
+uint64_t TraceRingOverflow::getPeakSize() {
+    uint64_t peakSize = m_peakSize;
+    m_peakSize = m_chunks.size() * OVERFLOW_CHUNK_SIZE;
+    return peakSize;
+}
+
+}  // namespace octf
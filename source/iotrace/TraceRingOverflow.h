@@ -0,0 +1,110 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TRACERINGOVERFLOW_H
+#define SOURCE_USERSPACE_TRACERINGOVERFLOW_H
+
+#include <stdint.h>
+#include <deque>
+#include <octf/trace/trace.h>
+#include <octf/utils/NonCopyable.h>
+
+namespace octf {
+
+/**
+ * @brief Batches of events which did not fit into the trace ring
+ *
+ * Trace rings are allocated small, and their size cannot change while the
+ * trace manager consumes them. When a ring is full, batches of events are
+ * kept here, in chunks allocated on demand up to the capacity, and moved into
+ * the ring as its consumer catches up. Drained chunks are released, so the
+ * memory of a queue grows under load only, up to the size requested by the
+ * user.
+ *
+ * Once a batch is kept here, following batches are kept here too, until the
+ * buffer is drained, so the order of events is preserved.
+ *
+ * @note This class is not thread safe, it is used by the perf buffer polling
+ * thread only.
+ */
+class TraceRingOverflow : public NonCopyable {
+public:
+    TraceRingOverflow();
+    virtual ~TraceRingOverflow();
+
+    /**
+     * @param capacity Maximum memory (in bytes) of kept events
+     * @param hugePages Back chunks with huge pages, if available
+     */
+    void init(uint64_t capacity, bool hugePages);
+
+    inline bool empty() const {
+        return m_chunks.empty();
+    }
+
+    /**
+     * @brief Keeps the batch of events
+     *
+     * @param count Number of events in the batch
+     *
+     * @retval false The capacity is reached, the batch is not kept
+     */
+    bool push(const void *batch, uint32_t size, uint32_t count);
+
+    /**
+     * @brief Moves kept batches into the trace ring, while they fit
+     *
+     * @retval true All events moved
+     */
+    bool drain(octf_trace_t trace);
+
+    /**
+     * @brief Drops kept batches
+     *
+     * @return Number of dropped events
+     */
+    uint64_t clear();
+
+    /**
+     * @return Peak memory (in bytes) of kept events since the last call
+     */
+    uint64_t getPeakSize();
+
+private:
+    struct Chunk {
+        char *data;
+        /** Offset of the first kept batch */
+        uint64_t head;
+        /** Offset of the end of the last kept batch */
+        uint64_t tail;
+    };
+
+    /** Header of a kept batch, followed by its events */
+    struct Batch {
+        uint32_t size;
+        uint32_t count;
+    };
+
+    char *allocate();
+
+    void release(Chunk &chunk);
+
+private:
+    std::deque<Chunk> m_chunks;
+    /** Drained chunk kept for reuse */
+    char *m_spare;
+    uint64_t m_capacity;
+    bool m_hugePages;
+    /** Memory of allocated chunks, including the spare one */
+    uint64_t m_size;
+    /** Peak memory of chunks holding events */
+    uint64_t m_peakSize;
+    /** Number of kept events */
+    uint64_t m_count;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TRACERINGOVERFLOW_H
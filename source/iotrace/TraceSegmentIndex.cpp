@@ -0,0 +1,122 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TraceSegmentIndex.h"
+
+#include <dirent.h>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <octf/utils/Exception.h>
+#include "TraceExtensionReader.h"
+
+namespace octf {
+
+/* File with session and index of the segment, in its trace directory */
+static const std::string SEGMENT_FILE_NAME = "iotrace.segment";
+
+void TraceSegmentIndex::addSegment(const std::string &tracePath,
+                                   const std::string &session,
+                                   uint64_t index) {
+    std::string path = TraceExtensionReader::getTraceDirectory(tracePath) +
+                       "/" + SEGMENT_FILE_NAME;
+    std::ofstream file(path, std::ios::trunc);
+    file << session << " " << index << std::endl;
+
+    if (!file.good()) {
+        throw Exception("Cannot write segment index " + path);
+    }
+}
+
+bool TraceSegmentIndex::readSegment(const std::string &tracePath,
+                                    std::string &session,
+                                    uint64_t &index) {
+    std::ifstream file(TraceExtensionReader::getTraceDirectory(tracePath) +
+                       "/" + SEGMENT_FILE_NAME);
+    return static_cast<bool>(file >> session >> index);
+}
+
+void TraceSegmentIndex::parseRange(const std::string &range,
+                                   uint64_t &first,
+                                   uint64_t &last) {
+    auto parseIndex = [&range](const std::string &value, uint64_t &index) {
+        if (value.empty()) {
+            return;
+        }
+        if (!std::all_of(value.begin(), value.end(), ::isdigit)) {
+            throw Exception("Invalid segment range " + range);
+        }
+        index = std::stoull(value);
+    };
+
+    first = 0;
+    last = UINT64_MAX;
+
+    auto delimiter = range.find('-');
+    if (delimiter == std::string::npos) {
+        parseIndex(range, first);
+        last = first;
+    } else {
+        parseIndex(range.substr(0, delimiter), first);
+        parseIndex(range.substr(delimiter + 1), last);
+    }
+
+    if (range.empty() || range == "-" || first > last) {
+        throw Exception("Invalid segment range " + range);
+    }
+}
+
+std::vector<std::string> TraceSegmentIndex::findSegments(
+        const std::string &tracePath,
+        const std::string &range) {
+    uint64_t first, last;
+    parseRange(range, first, last);
+
+    std::string session;
+    uint64_t index;
+    if (!readSegment(tracePath, session, index)) {
+        throw Exception("Trace " + tracePath + " is not a trace segment");
+    }
+
+    // Segments of the session are siblings of the trace
+    auto delimiter = tracePath.find_last_of('/');
+    std::string parent = delimiter == std::string::npos
+                                 ? ""
+                                 : tracePath.substr(0, delimiter + 1);
+    std::string dir = TraceExtensionReader::getTraceDirectory(parent);
+
+    std::map<uint64_t, std::string> segments;
+    DIR *stream = ::opendir(dir.c_str());
+    if (!stream) {
+        throw Exception("Cannot read trace directory " + dir);
+    }
+    while (auto entry = ::readdir(stream)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+
+        std::string siblingSession;
+        std::string sibling = parent + name;
+        if (readSegment(sibling, siblingSession, index) &&
+            siblingSession == session && index >= first && index <= last) {
+            segments[index] = sibling;
+        }
+    }
+    ::closedir(stream);
+
+    if (segments.empty()) {
+        throw Exception("No kept segment of the session in range " + range);
+    }
+
+    std::vector<std::string> paths;
+    for (const auto &segment : segments) {
+        paths.push_back(segment.second);
+    }
+    return paths;
+}
+
+}  // namespace octf
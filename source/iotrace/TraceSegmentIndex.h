@@ -0,0 +1,66 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TRACESEGMENTINDEX_H
+#define SOURCE_USERSPACE_TRACESEGMENTINDEX_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace octf {
+
+/**
+ * @brief Finds segments of a tracing session in the trace repository
+ *
+ * Each sealed segment has a file with its session and index in its trace
+ * directory. Segments of a session are in the same directory of the trace
+ * repository, so they are found by the files of their sibling traces.
+ */
+class TraceSegmentIndex {
+public:
+    /**
+     * @brief Records session and index of the sealed segment
+     *
+     * @param tracePath Path of the segment, relative to the trace repository
+     *
+     * @throws Exception The file cannot be written
+     */
+    static void addSegment(const std::string &tracePath,
+                           const std::string &session,
+                           uint64_t index);
+
+    /**
+     * @brief Finds kept segments of the session of the trace
+     *
+     * @param tracePath Path of any segment of the session
+     * @param range Range of segment indexes, "FIRST-LAST", "FIRST-", "-LAST"
+     * or a single index
+     *
+     * @return Paths of the segments relative to the trace repository, in
+     * order of their indexes
+     *
+     * @throws Exception The trace is not a segment, the range is invalid or
+     * no segment is in the range
+     */
+    static std::vector<std::string> findSegments(const std::string &tracePath,
+                                                 const std::string &range);
+
+private:
+    /**
+     * @retval false The trace is not a segment
+     */
+    static bool readSegment(const std::string &tracePath,
+                            std::string &session,
+                            uint64_t &index);
+
+    static void parseRange(const std::string &range,
+                           uint64_t &first,
+                           uint64_t &last);
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TRACESEGMENTINDEX_H
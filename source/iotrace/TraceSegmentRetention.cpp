@@ -0,0 +1,102 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TraceSegmentRetention.h"
+
+#include <ftw.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <octf/utils/Exception.h>
+#include <octf/utils/Log.h>
+
+namespace octf {
+
+static thread_local uint64_t directorySize;
+
+static int sumFileSize(const char *path,
+                       const struct stat *sb,
+                       int typeflag,
+                       struct FTW *ftwbuf) {
+    (void) path;
+    (void) ftwbuf;
+
+    if (typeflag == FTW_F) {
+        directorySize += sb->st_size;
+    }
+
+    return 0;
+}
+
+static int removeEntry(const char *path,
+                       const struct stat *sb,
+                       int typeflag,
+                       struct FTW *ftwbuf) {
+    (void) sb;
+    (void) typeflag;
+    (void) ftwbuf;
+
+    return ::remove(path);
+}
+
+TraceSegmentRetention::TraceSegmentRetention(
+        const std::string &traceRepository,
+        uint32_t maxSegments,
+        uint64_t maxSize)
+        : m_traceRepository(traceRepository)
+        , m_maxSegments(maxSegments)
+        , m_maxSize(maxSize)
+        , m_totalSize(0)
+        , m_segments() {}
+
+uint64_t TraceSegmentRetention::addSegment(const std::string &tracePath) {
+    uint64_t size = getDirectorySize(m_traceRepository + "/" + tracePath);
+
+    m_segments.emplace_back(tracePath, size);
+    m_totalSize += size;
+
+    while (m_segments.size() > 1) {
+        bool countExceeded = m_maxSegments && m_segments.size() > m_maxSegments;
+        bool sizeExceeded = m_maxSize && m_totalSize > m_maxSize;
+
+        if (!countExceeded && !sizeExceeded) {
+            break;
+        }
+
+        const auto &oldest = m_segments.front();
+        log::verbose << "Removing trace segment " << oldest.first << std::endl;
+        removeDirectory(m_traceRepository + "/" + oldest.first);
+
+        m_totalSize -= oldest.second;
+        m_segments.pop_front();
+    }
+
+    return size;
+}
+
+std::vector<std::string> TraceSegmentRetention::getSegments() const {
+    std::vector<std::string> segments;
+    for (const auto &segment : m_segments) {
+        segments.push_back(segment.first);
+    }
+    return segments;
+}
+
+uint64_t TraceSegmentRetention::getDirectorySize(const std::string &dir) {
+    directorySize = 0;
+
+    if (::nftw(dir.c_str(), sumFileSize, 16, FTW_PHYS)) {
+        throw Exception("Cannot get size of trace segment " + dir);
+    }
+
+    return directorySize;
+}
+
+void TraceSegmentRetention::removeDirectory(const std::string &dir) {
+    if (::nftw(dir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS)) {
+        log::cerr << "Cannot remove trace segment " << dir << std::endl;
+    }
+}
+
+}  // namespace octf
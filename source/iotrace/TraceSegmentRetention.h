@@ -0,0 +1,69 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_TRACESEGMENTRETENTION_H
+#define SOURCE_USERSPACE_TRACESEGMENTRETENTION_H
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+#include <octf/utils/NonCopyable.h>
+
+namespace octf {
+
+/**
+ * @brief Retention policy of sealed trace segments
+ *
+ * Keeps track of segments sealed during one tracing session and removes the
+ * oldest ones when the limit of segment count or total size is exceeded. The
+ * most recent segment is never removed.
+ */
+class TraceSegmentRetention : public NonCopyable {
+public:
+    /**
+     * @param traceRepository Absolute path of the trace repository
+     * @param maxSegments Maximum number of kept segments, zero means no limit
+     * @param maxSize Maximum total size of kept segments (in bytes), zero
+     * means no limit
+     */
+    TraceSegmentRetention(const std::string &traceRepository,
+                          uint32_t maxSegments,
+                          uint64_t maxSize);
+    virtual ~TraceSegmentRetention() = default;
+
+    /**
+     * @brief Adds sealed segment and applies the retention policy
+     *
+     * @param tracePath Path of the segment, relative to the trace repository
+     *
+     * @return Size of the segment (in bytes)
+     */
+    uint64_t addSegment(const std::string &tracePath);
+
+    /**
+     * @brief Gets paths of kept segments relative to the trace repository,
+     * from the oldest one
+     */
+    std::vector<std::string> getSegments() const;
+
+private:
+    static uint64_t getDirectorySize(const std::string &dir);
+
+    static void removeDirectory(const std::string &dir);
+
+private:
+    const std::string m_traceRepository;
+    const uint32_t m_maxSegments;
+    const uint64_t m_maxSize;
+    uint64_t m_totalSize;
+    /** Paths and sizes of kept segments */
+    std::deque<std::pair<std::string, uint64_t>> m_segments;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_TRACESEGMENTRETENTION_H
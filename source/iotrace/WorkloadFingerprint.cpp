@@ -0,0 +1,278 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "WorkloadFingerprint.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <octf/utils/Exception.h>
+
+namespace octf {
+
+/* Fingerprints hold at most this many devices */
+static constexpr size_t FINGERPRINT_DEVICES_MAX = 1024;
+
+/* Zipf exponent below which accesses are reproduced as uniform */
+static constexpr double ZIPF_THETA_MIN = 0.05;
+
+static double toDouble(uint64_t value) {
+    return value / (double) IOTRACE_FINGERPRINT_SCALE;
+}
+
+/**
+ * @brief Formats size of the bucket for fio, e.g. 4k
+ */
+static std::string getFioSize(size_t bucket) {
+    uint64_t bytes = 512ULL << bucket;
+
+    if (bytes % (1024 * 1024) == 0) {
+        return std::to_string(bytes / (1024 * 1024)) + "m";
+    } else if (bytes % 1024 == 0) {
+        return std::to_string(bytes / 1024) + "k";
+    }
+    return std::to_string(bytes);
+}
+
+/**
+ * @brief Formats shares of IO sizes as fio block size split, whose
+ * percentages have to sum up to 100
+ */
+static std::string getFioSizeSplit(const uint16_t *shares) {
+    uint64_t percents[IOTRACE_FINGERPRINT_SIZE_BUCKETS];
+    uint64_t remainders[IOTRACE_FINGERPRINT_SIZE_BUCKETS];
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < IOTRACE_FINGERPRINT_SIZE_BUCKETS; i++) {
+        percents[i] = shares[i] * 100 / IOTRACE_FINGERPRINT_SCALE;
+        remainders[i] = shares[i] * 100 % IOTRACE_FINGERPRINT_SCALE;
+        sum += percents[i];
+    }
+    if (std::all_of(shares, shares + IOTRACE_FINGERPRINT_SIZE_BUCKETS,
+                    [](uint16_t share) { return !share; })) {
+        // No IOs in this direction
+        return "4k/100";
+    }
+
+    // Rounding is given to buckets with the largest remainders
+    while (sum < 100) {
+        auto largest = std::max_element(
+                remainders, remainders + IOTRACE_FINGERPRINT_SIZE_BUCKETS);
+        percents[largest - remainders]++;
+        *largest = 0;
+        sum++;
+    }
+
+    std::string split;
+    for (size_t i = 0; i < IOTRACE_FINGERPRINT_SIZE_BUCKETS; i++) {
+        if (!percents[i]) {
+            continue;
+        }
+        if (!split.empty()) {
+            split += ":";
+        }
+        split += getFioSize(i) + "/" + std::to_string(percents[i]);
+    }
+    return split;
+}
+
+WorkloadFingerprint::WorkloadFingerprint()
+        : m_devices() {}
+
+void WorkloadFingerprint::addDevice(
+        const struct iotrace_fingerprint_device &device) {
+    m_devices.push_back(device);
+}
+
+const std::vector<struct iotrace_fingerprint_device>
+        &WorkloadFingerprint::getDevices() const {
+    return m_devices;
+}
+
+void WorkloadFingerprint::load(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    struct iotrace_fingerprint_hdr hdr = {};
+
+    file.read(reinterpret_cast<char *>(&hdr), sizeof(hdr));
+    if (!file) {
+        throw Exception("Cannot read fingerprint " + path);
+    }
+    if (hdr.magic != IOTRACE_FINGERPRINT_MAGIC) {
+        throw Exception("Invalid fingerprint " + path);
+    }
+    if (hdr.version != IOTRACE_FINGERPRINT_VERSION) {
+        throw Exception("Unsupported fingerprint version " +
+                        std::to_string(hdr.version));
+    }
+    if (hdr.device_count > FINGERPRINT_DEVICES_MAX) {
+        throw Exception("Invalid fingerprint " + path);
+    }
+
+    m_devices.resize(hdr.device_count);
+    file.read(reinterpret_cast<char *>(m_devices.data()),
+              m_devices.size() * sizeof(m_devices[0]));
+    if (!file) {
+        m_devices.clear();
+        throw Exception("Cannot read fingerprint " + path);
+    }
+
+    for (auto &device : m_devices) {
+        device.name[sizeof(device.name) - 1] = '\0';
+    }
+}
+
+void WorkloadFingerprint::save(const std::string &path) const {
+    struct iotrace_fingerprint_hdr hdr = {};
+    hdr.magic = IOTRACE_FINGERPRINT_MAGIC;
+    hdr.version = IOTRACE_FINGERPRINT_VERSION;
+    hdr.device_count = m_devices.size();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    file.write(reinterpret_cast<const char *>(m_devices.data()),
+               m_devices.size() * sizeof(m_devices[0]));
+    file.close();
+
+    if (file.fail()) {
+        throw Exception("Cannot write fingerprint " + path);
+    }
+}
+
+void WorkloadFingerprint::writeFioJobs(const std::string &path) const {
+    std::ofstream file(path, std::ios::trunc);
+
+    file << "# Workload fingerprint of a trace, reproduced by fio\n"
+         << "# Set filename of each job to the device to run it on\n\n"
+         << "[global]\n"
+         << "ioengine=libaio\n"
+         << "direct=1\n"
+         << "time_based\n";
+
+    for (const auto &device : m_devices) {
+        const auto read = iotrace_fingerprint_read;
+        const auto write = iotrace_fingerprint_write;
+        double seconds = device.duration / 1e9;
+        uint64_t readPercent = (device.read_share * 100 +
+                                IOTRACE_FINGERPRINT_SCALE / 2) /
+                               IOTRACE_FINGERPRINT_SCALE;
+
+        file << "\n[" << device.name << "]\n"
+             << "filename=/dev/" << device.name << "\n"
+             << "runtime=" << std::max<uint64_t>(1, std::llround(seconds))
+             << "\n";
+
+        if (readPercent >= 100) {
+            file << "rw=randread\n";
+        } else if (readPercent == 0) {
+            file << "rw=randwrite\n";
+        } else {
+            file << "rw=randrw\n"
+                 << "rwmixread=" << readPercent << "\n";
+        }
+
+        // Sequential IOs are the ones fio does not randomize
+        file << "percentage_random="
+             << 100 - device.sequential_shares[read] * 100 /
+                              IOTRACE_FINGERPRINT_SCALE
+             << ","
+             << 100 - device.sequential_shares[write] * 100 /
+                              IOTRACE_FINGERPRINT_SCALE
+             << "\n";
+
+        file << "bssplit=" << getFioSizeSplit(device.size_shares[read]) << ","
+             << getFioSizeSplit(device.size_shares[write]) << "\n";
+
+        double theta = toDouble(device.zipf_theta);
+        if (theta < ZIPF_THETA_MIN) {
+            file << "random_distribution=random\n";
+        } else {
+            // Zipf distribution of fio is not defined for theta of 1
+            if (std::fabs(theta - 1.0) < 0.01) {
+                theta = 1.01;
+            }
+            file << "random_distribution=zipf:" << theta << "\n";
+        }
+
+        file << "size="
+             << std::max<uint64_t>(1, device.lba_span * 100 /
+                                              IOTRACE_FINGERPRINT_SCALE)
+             << "%\n";
+
+        // A device with less than one IO in flight on average is driven by
+        // the arrival of IOs, other devices by the queue depth
+        double queueDepth = toDouble(device.queue_depth);
+        if (queueDepth < 1.0 && seconds > 0) {
+            uint64_t iops = std::llround(device.io_count / seconds);
+            uint64_t readIops = iops * readPercent / 100;
+
+            file << "iodepth="
+                 << std::max<uint64_t>(1, device.max_queue_depth) << "\n"
+                 << "rate_iops=" << std::max<uint64_t>(1, readIops) << ","
+                 << std::max<uint64_t>(1, iops - readIops) << "\n"
+                 << "rate_process="
+                 << (toDouble(device.interarrival_cv) >= 0.5 ? "poisson"
+                                                             : "linear")
+                 << "\n";
+        } else {
+            file << "iodepth="
+                 << std::max<uint64_t>(1, std::llround(queueDepth)) << "\n";
+        }
+    }
+
+    file.close();
+    if (file.fail()) {
+        throw Exception("Cannot write fio job file " + path);
+    }
+}
+
+void WorkloadFingerprint::getSummary(proto::FingerprintSummary *summary) const {
+    summary->Clear();
+
+    auto addShares = [](const uint16_t *shares, size_t count, uint64_t first,
+                        google::protobuf::RepeatedPtrField<proto::ShareBucket>
+                                *buckets) {
+        for (size_t i = 0; i < count; i++) {
+            auto bucket = buckets->Add();
+            if (i + 1 < count) {
+                bucket->set_maxvalue(first << i);
+            }
+            bucket->set_share(toDouble(shares[i]));
+        }
+    };
+
+    for (const auto &device : m_devices) {
+        auto result = summary->add_devices();
+        result->set_name(device.name);
+        result->set_devicesize(device.device_size);
+        result->set_duration(device.duration);
+        result->set_iocount(device.io_count);
+        result->set_bytes(device.bytes);
+        result->set_readshare(toDouble(device.read_share));
+
+        addShares(device.size_shares[iotrace_fingerprint_read],
+                  IOTRACE_FINGERPRINT_SIZE_BUCKETS, 512,
+                  result->mutable_readsizes());
+        addShares(device.size_shares[iotrace_fingerprint_write],
+                  IOTRACE_FINGERPRINT_SIZE_BUCKETS, 512,
+                  result->mutable_writesizes());
+
+        result->set_sequentialreadshare(
+                toDouble(device.sequential_shares[iotrace_fingerprint_read]));
+        result->set_sequentialwriteshare(
+                toDouble(device.sequential_shares[iotrace_fingerprint_write]));
+        result->set_footprint(toDouble(device.footprint));
+        result->set_lbaspan(toDouble(device.lba_span));
+        result->set_zipftheta(toDouble(device.zipf_theta));
+        result->set_queuedepth(toDouble(device.queue_depth));
+        result->set_maxqueuedepth(device.max_queue_depth);
+        result->set_interarrivalmean(device.interarrival_mean);
+        result->set_interarrivalcv(toDouble(device.interarrival_cv));
+        addShares(device.interarrival_shares, IOTRACE_FINGERPRINT_GAP_BUCKETS,
+                  1024, result->mutable_interarrival());
+    }
+}
+
+}  // namespace octf
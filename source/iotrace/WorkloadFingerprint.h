@@ -0,0 +1,57 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SOURCE_USERSPACE_WORKLOADFINGERPRINT_H
+#define SOURCE_USERSPACE_WORKLOADFINGERPRINT_H
+
+#include <string>
+#include <vector>
+#include "InterfaceTraceExtensionParsing.pb.h"
+#include "iotrace_fingerprint.h"
+
+namespace octf {
+
+/**
+ * @brief Fingerprint of the workload of traced devices, see
+ * iotrace_fingerprint.h
+ *
+ * The fingerprint is stored in its binary format, and is turned into fio job
+ * files reproducing the workload: one job per device, running concurrently.
+ */
+class WorkloadFingerprint {
+public:
+    WorkloadFingerprint();
+    virtual ~WorkloadFingerprint() = default;
+
+    void addDevice(const struct iotrace_fingerprint_device &device);
+
+    const std::vector<struct iotrace_fingerprint_device> &getDevices() const;
+
+    /**
+     * @throws Exception Cannot read the file or it is not a fingerprint
+     */
+    void load(const std::string &path);
+
+    /**
+     * @throws Exception Cannot write the file
+     */
+    void save(const std::string &path) const;
+
+    /**
+     * @brief Writes fio job file, devices are referred to by their names
+     *
+     * @throws Exception Cannot write the file
+     */
+    void writeFioJobs(const std::string &path) const;
+
+    void getSummary(proto::FingerprintSummary *summary) const;
+
+private:
+    std::vector<struct iotrace_fingerprint_device> m_devices;
+};
+
+}  // namespace octf
+
+#endif  // SOURCE_USERSPACE_WORKLOADFINGERPRINT_H
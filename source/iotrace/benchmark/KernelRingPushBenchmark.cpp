@@ -0,0 +1,190 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Microbenchmark of pushing trace events into OCTF trace rings
+ *
+ * Perf samples of compact IO events are expanded into IO and fs_meta events.
+ * Compares pushing each expanded event through a type erased callback into
+ * octf_trace_push() (the former push path), reserving ring space for each
+ * expanded event and filling it in place, and batching the events of the
+ * sample into one reservation and one copy (the push path of
+ * KernelRingTraceBuffer). Prints the cost of one sample in TSC cycles (or
+ * nanoseconds where TSC is not available).
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <octf/trace/iotrace_event.h>
+#include "../KernelRingTraceProducer.h"
+#include "../iotrace_event_compact.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static const char *UNIT = "cycles";
+static inline uint64_t now() {
+    return __rdtsc();
+}
+#else
+static const char *UNIT = "ns";
+static inline uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+#endif
+
+using namespace octf;
+
+/* Samples pushed in one round, they fit into the ring without a consumer */
+static constexpr uint32_t SAMPLE_COUNT = 500000;
+static constexpr uint32_t RING_SIZE_MIB = 128;
+static constexpr uint32_t ROUNDS = 5;
+
+struct Ring {
+    Ring()
+            : buffer(std::make_shared<KernelRingTraceBuffer>())
+            , producer() {
+        buffer->devs = std::make_shared<KernelRingDevList>();
+        buffer->refSeqId = std::make_shared<KernelRingSeqId>(0);
+        producer.reset(new KernelRingTraceProducer(buffer, 0));
+        producer->initRing(RING_SIZE_MIB);
+
+        octf_trace_t trace = buffer->trace;
+        pushTrace = [trace](const void *event, const uint32_t size) {
+            octf_trace_push(trace, event, size);
+        };
+    }
+
+    std::shared_ptr<KernelRingTraceBuffer> buffer;
+    std::unique_ptr<KernelRingTraceProducer> producer;
+    /** Former push path */
+    std::function<void(const void *trace, const uint32_t traceSize)> pushTrace;
+};
+
+typedef std::vector<struct iotrace_event_io_fs> Samples;
+
+static Samples createSamples() {
+    Samples samples(SAMPLE_COUNT);
+
+    for (uint32_t i = 0; i < SAMPLE_COUNT; i++) {
+        auto &ev = samples[i];
+        iotrace_event_init_hdr(&ev.io.hdr,
+                               static_cast<iotrace_event_type>(
+                                       iotrace_event_type_io_fs),
+                               2 * i + 1, i * 10, sizeof(ev));
+        ev.io.id = i;
+        ev.io.lba = i * 8ULL;
+        ev.io.len = 8;
+        ev.io.dev_id = 1;
+        ev.io.operation = iotrace_event_operation_wr;
+        ev.file_id.id = i % 64;
+        ev.file_offset = i * 8ULL;
+        ev.file_size = 1 << 20;
+        ev.partition_id = 1;
+    }
+
+    return samples;
+}
+
+static void expandIo(const struct iotrace_event_io_fs &ev,
+                     struct iotrace_event &io) {
+    io = ev.io;
+    io.hdr.type = iotrace_event_type_io;
+    io.hdr.size = sizeof(io);
+}
+
+static void expandMeta(const struct iotrace_event_io_fs &ev,
+                       struct iotrace_event_fs_meta &meta) {
+    iotrace_event_init_hdr(&meta.hdr, iotrace_event_type_fs_meta,
+                           ev.io.hdr.sid + 1, ev.io.hdr.timestamp,
+                           sizeof(meta));
+    meta.ref_id = ev.io.id;
+    meta.file_id = ev.file_id;
+    meta.file_offset = ev.file_offset;
+    meta.file_size = ev.file_size;
+    meta.partition_id = ev.partition_id;
+}
+
+template <typename Event, typename Fill>
+static void reserveEvent(Ring &ring, Fill fill) {
+    octf_trace_t trace = ring.buffer->trace;
+    octf_trace_event_handle_t handle;
+    void *buffer;
+
+    if (octf_trace_get_wr_buffer(trace, &handle, &buffer, sizeof(Event))) {
+        ring.buffer->failed++;
+        return;
+    }
+
+    fill(*static_cast<Event *>(buffer));
+    octf_trace_commit_wr_buffer(trace, handle);
+}
+
+template <typename PushFn>
+static void run(const char *name, const Samples &samples, PushFn push) {
+    uint64_t best = UINT64_MAX;
+    uint64_t failed = 0;
+
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        Ring ring;
+
+        uint64_t start = now();
+        for (const auto &ev : samples) {
+            push(ring, ev);
+        }
+        uint64_t elapsed = now() - start;
+
+        if (elapsed < best) {
+            best = elapsed;
+        }
+        failed += ring.buffer->failed;
+    }
+
+    std::printf("%-24s %8.1f %s/sample%s\n", name,
+                static_cast<double>(best) / samples.size(), UNIT,
+                failed ? " (ring full, increase ring size)" : "");
+}
+
+int main() {
+    auto samples = createSamples();
+
+    run("callback + push", samples,
+        [](Ring &ring, const struct iotrace_event_io_fs &ev) {
+            struct iotrace_event io;
+            struct iotrace_event_fs_meta meta;
+
+            expandIo(ev, io);
+            ring.pushTrace(&io, sizeof(io));
+            expandMeta(ev, meta);
+            ring.pushTrace(&meta, sizeof(meta));
+        });
+
+    run("reservation per event", samples,
+        [](Ring &ring, const struct iotrace_event_io_fs &ev) {
+            reserveEvent<struct iotrace_event>(
+                    ring, [&ev](struct iotrace_event &io) {
+                        expandIo(ev, io);
+                    });
+            reserveEvent<struct iotrace_event_fs_meta>(
+                    ring, [&ev](struct iotrace_event_fs_meta &meta) {
+                        expandMeta(ev, meta);
+                    });
+        });
+
+    run("batched sample", samples,
+        [](Ring &ring, const struct iotrace_event_io_fs &ev) {
+            ring.buffer->push(&ev.io.hdr);
+            ring.buffer->flush();
+        });
+
+    return 0;
+}
@@ -12,6 +12,8 @@
 #include "iotrace.bpf.config.h"
 #include "iotrace.bpf.defs.h"
 #include "iotrace_event.h"
+#include "iotrace_event_compact.h"
+#include "iotrace_event_ext.h"
 
 char LICENSE[] SEC("license") = "Dual BSD/GPL";
 
@@ -32,9 +34,157 @@ struct {
     __type(value, struct iotrace_inode_info);
 } inode_storage_map SEC(".maps");
 
+/*
+ * Traced devices, updated by userspace while tracing, so devices can be added
+ * and removed at runtime. eBPF programs only read it.
+ */
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, IOTRACE_DEVICE_MAX);
+    __type(key, uint64_t);
+    __type(value, struct iotrace_device_info);
+} device_map SEC(".maps");
+
+/*
+ * Number of IOs in flight of devices in slow IO mode, keyed by device id.
+ * Only eBPF programs update it, so updates of traced devices by userspace do
+ * not lose counted IOs.
+ */
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, IOTRACE_DEVICE_MAX);
+    __type(key, uint64_t);
+    __type(value, uint32_t);
+} device_inflight_map SEC(".maps");
+
 uint64_t ref_sid = 0;
-uint64_t device[32] = {0};
 uint64_t timebase; /* TODO(mbarczak) Make this per-cpu variable */
+/* Last ID of file paths emitted in the session */
+uint64_t path_id = 0;
+
+/*
+ * Captured features, set by userspace before loading. The verifier removes
+ * branches of features which are not captured.
+ */
+/* File system metadata and page flags (direct, metadata, readahead) of IOs */
+const volatile bool capture_fs = true;
+/* Names of opened files */
+const volatile bool capture_file_names = true;
+/* Full paths of opened files, resolved once per file */
+const volatile bool capture_file_paths = false;
+
+/*
+ * In slow IO mode IO events are not emitted at submission. They are kept in
+ * this map until completion and emitted only if the latency exceeds the
+ * threshold of the device.
+ *
+ * The map is not LRU, entries are not evicted behind the back of the count of
+ * IOs in flight of the device. Entries of IOs whose completion was lost are
+ * replaced when their bio is reused.
+ */
+struct iotrace_inflight_io {
+    struct iotrace_event io;
+    struct iotrace_event_fs_meta fs_meta;
+    uint32_t qd;
+    bool has_fs_meta;
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 65536);
+    __type(key, uint64_t);
+    __type(value, struct iotrace_inflight_io);
+} inflight_map SEC(".maps");
+
+/* Per CPU buffer of the request completion event, too big for the stack */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, uint32_t);
+    __type(value, struct iotrace_event_io_cmpl_rq);
+} cmpl_rq_buffer SEC(".maps");
+
+/* Per CPU buffer of the request hardware queue event, too big for the stack */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, uint32_t);
+    __type(value, struct iotrace_event_rq_hw_queue);
+} rq_hw_queue_buffer SEC(".maps");
+
+/*
+ * Names of threads and cgroups already emitted in the session, keyed by type
+ * of the name event and ID. The value is the name of the thread, so renamed
+ * threads are emitted again.
+ */
+struct iotrace_name_key {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t id;
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 16384);
+    __type(key, struct iotrace_name_key);
+    __type(value, char[IOTRACE_EVENT_COMM_SIZE]);
+} name_cache_map SEC(".maps");
+
+/* Per CPU buffer of the cgroup name event, too big for the stack */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, uint32_t);
+    __type(value, struct iotrace_event_cgroup_name);
+} cgroup_name_buffer SEC(".maps");
+
+/* IDs of file paths emitted in the session, keyed by hash of the path */
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 16384);
+    __type(key, uint64_t);
+    __type(value, uint64_t);
+} path_cache_map SEC(".maps");
+
+/* Per CPU buffer of the file path event, too big for the stack */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, uint32_t);
+    __type(value, struct iotrace_event_fs_path);
+} path_buffer SEC(".maps");
+
+/* Maximum depth of cgroups whose names are emitted */
+#define IOTRACE_CGROUP_DEPTH_MAX 8
+
+/* NUMA node of each CPU, missing if the kernel does not keep it per CPU */
+extern const int numa_node __ksym __weak;
+
+/* Time of inserting requests into the IO scheduler, keyed by request ID */
+struct {
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, 65536);
+    __type(key, uint64_t);
+    __type(value, uint64_t);
+} rq_insert_map SEC(".maps");
+
+/* Per CPU buffer of the request dispatch event, too big for the stack */
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, uint32_t);
+    __type(value, struct iotrace_event_rq_issue);
+} rq_issue_buffer SEC(".maps");
+
+/*
+ * Events of a slow IO emitted in one perf sample, userspace splits the
+ * sample into events. The file system metadata is optional, so it is last.
+ */
+struct iotrace_slow_io_sample {
+    struct iotrace_event io;
+    struct iotrace_event_io_ctx io_ctx;
+    struct iotrace_event_fs_meta fs_meta;
+};
 
 struct inode_cache_map_key {
     uint64_t ino;
@@ -49,6 +199,27 @@ struct {
     __type(value, char);
 } inode_cache_map SEC(".maps");
 
+/*
+ * File unlinked, renamed or truncated by a thread, kept from entry to exit of
+ * the file operation. File IDs change with the inode change time, so they are
+ * taken before the operation.
+ */
+struct iotrace_fs_op {
+    struct iotrace_event_fs_file_event file;
+    struct inode_cache_map_key key;
+    /* File replaced or exchanged by rename */
+    struct iotrace_event_fs_file_event target;
+    struct inode_cache_map_key target_key;
+    bool has_target;
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 4096);
+    __type(key, uint64_t);
+    __type(value, struct iotrace_fs_op);
+} fs_op_map SEC(".maps");
+
 static __always_inline void iotrace_inode_init_key(
         struct inode *inode,
         struct inode_cache_map_key *key) {
@@ -85,23 +256,39 @@ static __always_inline uint64_t iotrace_ktime_get_ns(void) {
     return bpf_ktime_get_ns() - timebase;
 }
 
-static __always_inline bool iotrace_dev_to_trace(const dev_t dev) {
-    uint64_t i;
+static __always_inline struct iotrace_device_info *iotrace_dev_info(
+        const dev_t dev) {
+    uint64_t key = dev;
 
-    for (i = 0; i < sizeof(device) / sizeof(device[0]); i++) {
-        if (dev == device[i]) {
-            return true;
-        } else if (0 == device[i]) {
-            break;
-        }
+    return bpf_map_lookup_elem(&device_map, &key);
+}
+
+/* Returns traced device info if a new IO of the device shall be traced */
+static __always_inline struct iotrace_device_info *iotrace_dev_submit_info(
+        const dev_t dev) {
+    struct iotrace_device_info *info = iotrace_dev_info(dev);
+
+    if (!info || (info->flags & IOTRACE_DEVICE_FLAG_REMOVED)) {
+        return NULL;
     }
-    return false;
+
+    return info;
+}
+
+static __always_inline bool iotrace_dev_slow_io(
+        const struct iotrace_device_info *info) {
+    return 0 != info->slow_ns;
 }
 
 static __always_inline uint64_t iotrace_event_get_seq_id(void) {
     return __sync_add_and_fetch(&ref_sid, 1);
 }
 
+/* Reserves consecutive sequence IDs and returns the first one */
+static __always_inline uint64_t iotrace_event_get_seq_ids(uint64_t count) {
+    return __sync_add_and_fetch(&ref_sid, count) - count + 1;
+}
+
 static __always_inline dev_t iotrace_bio_to_dev_id(const struct bio *bio) {
     struct block_device *bdev = BPF_CORE_READ(bio, bi_bdev);
     struct gendisk *disk = BPF_CORE_READ(bdev, bd_disk);
@@ -173,28 +360,174 @@ static __always_inline void iotrace_bio_get_fs_link(
     // TODO(mbarczak) Try to use flag REQ_META to map this to metadata IO
 }
 
-static __always_inline void iotrace_bio_trace_inode(void *ctx,
-                                                    struct inode *inode,
-                                                    struct page *page,
-                                                    uint64_t ref_id) {
-    struct iotrace_event_fs_meta ev;
-    iotrace_event_init_hdr(&ev.hdr, iotrace_event_type_fs_meta,
+/*
+ * Fills file system fields of the IO, which iotrace_event_fs_meta and the
+ * compact iotrace_event_io_fs have in common
+ */
+static __always_inline void iotrace_bio_set_fs_fields(
+        struct iotrace_event_file_id *file_id,
+        uint64_t *file_offset,
+        uint64_t *file_size,
+        uint64_t *partition_id,
+        struct inode *inode,
+        struct page *page) {
+    struct timespec64 cTime;
+
+    file_id->id = iotrace_inode_no(inode);
+    iotrace_inode_ctime(inode, &cTime);
+    file_id->ctime.tv_nsec = cTime.tv_nsec;
+    file_id->ctime.tv_sec = cTime.tv_sec;
+
+    *file_offset = iotrace_page_index(page) << (PAGE_SHIFT - SECTOR_SHIFT);
+    *file_size = iotrace_inode_size(inode) >> SECTOR_SHIFT;
+    *partition_id = iotrace_inode_dev(inode);
+}
+
+static __always_inline void iotrace_bio_set_fs_meta(
+        struct iotrace_event_fs_meta *ev,
+        struct inode *inode,
+        struct page *page,
+        uint64_t ref_id) {
+    iotrace_event_init_hdr(&ev->hdr, iotrace_event_type_fs_meta,
                            iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
-                           sizeof(ev));
+                           sizeof(*ev));
 
-    ev.ref_id = ref_id;
-    ev.file_id.id = iotrace_inode_no(inode);
+    ev->ref_id = ref_id;
+    iotrace_bio_set_fs_fields(&ev->file_id, &ev->file_offset, &ev->file_size,
+                              &ev->partition_id, inode, page);
+}
 
-    struct timespec64 cTime;
-    iotrace_inode_ctime(inode, &cTime);
-    ev.file_id.ctime.tv_nsec = cTime.tv_nsec;
-    ev.file_id.ctime.tv_sec = cTime.tv_sec;
+/*
+ * Emits the IO together with its file system metadata as one compact event,
+ * its sequence ID has to be reserved for two events
+ */
+static __always_inline void iotrace_bio_trace_io_fs(
+        void *ctx,
+        struct iotrace_event_io_fs *ev,
+        struct inode *inode,
+        struct page *page) {
+    ev->io.hdr.type = iotrace_event_type_io_fs;
+    ev->io.hdr.size = sizeof(*ev);
 
-    ev.file_offset = iotrace_page_index(page) << (PAGE_SHIFT - SECTOR_SHIFT);
-    ev.file_size = iotrace_inode_size(inode) >> SECTOR_SHIFT;
-    ev.partition_id = iotrace_inode_dev(inode);
+    iotrace_bio_set_fs_fields(&ev->file_id, &ev->file_offset, &ev->file_size,
+                              &ev->partition_id, inode, page);
 
-    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &ev, sizeof(ev));
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, ev, sizeof(*ev));
+}
+
+static __always_inline uint32_t *iotrace_dev_inflight(const dev_t dev) {
+    uint64_t key = dev;
+    uint32_t zero = 0;
+    uint32_t *count;
+
+    count = bpf_map_lookup_elem(&device_inflight_map, &key);
+    if (!count) {
+        bpf_map_update_elem(&device_inflight_map, &key, &zero, BPF_NOEXIST);
+        count = bpf_map_lookup_elem(&device_inflight_map, &key);
+    }
+
+    return count;
+}
+
+static __always_inline void iotrace_dev_inflight_dec(const dev_t dev) {
+    uint64_t key = dev;
+    uint32_t *count = bpf_map_lookup_elem(&device_inflight_map, &key);
+
+    if (count) {
+        __sync_fetch_and_sub(count, 1);
+    }
+}
+
+/*
+ * Queue depth of the IO in the in-flight map is zero if the IO is not counted
+ * in IOs in flight of its device
+ */
+static __always_inline void iotrace_slow_io_submit(
+        struct iotrace_event *ev,
+        struct inode *inode,
+        struct page *page) {
+    struct iotrace_inflight_io inflight = {0};
+    struct iotrace_inflight_io *stale;
+    uint32_t *count;
+
+    inflight.io = *ev;
+    if (inode) {
+        iotrace_bio_set_fs_meta(&inflight.fs_meta, inode, page, ev->id);
+        inflight.has_fs_meta = true;
+    }
+
+    stale = bpf_map_lookup_elem(&inflight_map, &ev->id);
+    if (stale && stale->qd) {
+        /*
+         * The bio is reused and completion of its previous IO was lost, the
+         * IO leaves the count of its device
+         */
+        iotrace_dev_inflight_dec(stale->io.dev_id);
+    }
+
+    count = iotrace_dev_inflight(ev->dev_id);
+    if (count) {
+        inflight.qd = __sync_add_and_fetch(count, 1);
+    }
+
+    if (bpf_map_update_elem(&inflight_map, &ev->id, &inflight, BPF_ANY) &&
+        count) {
+        /* Map full, the IO is not tracked */
+        __sync_fetch_and_sub(count, 1);
+    }
+}
+
+/*
+ * Returns true if the completion shall be emitted, that is the IO exceeded the
+ * slow IO threshold and its submission events have just been emitted.
+ */
+static __always_inline bool iotrace_slow_io_complete(
+        void *ctx,
+        struct iotrace_event_completion *cmpl,
+        const struct iotrace_device_info *info) {
+    struct iotrace_inflight_io *inflight;
+    bool slow = false;
+
+    inflight = bpf_map_lookup_elem(&inflight_map, &cmpl->ref_id);
+    if (!inflight) {
+        /* Submitted before tracing started or not tracked */
+        return false;
+    }
+
+    if (inflight->qd) {
+        iotrace_dev_inflight_dec(inflight->io.dev_id);
+    }
+
+    if (cmpl->hdr.timestamp - inflight->io.hdr.timestamp >= info->slow_ns) {
+        struct iotrace_slow_io_sample sample = {0};
+        struct iotrace_event_io_ctx *ev = &sample.io_ctx;
+
+        sample.io = inflight->io;
+
+        iotrace_event_init_hdr(&ev->hdr, iotrace_event_type_io_ctx,
+                               iotrace_event_get_seq_id(),
+                               inflight->io.hdr.timestamp, sizeof(*ev));
+        ev->ref_sid = inflight->io.hdr.sid;
+        ev->ref_id = inflight->io.id;
+        ev->dev_id = inflight->io.dev_id;
+        ev->qd = inflight->qd;
+
+        if (inflight->has_fs_meta) {
+            sample.fs_meta = inflight->fs_meta;
+            bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &sample,
+                                  sizeof(sample));
+        } else {
+            bpf_perf_event_output(
+                    ctx, &events, BPF_F_CURRENT_CPU, &sample,
+                    offsetof(struct iotrace_slow_io_sample, fs_meta));
+        }
+
+        slow = true;
+    }
+
+    bpf_map_delete_elem(&inflight_map, &cmpl->ref_id);
+
+    return slow;
 }
 
 static __always_inline void iotrace_bio_set_event(struct iotrace_event *ev,
@@ -223,50 +556,280 @@ static __always_inline void iotrace_bio_set_event(struct iotrace_event *ev,
     ev->write_hint = iotrace_bio_write_hint(bio);
 }
 
+static __always_inline void iotrace_process_name(void *ctx,
+                                                 uint64_t pid_tgid) {
+    struct iotrace_event_process_name ev = {0};
+    struct iotrace_name_key key = {0};
+    char *comm;
+
+    bpf_get_current_comm(ev.comm, sizeof(ev.comm));
+
+    key.type = iotrace_event_type_process_name;
+    key.id = (uint32_t) pid_tgid;
+    comm = bpf_map_lookup_elem(&name_cache_map, &key);
+    if (comm && !__builtin_memcmp(comm, ev.comm, sizeof(ev.comm))) {
+        return;
+    }
+    bpf_map_update_elem(&name_cache_map, &key, ev.comm, BPF_ANY);
+
+    iotrace_event_init_hdr(&ev.hdr, iotrace_event_type_process_name,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           sizeof(ev));
+    ev.pid = (uint32_t) pid_tgid;
+    ev.tgid = pid_tgid >> 32;
+
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &ev, sizeof(ev));
+}
+
+/*
+ * Emits names of the cgroup and its ancestors, up to the first one already
+ * emitted in the session
+ */
+static __always_inline void iotrace_cgroup_name(void *ctx,
+                                                struct cgroup *cgrp) {
+    char comm[IOTRACE_EVENT_COMM_SIZE] = {0};
+    struct iotrace_event_cgroup_name *ev;
+    struct cgroup_subsys_state *parent;
+    struct iotrace_name_key key = {0};
+    uint32_t index = 0;
+    uint32_t i;
+
+    ev = bpf_map_lookup_elem(&cgroup_name_buffer, &index);
+    if (!ev) {
+        return;
+    }
+
+    key.type = iotrace_event_type_cgroup_name;
+    for (i = 0; i < IOTRACE_CGROUP_DEPTH_MAX; i++) {
+        if (!cgrp) {
+            break;
+        }
+
+        key.id = BPF_CORE_READ(cgrp, kn, id);
+        if (bpf_map_lookup_elem(&name_cache_map, &key)) {
+            break;
+        }
+        bpf_map_update_elem(&name_cache_map, &key, comm, BPF_ANY);
+
+        iotrace_event_init_hdr(&ev->hdr, iotrace_event_type_cgroup_name,
+                               iotrace_event_get_seq_id(),
+                               iotrace_ktime_get_ns(), sizeof(*ev));
+        ev->cgroup_id = key.id;
+        bpf_probe_read_kernel_str(ev->name, sizeof(ev->name),
+                                  BPF_CORE_READ(cgrp, kn, name));
+
+        parent = BPF_CORE_READ(cgrp, self.parent);
+        cgrp = parent ? BPF_CORE_READ(parent, cgroup) : NULL;
+        ev->parent_id = cgrp ? BPF_CORE_READ(cgrp, kn, id) : 0;
+
+        bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, ev,
+                              sizeof(*ev));
+    }
+}
+
+/*
+ * Emits the process and cgroup submitting the IO, after names of the thread
+ * and the cgroup if they are new in the session
+ */
+static __always_inline void iotrace_bio_process(
+        void *ctx,
+        struct bio *bio,
+        const struct iotrace_event *io) {
+    struct iotrace_event_io_process ev = {0};
+    uint64_t pid_tgid = bpf_get_current_pid_tgid();
+    struct cgroup *cgrp = NULL;
+
+    /* The cgroup IO is charged to, the submitting thread may be a flusher */
+    if (bpf_core_field_exists(bio->bi_blkg)) {
+        cgrp = BPF_CORE_READ(bio, bi_blkg, blkcg, css.cgroup);
+    }
+    if (!cgrp) {
+        struct task_struct *task = bpf_get_current_task_btf();
+        cgrp = BPF_CORE_READ(task, cgroups, dfl_cgrp);
+    }
+
+    iotrace_process_name(ctx, pid_tgid);
+    iotrace_cgroup_name(ctx, cgrp);
+
+    iotrace_event_init_hdr(&ev.hdr, iotrace_event_type_io_process,
+                           iotrace_event_get_seq_id(), io->hdr.timestamp,
+                           sizeof(ev));
+    ev.ref_sid = io->hdr.sid;
+    ev.ref_id = io->id;
+    ev.dev_id = io->dev_id;
+    ev.cgroup_id = cgrp ? BPF_CORE_READ(cgrp, kn, id) : 0;
+    ev.pid = (uint32_t) pid_tgid;
+    ev.tgid = pid_tgid >> 32;
+
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &ev, sizeof(ev));
+}
+
 SEC("tp_btf/block_bio_queue")
 int BPF_PROG(block_bio_queue, struct bio *bio) {
-    struct iotrace_event event = {0};
+    struct iotrace_event_io_fs io_fs = {0};
+    struct iotrace_event *event = &io_fs.io;
     struct iotrace_bio_fs_link link = {0};
+    uint64_t sid;
 
     dev_t dev = iotrace_bio_to_dev_id(bio);
+    struct iotrace_device_info *info = iotrace_dev_submit_info(dev);
 
-    if (!iotrace_dev_to_trace(dev)) {
+    if (!info) {
         return 0;
     }
 
-    if (iotrace_bio_has_data(bio)) {
+    if (capture_fs && iotrace_bio_has_data(bio)) {
         iotrace_bio_get_fs_link(bio, &link);
     }
 
-    iotrace_event_init_hdr(&event.hdr, iotrace_event_type_io,
-                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
-                           sizeof(event));
+    if (link.inode && !iotrace_dev_slow_io(info)) {
+        /* The IO and its fs_meta are emitted as one compact event */
+        sid = iotrace_event_get_seq_ids(2);
+    } else {
+        sid = iotrace_event_get_seq_id();
+    }
+
+    iotrace_event_init_hdr(&event->hdr, iotrace_event_type_io, sid,
+                           iotrace_ktime_get_ns(), sizeof(*event));
     if (link.direct) {
-        event.flags |= iotrace_event_flag_direct;
+        event->flags |= iotrace_event_flag_direct;
     }
     if (link.metadata) {
-        event.flags |= iotrace_event_flag_metadata;
+        event->flags |= iotrace_event_flag_metadata;
     }
     if (link.readahead) {
-        event.flags |= iotrace_event_flag_readahead;
+        event->flags |= iotrace_event_flag_readahead;
     }
-    iotrace_bio_set_event(&event, bio, dev);
+    iotrace_bio_set_event(event, bio, dev);
 
-    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &event,
-                          sizeof(event));
+    if (iotrace_dev_slow_io(info)) {
+        iotrace_slow_io_submit(event, link.inode, link.page);
+        return 0;
+    }
 
     if (link.inode) {
-        iotrace_bio_trace_inode(ctx, link.inode, link.page, event.id);
+        iotrace_bio_trace_io_fs(ctx, &io_fs, link.inode, link.page);
+    } else {
+        bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, event,
+                              sizeof(*event));
+    }
+
+    if (info->flags & IOTRACE_DEVICE_FLAG_PROCESS) {
+        iotrace_bio_process(ctx, bio, event);
     }
 
     return 0;
 }
 
+static __always_inline bool iotrace_dev_bio_events(
+        const struct iotrace_device_info *info) {
+    return info && (info->flags & IOTRACE_DEVICE_FLAG_BIO_EVENTS);
+}
+
+SEC("tp_btf/block_split")
+int BPF_PROG(block_split, struct bio *bio, unsigned int new_sector) {
+    struct iotrace_event_bio_split ev = {0};
+    dev_t dev = iotrace_bio_to_dev_id(bio);
+
+    if (!iotrace_dev_bio_events(iotrace_dev_submit_info(dev))) {
+        return 0;
+    }
+
+    iotrace_event_init_hdr(&ev.hdr, iotrace_event_type_bio_split,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           sizeof(ev));
+
+    ev.ref_id = iotrace_bio_to_id(bio);
+    /* The split off bio is chained to its parent */
+    ev.parent_id = (uint64_t) BPF_CORE_READ(bio, bi_private);
+    ev.dev_id = dev;
+    ev.lba = BPF_CORE_READ(bio, bi_iter.bi_sector);
+    ev.len = BPF_CORE_READ(bio, bi_iter.bi_size) >> 9;
+    ev.parent_lba = new_sector;
+
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &ev, sizeof(ev));
+    return 0;
+}
+
+static __always_inline void iotrace_bio_merge(void *ctx,
+                                              struct bio *bio,
+                                              uint32_t front) {
+    struct iotrace_event_bio_merge ev = {0};
+    dev_t dev = iotrace_bio_to_dev_id(bio);
+
+    if (!iotrace_dev_bio_events(iotrace_dev_submit_info(dev))) {
+        return;
+    }
+
+    iotrace_event_init_hdr(&ev.hdr, iotrace_event_type_bio_merge,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           sizeof(ev));
+
+    ev.ref_id = iotrace_bio_to_id(bio);
+    ev.dev_id = dev;
+    ev.lba = BPF_CORE_READ(bio, bi_iter.bi_sector);
+    ev.len = BPF_CORE_READ(bio, bi_iter.bi_size) >> 9;
+    ev.front = front;
+
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &ev, sizeof(ev));
+}
+
+SEC("tp_btf/block_bio_backmerge")
+int BPF_PROG(block_bio_backmerge, struct bio *bio) {
+    iotrace_bio_merge(ctx, bio, 0);
+    return 0;
+}
+
+SEC("tp_btf/block_bio_frontmerge")
+int BPF_PROG(block_bio_frontmerge, struct bio *bio) {
+    iotrace_bio_merge(ctx, bio, 1);
+    return 0;
+}
+
+SEC("tp_btf/block_bio_remap")
+int BPF_PROG(block_bio_remap, struct bio *bio, dev_t from_dev, sector_t from) {
+    struct iotrace_event_bio_remap ev = {0};
+    dev_t dev = iotrace_bio_to_dev_id(bio);
+    dev_t from_disk = from_dev;
+    dev_t from_part = 0;
+
+    /*
+     * A partition remaps the IO itself, which stays on the partition, while
+     * devices are traced by their whole disks
+     */
+    if (from_dev != dev && BPF_CORE_READ(bio, bi_bdev, bd_dev) == from_dev) {
+        from_disk = dev;
+        from_part = from_dev;
+    }
+
+    /* Either the lower or the upper device is traced */
+    if (!iotrace_dev_bio_events(iotrace_dev_submit_info(dev)) &&
+        !iotrace_dev_bio_events(iotrace_dev_submit_info(from_disk))) {
+        return 0;
+    }
+
+    iotrace_event_init_hdr(&ev.hdr, iotrace_event_type_bio_remap,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           sizeof(ev));
+
+    ev.ref_id = iotrace_bio_to_id(bio);
+    ev.dev_id = dev;
+    ev.lba = BPF_CORE_READ(bio, bi_iter.bi_sector);
+    ev.len = BPF_CORE_READ(bio, bi_iter.bi_size) >> 9;
+    ev.from_dev_id = from_disk;
+    ev.from_partition_id = from_part;
+    ev.from_lba = from;
+
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &ev, sizeof(ev));
+    return 0;
+}
+
 static __always_inline void iotrace_bio_complete(void *ctx, struct bio *bio) {
     struct iotrace_event_completion cmpl = {0};
     dev_t dev = iotrace_bio_to_dev_id(bio);
+    struct iotrace_device_info *info = iotrace_dev_info(dev);
 
-    if (!iotrace_dev_to_trace(dev)) {
+    if (!info) {
         return;
     }
 
@@ -280,6 +843,11 @@ static __always_inline void iotrace_bio_complete(void *ctx, struct bio *bio) {
     cmpl.error = iotrace_bio_error(bio);
     cmpl.dev_id = dev;
 
+    if (iotrace_dev_slow_io(info) &&
+        !iotrace_slow_io_complete(ctx, &cmpl, info)) {
+        return;
+    }
+
     bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &cmpl, sizeof(cmpl));
 }
 
@@ -321,8 +889,9 @@ void static __always_inline iotrace_rq_queue(void *ctx, struct request *rq) {
 
     struct iotrace_event event = {0};
     dev_t dev = iotrace_rq_to_dev_id(rq);
+    struct iotrace_device_info *info = iotrace_dev_submit_info(dev);
 
-    if (!iotrace_dev_to_trace(dev)) {
+    if (!info) {
         return;
     }
 
@@ -334,13 +903,103 @@ void static __always_inline iotrace_rq_queue(void *ctx, struct request *rq) {
         return;
     }
 
+    if (iotrace_dev_slow_io(info)) {
+        iotrace_slow_io_submit(&event, NULL, NULL);
+        return;
+    }
+
     bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &event,
                           sizeof(event));
 }
 
+static __always_inline bool iotrace_dev_rq_time(
+        const struct iotrace_device_info *info) {
+    return info->flags & IOTRACE_DEVICE_FLAG_RQ_TIME;
+}
+
+SEC("tp_btf/block_rq_insert")
+int BPF_PROG(block_rq_insert, struct request *rq) {
+    struct iotrace_device_info *info;
+    uint64_t key, timestamp;
+
+    if (!BPF_CORE_READ(rq, bio)) {
+        return 0;
+    }
+
+    info = iotrace_dev_submit_info(iotrace_rq_to_dev_id(rq));
+    if (!info || !iotrace_dev_rq_time(info)) {
+        return 0;
+    }
+
+    key = iotrace_rq_to_id(rq);
+    timestamp = iotrace_ktime_get_ns();
+    bpf_map_update_elem(&rq_insert_map, &key, &timestamp, BPF_ANY);
+
+    return 0;
+}
+
+/*
+ * Emits dispatch of a request to the device with IDs of its IOs, so the
+ * latency of each IO can be split into queue and device time
+ */
+static __always_inline void iotrace_rq_issue(void *ctx, struct request *rq) {
+    struct bio *bio = BPF_CORE_READ(rq, bio);
+    struct iotrace_event_rq_issue *ev;
+    struct iotrace_device_info *info;
+    uint64_t *insert_timestamp;
+    uint32_t key = 0;
+    uint64_t size;
+    uint32_t i;
+
+    dev_t dev = iotrace_rq_to_dev_id(rq);
+    info = iotrace_dev_submit_info(dev);
+    if (!info || !iotrace_dev_rq_time(info)) {
+        return;
+    }
+
+    ev = bpf_map_lookup_elem(&rq_issue_buffer, &key);
+    if (!ev) {
+        return;
+    }
+
+    for (i = 0; i < IOTRACE_EVENT_RQ_IO_MAX; i++) {
+        if (!bio) {
+            break;
+        }
+
+        ev->ref_ids[i] = iotrace_bio_to_id(bio);
+        bio = BPF_CORE_READ(bio, bi_next);
+    }
+
+    ev->dev_id = dev;
+    ev->rq_id = iotrace_rq_to_id(rq);
+    ev->count = i;
+    ev->insert_timestamp = 0;
+
+    insert_timestamp = bpf_map_lookup_elem(&rq_insert_map, &ev->rq_id);
+    if (insert_timestamp) {
+        ev->insert_timestamp = *insert_timestamp;
+        bpf_map_delete_elem(&rq_insert_map, &ev->rq_id);
+    }
+
+    /* Bounded by the loop, the verifier accepts the size */
+    size = offsetof(struct iotrace_event_rq_issue, ref_ids) +
+           i * sizeof(ev->ref_ids[0]);
+
+    iotrace_event_init_hdr(&ev->hdr, iotrace_event_type_rq_issue,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           size);
+
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, ev, size);
+}
+
 SEC("tp_btf/block_rq_issue")
 int BPF_PROG(block_rq_issue, struct request *rq) {
-    iotrace_rq_queue(ctx, rq);
+    if (BPF_CORE_READ(rq, bio)) {
+        iotrace_rq_issue(ctx, rq);
+    } else {
+        iotrace_rq_queue(ctx, rq);
+    }
     return 0;
 }
 
@@ -349,8 +1008,9 @@ void static __always_inline iotrace_rq_complete(void *ctx,
                                                 int error) {
     struct iotrace_event_completion cmpl = {0};
     dev_t dev = iotrace_rq_to_dev_id(rq);
+    struct iotrace_device_info *info = iotrace_dev_info(dev);
 
-    if (!iotrace_dev_to_trace(dev)) {
+    if (!info) {
         return;
     }
 
@@ -367,31 +1027,146 @@ void static __always_inline iotrace_rq_complete(void *ctx,
     cmpl.error = error;
     cmpl.dev_id = dev;
 
+    if (iotrace_dev_slow_io(info) &&
+        !iotrace_slow_io_complete(ctx, &cmpl, info)) {
+        return;
+    }
+
     bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &cmpl, sizeof(cmpl));
 }
 
+static __always_inline int32_t iotrace_cpu_node(uint32_t cpu) {
+    const int *node;
+
+    /* Weak symbol, zero if the kernel does not have it */
+    if (!&numa_node) {
+        return -1;
+    }
+
+    node = bpf_per_cpu_ptr(&numa_node, cpu);
+    return node ? *node : -1;
+}
+
+/*
+ * Emits the hardware queue which served a request, and CPUs it was submitted
+ * and completed on, with IDs of its IOs
+ */
+static __always_inline void iotrace_rq_hw_queue(
+        void *ctx,
+        struct request *rq,
+        const struct iotrace_device_info *info) {
+    struct bio *bio = BPF_CORE_READ(rq, bio);
+    struct iotrace_event_rq_hw_queue *ev;
+    uint32_t key = 0;
+    uint64_t size;
+    uint32_t i;
+
+    if (!(info->flags & IOTRACE_DEVICE_FLAG_HW_QUEUE)) {
+        return;
+    }
+
+    ev = bpf_map_lookup_elem(&rq_hw_queue_buffer, &key);
+    if (!ev) {
+        return;
+    }
+
+    for (i = 0; i < IOTRACE_EVENT_RQ_IO_MAX; i++) {
+        if (!bio) {
+            break;
+        }
+
+        ev->ref_ids[i] = iotrace_bio_to_id(bio);
+        bio = BPF_CORE_READ(bio, bi_next);
+    }
+
+    ev->dev_id = iotrace_rq_to_dev_id(rq);
+    ev->hw_queue = BPF_CORE_READ(rq, mq_hctx, queue_num);
+    ev->count = i;
+    ev->submit_cpu = BPF_CORE_READ(rq, mq_ctx, cpu);
+    ev->complete_cpu = bpf_get_smp_processor_id();
+    ev->submit_node = iotrace_cpu_node(ev->submit_cpu);
+    ev->complete_node = bpf_get_numa_node_id();
+
+    /* Bounded by the loop, the verifier accepts the size */
+    size = offsetof(struct iotrace_event_rq_hw_queue, ref_ids) +
+           i * sizeof(ev->ref_ids[0]);
+
+    /* Sequence ID precedes completions of the IOs */
+    iotrace_event_init_hdr(&ev->hdr, iotrace_event_type_rq_hw_queue,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           size);
+
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, ev, size);
+}
+
 SEC("tp_btf/block_rq_complete")
 int BPF_PROG(block_rq_complete,
              struct request *rq,
              int error,
              unsigned int nr_bytes) {
     struct bio *bio = BPF_CORE_READ(rq, bio);
+    struct iotrace_event_io_cmpl_rq *ev;
+    struct iotrace_device_info *info;
+    uint32_t key = 0;
+    uint64_t size;
     uint32_t i;
+    dev_t dev;
 
     if (NULL == bio) {
         iotrace_rq_complete(ctx, rq, error);
         return 0;
     }
 
-    for (i = 0; i < 64; i++) {
-        if (bio) {
-            iotrace_bio_complete(ctx, bio);
-            bio = BPF_CORE_READ(bio, bi_next);
-        } else {
+    dev = iotrace_bio_to_dev_id(bio);
+    info = iotrace_dev_info(dev);
+    if (!info) {
+        return 0;
+    }
+
+    iotrace_rq_hw_queue(ctx, rq, info);
+
+    ev = bpf_map_lookup_elem(&cmpl_rq_buffer, &key);
+    if (!ev || iotrace_dev_slow_io(info) || !BPF_CORE_READ(bio, bi_next)) {
+        /*
+         * A single bio, or each bio is checked against the slow IO threshold
+         */
+        for (i = 0; i < IOTRACE_EVENT_CMPL_RQ_MAX; i++) {
+            if (bio) {
+                iotrace_bio_complete(ctx, bio);
+                bio = BPF_CORE_READ(bio, bi_next);
+            } else {
+                break;
+            }
+        }
+
+        return 0;
+    }
+
+    /* Completions of all bios of the request go in one compact event */
+    for (i = 0; i < IOTRACE_EVENT_CMPL_RQ_MAX; i++) {
+        if (!bio) {
             break;
         }
+
+        ev->bios[i].ref_id = iotrace_bio_to_id(bio);
+        ev->bios[i].lba = BPF_CORE_READ(bio, bi_iter.bi_sector);
+        ev->bios[i].len = BPF_CORE_READ(bio, bi_iter.bi_size) >> 9;
+        ev->bios[i].error = iotrace_bio_error(bio);
+        bio = BPF_CORE_READ(bio, bi_next);
     }
 
+    /* Bounded by the loop, the verifier accepts the size */
+    size = offsetof(struct iotrace_event_io_cmpl_rq, bios) +
+           i * sizeof(struct iotrace_event_io_cmpl_bio);
+
+    ev->dev_id = dev;
+    ev->count = i;
+    iotrace_event_init_hdr(&ev->hdr, iotrace_event_type_io_cmpl_rq,
+                           iotrace_event_get_seq_ids(i),
+                           iotrace_ktime_get_ns(), size);
+
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, ev, size);
+
     return 0;
 }
 
@@ -491,16 +1266,393 @@ static __always_inline void iotrace_inode_loop(void *ctx,
     }
 }
 
+static __always_inline void iotrace_fs_file_id(
+        struct inode *inode,
+        uint64_t *part_id,
+        struct iotrace_event_file_id *file_id) {
+    struct timespec64 cTime;
+
+    *part_id = iotrace_bdev_id(iotrace_inode_bdev(inode));
+    file_id->id = iotrace_inode_no(inode);
+    iotrace_inode_ctime(inode, &cTime);
+    file_id->ctime.tv_nsec = cTime.tv_nsec;
+    file_id->ctime.tv_sec = cTime.tv_sec;
+}
+
+static __always_inline void iotrace_fs_event_init(
+        struct iotrace_event_fs_file_event *ev,
+        struct inode *inode,
+        iotrace_fs_event_type type) {
+    iotrace_fs_file_id(inode, &ev->partition_id, &ev->file_id);
+    ev->fs_event_type = type;
+}
+
+static __always_inline void iotrace_fs_event(void *ctx,
+                                             struct inode *inode,
+                                             iotrace_fs_event_type type) {
+    struct iotrace_event_fs_file_event ev = {};
+
+    if (!inode) {
+        return;
+    }
+
+    iotrace_event_init_hdr(&ev.hdr, iotrace_event_type_fs_file_event,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           sizeof(ev));
+    iotrace_fs_event_init(&ev, inode, type);
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &ev, sizeof(ev));
+}
+
+/*
+ * Files created in the directory are traced if its file system is on any
+ * block device, like names of files in iotrace_inode(), as the file system
+ * can be on a logical device stacked on the traced one
+ */
+static __always_inline bool iotrace_fs_is_traced(struct inode *dir) {
+    return NULL != iotrace_inode_bdev(dir);
+}
+
 SEC("fexit/do_dentry_open")
 int BPF_PROG(post_open,
              struct file *file,
              struct inode *inode,
              int (*open)(struct inode *, struct file *),
              long ret) {
-    if (ret) {
+    if (!capture_file_names || ret) {
         return 0;
     }
 
+    /* Files created by open are not passed to vfs_create() */
+    if (file->f_mode & FMODE_CREATED) {
+        struct dentry *dentry = file->f_path.dentry;
+        struct inode *dir = BPF_CORE_READ(dentry, d_parent, d_inode);
+
+        if (iotrace_fs_is_traced(dir)) {
+            iotrace_fs_event(ctx, file->f_inode, iotrace_fs_event_create);
+        }
+    }
+
     iotrace_inode_loop(ctx, file->f_path.dentry, file->f_inode);
     return 0;
 }
+
+SEC("fexit/vfs_create")
+int BPF_PROG(post_create,
+             void *idmap,
+             struct inode *dir,
+             struct dentry *dentry,
+             umode_t mode,
+             bool want_excl,
+             int ret) {
+    if (!capture_file_names || ret || !iotrace_fs_is_traced(dir)) {
+        return 0;
+    }
+
+    struct inode *inode = BPF_CORE_READ(dentry, d_inode);
+
+    iotrace_fs_event(ctx, inode, iotrace_fs_event_create);
+    iotrace_inode_loop(ctx, dentry, inode);
+    return 0;
+}
+
+/* Keeps the file of the operation, if its name was traced */
+static __always_inline struct iotrace_fs_op *iotrace_fs_op_start(
+        struct inode *inode) {
+    if (!capture_file_names || !inode || !iotrace_inode_is_traced(inode)) {
+        return NULL;
+    }
+
+    uint64_t key = bpf_get_current_pid_tgid();
+    struct iotrace_fs_op op = {};
+
+    if (bpf_map_update_elem(&fs_op_map, &key, &op, BPF_ANY)) {
+        return NULL;
+    }
+
+    struct iotrace_fs_op *result = bpf_map_lookup_elem(&fs_op_map, &key);
+    if (result) {
+        iotrace_inode_init_key(inode, &result->key);
+    }
+
+    return result;
+}
+
+static __always_inline struct iotrace_fs_op *iotrace_fs_op_get(void) {
+    uint64_t key = bpf_get_current_pid_tgid();
+
+    return bpf_map_lookup_elem(&fs_op_map, &key);
+}
+
+static __always_inline void iotrace_fs_op_finish(void) {
+    uint64_t key = bpf_get_current_pid_tgid();
+
+    bpf_map_delete_elem(&fs_op_map, &key);
+}
+
+/* Sends the file event kept at the start of the operation */
+static __always_inline void iotrace_fs_op_event(
+        void *ctx,
+        struct iotrace_event_fs_file_event *ev) {
+    /* Sequence ID and time of completion of the operation */
+    iotrace_event_init_hdr(&ev->hdr, iotrace_event_type_fs_file_event,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           sizeof(*ev));
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, ev, sizeof(*ev));
+}
+
+SEC("fentry/vfs_unlink")
+int BPF_PROG(pre_unlink,
+             void *idmap,
+             struct inode *dir,
+             struct dentry *dentry) {
+    struct inode *inode = BPF_CORE_READ(dentry, d_inode);
+    struct iotrace_fs_op *op = iotrace_fs_op_start(inode);
+
+    if (op) {
+        iotrace_fs_event_init(&op->file, inode, iotrace_fs_event_delete);
+    }
+
+    return 0;
+}
+
+SEC("fexit/vfs_unlink")
+int BPF_PROG(post_unlink,
+             void *idmap,
+             struct inode *dir,
+             struct dentry *dentry,
+             struct inode **delegated,
+             int ret) {
+    struct iotrace_fs_op *op = iotrace_fs_op_get();
+    if (!op) {
+        return 0;
+    }
+
+    if (!ret) {
+        iotrace_fs_op_event(ctx, &op->file);
+        bpf_map_delete_elem(&inode_cache_map, &op->key);
+    }
+
+    iotrace_fs_op_finish();
+    return 0;
+}
+
+SEC("fentry/vfs_rename")
+int BPF_PROG(pre_rename, struct renamedata *rd) {
+    struct inode *inode = BPF_CORE_READ(rd, old_dentry, d_inode);
+    struct inode *target = BPF_CORE_READ(rd, new_dentry, d_inode);
+    struct iotrace_fs_op *op = iotrace_fs_op_start(inode);
+    if (!op) {
+        return 0;
+    }
+
+    iotrace_fs_event_init(&op->file, inode, iotrace_fs_event_move_from);
+
+    /* File replaced by rename, or moved in place of the source */
+    if (target && iotrace_inode_is_traced(target)) {
+        iotrace_fs_event_init(&op->target, target, iotrace_fs_event_move_from);
+        iotrace_inode_init_key(target, &op->target_key);
+        op->has_target = true;
+    }
+
+    return 0;
+}
+
+/*
+ * Sends file events of the moved file and its new name. The inode change time
+ * is updated by rename, so the file is traced again with its new ID.
+ */
+static __always_inline void iotrace_fs_move(
+        void *ctx,
+        struct iotrace_event_fs_file_event *from,
+        struct inode_cache_map_key *key,
+        struct dentry *dentry) {
+    struct inode *inode = BPF_CORE_READ(dentry, d_inode);
+    if (!inode) {
+        return;
+    }
+
+    iotrace_fs_op_event(ctx, from);
+    iotrace_fs_event(ctx, inode, iotrace_fs_event_move_to);
+
+    bpf_map_delete_elem(&inode_cache_map, key);
+    iotrace_inode_set_traced(inode);
+    iotrace_inode(ctx, dentry, inode);
+}
+
+SEC("fexit/vfs_rename")
+int BPF_PROG(post_rename, struct renamedata *rd, int ret) {
+    struct iotrace_fs_op *op = iotrace_fs_op_get();
+    if (!op) {
+        return 0;
+    }
+
+    if (ret) {
+        iotrace_fs_op_finish();
+        return 0;
+    }
+
+    /* Dentries are moved, the old one carries the new name */
+    struct dentry *dentry = BPF_CORE_READ(rd, old_dentry);
+    iotrace_fs_move(ctx, &op->file, &op->key, dentry);
+
+    if (op->has_target) {
+        if (BPF_CORE_READ(rd, flags) & RENAME_EXCHANGE) {
+            dentry = BPF_CORE_READ(rd, new_dentry);
+            iotrace_fs_move(ctx, &op->target, &op->target_key, dentry);
+        } else {
+            op->target.fs_event_type = iotrace_fs_event_delete;
+            iotrace_fs_op_event(ctx, &op->target);
+            bpf_map_delete_elem(&inode_cache_map, &op->target_key);
+        }
+    }
+
+    iotrace_fs_op_finish();
+    return 0;
+}
+
+SEC("fentry/do_truncate")
+int BPF_PROG(pre_truncate, void *idmap, struct dentry *dentry) {
+    iotrace_fs_op_start(BPF_CORE_READ(dentry, d_inode));
+    return 0;
+}
+
+SEC("fexit/do_truncate")
+int BPF_PROG(post_truncate,
+             void *idmap,
+             struct dentry *dentry,
+             loff_t length,
+             unsigned int time_attrs,
+             struct file *filp,
+             int ret) {
+    struct iotrace_fs_op *op = iotrace_fs_op_get();
+    if (!op) {
+        return 0;
+    }
+
+    struct inode *inode = BPF_CORE_READ(dentry, d_inode);
+    if (!ret && inode) {
+        struct iotrace_event_fs_truncate ev = {};
+
+        iotrace_event_init_hdr(&ev.hdr, iotrace_event_type_fs_truncate,
+                               iotrace_event_get_seq_id(),
+                               iotrace_ktime_get_ns(), sizeof(ev));
+        iotrace_fs_file_id(inode, &ev.partition_id, &ev.file_id);
+        ev.file_size = iotrace_inode_size(inode) >> SECTOR_SHIFT;
+        bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &ev,
+                              sizeof(ev));
+
+        /* Truncation changes the file ID, trace the file again with it */
+        bpf_map_delete_elem(&inode_cache_map, &op->key);
+        iotrace_inode_set_traced(inode);
+    }
+
+    iotrace_fs_op_finish();
+    return 0;
+}
+
+/* FNV-1a hash of the path, identifies paths emitted in the session */
+static __always_inline uint64_t iotrace_path_hash(const char *path,
+                                                  uint32_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (uint32_t i = 0; i < IOTRACE_EVENT_FS_PATH_SIZE; i++) {
+        if (i >= len) {
+            break;
+        }
+
+        hash ^= (uint8_t) path[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+/*
+ * Returns ID of the path, emitting the path first if it is new in the session.
+ * The path event is emitted before its ID is shared, so it precedes events
+ * referring to it.
+ */
+static __always_inline uint64_t iotrace_path_id(
+        void *ctx,
+        struct iotrace_event_fs_path *ev,
+        long len) {
+    uint64_t hash, id, *cached;
+    uint32_t size;
+
+    /*
+     * Length returned by bpf_d_path() includes the terminating null, it is
+     * negative on error
+     */
+    if (len <= 1 || len > IOTRACE_EVENT_FS_PATH_SIZE) {
+        return 0;
+    }
+    ev->len = len - 1;
+
+    hash = iotrace_path_hash(ev->path, ev->len);
+    cached = bpf_map_lookup_elem(&path_cache_map, &hash);
+    if (cached) {
+        return *cached;
+    }
+
+    id = __sync_add_and_fetch(&path_id, 1);
+    ev->path_id = id;
+
+    size = offsetof(struct iotrace_event_fs_path, path) + ((len + 7) & ~7);
+    if (size > sizeof(*ev)) {
+        size = sizeof(*ev);
+    }
+
+    iotrace_event_init_hdr(&ev->hdr, iotrace_event_type_fs_path,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           size);
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, ev, size);
+
+    bpf_map_update_elem(&path_cache_map, &hash, &id, BPF_ANY);
+    return id;
+}
+
+/*
+ * Resolves the full path of the opened file once per file ID, instead of
+ * emitting names of the file and its ancestors. bpf_d_path() is allowed in
+ * security_file_open(), which is called by do_dentry_open().
+ */
+SEC("fentry/security_file_open")
+int BPF_PROG(open_path, struct file *file) {
+    struct iotrace_event_fs_file_path file_ev = {};
+    struct iotrace_event_fs_path *ev;
+    struct inode *inode = file->f_inode;
+    uint32_t index = 0;
+    long len;
+
+    if (!capture_file_paths || !inode || !iotrace_inode_bdev(inode)) {
+        return 0;
+    }
+
+    if (iotrace_inode_is_traced(inode)) {
+        return 0;
+    }
+
+    ev = bpf_map_lookup_elem(&path_buffer, &index);
+    if (!ev) {
+        return 0;
+    }
+
+    len = bpf_d_path(&file->f_path, ev->path, sizeof(ev->path));
+    file_ev.path_id = iotrace_path_id(ctx, ev, len);
+    if (!file_ev.path_id) {
+        return 0;
+    }
+
+    iotrace_inode_set_traced(inode);
+
+    iotrace_fs_file_id(inode, &file_ev.partition_id, &file_ev.file_id);
+    /* As in file system metadata of IOs */
+    file_ev.partition_id = iotrace_inode_dev(inode);
+    iotrace_event_init_hdr(&file_ev.hdr, iotrace_event_type_fs_file_path,
+                           iotrace_event_get_seq_id(), iotrace_ktime_get_ns(),
+                           sizeof(file_ev));
+    bpf_perf_event_output(ctx, &events, BPF_F_CURRENT_CPU, &file_ev,
+                          sizeof(file_ev));
+
+    return 0;
+}
@@ -12,4 +12,44 @@
 #define MINOR(dev) ((unsigned int) ((dev) &MINORMASK))
 #define MKDEV(ma, mi) (((ma) << MINORBITS) | (mi))
 
+/* Maximum number of traced devices */
+#define IOTRACE_DEVICE_MAX 32
+
+/*
+ * Device is being removed from tracing. New IOs are not traced anymore, but
+ * completions of IOs in flight still are.
+ */
+#define IOTRACE_DEVICE_FLAG_REMOVED (1U << 0)
+
+/*
+ * Insertion into the IO scheduler and dispatch to the device of requests are
+ * traced, so the IO latency can be split into queue and device time
+ */
+#define IOTRACE_DEVICE_FLAG_RQ_TIME (1U << 1)
+
+/*
+ * Split, merge and remap of bios are traced, so IOs of stacked devices can be
+ * linked across layers
+ */
+#define IOTRACE_DEVICE_FLAG_BIO_EVENTS (1U << 2)
+
+/*
+ * Hardware queue, submission and completion CPU of requests are traced, so
+ * IOs can be attributed to hardware queues and IRQ affinity
+ */
+#define IOTRACE_DEVICE_FLAG_HW_QUEUE (1U << 3)
+
+/*
+ * Process, thread and cgroup submitting IOs are traced, names of processes
+ * and cgroups are emitted once per session
+ */
+#define IOTRACE_DEVICE_FLAG_PROCESS (1U << 4)
+
+/* Value of the traced devices map, keyed by device id */
+struct iotrace_device_info {
+    /* Slow IO latency threshold in ns, zero traces all IO */
+    uint64_t slow_ns;
+    uint32_t flags;
+};
+
 #endif /* SOURCE_USERSPACE_IOTRACE_BPF_COMMON_H_ */
@@ -53,6 +53,12 @@
 #define S_ISDIR(m) (((m) &S_IFMT) == S_IFDIR)
 #define S_ISBLK(m) (((m) &S_IFMT) == S_IFBLK)
 
+/* File was created by open */
+#define FMODE_CREATED 0x100000
+
+/* Rename exchanges the source and the target */
+#define RENAME_EXCHANGE (1 << 1)
+
 /*
  * BIO definitions
  */
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SOURCE_USERSPACE_IOTRACE_EVENT_COMPACT_H_
+#define SOURCE_USERSPACE_IOTRACE_EVENT_COMPACT_H_
+
+#include "iotrace_event.h"
+
+/*
+ * iotrace compact events
+ *
+ * These events carry several regular iotrace_event_* events in one, so the
+ * eBPF program emits fewer and smaller perf samples. They never reach OCTF
+ * trace rings. Userspace expands them into the regular events before pushing,
+ * so traces keep the OCTF format and parsers read them unchanged.
+ */
+
+/** First type of compact event, below extension events (0x1000) */
+#define IOTRACE_EVENT_TYPE_COMPACT_BASE 0x800
+
+typedef enum {
+    /** IO event with file system metadata of a data IO to a regular file */
+    iotrace_event_type_io_fs = IOTRACE_EVENT_TYPE_COMPACT_BASE,
+
+    /** Completions of all bios of a request */
+    iotrace_event_type_io_cmpl_rq,
+} iotrace_event_compact_type;
+
+struct iotrace_event_io_fs {
+    /**
+     * IO event. Its header type is iotrace_event_type_io_fs and its size is
+     * the size of this event. The sequence ID of the expanded
+     * iotrace_event_fs_meta is the IO sequence ID plus one.
+     */
+    struct iotrace_event io;
+
+    /** Fields of iotrace_event_fs_meta which refers to this IO */
+    struct iotrace_event_file_id file_id;
+
+    /** File offset in sectors */
+    uint64_t file_offset;
+
+    /** File size in sectors */
+    uint64_t file_size;
+
+    /** Partition ID */
+    uint64_t partition_id;
+} __attribute__((packed, aligned(8)));
+
+/** Maximum number of bio completions in iotrace_event_io_cmpl_rq */
+#define IOTRACE_EVENT_CMPL_RQ_MAX 64
+
+/** Completion of one bio of a request */
+struct iotrace_event_io_cmpl_bio {
+    /** ID of the completed IO */
+    uint64_t ref_id;
+
+    /** Address of IO in sectors */
+    uint64_t lba;
+
+    /** Size of IO in sectors */
+    uint32_t len;
+
+    /** Error code of IO */
+    uint32_t error;
+} __attribute__((packed, aligned(8)));
+
+struct iotrace_event_io_cmpl_rq {
+    /**
+     * Trace event header, its size covers the used bio completions only. Each
+     * expanded iotrace_event_completion takes the next sequence ID, starting
+     * from the one in this header, and the timestamp of this header.
+     */
+    struct iotrace_event_hdr hdr;
+
+    /** Device ID */
+    uint32_t dev_id;
+
+    /** Number of bio completions */
+    uint32_t count;
+
+    struct iotrace_event_io_cmpl_bio bios[IOTRACE_EVENT_CMPL_RQ_MAX];
+} __attribute__((packed, aligned(8)));
+
+#endif /* SOURCE_USERSPACE_IOTRACE_EVENT_COMPACT_H_ */
@@ -0,0 +1,343 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SOURCE_USERSPACE_IOTRACE_EVENT_EXT_H_
+#define SOURCE_USERSPACE_IOTRACE_EVENT_EXT_H_
+
+#include "iotrace_event.h"
+
+/*
+ * iotrace extension events
+ *
+ * These events carry information which has no counterpart in the OCTF trace
+ * format. They are produced by the eBPF program next to the regular
+ * iotrace_event_* events, but they are not pushed into OCTF trace rings.
+ * Instead, userspace stores them in the trace extension file (iotrace.ext)
+ * which is placed in the trace directory. Extension events refer to the
+ * regular IO events by sequence ID.
+ */
+
+/** First type of extension event, must not collide with iotrace_event_type */
+#define IOTRACE_EVENT_TYPE_EXT_BASE 0x1000
+
+typedef enum {
+    /** IO context captured at submission */
+    iotrace_event_type_io_ctx = IOTRACE_EVENT_TYPE_EXT_BASE,
+
+    /** Dispatch of a request to the device */
+    iotrace_event_type_rq_issue,
+
+    /** Split of an IO */
+    iotrace_event_type_bio_split,
+
+    /** Merge of an IO into a request */
+    iotrace_event_type_bio_merge,
+
+    /** Remap of an IO from a partition or a stacked device */
+    iotrace_event_type_bio_remap,
+
+    /** Completion of a request by a hardware queue */
+    iotrace_event_type_rq_hw_queue,
+
+    /** Process and cgroup submitting an IO */
+    iotrace_event_type_io_process,
+
+    /** Name of a thread, emitted once per thread */
+    iotrace_event_type_process_name,
+
+    /** Name of a cgroup, emitted once per cgroup */
+    iotrace_event_type_cgroup_name,
+
+    /** Truncation of a file */
+    iotrace_event_type_fs_truncate,
+
+    /** Full path of a file, emitted once per path */
+    iotrace_event_type_fs_path,
+
+    /** Path of a file, referring to the path by its ID */
+    iotrace_event_type_fs_file_path,
+} iotrace_event_ext_type;
+
+static inline int iotrace_event_is_ext(uint32_t type) {
+    return type >= IOTRACE_EVENT_TYPE_EXT_BASE;
+}
+
+struct iotrace_event_io_ctx {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /** Sequence ID of the IO event which this context belongs to */
+    log_sid_t ref_sid;
+
+    /** ID of the IO */
+    uint64_t ref_id;
+
+    /** Device ID */
+    uint64_t dev_id;
+
+    /** Number of IOs in flight to the device at submission, including this
+     * one */
+    uint32_t qd;
+
+    /** Reserved */
+    uint32_t reserved;
+} __attribute__((packed, aligned(8)));
+
+/** Maximum number of IOs in iotrace_event_rq_issue */
+#define IOTRACE_EVENT_RQ_IO_MAX 64
+
+struct iotrace_event_rq_issue {
+    /**
+     * Trace event header, its timestamp is the time of dispatching the request
+     * to the device. The size covers the used IO IDs only.
+     */
+    struct iotrace_event_hdr hdr;
+
+    /** Device ID */
+    uint64_t dev_id;
+
+    /** ID of the request */
+    uint64_t rq_id;
+
+    /**
+     * Time of inserting the request into the IO scheduler, zero if the
+     * request was dispatched without the IO scheduler
+     */
+    uint64_t insert_timestamp;
+
+    /** Number of IOs merged into the request */
+    uint32_t count;
+
+    /** Reserved */
+    uint32_t reserved;
+
+    /** IDs of IOs merged into the request */
+    uint64_t ref_ids[IOTRACE_EVENT_RQ_IO_MAX];
+} __attribute__((packed, aligned(8)));
+
+struct iotrace_event_bio_split {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /** ID of the new IO split off the front of the parent IO */
+    uint64_t ref_id;
+
+    /** ID of the parent IO, its remaining part is submitted again */
+    uint64_t parent_id;
+
+    /** Device ID */
+    uint64_t dev_id;
+
+    /** Address of the split off IO in sectors */
+    uint64_t lba;
+
+    /** Size of the split off IO in sectors */
+    uint32_t len;
+
+    /** Reserved */
+    uint32_t reserved;
+
+    /** Address of the remaining part of the parent IO in sectors */
+    uint64_t parent_lba;
+} __attribute__((packed, aligned(8)));
+
+struct iotrace_event_bio_merge {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /** ID of the IO merged into a request */
+    uint64_t ref_id;
+
+    /** Device ID */
+    uint64_t dev_id;
+
+    /** Address of IO in sectors */
+    uint64_t lba;
+
+    /** Size of IO in sectors */
+    uint32_t len;
+
+    /** Non-zero if the IO was merged at the front of the request */
+    uint32_t front;
+} __attribute__((packed, aligned(8)));
+
+struct iotrace_event_bio_remap {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /**
+     * ID of the remapped IO. Stacked devices remap clones of IOs, which have
+     * IDs of their own.
+     */
+    uint64_t ref_id;
+
+    /** Device ID after remap, the whole disk for partitions */
+    uint64_t dev_id;
+
+    /** Address of IO after remap in sectors */
+    uint64_t lba;
+
+    /** Size of IO in sectors */
+    uint32_t len;
+
+    /**
+     * Partition ID before remap, zero if the IO was not remapped from a
+     * partition. Kernel device numbers fit in 32 bits.
+     */
+    uint32_t from_partition_id;
+
+    /** Device ID before remap, the whole disk or the stacked device */
+    uint64_t from_dev_id;
+
+    /** Address of IO before remap in sectors */
+    uint64_t from_lba;
+} __attribute__((packed, aligned(8)));
+
+struct iotrace_event_rq_hw_queue {
+    /**
+     * Trace event header, its timestamp is the time of completing the
+     * request. The size covers the used IO IDs only.
+     */
+    struct iotrace_event_hdr hdr;
+
+    /** Device ID */
+    uint64_t dev_id;
+
+    /** Index of the hardware queue which served the request */
+    uint32_t hw_queue;
+
+    /** Number of IOs merged into the request */
+    uint32_t count;
+
+    /** CPU of the software queue the request was submitted on */
+    uint32_t submit_cpu;
+
+    /** CPU the request completed on */
+    uint32_t complete_cpu;
+
+    /** NUMA node of the submission CPU, -1 if unknown */
+    int32_t submit_node;
+
+    /** NUMA node of the completion CPU, -1 if unknown */
+    int32_t complete_node;
+
+    /** IDs of IOs merged into the request */
+    uint64_t ref_ids[IOTRACE_EVENT_RQ_IO_MAX];
+} __attribute__((packed, aligned(8)));
+
+struct iotrace_event_io_process {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /** Sequence ID of the IO event which this attribution belongs to */
+    log_sid_t ref_sid;
+
+    /** ID of the IO */
+    uint64_t ref_id;
+
+    /** Device ID */
+    uint64_t dev_id;
+
+    /**
+     * ID of the cgroup the IO is charged to. It is the cgroup of the owner
+     * of the pages for writeback, not of the flushing thread.
+     */
+    uint64_t cgroup_id;
+
+    /** ID of the thread submitting the IO */
+    uint32_t pid;
+
+    /** ID of the process submitting the IO */
+    uint32_t tgid;
+} __attribute__((packed, aligned(8)));
+
+/** Size of the thread name, as in the kernel */
+#define IOTRACE_EVENT_COMM_SIZE 16
+
+struct iotrace_event_process_name {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /** ID of the thread */
+    uint32_t pid;
+
+    /** ID of the process */
+    uint32_t tgid;
+
+    /** Name of the thread */
+    char comm[IOTRACE_EVENT_COMM_SIZE];
+} __attribute__((packed, aligned(8)));
+
+/** Maximum size of the cgroup name, longer names are truncated */
+#define IOTRACE_EVENT_CGROUP_NAME_SIZE 128
+
+struct iotrace_event_cgroup_name {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /** ID of the cgroup */
+    uint64_t cgroup_id;
+
+    /** ID of the parent cgroup, zero for the root cgroup */
+    uint64_t parent_id;
+
+    /** Name of the cgroup, its path is built from names of its ancestors */
+    char name[IOTRACE_EVENT_CGROUP_NAME_SIZE];
+} __attribute__((packed, aligned(8)));
+
+struct iotrace_event_fs_truncate {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /** Partition of the file system */
+    uint64_t partition_id;
+
+    /**
+     * File ID after truncation, truncation changes the inode change time, so
+     * it matches file IDs of following IOs
+     */
+    struct iotrace_event_file_id file_id;
+
+    /** New size of the file in sectors */
+    uint64_t file_size;
+} __attribute__((packed, aligned(8)));
+
+/** Maximum size of the file path with the terminating null, as PATH_MAX */
+#define IOTRACE_EVENT_FS_PATH_SIZE 4096
+
+struct iotrace_event_fs_path {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /** ID of the path, IDs are allocated from one for each trace */
+    uint64_t path_id;
+
+    /** Length of the path, without the terminating null */
+    uint32_t len;
+
+    uint32_t reserved;
+
+    /**
+     * Absolute path in the mount namespace of the process opening the file,
+     * the event is truncated to the path length rounded up to 8 bytes
+     */
+    char path[IOTRACE_EVENT_FS_PATH_SIZE];
+} __attribute__((packed, aligned(8)));
+
+struct iotrace_event_fs_file_path {
+    /** Trace event header */
+    struct iotrace_event_hdr hdr;
+
+    /** Partition of the file system, as in file system metadata of IOs */
+    uint64_t partition_id;
+
+    /** ID of the file */
+    struct iotrace_event_file_id file_id;
+
+    /** ID of the path, its fs_path event precedes this event */
+    uint64_t path_id;
+} __attribute__((packed, aligned(8)));
+
+#endif /* SOURCE_USERSPACE_IOTRACE_EVENT_EXT_H_ */
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SOURCE_USERSPACE_IOTRACE_FINGERPRINT_H_
+#define SOURCE_USERSPACE_IOTRACE_FINGERPRINT_H_
+
+#include <stdint.h>
+
+/*
+ * Binary format of the workload fingerprint
+ *
+ * The fingerprint holds statistics of the workload of traced devices, which
+ * are enough to reproduce it with fio, and no file names or LBAs. The file is
+ * a header followed by one record per device, in little endian.
+ *
+ * Shares and other fractional values are fixed point numbers in units of
+ * 1/IOTRACE_FINGERPRINT_SCALE.
+ */
+
+/** Magic number of the header, "IOTF" */
+#define IOTRACE_FINGERPRINT_MAGIC 0x46544f49
+
+#define IOTRACE_FINGERPRINT_VERSION 1
+
+#define IOTRACE_FINGERPRINT_SCALE 10000
+
+/** IO size buckets, bucket i holds sizes up to 512 << i, the last larger */
+#define IOTRACE_FINGERPRINT_SIZE_BUCKETS 13
+
+/** Inter-arrival buckets, bucket i holds gaps up to 1024 << i ns, the last
+ * longer */
+#define IOTRACE_FINGERPRINT_GAP_BUCKETS 24
+
+#define IOTRACE_FINGERPRINT_NAME_MAX 32
+
+enum iotrace_fingerprint_direction {
+    iotrace_fingerprint_read,
+    iotrace_fingerprint_write,
+    iotrace_fingerprint_direction_count,
+};
+
+struct iotrace_fingerprint_hdr {
+    /** IOTRACE_FINGERPRINT_MAGIC */
+    uint32_t magic;
+
+    /** IOTRACE_FINGERPRINT_VERSION */
+    uint16_t version;
+
+    /** Number of device records following the header */
+    uint16_t device_count;
+} __attribute__((packed, aligned(8)));
+
+struct iotrace_fingerprint_device {
+    /** Name of the traced device, null terminated */
+    char name[IOTRACE_FINGERPRINT_NAME_MAX];
+
+    /** Size of the device in sectors */
+    uint64_t device_size;
+
+    /** Time between the first and the last IO in ns */
+    uint64_t duration;
+
+    /** Read and write IOs */
+    uint64_t io_count;
+
+    /** Bytes read and written */
+    uint64_t bytes;
+
+    /** Share of reads in IOs */
+    uint16_t read_share;
+
+    /** Shares of IO size buckets in IOs of each direction */
+    uint16_t size_shares[iotrace_fingerprint_direction_count]
+                        [IOTRACE_FINGERPRINT_SIZE_BUCKETS];
+
+    /** Shares of sequential bytes in bytes of each direction */
+    uint16_t sequential_shares[iotrace_fingerprint_direction_count];
+
+    /** Share of zones of the device accessed at least once */
+    uint16_t footprint;
+
+    /** Share of the device from its start to the last accessed zone */
+    uint16_t lba_span;
+
+    /** Exponent of the Zipf distribution of accesses to zones, zero if
+     * uniform */
+    uint16_t zipf_theta;
+
+    /** Average number of IOs in flight */
+    uint32_t queue_depth;
+
+    uint32_t max_queue_depth;
+
+    /** Mean time between submissions of IOs in ns */
+    uint64_t interarrival_mean;
+
+    /** Coefficient of variation of time between submissions */
+    uint32_t interarrival_cv;
+
+    /** Shares of inter-arrival buckets */
+    uint16_t interarrival_shares[IOTRACE_FINGERPRINT_GAP_BUCKETS];
+} __attribute__((packed, aligned(8)));
+
+#endif /* SOURCE_USERSPACE_IOTRACE_FINGERPRINT_H_ */
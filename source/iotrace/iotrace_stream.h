@@ -0,0 +1,56 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SOURCE_USERSPACE_IOTRACE_STREAM_H_
+#define SOURCE_USERSPACE_IOTRACE_STREAM_H_
+
+#include <stdint.h>
+
+/*
+ * Wire format of the live event stream
+ *
+ * The tracing process streams events to one local consumer at a time over a
+ * Unix stream socket. Events are sent in batches, each batch is a header
+ * followed by events. Every event starts with iotrace_event_hdr which holds
+ * its size. Events are the ones stored in trace files (iotrace_event.h) and
+ * in the trace extension file (iotrace_event_ext.h), compact events produced
+ * by eBPF programs are expanded before streaming.
+ *
+ * Device descriptions of traced devices are sent in the first batch after
+ * connecting. Events which do not fit into the stream buffer, because the
+ * consumer does not keep up, are dropped and counted.
+ */
+
+/** Path of the stream socket is SOCKET_DIR/<name> followed by this suffix */
+#define IOTRACE_STREAM_SOCKET_SUFFIX ".stream"
+
+/** Magic number of the batch header, "IOTS" */
+#define IOTRACE_STREAM_MAGIC 0x53544f49
+
+#define IOTRACE_STREAM_VERSION 1
+
+/** Maximum size of events of one batch */
+#define IOTRACE_STREAM_BATCH_MAX_SIZE (256 * 1024)
+
+struct iotrace_stream_batch {
+    /** IOTRACE_STREAM_MAGIC */
+    uint32_t magic;
+
+    /** IOTRACE_STREAM_VERSION */
+    uint16_t version;
+
+    uint16_t reserved;
+
+    /** Number of events following the header */
+    uint32_t count;
+
+    /** Size of events following the header in bytes */
+    uint32_t size;
+
+    /** Events dropped since the consumer connected */
+    uint64_t dropped;
+} __attribute__((packed, aligned(8)));
+
+#endif /* SOURCE_USERSPACE_IOTRACE_STREAM_H_ */
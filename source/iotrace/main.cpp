@@ -10,6 +10,7 @@
 #include <octf/interface/InterfaceTraceParsingImpl.h>
 #include <octf/utils/Exception.h>
 #include "InterfaceKernelTraceCreatingImpl.h"
+#include "InterfaceTraceExtensionParsingImpl.h"
 
 using namespace std;
 using namespace octf;
@@ -53,13 +54,17 @@ int main(int argc, char *argv[]) {
         InterfaceShRef iTraceParsing =
                 std::make_shared<InterfaceTraceParsingImpl>();
 
+        // Trace Extension Parsing Interface
+        InterfaceShRef iTraceExtensionParsing =
+                std::make_shared<InterfaceTraceExtensionParsingImpl>();
+
         // Configuration Interface for setting trace repository path
         InterfaceShRef iConfiguration =
                 std::make_shared<InterfaceConfigurationImpl>();
 
         // Add interfaces to executor
         ex.addModules(iTraceManagement, iKernelTarcing, iTraceParsing,
-                      iConfiguration);
+                      iTraceExtensionParsing, iConfiguration);
 
         // Execute command
         return ex.execute(argc, argv);
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2024 Solidigm All Rights Reserved
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Minimal consumer of the live event stream
+ *
+ * Connects to the stream of a running trace (iotrace -S ... --stream <name>)
+ * and prints the sequence ID, timestamp, type and size of each event until
+ * tracing ends. Prints counts of received and dropped events at the end.
+ * With --count only the counts are printed.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <octf/trace/iotrace_event.h>
+#include "../EventStreamClient.h"
+
+int main(int argc, char *argv[]) {
+    bool countOnly = argc == 3 && !std::strcmp(argv[2], "--count");
+    if (argc != 2 && !countOnly) {
+        std::fprintf(stderr, "Usage: %s <stream name> [--count]\n", argv[0]);
+        return 1;
+    }
+
+    try {
+        octf::EventStreamClient client(argv[1]);
+        uint64_t count = 0;
+
+        while (auto hdr = client.next()) {
+            count++;
+            if (!countOnly) {
+                std::printf("%lu %lu %u %u\n", (unsigned long) hdr->sid,
+                            (unsigned long) hdr->timestamp, hdr->type,
+                            hdr->size);
+            }
+        }
+
+        std::printf("events: %lu, dropped: %lu\n", (unsigned long) count,
+                    (unsigned long) client.getDroppedCount());
+    } catch (std::exception &e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import pytest
+
+from core.test_run import TestRun
+from test_tools.disk_utils import Filesystem
+from test_tools.fs_utils import write_file
+from test_utils.os_utils import sync
+from utils.iotrace import IotracePlugin
+
+mountpoint = "/mnt"
+
+
+@pytest.mark.parametrize("capture,fs_meta,file_names", [
+    ("block", False, False),
+    ("block+fs", True, False),
+    ("full", True, True),
+])
+def test_fs_capture(capture, fs_meta, file_names):
+    """
+        title: Captured events
+        description: |
+          Trace writes to files with each level of captured events and check
+          that the trace contains the file system events of the level only.
+        pass_criteria:
+          - No system crash.
+          - Trace contains IOs.
+          - File system metadata is traced with block+fs and full only.
+          - File names are traced with full only.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    try:
+        with TestRun.step("Create file system and mount device"):
+            disk.create_filesystem(Filesystem.ext4)
+            disk.mount(mountpoint)
+
+        with TestRun.step(f"Start tracing capturing {capture} events"):
+            iotrace.start_tracing([disk.system_path], capture=capture)
+
+        with TestRun.step("Write test files"):
+            for i in range(16):
+                write_file(f"{mountpoint}/test_file{i}", content="foo" * 4096)
+            sync()
+
+        with TestRun.step("Stop tracing"):
+            iotrace.stop_tracing()
+
+        with TestRun.step("Check traced events"):
+            trace_path = IotracePlugin.get_latest_trace_path()
+            events = IotracePlugin.get_trace_events(trace_path, raw=True)
+
+            if not any('io' in event for event in events):
+                TestRun.fail("Trace shall contain IOs")
+            if any('filesystemMeta' in event for event in events) != fs_meta:
+                TestRun.fail(f"File system metadata is {'not ' if fs_meta else ''}"
+                             f"expected capturing {capture} events")
+            if any('filesystemFileName' in event for event in events) != file_names:
+                TestRun.fail(f"File names are {'not ' if file_names else ''}"
+                             f"expected capturing {capture} events")
+    finally:
+        with TestRun.step("Unmount device"):
+            disk.unmount()
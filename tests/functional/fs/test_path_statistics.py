@@ -0,0 +1,82 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from core.test_run import TestRun
+from test_tools.disk_utils import Filesystem
+from test_tools.fs_utils import create_directory, write_file
+from test_utils.os_utils import sync
+from utils.iotrace import IotracePlugin
+
+mountpoint = "/mnt"
+
+
+def test_path_statistics():
+    """
+        title: Full paths of files
+        description: |
+          Trace writes to files in two directories capturing paths and check
+          that IOs are attributed to full paths of the files.
+        pass_criteria:
+          - No system crash.
+          - File names are not traced, paths are.
+          - IOs are attributed to the written files.
+          - Statistics are rolled up by directory and extension.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    try:
+        with TestRun.step("Create file system and mount device"):
+            disk.create_filesystem(Filesystem.ext4)
+            disk.mount(mountpoint)
+            create_directory(f"{mountpoint}/dir_a")
+            create_directory(f"{mountpoint}/dir_b")
+            sync()
+
+        with TestRun.step("Start tracing capturing paths"):
+            iotrace.start_tracing([disk.system_path], capture="paths")
+
+        with TestRun.step("Write test files"):
+            for directory in ["dir_a", "dir_b"]:
+                for i in range(4):
+                    write_file(f"{mountpoint}/{directory}/test_file{i}.x",
+                               content="foo" * 4096)
+            sync()
+
+        with TestRun.step("Stop tracing"):
+            iotrace.stop_tracing()
+
+        with TestRun.step("Check traced events"):
+            trace_path = IotracePlugin.get_latest_trace_path()
+            events = IotracePlugin.get_trace_events(trace_path, raw=True)
+            if any('filesystemFileName' in event for event in events):
+                TestRun.fail("File names are not expected capturing paths")
+
+        with TestRun.step("Check paths of IOs"):
+            output = IotracePlugin.get_path_statistics(trace_path, io=True)
+            paths = {entry['path'] for entry in output if 'lba' in entry}
+            for directory in ["dir_a", "dir_b"]:
+                for i in range(4):
+                    path = f"{mountpoint}/{directory}/test_file{i}.x"
+                    if path not in paths:
+                        TestRun.fail(f"No IOs attributed to {path}")
+
+        with TestRun.step("Check directory and extension statistics"):
+            summary = output[-1]
+            directories = {entry['path']: entry
+                           for entry in summary.get('directories', [])}
+            for directory in ["dir_a", "dir_b"]:
+                stats = directories.get(f"{mountpoint}/{directory}")
+                if not stats or int(stats.get('fileCount', 0)) != 4:
+                    TestRun.fail(f"Invalid statistics of {directory}, {stats}")
+                if int(stats.get('writeBytes', 0)) < 4 * 3 * 4096:
+                    TestRun.fail(f"Missing writes of {directory}, {stats}")
+            extensions = {entry['path']: entry
+                          for entry in summary.get('extensions', [])}
+            if int(extensions.get('x', {}).get('fileCount', 0)) != 8:
+                TestRun.fail(f"Invalid statistics of extension x, {extensions}")
+    finally:
+        with TestRun.step("Unmount device"):
+            disk.unmount()
@@ -0,0 +1,93 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=10)
+
+
+def run_workload(disk, read_write):
+    (Fio().create_command()
+          .io_engine(IoEngine.libaio)
+          .read_write(read_write)
+          .block_size(Size(4, Unit.KibiByte))
+          .direct()
+          .run_time(runtime)
+          .time_based()
+          .target(disk.system_path)
+          .run())
+
+
+def test_access_pattern():
+    """
+        title: Access pattern classification of IOs
+        description: |
+          Trace a sequential and then a random workload on the device. Check
+          that IOs of both workloads are classified, and that sequential
+          streams are detected.
+        pass_criteria:
+          - No system crash.
+          - Trace is complete.
+          - Each IO is classified on the device.
+          - Most bytes of the sequential workload are sequential.
+          - Most bytes of the random workload are random.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Start tracing"):
+        iotrace.start_tracing([disk.system_path])
+
+    with TestRun.step("Run sequential and random workload"):
+        run_workload(disk, ReadWrite.write)
+        run_workload(disk, ReadWrite.randwrite)
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Check trace summary"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        summary = IotracePlugin.get_trace_summary(trace_path)
+        if summary['state'] != "COMPLETE":
+            TestRun.fail("Trace is not complete")
+
+    with TestRun.step("Check access class of IOs"):
+        output = IotracePlugin.get_access_pattern(trace_path, io=True)
+        ios = [entry for entry in output if 'deviceClass' in entry]
+        if not ios:
+            TestRun.fail("No IOs classified")
+        for io in ios:
+            if io['deviceClass'] not in ['sequential', 'strided', 'random']:
+                TestRun.fail(f"Invalid access class of IO, {io}")
+
+    with TestRun.step("Check access pattern summary"):
+        devices = output[-1].get('devices', [])
+        if len(devices) != 1:
+            TestRun.fail(f"Expected one device in summary, {devices}")
+        stats = devices[0]['device']
+        counts = stats['ios']
+        classified = sum(int(counts.get(name, 0))
+                         for name in ['sequential', 'strided', 'random'])
+        # IOs are printed at completion, in flight IOs are only counted
+        if classified < len(ios):
+            TestRun.fail("Classified IOs do not sum up to printed IOs")
+
+        # Each workload runs for half of the traced time
+        total = sum(int(value) for value in stats['bytes'].values())
+        for name in ['sequential', 'random']:
+            share = int(stats['bytes'].get(name, 0)) / total
+            if share < 0.3:
+                TestRun.fail(f"Share of {name} bytes is {share:.2f}")
+
+        if int(stats['sequentialStreams'].get('count', 0)) < 1:
+            TestRun.fail("No sequential stream detected")
+        if not stats.get('intervals'):
+            TestRun.fail("No bytes per interval")
@@ -0,0 +1,166 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_tools.fs_utils import check_if_directory_exists
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=10)
+pin_path = "/sys/fs/bpf/iotrace"
+
+
+def run_workload(disk):
+    (Fio().create_command()
+          .io_engine(IoEngine.libaio)
+          .read_write(ReadWrite.randwrite)
+          .block_size(Size(4, Unit.KibiByte))
+          .direct()
+          .run_time(runtime)
+          .time_based()
+          .target(disk.system_path)
+          .run())
+
+
+def test_daemon():
+    """
+        title: Tracing with the tracing daemon
+        description: |
+          Start the tracing daemon and run several tracing sessions in it.
+          Check that eBPF programs stay pinned between sessions and are
+          unloaded when the daemon exits.
+        pass_criteria:
+          - No system crash.
+          - eBPF programs are pinned while the daemon is running.
+          - Each session produces a complete trace with IOs.
+          - eBPF programs are unpinned after the daemon exits.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Start tracing daemon"):
+        iotrace.start_daemon(unload=True)
+        if not check_if_directory_exists(pin_path):
+            TestRun.fail("eBPF programs are not pinned")
+
+    for session in range(2):
+        with TestRun.step(f"Run tracing session {session}"):
+            iotrace.start_tracing([disk.system_path])
+            run_workload(disk)
+            iotrace.stop_tracing()
+
+        with TestRun.step(f"Check trace of session {session}"):
+            trace_path = IotracePlugin.get_latest_trace_path()
+            summary = IotracePlugin.get_trace_summary(trace_path)
+            if summary['state'] != "COMPLETE":
+                TestRun.fail("Trace is not complete")
+
+            events = IotracePlugin.get_trace_events(trace_path, raw=True)
+            if not [event for event in events if 'io' in event]:
+                TestRun.fail("Trace shall contain IOs")
+
+        if not check_if_directory_exists(pin_path):
+            TestRun.fail("eBPF programs are not pinned after session")
+
+    with TestRun.step("Stop tracing daemon"):
+        iotrace.stop_daemon()
+        if check_if_directory_exists(pin_path):
+            TestRun.fail("eBPF programs are still pinned")
+
+
+def get_device_id(events, disk):
+    name = disk.system_path.split('/')[-1]
+    for event in events:
+        if event.get('deviceDescription', {}).get('name') == name:
+            return event['deviceDescription']['id']
+    TestRun.fail(f"Device {name} is not described in the trace")
+
+
+def test_daemon_concurrent_sessions():
+    """
+        title: Concurrent tracing sessions in the tracing daemon
+        description: |
+          Start the tracing daemon and run two tracing sessions in it at the
+          same time, each tracing a different device. Check that each trace
+          contains IOs of its own device only.
+        pass_criteria:
+          - No system crash.
+          - The second session starts while the first one is running.
+          - Each session produces a complete trace with IOs of its device.
+          - Traces contain no IOs of devices traced by the other session.
+          - Each session is controlled by PID of its client and lists its
+            own device only.
+          - Stopping a session by PID of its client leaves the other one
+            running.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disks = [TestRun.dut.disks[0], TestRun.dut.disks[1]]
+    sessions = [iotrace, IotracePlugin()]
+
+    with TestRun.step("Start tracing daemon"):
+        iotrace.start_daemon(unload=True)
+
+    with TestRun.step("Start tracing sessions"):
+        trace_count = IotracePlugin.get_trace_count()
+        for session, disk in zip(sessions, disks):
+            session.start_tracing([disk.system_path])
+            if not session.check_if_tracing_active():
+                TestRun.fail("Tracing session is not running")
+
+    with TestRun.step("Run workload on both devices"):
+        for disk in disks:
+            run_workload(disk)
+
+    with TestRun.step("Control each tracing session by PID"):
+        for session, disk in zip(sessions, disks):
+            devices = session.control_tracing()
+            if len(devices) != 1 or \
+                    devices[0]['name'] != disk.system_path.split('/')[-1]:
+                TestRun.fail(f"Session controls other devices: {devices}")
+
+    with TestRun.step("Stop the first tracing session by PID"):
+        sessions[0].stop_daemon_tracing()
+        if sessions[0].check_if_tracing_active():
+            TestRun.fail("Tracing session is still running")
+        if not sessions[1].check_if_tracing_active():
+            TestRun.fail("Other tracing session has been stopped")
+
+    with TestRun.step("Stop all tracing sessions"):
+        sessions[1].stop_daemon_tracing(all_sessions=True)
+        if sessions[1].check_if_tracing_active():
+            TestRun.fail("Tracing session is still running")
+
+    with TestRun.step("Check traces of sessions"):
+        traces = IotracePlugin.get_traces_list()[trace_count:]
+        if len(traces) != len(sessions):
+            TestRun.fail(f"Unexpected number of traces: {len(traces)}")
+
+        for trace in traces:
+            trace_path = trace['tracePath']
+            summary = IotracePlugin.get_trace_summary(trace_path)
+            if summary['state'] != "COMPLETE":
+                TestRun.fail("Trace is not complete")
+
+            events = IotracePlugin.get_trace_events(trace_path, raw=True)
+            traced = [disk for disk in disks
+                      if disk.system_path.split('/')[-1] in
+                      [event['deviceDescription']['name'] for event in events
+                       if 'deviceDescription' in event]]
+            if len(traced) != 1:
+                TestRun.fail("Trace shall describe one of the devices")
+            device_id = get_device_id(events, traced[0])
+
+            ios = [event for event in events if 'io' in event]
+            if not ios:
+                TestRun.fail("Trace shall contain IOs")
+            if [io for io in ios if io['io']['deviceId'] != device_id]:
+                TestRun.fail("Trace contains IOs of the other session")
+
+    with TestRun.step("Stop tracing daemon"):
+        iotrace.stop_daemon()
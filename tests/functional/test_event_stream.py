@@ -0,0 +1,76 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import time
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=10)
+stream_name = "test-stream"
+output_path = "/tmp/iotrace-stream-dump.txt"
+
+
+def test_event_stream():
+    """
+        title: Live event stream
+        description: |
+          Stream events of a workload to the stub consumer without writing
+          them to the trace and check that the consumer received its IOs.
+        pass_criteria:
+          - No system crash.
+          - Consumer receives device descriptions and IO events.
+          - IO events are not written to the trace.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Start tracing streaming events only"):
+        iotrace.start_tracing([disk.system_path], stream=stream_name,
+                              stream_only=True)
+
+    with TestRun.step("Connect stream consumer"):
+        # The stub consumer is built with iotrace, but not installed
+        dump = (f"{iotrace.working_dir}/standalone-linux-io-tracer/"
+                "build/release/source/iotrace/iotrace-stream-dump")
+        TestRun.executor.run_in_background(
+            f"{dump} {stream_name} > {output_path}")
+        time.sleep(1)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randwrite)
+              .block_size(Size(4, Unit.KibiByte))
+              .io_depth(16)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+        time.sleep(1)
+
+    with TestRun.step("Check streamed events"):
+        lines = TestRun.executor.run_expect_success(
+            f"cat {output_path}").stdout.splitlines()
+        if not lines or not lines[-1].startswith("events:"):
+            TestRun.fail("Stream did not end")
+        types = {int(line.split()[2]) for line in lines[:-1]}
+        # Device description and IO events
+        if 0 not in types or 1 not in types:
+            TestRun.fail(f"Missing events in stream, types {types}")
+
+    with TestRun.step("Check trace has no IOs"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        events = IotracePlugin.get_trace_events(trace_path)
+        if any('io' in event for event in events):
+            TestRun.fail("IOs written to trace while streaming only")
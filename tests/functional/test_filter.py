@@ -0,0 +1,86 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.output import CmdException
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=10)
+
+
+def get_counts(summary):
+    reads = sum(int(sample.get('readCount', 0)) for sample in summary.get('samples', []))
+    writes = sum(int(sample.get('writeCount', 0)) for sample in summary.get('samples', []))
+    return reads, writes
+
+
+def test_filter():
+    """
+        title: Filter expression of parser commands
+        description: |
+          Trace mixed reads and writes, and parse the trace with filter
+          expressions. Check that only IOs matching the expression are
+          counted, and that invalid expressions are rejected.
+        pass_criteria:
+          - No system crash.
+          - Filter of operation passes IOs of that operation only.
+          - IOs of complementary filters sum up to all IOs.
+          - Filter of another device passes no IOs.
+          - Invalid expression fails the command.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+    name = disk.system_path.split('/')[-1]
+
+    with TestRun.step("Trace workload"):
+        iotrace.start_tracing([disk.system_path])
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randrw)
+              .block_size(Size(4, Unit.KibiByte))
+              .io_depth(16)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+        iotrace.stop_tracing()
+        trace_path = IotracePlugin.get_latest_trace_path()
+
+    with TestRun.step("Filter by operation"):
+        reads, writes = get_counts(IotracePlugin.get_time_series([trace_path]))
+        if not reads or not writes:
+            TestRun.fail("Workload has no reads or no writes")
+
+        summary = IotracePlugin.get_time_series([trace_path],
+                                                filter_expression=f"dev=={name} && op==read")
+        if get_counts(summary) != (reads, 0):
+            TestRun.fail(f"Unexpected IOs of reads, {get_counts(summary)}")
+
+    with TestRun.step("Filter by latency"):
+        slow = get_counts(IotracePlugin.get_time_series(
+            [trace_path], filter_expression="lat>100us"))
+        fast = get_counts(IotracePlugin.get_time_series(
+            [trace_path], filter_expression="!(lat>100us)", shortcut=True))
+        if slow[0] + fast[0] != reads or slow[1] + fast[1] != writes:
+            TestRun.fail("Complementary filters do not sum up to all IOs")
+
+    with TestRun.step("Filter by another device"):
+        summary = IotracePlugin.get_time_series([trace_path],
+                                                filter_expression="dev==nodevice")
+        if get_counts(summary) != (0, 0):
+            TestRun.fail("IOs of another device passed the filter")
+
+    with TestRun.step("Reject invalid expression"):
+        try:
+            IotracePlugin.get_time_series([trace_path], filter_expression="op>read")
+            TestRun.fail("Invalid expression was accepted")
+        except CmdException:
+            pass
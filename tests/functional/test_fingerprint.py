@@ -0,0 +1,98 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=20)
+output_path = "/tmp/iotrace_workload"
+tolerance = 0.1
+
+
+def get_device(summary, name):
+    for device in summary.get('devices', []):
+        if device['name'] == name:
+            return device
+    TestRun.fail(f"No fingerprint of {name}")
+
+
+def compare_shares(original, replayed, key):
+    difference = abs(float(original.get(key, 0)) - float(replayed.get(key, 0)))
+    if difference > tolerance:
+        TestRun.fail(f"{key} of replayed workload differs by {difference}")
+
+
+def compare_sizes(original, replayed, key):
+    for bucket, replayed_bucket in zip(original.get(key, []),
+                                       replayed.get(key, [])):
+        compare_shares(bucket, replayed_bucket, 'share')
+
+
+def test_fingerprint():
+    """
+        title: Workload fingerprint replayed by fio
+        description: |
+          Trace a workload and extract its fingerprint, as fio job file and
+          binary fingerprint. Replay the fio job file while tracing again and
+          check that fingerprint of the replayed workload matches.
+        pass_criteria:
+          - No system crash.
+          - Binary fingerprint reads back as the same fingerprint.
+          - Read share, IO size shares and sequential shares of the replayed
+            workload are within the tolerance of the original ones.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+    name = disk.system_path.split('/')[-1]
+
+    with TestRun.step("Trace workload"):
+        iotrace.start_tracing([disk.system_path])
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randrw)
+              .write_percentage(30)
+              .block_size(Size(4, Unit.KibiByte))
+              .io_depth(8)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+        iotrace.stop_tracing()
+
+    with TestRun.step("Get fingerprint of the trace"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        summary = IotracePlugin.get_fingerprint(trace_path, output=output_path)
+        original = get_device(summary, name)
+        if abs(float(original.get('readShare', 0)) - 0.7) > tolerance:
+            TestRun.fail(f"Unexpected read share, {original}")
+
+    with TestRun.step("Read binary fingerprint"):
+        loaded = IotracePlugin.get_fingerprint(
+            input_path=f"{output_path}.fingerprint")
+        if loaded != summary:
+            TestRun.fail("Binary fingerprint differs from the trace")
+
+    with TestRun.step("Trace workload replayed by fio"):
+        iotrace.start_tracing([disk.system_path])
+        TestRun.executor.run_expect_success(f"fio {output_path}.fio")
+        iotrace.stop_tracing()
+
+    with TestRun.step("Compare fingerprint of the replayed workload"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        replayed = get_device(IotracePlugin.get_fingerprint(trace_path), name)
+
+        compare_shares(original, replayed, 'readShare')
+        compare_shares(original, replayed, 'sequentialReadShare')
+        compare_shares(original, replayed, 'sequentialWriteShare')
+        compare_sizes(original, replayed, 'readSizes')
+        compare_sizes(original, replayed, 'writeSizes')
+
+        TestRun.executor.run(f"rm -f {output_path}.fio {output_path}.fingerprint")
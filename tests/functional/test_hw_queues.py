@@ -0,0 +1,88 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=20)
+
+
+def test_hw_queues():
+    """
+        title: Hardware queue and CPU attribution of IOs
+        description: |
+          Trace the device with hardware queue and check that IOs are
+          attributed to hardware queues and CPUs of their requests.
+        pass_criteria:
+          - No system crash.
+          - Trace is complete.
+          - Each IO is attributed to a hardware queue and CPUs.
+          - Hardware queue statistics match the IOs, including IOs completed
+            on another CPU than submitted on.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Start tracing with hardware queue"):
+        iotrace.start_tracing([disk.system_path], hw_queue=True)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randrw)
+              .block_size(Size(4, Unit.KibiByte))
+              .io_depth(32)
+              .num_jobs(4)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Check trace summary"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        summary = IotracePlugin.get_trace_summary(trace_path)
+        if summary['state'] != "COMPLETE":
+            TestRun.fail("Trace is not complete")
+
+    with TestRun.step("Check hardware queue of IOs"):
+        output = IotracePlugin.get_hw_queues(trace_path, io=True)
+        ios = [entry for entry in output if 'latency' in entry]
+        if not ios:
+            TestRun.fail("No IOs attributed to hardware queues")
+
+    with TestRun.step("Check hardware queue summary"):
+        devices = output[-1].get('devices', [])
+        if len(devices) != 1:
+            TestRun.fail(f"Expected one device in summary, {devices}")
+        device = devices[0]
+        queues = device.get('hwQueues', [])
+        if sum(int(queue.get('ioCount', 0)) for queue in queues) != len(ios):
+            TestRun.fail("IOs of hardware queues do not sum up to traced IOs")
+        for queue in queues:
+            index = int(queue.get('index', 0))
+            queue_ios = [io for io in ios if int(io.get('hwQueue', 0)) == index]
+            if int(queue.get('ioCount', 0)) != len(queue_ios):
+                TestRun.fail(f"IO count of hardware queue does not match IOs, {queue}")
+            if int(queue.get('maxDepth', 0)) < 1:
+                TestRun.fail(f"No queue depth of hardware queue, {queue}")
+            cross_cpu = [io for io in queue_ios
+                         if int(io.get('submitCpu', 0)) != int(io.get('completeCpu', 0))]
+            if int(queue.get('crossCpuCount', 0)) != len(cross_cpu):
+                TestRun.fail(f"Cross-CPU count does not match IOs, {queue}")
+            submit_cpus = {int(cpu) for cpu in queue.get('submitCpus', [])}
+            if not {int(io.get('submitCpu', 0)) for io in queue_ios} <= submit_cpus:
+                TestRun.fail(f"Submission CPUs of IOs are missing, {queue}")
+        fraction = float(device.get('crossCpuFraction', 0))
+        if fraction < 0 or fraction > 1:
+            TestRun.fail(f"Invalid cross-CPU completion fraction, {device}")
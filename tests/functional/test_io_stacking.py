@@ -0,0 +1,83 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=20)
+
+
+def test_io_stacking():
+    """
+        title: Split, merge and remap of IOs
+        description: |
+          Trace a disk with bio events while running a workload with large IOs
+          on its partition, and check that IOs of the partition are remapped
+          to the disk and large IOs are split.
+        pass_criteria:
+          - No system crash.
+          - Trace is complete.
+          - IOs of the partition are remapped to the disk by a constant offset.
+          - Large IOs are split.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Create partition"):
+        disk.create_partitions([Size(1, Unit.GibiByte), Size(1, Unit.GibiByte)])
+        partition = disk.partitions[1]
+
+    with TestRun.step("Start tracing with bio events"):
+        iotrace.start_tracing([disk.system_path], bio_events=True)
+
+    with TestRun.step("Run workload on partition"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.write)
+              .block_size(Size(4, Unit.MebiByte))
+              .io_depth(4)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(partition.system_path)
+              .run())
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Check trace summary"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        summary = IotracePlugin.get_trace_summary(trace_path)
+        if summary['state'] != "COMPLETE":
+            TestRun.fail("Trace is not complete")
+
+    with TestRun.step("Check remap of partition IOs"):
+        output = IotracePlugin.get_io_stacking(trace_path, io=True)
+        ios = [entry for entry in output if 'fromLba' in entry]
+        if not ios:
+            TestRun.fail("No remapped IOs")
+        remaps = output[-1].get('remaps', [])
+        if len(remaps) != 1:
+            TestRun.fail(f"Expected remap of one partition, {remaps}")
+        remap = remaps[0]
+        if remap['fromDeviceId'] != remap['deviceId'] or \
+                not int(remap.get('fromPartitionId', 0)):
+            TestRun.fail(f"Partition not recorded in its remap, {remap}")
+        if remap['minOffset'] != remap['maxOffset'] or \
+                int(remap['minOffset']) <= 0:
+            TestRun.fail(f"Partition offset is not constant, {remap}")
+        for io in ios:
+            if int(io['lba']) - int(io['fromLba']) != int(remap['minOffset']):
+                TestRun.fail(f"IO is not remapped by partition offset, {io}")
+
+    with TestRun.step("Check split of large IOs"):
+        devices = output[-1].get('devices', [])
+        if not any(int(device.get('splitCount', 0)) > 0 for device in devices):
+            TestRun.fail(f"No IOs split, {devices}")
@@ -0,0 +1,77 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=10)
+metrics_path = "/tmp/iotrace.prom"
+
+
+def read_metrics() -> dict:
+    output = TestRun.executor.run_expect_success(f"cat {metrics_path}")
+    lines = output.stdout.splitlines()
+    if not lines or lines[-1] != "# EOF":
+        TestRun.fail("Metrics file is incomplete")
+    return {line.rsplit(' ', 1)[0]: float(line.rsplit(' ', 1)[1])
+            for line in lines if not line.startswith('#')}
+
+
+def test_metrics():
+    """
+        title: Live metrics
+        description: |
+          Trace the device with the metrics file while running a workload
+          and check that metrics are updated while tracing.
+        pass_criteria:
+          - No system crash.
+          - Metrics are written while tracing.
+          - Written IOs and their latencies are counted for the device.
+          - Health of the tracer is reported.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+    name = disk.system_path.split('/')[-1]
+
+    with TestRun.step("Start tracing with metrics"):
+        iotrace.start_tracing([disk.system_path], metrics=metrics_path)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randwrite)
+              .block_size(Size(4, Unit.KibiByte))
+              .io_depth(16)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Check metrics while tracing"):
+        metrics = read_metrics()
+        ios = metrics.get(
+            f'iotrace_device_ios_total{{device="{name}",operation="write"}}', 0)
+        if not ios:
+            TestRun.fail(f"No writes counted for {name}")
+        count = metrics.get(
+            f'iotrace_device_latency_seconds_count{{device="{name}"}}', 0)
+        if not count:
+            TestRun.fail(f"No latencies counted for {name}")
+        if 'iotrace_cpu_seconds_total{mode="user"}' not in metrics:
+            TestRun.fail("No CPU time of the tracer")
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Check final metrics"):
+        metrics = read_metrics()
+        if f'iotrace_device_inflight_ios{{device="{name}"}}' not in metrics:
+            TestRun.fail("No queue depth of the device")
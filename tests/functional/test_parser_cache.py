@@ -0,0 +1,84 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=10)
+
+
+def get_cache_files(trace_dir):
+    output = TestRun.executor.run(
+        f'stat -c "%n %y" {trace_dir}/iotrace.cache.* 2>/dev/null')
+    return sorted(output.stdout.splitlines())
+
+
+def test_parser_cache():
+    """
+        title: Cache of parser results in the trace directory
+        description: |
+          Trace the device with the parser cache filled when tracing ends.
+          Check that cached results equal results of parsing, and that the
+          cache is invalidated when files of the trace change.
+        pass_criteria:
+          - No system crash.
+          - Cache files are written when tracing ends.
+          - Repeated queries return the same results.
+          - Results are parsed again after the trace changes.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Start tracing with the parser cache"):
+        iotrace.start_tracing([disk.system_path], cache=True)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randrw)
+              .block_size(Size(4, Unit.KibiByte))
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Check cache files of the trace"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        trace_dir = f'{IotracePlugin.get_trace_repository_path()}/{trace_path}'
+        cached = get_cache_files(trace_dir)
+        if len(cached) < 2:
+            TestRun.fail(f"Parser cache not filled when tracing ended: {cached}")
+
+    with TestRun.step("Check cached results"):
+        first = IotracePlugin.get_time_series([trace_path])
+        second = IotracePlugin.get_time_series([trace_path])
+        if first != second:
+            TestRun.fail("Cached time series differs from parsed one")
+        if not first.get('samples'):
+            TestRun.fail("Cached time series without samples")
+        if get_cache_files(trace_dir) != cached:
+            TestRun.fail("Cache rewritten although the trace did not change")
+
+        pattern = IotracePlugin.get_access_pattern(trace_path)
+        if pattern != IotracePlugin.get_access_pattern(trace_path):
+            TestRun.fail("Cached access pattern differs from parsed one")
+
+    with TestRun.step("Check invalidation of the cache"):
+        TestRun.executor.run_expect_success(
+            f"find {trace_dir} -maxdepth 1 -type f "
+            f"! -name 'iotrace.cache.*' -exec touch {{}} +")
+        if IotracePlugin.get_time_series([trace_path]) != first:
+            TestRun.fail("Time series of unchanged events differs")
+        if get_cache_files(trace_dir) == cached:
+            TestRun.fail("Cache not rewritten after the trace changed")
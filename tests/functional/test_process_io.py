@@ -0,0 +1,73 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=20)
+
+
+def test_process_io():
+    """
+        title: Process and cgroup attribution of IOs
+        description: |
+          Trace the device with process attribution while running a workload
+          and check that its IOs are attributed to the workload process.
+        pass_criteria:
+          - No system crash.
+          - Trace is complete.
+          - IOs are attributed to the workload process by its name.
+          - Filtering by the process name keeps its IOs only.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Start tracing with process attribution"):
+        iotrace.start_tracing([disk.system_path], process=True)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randread)
+              .block_size(Size(4, Unit.KibiByte))
+              .io_depth(16)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Check trace summary"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        summary = IotracePlugin.get_trace_summary(trace_path)
+        if summary['state'] != "COMPLETE":
+            TestRun.fail("Trace is not complete")
+
+    with TestRun.step("Check IOs of the workload process"):
+        output = IotracePlugin.get_process_io(trace_path)
+        processes = output[-1].get('processes', [])
+        fio = [p for p in processes if p.get('name', '').startswith('fio')]
+        if not fio:
+            TestRun.fail(f"No IOs attributed to fio, {processes}")
+        if not output[-1].get('cgroups', []):
+            TestRun.fail("No IOs attributed to cgroups")
+
+    with TestRun.step("Check filtering by process name"):
+        comm = fio[0]['name']
+        output = IotracePlugin.get_process_io(trace_path, io=True, comm=comm)
+        ios = [entry for entry in output if 'latency' in entry and 'pid' in entry]
+        if not ios:
+            TestRun.fail("No IOs of the filtered process")
+        for io in ios:
+            if io.get('comm') != comm:
+                TestRun.fail(f"IO of another process not filtered out, {io}")
@@ -0,0 +1,90 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=20)
+
+
+def test_request_latency():
+    """
+        title: Queue and device time of IOs
+        description: |
+          Trace the device with request time and an IO scheduler, and check
+          that latency of IOs is split into queue (Q2D) and device (D2C) time,
+          and that insertion into the scheduler (Q2I) is part of queue time.
+        pass_criteria:
+          - No system crash.
+          - Trace is complete.
+          - Queue and device time of each IO sum up to its latency.
+          - Insertion of each IO into the scheduler precedes its dispatch.
+          - Device summary counts IOs, inserted IOs and their times.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Set IO scheduler"):
+        name = TestRun.executor.run_expect_success(
+            f"basename $(readlink -f {disk.system_path})").stdout.strip()
+        TestRun.executor.run_expect_success(
+            f"echo mq-deadline > /sys/block/{name}/queue/scheduler")
+
+    with TestRun.step("Start tracing with request time"):
+        iotrace.start_tracing([disk.system_path], request_time=True)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randrw)
+              .block_size(Size(4, Unit.KibiByte))
+              .io_depth(32)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Check trace summary"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        summary = IotracePlugin.get_trace_summary(trace_path)
+        if summary['state'] != "COMPLETE":
+            TestRun.fail("Trace is not complete")
+
+    with TestRun.step("Check queue and device time of IOs"):
+        output = IotracePlugin.get_request_latency(trace_path, io=True)
+        ios = [entry for entry in output if 'latency' in entry]
+        if not ios:
+            TestRun.fail("No IOs with queue and device time")
+        for io in ios:
+            q2i = int(io.get('q2i', 0))
+            q2d = int(io.get('q2d', 0))
+            d2c = int(io.get('d2c', 0))
+            if q2d + d2c != int(io['latency']):
+                TestRun.fail(f"Queue and device time do not sum up to latency, {io}")
+            if q2i > q2d:
+                TestRun.fail(f"IO inserted into scheduler after its dispatch, {io}")
+
+    with TestRun.step("Check device summary"):
+        devices = output[-1].get('devices', [])
+        if len(devices) != 1:
+            TestRun.fail(f"Expected one device in summary, {devices}")
+        device = devices[0]
+        if int(device.get('ioCount', 0)) < len(ios):
+            TestRun.fail(f"IO count does not cover IOs, {device}")
+        inserted = len([io for io in ios if int(io.get('q2i', 0)) > 0])
+        if inserted == 0 or int(device.get('insertedCount', 0)) != inserted:
+            TestRun.fail(f"Inserted count does not match IOs, {device}")
+        for time in ['q2d', 'd2c']:
+            if int(device[time].get('count', 0)) != len(ios):
+                TestRun.fail(f"Statistics of {time} do not match IOs, {device}")
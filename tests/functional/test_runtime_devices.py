@@ -0,0 +1,105 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import time
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=10)
+
+
+def run_workload(disk):
+    (Fio().create_command()
+          .io_engine(IoEngine.libaio)
+          .read_write(ReadWrite.randwrite)
+          .block_size(Size(4, Unit.KibiByte))
+          .direct()
+          .run_time(runtime)
+          .time_based()
+          .target(disk.system_path)
+          .run())
+
+
+def get_device_id(events, disk):
+    name = disk.system_path.split('/')[-1]
+    for event in events:
+        if event.get('deviceDescription', {}).get('name') == name:
+            return event['deviceDescription']['id']
+    TestRun.fail(f"Device {name} is not described in the trace")
+
+
+def test_runtime_devices():
+    """
+        title: Add and remove traced devices while tracing
+        description: |
+          Start tracing one device, add the second one to the running tracing,
+          then remove the first one. Check that the trace describes both
+          devices and contains IOs of each device while it was traced.
+        pass_criteria:
+          - No system crash.
+          - Trace is complete.
+          - Traced device list is updated after each control command.
+          - Trace contains IOs of the added device.
+          - Trace contains no IOs of the removed device submitted after
+            its removal.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    first = TestRun.dut.disks[0]
+    second = TestRun.dut.disks[1]
+
+    with TestRun.step("Start tracing the first device"):
+        iotrace.start_tracing([first.system_path])
+
+    with TestRun.step("Run workload on both devices"):
+        run_workload(first)
+        run_workload(second)
+
+    with TestRun.step("Add the second device to tracing"):
+        devices = iotrace.control_tracing(add=[second.system_path])
+        if len(devices) != 2:
+            TestRun.fail(f"Unexpected traced devices: {devices}")
+
+    with TestRun.step("Run workload on the second device"):
+        run_workload(second)
+
+    with TestRun.step("Remove the first device from tracing"):
+        devices = iotrace.control_tracing(remove=[first.system_path])
+        if len(devices) != 1:
+            TestRun.fail(f"Unexpected traced devices: {devices}")
+        time.sleep(1)
+
+    with TestRun.step("Run workload on the first device"):
+        run_workload(first)
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Check trace"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        summary = IotracePlugin.get_trace_summary(trace_path)
+        if summary['state'] != "COMPLETE":
+            TestRun.fail("Trace is not complete")
+
+        events = IotracePlugin.get_trace_events(trace_path, raw=True)
+        first_id = get_device_id(events, first)
+        second_id = get_device_id(events, second)
+
+        ios = [event for event in events if 'io' in event]
+        first_ios = [int(io['header']['timestamp']) for io in ios
+                     if io['io']['deviceId'] == first_id]
+        second_ios = [int(io['header']['timestamp']) for io in ios
+                      if io['io']['deviceId'] == second_id]
+        if not first_ios or not second_ios:
+            TestRun.fail("Trace shall contain IOs of both devices")
+
+        # The first device is removed after the last workload on the second
+        # one, so its IOs traced later were submitted after the removal
+        if max(first_ios) > max(second_ios):
+            TestRun.fail("IOs of the removed device traced after removal")
@@ -0,0 +1,63 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+slow_io_threshold = timedelta(milliseconds=1)
+runtime = timedelta(seconds=30)
+
+
+def test_slow_io():
+    """
+        title: Slow IO capture mode
+        description: |
+          Trace the device in slow IO mode and check that only IOs exceeding
+          the latency threshold are stored in the trace.
+        pass_criteria:
+          - No system crash.
+          - Trace is complete.
+          - Latency of each traced IO is not lower than the threshold.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Start tracing in slow IO mode"):
+        iotrace.start_tracing([disk.system_path], slow_io=slow_io_threshold)
+
+    with TestRun.step("Run workload with mixed queue depths"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randrw)
+              .block_size(Size(4, Unit.KibiByte))
+              .io_depth(128)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Check trace summary"):
+        trace_path = IotracePlugin.get_latest_trace_path()
+        summary = IotracePlugin.get_trace_summary(trace_path)
+        if summary['state'] != "COMPLETE":
+            TestRun.fail("Trace is not complete")
+
+    with TestRun.step("Check latency of traced IOs"):
+        threshold_ns = int(slow_io_threshold / timedelta(microseconds=1)) * 1000
+        events = IotracePlugin.get_trace_events(trace_path)
+        for event in events:
+            if 'io' not in event or 'latency' not in event['io']:
+                continue
+            if int(event['io']['latency']) < threshold_ns:
+                TestRun.fail(f"IO below slow IO threshold traced: {event}")
@@ -0,0 +1,107 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+segment_time = timedelta(seconds=5)
+runtime = timedelta(seconds=20)
+csv_path = "/tmp/iotrace_time_series.csv"
+
+
+def get_io_count(summary):
+    return sum(int(sample.get('readCount', 0)) + int(sample.get('writeCount', 0))
+               for sample in summary.get('samples', []))
+
+
+def test_time_series():
+    """
+        title: Time series of IO statistics across trace segments
+        description: |
+          Trace the device in segments and get statistics per interval of
+          all segments at once. Check that intervals of segments parsed in
+          parallel are merged, and that samples can be written as CSV.
+        pass_criteria:
+          - No system crash.
+          - Samples cover the duration of the workload.
+          - IOs of merged samples sum up to IOs of samples of each segment.
+          - Range of segments selects the kept segments of the session.
+          - CSV file has a header and a line per sample.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Start tracing in segments"):
+        iotrace.start_tracing([disk.system_path], segment_time=segment_time)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randrw)
+              .block_size(Size(4, Unit.KibiByte))
+              .io_depth(16)
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+
+    with TestRun.step("Get time series of all segments"):
+        segments = [trace for trace in IotracePlugin.get_traces_list()
+                    if 'segment.session' in trace.get('tags', {})]
+        latest = max({trace['tags']['segment.session'] for trace in segments},
+                     key=int)
+        paths = [trace['tracePath'] for trace in segments
+                 if trace['tags']['segment.session'] == latest]
+        if len(paths) < 2:
+            TestRun.fail(f"Unexpected number of segments: {len(paths)}")
+
+        summary = IotracePlugin.get_time_series(paths)
+        samples = summary.get('samples', [])
+        if len(samples) < runtime.total_seconds() - 2:
+            TestRun.fail(f"Samples do not cover the workload: {len(samples)}")
+
+        for sample in samples:
+            if float(sample.get('iops', 0)) <= 0:
+                TestRun.fail(f"Sample without IOs, {sample}")
+            if float(sample.get('queueDepth', 0)) <= 0:
+                TestRun.fail(f"Sample without queue depth, {sample}")
+            if int(sample.get('latency', {}).get('p99', 0)) <= 0:
+                TestRun.fail(f"Sample without latency, {sample}")
+
+    with TestRun.step("Compare with time series of each segment"):
+        count = sum(get_io_count(IotracePlugin.get_time_series([path]))
+                    for path in paths)
+        if count != get_io_count(summary):
+            TestRun.fail("IOs of merged samples differ from IOs of segments")
+
+    with TestRun.step("Select segments by range"):
+        summary_range = IotracePlugin.get_time_series([paths[0]],
+                                                      segments="0-")
+        if get_io_count(summary_range) != get_io_count(summary):
+            TestRun.fail("IOs of the range of all segments differ from IOs "
+                         "of the given segments")
+
+        first = IotracePlugin.get_time_series([paths[0]], segments="0")
+        if not 0 < get_io_count(first) < get_io_count(summary):
+            TestRun.fail("Range of a single segment selects other segments")
+
+    with TestRun.step("Write time series as CSV"):
+        summary = IotracePlugin.get_time_series(paths, csv=csv_path)
+        lines = TestRun.executor.run_expect_success(
+            f"cat {csv_path}").stdout.splitlines()
+        if not lines or not lines[0].startswith("start,device_id"):
+            TestRun.fail("CSV file has no header")
+        if len(lines) - 1 != int(summary['sampleCount']):
+            TestRun.fail("CSV file does not have a line per sample")
+        TestRun.executor.run(f"rm -f {csv_path}")
@@ -0,0 +1,85 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+runtime = timedelta(seconds=15)
+
+
+def trace_workload(iotrace, disk, io_depth):
+    iotrace.start_tracing([disk.system_path])
+    (Fio().create_command()
+          .io_engine(IoEngine.libaio)
+          .read_write(ReadWrite.randread)
+          .block_size(Size(4, Unit.KibiByte))
+          .io_depth(io_depth)
+          .direct()
+          .run_time(runtime)
+          .time_based()
+          .target(disk.system_path)
+          .run())
+    iotrace.stop_tracing()
+    return IotracePlugin.get_latest_trace_path()
+
+
+def get_device(summary, name):
+    for device in summary.get('devices', []):
+        if device['name'] == name:
+            return device
+    TestRun.fail(f"No difference of {name}")
+
+
+def test_trace_diff():
+    """
+        title: Comparison of traces
+        description: |
+          Trace the same workload at a low and a high queue depth, and compare
+          the traces. Check that differences of queue depth and latency are
+          found, and that a trace compared with itself has no differences.
+        pass_criteria:
+          - No system crash.
+          - Queue depth and latency of the second trace are higher.
+          - Latency shift is significant.
+          - Trace compared with itself has no changes.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+    name = disk.system_path.split('/')[-1]
+
+    with TestRun.step("Trace workload at low and high queue depth"):
+        baseline = trace_workload(iotrace, disk, 1)
+        compared = trace_workload(iotrace, disk, 32)
+
+    with TestRun.step("Compare traces"):
+        device = get_device(IotracePlugin.get_trace_diff(baseline, compared), name)
+        if float(device['queueDepth'].get('change', 0)) <= 0:
+            TestRun.fail(f"Queue depth did not increase, {device['queueDepth']}")
+        latency = device['latency']
+        if float(latency.get('medianChange', 0)) <= 0:
+            TestRun.fail(f"Latency did not increase, {latency}")
+        if not latency.get('significant', False):
+            TestRun.fail(f"Latency shift is not significant, {latency}")
+
+        classes = [io_class for io_class in device.get('classes', [])
+                   if io_class['operation'] == 'read' and io_class.get('allSizes')]
+        if len(classes) != 1:
+            TestRun.fail("No difference of reads")
+
+    with TestRun.step("Compare trace with itself"):
+        device = get_device(IotracePlugin.get_trace_diff(baseline, baseline, shortcut=True),
+                            name)
+        for metric in ['iops', 'queueDepth', 'bandwidth', 'hotShare']:
+            if float(device[metric].get('change', 0)) != 0:
+                TestRun.fail(f"{metric} of the same trace changed")
+        if float(device['latency'].get('distance', 0)) != 0:
+            TestRun.fail("Latency distribution of the same trace changed")
+        if float(device.get('hotnessDistance', 0)) != 0:
+            TestRun.fail("Hotness of the same trace changed")
@@ -0,0 +1,189 @@
+#
+# Copyright 2024 Solidigm All Rights Reserved
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+import time
+from datetime import timedelta
+
+from core.test_run import TestRun
+from test_tools.fio.fio import Fio
+from test_tools.fio.fio_param import IoEngine, ReadWrite
+from test_utils.size import Unit, Size
+from utils.iotrace import IotracePlugin
+
+segment_time = timedelta(seconds=5)
+retain_segments = 3
+runtime = timedelta(seconds=40)
+
+
+def test_trace_segments():
+    """
+        title: Trace rotation and retention
+        description: |
+          Trace the device in time based segments with a limited number of
+          retained segments. Check that the oldest segments are removed and
+          that each kept segment is a complete trace on its own.
+        pass_criteria:
+          - No system crash.
+          - Number of kept segments does not exceed the retention limit.
+          - Each kept segment is complete and contains IO events.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+
+    with TestRun.step("Start tracing in segments"):
+        iotrace.start_tracing([disk.system_path], segment_time=segment_time,
+                              retain_segments=retain_segments)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randwrite)
+              .block_size(Size(4, Unit.KibiByte))
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Stop tracing"):
+        iotrace.stop_tracing()
+        time.sleep(1)
+
+    with TestRun.step("Check kept segments"):
+        segments = [trace for trace in IotracePlugin.get_traces_list()
+                    if 'segment.session' in trace.get('tags', {})]
+        sessions = {trace['tags']['segment.session'] for trace in segments}
+        latest = max(sessions, key=int)
+        segments = [trace for trace in segments
+                    if trace['tags']['segment.session'] == latest]
+
+        if not 1 < len(segments) <= retain_segments:
+            TestRun.fail(f"Unexpected number of kept segments: {len(segments)}")
+
+        indexes = sorted(int(trace['tags']['segment.index']) for trace in segments)
+        if indexes[0] == 0:
+            TestRun.fail("The oldest segment has not been removed")
+
+    with TestRun.step("Parse each segment on its own"):
+        for trace in segments:
+            if trace['state'] != "COMPLETE":
+                TestRun.fail(f"Segment {trace['tracePath']} is not complete")
+
+            events = IotracePlugin.get_trace_events(trace['tracePath'])
+            if not any('io' in event for event in events):
+                TestRun.fail(f"No IO events in segment {trace['tracePath']}")
+
+
+def test_trace_segments_session_size():
+    """
+        title: Maximum size of a segmented trace
+        description: |
+          Trace the device in time based segments with a small maximum trace
+          size. Check that reaching the size stops tracing instead of
+          starting a new segment.
+        pass_criteria:
+          - No system crash.
+          - Tracing stops before the workload ends.
+          - Segments of the session together do not grow past the maximum
+            size by another segment.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+    max_size = Size(2, Unit.MebiByte)
+
+    with TestRun.step("Start tracing in segments"):
+        iotrace.start_tracing([disk.system_path], segment_time=segment_time,
+                              trace_file_size=max_size)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randwrite)
+              .block_size(Size(4, Unit.KibiByte))
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Check that tracing stopped"):
+        if iotrace.check_if_tracing_active():
+            iotrace.stop_tracing()
+            TestRun.fail("Tracing did not stop at the maximum size")
+
+    with TestRun.step("Check size of the session"):
+        segments = [trace for trace in IotracePlugin.get_traces_list()
+                    if 'segment.session' in trace.get('tags', {})]
+        latest = max({trace['tags']['segment.session'] for trace in segments},
+                     key=int)
+        repository = IotracePlugin.get_trace_repository_path()
+        paths = [f"{repository}/{trace['tracePath']}" for trace in segments
+                 if trace['tags']['segment.session'] == latest]
+
+        output = TestRun.executor.run_expect_success(
+            f"du -cb {' '.join(paths)} | tail -1")
+        size = int(output.stdout.split()[0])
+        # The trace extension is written beyond the limit of the last segment
+        if size > 2 * max_size.get_value(Unit.Byte):
+            TestRun.fail(f"Segments exceed the maximum size: {size}")
+
+
+def test_trace_segments_long_retention():
+    """
+        title: Maximum size of a segmented trace with retention
+        description: |
+          Trace the device in time based segments with a retention policy and
+          a maximum trace size smaller than all segments of the session.
+          Check that the size limits only the kept segments, so tracing goes
+          on while the oldest segments are removed.
+        pass_criteria:
+          - No system crash.
+          - Tracing is still active when the workload ends.
+          - Number of kept segments does not exceed the retention limit.
+          - Kept segments are the latest ones of the session.
+    """
+    iotrace: IotracePlugin = TestRun.plugins['iotrace']
+    disk = TestRun.dut.disks[0]
+    max_size = Size(2, Unit.MebiByte)
+
+    with TestRun.step("Start tracing in segments with retention"):
+        iotrace.start_tracing([disk.system_path], segment_time=segment_time,
+                              retain_segments=retain_segments,
+                              trace_file_size=max_size)
+
+    with TestRun.step("Run workload"):
+        (Fio().create_command()
+              .io_engine(IoEngine.libaio)
+              .read_write(ReadWrite.randwrite)
+              .block_size(Size(4, Unit.KibiByte))
+              .direct()
+              .run_time(runtime)
+              .time_based()
+              .target(disk.system_path)
+              .run())
+
+    with TestRun.step("Check that tracing is still active"):
+        if not iotrace.check_if_tracing_active():
+            TestRun.fail("Tracing stopped at the maximum size of the session")
+        iotrace.stop_tracing()
+        time.sleep(1)
+
+    with TestRun.step("Check kept segments"):
+        segments = [trace for trace in IotracePlugin.get_traces_list()
+                    if 'segment.session' in trace.get('tags', {})]
+        latest = max({trace['tags']['segment.session'] for trace in segments},
+                     key=int)
+        segments = [trace for trace in segments
+                    if trace['tags']['segment.session'] == latest]
+
+        if not 1 < len(segments) <= retain_segments:
+            TestRun.fail(f"Unexpected number of kept segments: {len(segments)}")
+
+        indexes = sorted(int(trace['tags']['segment.index']) for trace in segments)
+        # Segments are rotated by time or by size, whichever comes first
+        if indexes[-1] < runtime / segment_time - 2:
+            TestRun.fail(f"Tracing did not go on until the end: {indexes}")
+        if indexes != list(range(indexes[0], indexes[-1] + 1)):
+            TestRun.fail(f"Kept segments are not the latest ones: {indexes}")
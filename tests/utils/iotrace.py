@@ -34,6 +34,7 @@ class IotracePlugin:
         self.reinstall = False
 
         self.pid = None
+        self.daemon_pid = None
 
     def runtest_setup(self, item) -> object:
         try:
@@ -93,6 +94,19 @@ class IotracePlugin:
                       trace_file_size: Size = None,
                       timeout: timedelta = None,
                       label: str = None,
+                      slow_io: timedelta = None,
+                      segment_time: timedelta = None,
+                      retain_segments: int = None,
+                      capture: str = None,
+                      request_time: bool = False,
+                      bio_events: bool = False,
+                      hw_queue: bool = False,
+                      process: bool = False,
+                      stream: str = None,
+                      stream_only: bool = False,
+                      metrics: str = None,
+                      cache: bool = False,
+                      huge_pages: bool = False,
                       shortcut: bool = False):
         """
         Start tracing given block devices. Trace all available if none given.
@@ -103,12 +117,38 @@ class IotracePlugin:
         :param trace_file_size: Max size of trace file in MiB
         :param timeout: Max trace duration time in seconds
         :param label: User defined custom label
+        :param slow_io: Trace only IOs with latency above this threshold
+        :param segment_time: Cut trace into segments of this duration
+        :param retain_segments: Maximum number of kept trace segments
+        :param capture: Captured events: block, block+fs, full or paths
+        :param request_time: Trace insertion and dispatch of requests
+        :param bio_events: Trace split, merge and remap of IOs
+        :param hw_queue: Trace hardware queue and CPUs of requests
+        :param process: Trace process and cgroup submitting IOs
+        :param stream: Name of the live event stream
+        :param stream_only: Stream events without writing them to the trace
+        :param metrics: Path of the live metrics file
+        :param cache: Fill the parser cache of traces when tracing ends
+        :param huge_pages: Back growing trace buffers with huge pages
         :param shortcut: Use shorter command
         :type bdevs: list of strings
         :type buffer: Size
         :type trace_file_size: Size
         :type timeout: timedelta
         :type label: str
+        :type slow_io: timedelta
+        :type segment_time: timedelta
+        :type retain_segments: int
+        :type capture: str
+        :type request_time: bool
+        :type bio_events: bool
+        :type hw_queue: bool
+        :type process: bool
+        :type stream: str
+        :type stream_only: bool
+        :type metrics: str
+        :type cache: bool
+        :type huge_pages: bool
         :type shortcut: bool
         """
 
@@ -120,6 +160,7 @@ class IotracePlugin:
         buffer_range = range(1, 1025)
         trace_file_size_range = range(1, 100000001)
         timeout_range = range(1, 4294967296)
+        slow_io_range = range(0, 60000001)
 
         command = 'iotrace' + (' -S' if shortcut else ' --start-tracing')
         command += (' -d ' if shortcut else ' --devices ') + ','.join(bdevs)
@@ -145,6 +186,56 @@ class IotracePlugin:
         if label is not None:
             command += ' -l ' if shortcut else ' --label ' + f'{label}'
 
+        if slow_io is not None:
+            slow_io_us = int(slow_io / timedelta(microseconds=1))
+            if slow_io_us not in slow_io_range:
+                raise CmdException(f"Given slow IO threshold is out of range {slow_io_range}.")
+            command += ' -L ' if shortcut else ' --slow-io '
+            command += f'{slow_io_us}'
+
+        if segment_time is not None:
+            if not int(segment_time.total_seconds()) in timeout_range:
+                raise CmdException(f"Given segment time is out of range {timeout_range}.")
+            command += ' -i ' if shortcut else ' --segment-time '
+            command += f'{int(segment_time.total_seconds())}'
+
+        if retain_segments is not None:
+            command += ' -n ' if shortcut else ' --retain-segments '
+            command += f'{retain_segments}'
+
+        if capture is not None:
+            command += ' -c ' if shortcut else ' --capture '
+            command += f'{capture}'
+
+        if request_time:
+            command += ' -q' if shortcut else ' --request-time'
+
+        if bio_events:
+            command += ' -e' if shortcut else ' --bio-events'
+
+        if hw_queue:
+            command += ' -u' if shortcut else ' --hw-queue'
+
+        if process:
+            command += ' -P' if shortcut else ' --process'
+
+        if stream is not None:
+            command += ' -m ' if shortcut else ' --stream '
+            command += f'{stream}'
+
+        if stream_only:
+            command += ' -o' if shortcut else ' --stream-only'
+
+        if metrics is not None:
+            command += ' -x ' if shortcut else ' --metrics '
+            command += f'{metrics}'
+
+        if cache:
+            command += ' -a' if shortcut else ' --cache'
+
+        if huge_pages:
+            command += ' -H' if shortcut else ' --huge-pages'
+
         self.pid = str(TestRun.executor.run_in_background(command))
         TestRun.LOGGER.info("Started tracing of: " + ','.join(bdevs))
         # Make sure there's a >0 duration in all tests
@@ -207,6 +298,27 @@ class IotracePlugin:
 
         return True
 
+    def stop_daemon_tracing(self, all_sessions: bool = False,
+                            shortcut: bool = False):
+        """
+        Stop tracing session running in the tracing daemon
+
+        :param all_sessions: Stop all sessions instead of this one
+        :param shortcut: Use shorter command
+        :type all_sessions: bool
+        :type shortcut: bool
+        :raises Exception: when the command fails
+        """
+        command = 'iotrace' + (' -X' if shortcut else ' --stop-tracing')
+
+        if all_sessions:
+            command += ' -a' if shortcut else ' --all'
+        else:
+            command += (' -p ' if shortcut else ' --pid ') + self.pid
+
+        TestRun.executor.run_expect_success(command)
+        TestRun.executor.wait_cmd_finish(pid=self.pid, timeout=timedelta(seconds=60))
+
     def kill_tracing(self) -> bool:
         """
         Kill tracing.
@@ -232,6 +344,64 @@ class IotracePlugin:
 
         return True
 
+    def start_daemon(self, unload: bool = False, shortcut: bool = False):
+        """
+        Start tracing daemon which keeps eBPF programs loaded
+
+        :param unload: Unload eBPF programs when the daemon exits
+        :param shortcut: Use shorter command
+        :type unload: bool
+        :type shortcut: bool
+        """
+        command = 'iotrace' + (' -D' if shortcut else ' --daemon')
+
+        if unload:
+            command += ' -u' if shortcut else ' --unload'
+
+        self.daemon_pid = str(TestRun.executor.run_in_background(command))
+        TestRun.LOGGER.info("Started tracing daemon")
+        # Wait until eBPF programs are loaded and pinned
+        time.sleep(5)
+
+    def stop_daemon(self):
+        """
+        Stop tracing daemon
+        """
+        TestRun.LOGGER.info("Stopping tracing daemon")
+        TestRun.executor.run(f'kill -15 {self.daemon_pid}')
+        TestRun.executor.wait_cmd_finish(pid=self.daemon_pid,
+                                         timeout=timedelta(seconds=60))
+
+    def control_tracing(self,
+                        add: list = [],
+                        remove: list = [],
+                        shortcut: bool = False) -> list:
+        """
+        Add or remove traced devices of the running tracing
+
+        :param add: Block devices to be added to tracing
+        :param remove: Block devices to be removed from tracing
+        :param shortcut: Use shorter command
+        :type add: list of strings
+        :type remove: list of strings
+        :type shortcut: bool
+        :return: list of dictionaries with traced devices
+        :raises Exception: when the command fails
+        """
+        command = 'iotrace' + (' -T' if shortcut else ' --control-tracing')
+
+        if len(add):
+            command += (' -a ' if shortcut else ' --add-devices ') + ','.join(add)
+
+        if len(remove):
+            command += (' -r ' if shortcut else ' --remove-devices ') + ','.join(remove)
+
+        if self.pid is not None:
+            command += (' -p ' if shortcut else ' --pid ') + self.pid
+
+        output = parse_json(TestRun.executor.run_expect_success(command).stdout)
+        return output[0].get('device', [])
+
     @staticmethod
     def get_traces_list(prefix: str = None, shortcut: bool = False) -> list:
         """
@@ -474,6 +644,241 @@ class IotracePlugin:
         raise CmdException(f"No trace stats for device {dev_path}", output)
 
 
+    @staticmethod
+    def get_request_latency(trace_path: str, io: bool = False, shortcut: bool = False) -> list:
+        """
+        Get queue and device time of IOs of a trace captured with request time
+
+        :param trace_path: trace path
+        :param io: Include queue and device time of each IO
+        :param shortcut: Use shorter command
+        :type trace_path: str
+        :type io: bool
+        :type shortcut: bool
+        :return: IOs (if requested) followed by the summary of devices
+        :raises Exception: if the trace has no request events
+        """
+        return _run_parser('request-latency', 'Q', trace_path, io, shortcut)
+
+    @staticmethod
+    def get_io_stacking(trace_path: str, io: bool = False, shortcut: bool = False) -> list:
+        """
+        Get split, merge and remap statistics of a trace captured with bio events
+
+        :param trace_path: trace path
+        :param io: Include each remapped IO linked with the IO of the upper device
+        :param shortcut: Use shorter command
+        :type trace_path: str
+        :type io: bool
+        :type shortcut: bool
+        :return: Remapped IOs (if requested) followed by the summary
+        :raises Exception: if the trace has no bio events
+        """
+        return _run_parser('io-stacking', 'K', trace_path, io, shortcut)
+
+    @staticmethod
+    def get_hw_queues(trace_path: str, io: bool = False, shortcut: bool = False) -> list:
+        """
+        Get hardware queue statistics of a trace captured with hardware queue
+
+        :param trace_path: trace path
+        :param io: Include hardware queue and CPUs of each IO
+        :param shortcut: Use shorter command
+        :type trace_path: str
+        :type io: bool
+        :type shortcut: bool
+        :return: IOs (if requested) followed by the summary of devices
+        :raises Exception: if the trace has no hardware queue events
+        """
+        return _run_parser('hw-queues', 'W', trace_path, io, shortcut)
+
+    @staticmethod
+    def get_process_io(trace_path: str,
+                       io: bool = False,
+                       cgroup: str = None,
+                       pid: int = None,
+                       comm: str = None,
+                       shortcut: bool = False) -> list:
+        """
+        Get IO statistics per cgroup and process of a trace captured with process
+
+        :param trace_path: trace path
+        :param io: Include process and cgroup of each IO
+        :param cgroup: Only IOs of cgroups with the path starting with this prefix
+        :param pid: Only IOs of the process (or thread) with this ID
+        :param comm: Only IOs of threads with this name
+        :param shortcut: Use shorter command
+        :type trace_path: str
+        :type io: bool
+        :type cgroup: str
+        :type pid: int
+        :type comm: str
+        :type shortcut: bool
+        :return: IOs (if requested) followed by the summary
+        :raises Exception: if the trace has no process events
+        """
+        options = ''
+
+        if cgroup is not None:
+            options += (' -c ' if shortcut else ' --cgroup ') + f'{cgroup}'
+
+        if pid is not None:
+            options += (' -t ' if shortcut else ' --pid ') + f'{pid}'
+
+        if comm is not None:
+            options += (' -m ' if shortcut else ' --comm ') + f'{comm}'
+
+        return _run_parser('process-io', 'A', trace_path, io, shortcut, options)
+
+    @staticmethod
+    def get_path_statistics(trace_path: str, io: bool = False, shortcut: bool = False) -> list:
+        """
+        Get IO statistics per directory and file extension of a trace captured with paths
+
+        :param trace_path: trace path
+        :param io: Include path of the file of each IO
+        :param shortcut: Use shorter command
+        :type trace_path: str
+        :type io: bool
+        :type shortcut: bool
+        :return: IOs (if requested) followed by the summary
+        :raises Exception: if the trace has no file paths
+        """
+        return _run_parser('path-statistics', 'N', trace_path, io, shortcut)
+
+    @staticmethod
+    def get_access_pattern(trace_path: str,
+                           io: bool = False,
+                           interval: int = None,
+                           shortcut: bool = False) -> list:
+        """
+        Get sequential, strided and random IO of devices and files of a trace
+
+        :param trace_path: trace path
+        :param io: Include access class of each IO
+        :param interval: Length of intervals of bytes over time in seconds
+        :param shortcut: Use shorter command
+        :type trace_path: str
+        :type io: bool
+        :type interval: int
+        :type shortcut: bool
+        :return: IOs (if requested) followed by the summary
+        :raises Exception: if parsing failed
+        """
+        options = ''
+
+        if interval is not None:
+            options += (' -n ' if shortcut else ' --interval ') + f'{interval}'
+
+        return _run_parser('access-pattern', 'J', trace_path, io, shortcut,
+                           options)
+
+    @staticmethod
+    def get_time_series(trace_paths: list,
+                        interval: int = None,
+                        csv: str = None,
+                        filter_expression: str = None,
+                        segments: str = None,
+                        shortcut: bool = False) -> dict:
+        """
+        Get IO statistics of devices per interval of time
+
+        :param trace_paths: trace paths, e.g. segments of a tracing session
+        :param interval: Length of intervals in seconds
+        :param csv: Path of the CSV file to write samples into
+        :param filter_expression: Filter expression of IOs
+        :param segments: Range of kept segments of the session of the trace
+        :param shortcut: Use shorter command
+        :type trace_paths: list of strings
+        :type interval: int
+        :type csv: str
+        :type filter_expression: str
+        :type segments: str
+        :type shortcut: bool
+        :return: summary with samples, unless written to the CSV file
+        :raises Exception: if parsing failed
+        """
+        command = 'iotrace' + (' -Y' if shortcut else ' --time-series')
+        command += (' -p ' if shortcut else ' --path ') + ','.join(trace_paths)
+
+        if interval is not None:
+            command += (' -n ' if shortcut else ' --interval ') + f'{interval}'
+
+        if csv is not None:
+            command += (' -c ' if shortcut else ' --csv ') + f'{csv}'
+
+        if filter_expression is not None:
+            command += (' -f ' if shortcut else ' --filter ') + f'"{filter_expression}"'
+
+        if segments is not None:
+            command += (' -g ' if shortcut else ' --segments ') + f'{segments}'
+
+        output = TestRun.executor.run(command)
+        if output.exit_code != 0 or output.stdout == "":
+            raise CmdException("Invalid time series", output)
+
+        return parse_json(output.stdout)[-1]
+
+    @staticmethod
+    def get_fingerprint(trace_path: str = None,
+                        output: str = None,
+                        input_path: str = None,
+                        shortcut: bool = False) -> dict:
+        """
+        Get workload fingerprint of devices of the trace
+
+        :param trace_path: trace path
+        :param output: Prefix of fio job file and binary fingerprint to write
+        :param input_path: Path of binary fingerprint to read instead of trace
+        :param shortcut: Use shorter command
+        :type trace_path: str
+        :type output: str
+        :type input_path: str
+        :type shortcut: bool
+        :return: fingerprint of each device
+        :raises Exception: if parsing failed
+        """
+        command = 'iotrace' + (' -E' if shortcut else ' --fingerprint')
+
+        if trace_path is not None:
+            command += (' -p ' if shortcut else ' --path ') + f'{trace_path}'
+
+        if output is not None:
+            command += (' -o ' if shortcut else ' --output ') + f'{output}'
+
+        if input_path is not None:
+            command += (' -i ' if shortcut else ' --input ') + f'{input_path}'
+
+        output = TestRun.executor.run(command)
+        if output.exit_code != 0 or output.stdout == "":
+            raise CmdException("Invalid fingerprint", output)
+
+        return parse_json(output.stdout)[-1]
+
+    @staticmethod
+    def get_trace_diff(baseline_path: str, trace_path: str, shortcut: bool = False) -> dict:
+        """
+        Compare IO statistics of the trace with the baseline trace
+
+        :param baseline_path: trace path of the baseline
+        :param trace_path: trace path compared with the baseline
+        :param shortcut: Use shorter command
+        :type baseline_path: str
+        :type trace_path: str
+        :type shortcut: bool
+        :return: differences per device, operation and IO size class
+        :raises Exception: if parsing failed
+        """
+        command = 'iotrace' + (' -Z' if shortcut else ' --trace-diff')
+        command += (' -b ' if shortcut else ' --baseline ') + f'{baseline_path}'
+        command += (' -p ' if shortcut else ' --path ') + f'{trace_path}'
+
+        output = TestRun.executor.run(command)
+        if output.exit_code != 0 or output.stdout == "":
+            raise CmdException("Invalid trace diff", output)
+
+        return parse_json(output.stdout)[-1]
+
     @staticmethod
     def remove_traces(prefix: str, force: bool = False, shortcut: bool = False):
         """
@@ -554,6 +959,43 @@ class IotracePlugin:
         return version
 
 
+def _run_parser(command: str,
+                short: str,
+                trace_path: str,
+                io: bool,
+                shortcut: bool = False,
+                options: str = '') -> list:
+    """
+    Run parser command printing IOs (if requested) followed by the summary
+
+    :param command: Long key of the parser command, e.g. request-latency
+    :param short: Short key of the parser command, e.g. Q
+    :param trace_path: trace path
+    :param io: Include each IO
+    :param shortcut: Use shorter command
+    :param options: Further options of the command
+    :type command: str
+    :type short: str
+    :type trace_path: str
+    :type io: bool
+    :type shortcut: bool
+    :type options: str
+    :return: IOs (if requested) followed by the summary
+    :raises Exception: if parsing failed
+    """
+    cmd = 'iotrace' + (f' -{short}' if shortcut else f' --{command}')
+    cmd += (' -p ' if shortcut else ' --path ') + f'{trace_path}'
+
+    if io:
+        cmd += ' -i' if shortcut else ' --io'
+
+    output = TestRun.executor.run(cmd + options)
+    if output.exit_code != 0 or output.stdout == "":
+        raise CmdException(f"Invalid {command.replace('-', ' ')}", output)
+
+    return parse_json(output.stdout)
+
+
 def parse_json(output: str):
     """
     Parse a string with json messages to a list of python dictionaries